@@ -20,10 +20,96 @@ LOCAL_C_INCLUDES := \
     frameworks/av/include
 
 LOCAL_SRC_FILES := \
-    MtkCameraParameters.cpp
+    MtkCameraParameters.cpp \
+    MtkCameraBinary.cpp \
+    MtkCameraCapabilities.cpp \
+    MtkCameraSnapshot.cpp
+
+# The key table in MtkCameraKeys.h is built with C++14 constexpr
+LOCAL_CLANG := true
+LOCAL_CPPFLAGS := -std=gnu++14
 
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)
 LOCAL_MODULE := mtkcamera_parameters
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_STATIC_LIBRARY)
+
+# Frame formats, pools and dumps, pixel conversion, raw development, lens
+# shading, exposure fusion, face beauty and panorama stitching, kernels
+# per instruction set are picked at run time
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES := \
+    frameworks/av/include
+
+LOCAL_SRC_FILES := \
+    MtkBeautyNeon.cpp \
+    MtkBeautyX86.cpp \
+    MtkExposureFusion.cpp \
+    MtkFaceBeauty.cpp \
+    MtkFrameDump.cpp \
+    MtkFramePool.cpp \
+    MtkFusionNeon.cpp \
+    MtkFusionX86.cpp \
+    MtkImage.cpp \
+    MtkLensShading.cpp \
+    MtkPanorama.cpp \
+    MtkPanoramaNeon.cpp \
+    MtkPanoramaX86.cpp \
+    MtkPixelConvert.cpp \
+    MtkPixelConvertNeon.cpp \
+    MtkPixelConvertX86.cpp \
+    MtkRawProcessor.cpp \
+    MtkRawNeon.cpp \
+    MtkRawX86.cpp \
+    MtkShadingNeon.cpp \
+    MtkShadingX86.cpp \
+    MtkThreadPool.cpp
+
+LOCAL_CLANG := true
+LOCAL_CPPFLAGS := -std=gnu++14
+LOCAL_ARM_NEON := true
+
+LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)
+LOCAL_MODULE := mtkcamera_image
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_STATIC_LIBRARY)
+
+# Benchmarks, bench/<name>.cpp builds camera_<name>
+camera_benches := \
+    params_bench \
+    snapshot_stress \
+    validate_bench \
+    convert_bench \
+    raw_bench \
+    frame_pool_bench \
+    fusion_bench \
+    dump_bench \
+    beauty_bench \
+    shading_bench \
+    panorama_bench
+
+define camera-bench
+include $$(CLEAR_VARS)
+
+LOCAL_C_INCLUDES := \
+    $$(LOCAL_PATH) \
+    frameworks/av/include
+
+LOCAL_SRC_FILES := \
+    bench/$(1).cpp
+
+LOCAL_CLANG := true
+LOCAL_CPPFLAGS := -std=gnu++14
+LOCAL_STATIC_LIBRARIES := mtkcamera_image mtkcamera_parameters
+# libdl for params_bench, which interposes malloc to count allocations
+LOCAL_SHARED_LIBRARIES := libcamera_client libutils liblog libdl
+LOCAL_MODULE := camera_$(1)
+LOCAL_MODULE_TAGS := optional
+
+include $$(BUILD_EXECUTABLE)
+endef
+
+$(foreach bench,$(camera_benches),$(eval $(call camera-bench,$(bench))))
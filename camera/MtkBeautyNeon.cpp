@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_NEON
+
+#include <arm_neon.h>
+
+namespace android {
+
+// The same four rounding average chains as the scalar lerp8()
+static inline uint16x8_t lerp8(uint16x8_t a, uint16x8_t b, int eighths)
+{
+    uint16x8_t m = vrhaddq_u16(a, b);
+
+    switch (eighths) {
+    case 1:     return vrhaddq_u16(a, vrhaddq_u16(a, m));
+    case 3:     return vrhaddq_u16(m, vrhaddq_u16(a, m));
+    case 5:     return vrhaddq_u16(m, vrhaddq_u16(b, m));
+    default:    return vrhaddq_u16(b, vrhaddq_u16(b, m));
+    }
+}
+
+// Four rows of 16 pixels to their four block sums
+static inline uint16x4_t blockSums(const uint8_t *const y[4], int x)
+{
+    uint16x8_t pairs = vpaddlq_u8(vld1q_u8(y[0] + x));
+
+    for (int r = 1; r < 4; r++)
+        pairs = vpadalq_u8(pairs, vld1q_u8(y[r] + x));
+    return vmovn_u32(vpaddlq_u16(pairs));
+}
+
+static void downsampleNeon(const uint8_t *const y[4], uint16_t *out, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+        vst1q_u16(out + x, vcombine_u16(blockSums(y, 4 * x), blockSums(y, 4 * x + 16)));
+    if (x < width) {
+        const uint8_t *const rest[4] = { y[0] + 4 * x, y[1] + 4 * x, y[2] + 4 * x, y[3] + 4 * x };
+        kMtkBeautyScalar.downsample(rest, out + x, width - x);
+    }
+}
+
+static void downsampleVuNeon(const uint8_t *const vu[2], uint16_t *v, uint16_t *u, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x16x2_t a = vld2q_u8(vu[0] + 4 * x), b = vld2q_u8(vu[1] + 4 * x);
+        vst1q_u16(v + x, vpadalq_u8(vpaddlq_u8(a.val[0]), b.val[0]));
+        vst1q_u16(u + x, vpadalq_u8(vpaddlq_u8(a.val[1]), b.val[1]));
+    }
+    if (x < width) {
+        const uint8_t *const rest[2] = { vu[0] + 4 * x, vu[1] + 4 * x };
+        kMtkBeautyScalar.downsampleVu(rest, v + x, u + x, width - x);
+    }
+}
+
+static void lerpNeon(const uint16_t *a, const uint16_t *b, int eighths, uint16_t *out, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+        vst1q_u16(out + x, lerp8(vld1q_u16(a + x), vld1q_u16(b + x), eighths));
+    if (x < width)
+        kMtkBeautyScalar.lerp(a + x, b + x, eighths, out + x, width - x);
+}
+
+static void expand4Neon(const uint16_t *in, uint16_t *out, int width)
+{
+    int i = 0;
+
+    for (; i + 8 <= width / 4; i += 8) {
+        uint16x8_t p = vld1q_u16(in + i - 1), c = vld1q_u16(in + i), n = vld1q_u16(in + i + 1);
+        uint16x8x4_t o;
+
+        o.val[0] = lerp8(p, c, 5);
+        o.val[1] = lerp8(p, c, 7);
+        o.val[2] = lerp8(c, n, 1);
+        o.val[3] = lerp8(c, n, 3);
+        vst4q_u16(out + 4 * i, o);
+    }
+    if (4 * i < width)
+        kMtkBeautyScalar.expand4(in + i, out + 4 * i, width - 4 * i);
+}
+
+// a * y fits 16 bits as a is at most 256, the adds saturate like the scalar min()
+static inline uint8x8_t applied(uint8x8_t y, const uint16_t *a, const uint16_t *b)
+{
+    uint16x8_t v = vqaddq_u16(vmulq_u16(vld1q_u16(a), vmovl_u8(y)), vld1q_u16(b));
+    return vshrn_n_u16(vqaddq_u16(v, vdupq_n_u16(128)), 8);
+}
+
+static void applyNeon(const uint8_t *y, const uint16_t *a, const uint16_t *b, uint8_t *out,
+        int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t v = vld1q_u8(y + x);
+        vst1q_u8(out + x, vcombine_u8(applied(vget_low_u8(v), a + x, b + x),
+                applied(vget_high_u8(v), a + x + 8, b + x + 8)));
+    }
+    if (x < width)
+        kMtkBeautyScalar.apply(y + x, a + x, b + x, out + x, width - x);
+}
+
+// vrshr is the scalar "+ 8, then shift"
+static inline uint8x8_t sharpened(uint8x8_t c, uint8x8_t blur, int16_t amount)
+{
+    int16x8_t d = vmulq_n_s16(vreinterpretq_s16_u16(vsubl_u8(c, blur)), amount);
+    return vqmovun_s16(vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(c)), vrshrq_n_s16(d, 4)));
+}
+
+static void sharpenNeon(const uint8_t *const rows[3], uint8_t *tmp, uint8_t *out, int amount,
+        int width)
+{
+    int x;
+
+    for (x = -1; x + 16 <= width + 1; x += 16) {
+        vst1q_u8(tmp + x, vrhaddq_u8(vrhaddq_u8(vld1q_u8(rows[0] + x), vld1q_u8(rows[2] + x)),
+                vld1q_u8(rows[1] + x)));
+    }
+    for (; x <= width; x++)
+        tmp[x] = (((rows[0][x] + rows[2][x] + 1) >> 1) + rows[1][x] + 1) >> 1;
+
+    for (x = 0; x + 16 <= width; x += 16) {
+        uint8x16_t c = vld1q_u8(rows[1] + x);
+        uint8x16_t blur = vrhaddq_u8(vrhaddq_u8(vld1q_u8(tmp + x - 1), vld1q_u8(tmp + x + 1)),
+                vld1q_u8(tmp + x));
+        vst1q_u8(out + x, vcombine_u8(
+                sharpened(vget_low_u8(c), vget_low_u8(blur), amount),
+                sharpened(vget_high_u8(c), vget_high_u8(blur), amount)));
+    }
+    if (x < width) {
+        const uint8_t *const rest[3] = { rows[0] + x, rows[1] + x, rows[2] + x };
+        kMtkBeautyScalar.sharpen(rest, tmp + x, out + x, amount, width - x);
+    }
+}
+
+static void skinToneNeon(const uint8_t *vu, uint8_t *out, int level, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x2_t p = vld2_u8(vu + 2 * x);
+        uint16x8_t v = vmovl_u8(p.val[0]), u = vmovl_u8(p.val[1]);
+        uint16x8_t d = vaddq_u16(vabdq_u16(v, vdupq_n_u16(BEAUTY_SKIN_V)),
+                vabdq_u16(u, vdupq_n_u16(BEAUTY_SKIN_U)));
+        int16x8_t m = vsubq_s16(vdupq_n_s16(320), vshlq_n_s16(vreinterpretq_s16_u16(d), 3));
+
+        m = vminq_s16(vmaxq_s16(m, vdupq_n_s16(0)), vdupq_n_s16(255));
+        int16x8_t k = vreinterpretq_s16_u16(vshrq_n_u16(
+                vmulq_n_u16(vreinterpretq_u16_s16(m), level), 8));
+        int16x8_t sv = vreinterpretq_s16_u16(v), su = vreinterpretq_s16_u16(u);
+        int16x8_t tv = vmulq_s16(vsubq_s16(vdupq_n_s16(BEAUTY_TARGET_V), sv), k);
+        int16x8_t tu = vmulq_s16(vsubq_s16(vdupq_n_s16(BEAUTY_TARGET_U), su), k);
+
+        p.val[0] = vqmovun_s16(vaddq_s16(sv, vrshrq_n_s16(tv, 7)));
+        p.val[1] = vqmovun_s16(vaddq_s16(su, vrshrq_n_s16(tu, 7)));
+        vst2_u8(out + 2 * x, p);
+    }
+    if (x < width)
+        kMtkBeautyScalar.skinTone(vu + 2 * x, out + 2 * x, level, width - x);
+}
+
+const MtkBeautyKernels kMtkBeautyNeon = {
+    downsampleNeon,
+    downsampleVuNeon,
+    lerpNeon,
+    expand4Neon,
+    applyNeon,
+    sharpenNeon,
+    skinToneNeon,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_NEON
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_X86
+
+#include <emmintrin.h>
+
+namespace android {
+
+static inline __m128i load(const void *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void store(void *p, __m128i v)
+{
+    _mm_storeu_si128((__m128i *)p, v);
+}
+
+static inline __m128i abs16(__m128i v)
+{
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+// The same four rounding average chains as the scalar lerp8()
+static inline __m128i lerp8(__m128i a, __m128i b, int eighths)
+{
+    __m128i m = _mm_avg_epu16(a, b);
+
+    switch (eighths) {
+    case 1:     return _mm_avg_epu16(a, _mm_avg_epu16(a, m));
+    case 3:     return _mm_avg_epu16(m, _mm_avg_epu16(a, m));
+    case 5:     return _mm_avg_epu16(m, _mm_avg_epu16(b, m));
+    default:    return _mm_avg_epu16(b, _mm_avg_epu16(b, m));
+    }
+}
+
+// Four rows of 16 pixels to their four block sums
+static inline __m128i blockSums(const uint8_t *const y[4], int x)
+{
+    const __m128i zero = _mm_setzero_si128(), ones = _mm_set1_epi16(1);
+    __m128i lo = zero, hi = zero;
+
+    for (int r = 0; r < 4; r++) {
+        __m128i v = load(y[r] + x);
+        lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+        hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+    }
+    __m128i pairs = _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+    return _mm_madd_epi16(pairs, ones);
+}
+
+static void downsampleSse2(const uint8_t *const y[4], uint16_t *out, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+        store(out + x, _mm_packs_epi32(blockSums(y, 4 * x), blockSums(y, 4 * x + 16)));
+    if (x < width) {
+        const uint8_t *const rest[4] = { y[0] + 4 * x, y[1] + 4 * x, y[2] + 4 * x, y[3] + 4 * x };
+        kMtkBeautyScalar.downsample(rest, out + x, width - x);
+    }
+}
+
+// Eight VU pairs of two rows to four V U sums, interleaved in 32 bits
+static inline __m128i pairSums(const uint8_t *const vu[2], int x)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = load(vu[0] + x), b = load(vu[1] + x);
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+    lo = _mm_shuffle_epi32(_mm_add_epi16(lo, _mm_srli_si128(lo, 4)), _MM_SHUFFLE(3, 1, 2, 0));
+    hi = _mm_shuffle_epi32(_mm_add_epi16(hi, _mm_srli_si128(hi, 4)), _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+static void downsampleVuSse2(const uint8_t *const vu[2], uint16_t *v, uint16_t *u, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i a = pairSums(vu, 4 * x), b = pairSums(vu, 4 * x + 16);
+        store(v + x, _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                _mm_srai_epi32(_mm_slli_epi32(b, 16), 16)));
+        store(u + x, _mm_packs_epi32(_mm_srli_epi32(a, 16), _mm_srli_epi32(b, 16)));
+    }
+    if (x < width) {
+        const uint8_t *const rest[2] = { vu[0] + 4 * x, vu[1] + 4 * x };
+        kMtkBeautyScalar.downsampleVu(rest, v + x, u + x, width - x);
+    }
+}
+
+static void lerpSse2(const uint16_t *a, const uint16_t *b, int eighths, uint16_t *out, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+        store(out + x, lerp8(load(a + x), load(b + x), eighths));
+    if (x < width)
+        kMtkBeautyScalar.lerp(a + x, b + x, eighths, out + x, width - x);
+}
+
+static void expand4Sse2(const uint16_t *in, uint16_t *out, int width)
+{
+    int i = 0;
+
+    for (; i + 8 <= width / 4; i += 8) {
+        __m128i p = load(in + i - 1), c = load(in + i), n = load(in + i + 1);
+        __m128i o0 = lerp8(p, c, 5), o1 = lerp8(p, c, 7);
+        __m128i o2 = lerp8(c, n, 1), o3 = lerp8(c, n, 3);
+        __m128i lo01 = _mm_unpacklo_epi16(o0, o1), hi01 = _mm_unpackhi_epi16(o0, o1);
+        __m128i lo23 = _mm_unpacklo_epi16(o2, o3), hi23 = _mm_unpackhi_epi16(o2, o3);
+
+        store(out + 4 * i, _mm_unpacklo_epi32(lo01, lo23));
+        store(out + 4 * i + 8, _mm_unpackhi_epi32(lo01, lo23));
+        store(out + 4 * i + 16, _mm_unpacklo_epi32(hi01, hi23));
+        store(out + 4 * i + 24, _mm_unpackhi_epi32(hi01, hi23));
+    }
+    if (4 * i < width)
+        kMtkBeautyScalar.expand4(in + i, out + 4 * i, width - 4 * i);
+}
+
+// a * y fits 16 bits as a is at most 256, the adds saturate like the scalar min()
+static inline __m128i applied(__m128i y, const uint16_t *a, const uint16_t *b)
+{
+    __m128i v = _mm_adds_epu16(_mm_mullo_epi16(load(a), y), load(b));
+    return _mm_srli_epi16(_mm_adds_epu16(v, _mm_set1_epi16(128)), 8);
+}
+
+static void applySse2(const uint8_t *y, const uint16_t *a, const uint16_t *b, uint8_t *out,
+        int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = load(y + x);
+        store(out + x, _mm_packus_epi16(applied(_mm_unpacklo_epi8(v, zero), a + x, b + x),
+                applied(_mm_unpackhi_epi8(v, zero), a + x + 8, b + x + 8)));
+    }
+    if (x < width)
+        kMtkBeautyScalar.apply(y + x, a + x, b + x, out + x, width - x);
+}
+
+static inline __m128i sharpened(__m128i c, __m128i blur, __m128i amount)
+{
+    __m128i d = _mm_mullo_epi16(_mm_sub_epi16(c, blur), amount);
+    return _mm_add_epi16(c, _mm_srai_epi16(_mm_add_epi16(d, _mm_set1_epi16(8)), 4));
+}
+
+static void sharpenSse2(const uint8_t *const rows[3], uint8_t *tmp, uint8_t *out, int amount,
+        int width)
+{
+    const __m128i zero = _mm_setzero_si128(), k = _mm_set1_epi16(amount);
+    int x;
+
+    for (x = -1; x + 16 <= width + 1; x += 16) {
+        store(tmp + x, _mm_avg_epu8(_mm_avg_epu8(load(rows[0] + x), load(rows[2] + x)),
+                load(rows[1] + x)));
+    }
+    for (; x <= width; x++)
+        tmp[x] = (((rows[0][x] + rows[2][x] + 1) >> 1) + rows[1][x] + 1) >> 1;
+
+    for (x = 0; x + 16 <= width; x += 16) {
+        __m128i c = load(rows[1] + x);
+        __m128i blur = _mm_avg_epu8(_mm_avg_epu8(load(tmp + x - 1), load(tmp + x + 1)),
+                load(tmp + x));
+        store(out + x, _mm_packus_epi16(
+                sharpened(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(blur, zero), k),
+                sharpened(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(blur, zero), k)));
+    }
+    if (x < width) {
+        const uint8_t *const rest[3] = { rows[0] + x, rows[1] + x, rows[2] + x };
+        kMtkBeautyScalar.sharpen(rest, tmp + x, out + x, amount, width - x);
+    }
+}
+
+// Four VU pairs widened to 16 bits
+static inline __m128i toned(__m128i vu, __m128i level)
+{
+    const __m128i skin = _mm_set1_epi32(BEAUTY_SKIN_U << 16 | BEAUTY_SKIN_V);
+    const __m128i target = _mm_set1_epi32(BEAUTY_TARGET_U << 16 | BEAUTY_TARGET_V);
+    __m128i d = abs16(_mm_sub_epi16(vu, skin));
+
+    // |V - 152| + |U - 108| in both halves of each pair
+    d = _mm_add_epi16(d, _mm_or_si128(_mm_slli_epi32(d, 16), _mm_srli_epi32(d, 16)));
+    __m128i m = _mm_sub_epi16(_mm_set1_epi16(320), _mm_slli_epi16(d, 3));
+    m = _mm_min_epi16(_mm_max_epi16(m, _mm_setzero_si128()), _mm_set1_epi16(255));
+    __m128i k = _mm_srli_epi16(_mm_mullo_epi16(m, level), 8);
+    __m128i t = _mm_mullo_epi16(_mm_sub_epi16(target, vu), k);
+
+    return _mm_add_epi16(vu, _mm_srai_epi16(_mm_add_epi16(t, _mm_set1_epi16(64)), 7));
+}
+
+static void skinToneSse2(const uint8_t *vu, uint8_t *out, int level, int width)
+{
+    const __m128i zero = _mm_setzero_si128(), k = _mm_set1_epi16(level);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = load(vu + 2 * x);
+        store(out + 2 * x, _mm_packus_epi16(toned(_mm_unpacklo_epi8(v, zero), k),
+                toned(_mm_unpackhi_epi8(v, zero), k)));
+    }
+    if (x < width)
+        kMtkBeautyScalar.skinTone(vu + 2 * x, out + 2 * x, level, width - x);
+}
+
+const MtkBeautyKernels kMtkBeautySse2 = {
+    downsampleSse2,
+    downsampleVuSse2,
+    lerpSse2,
+    expand4Sse2,
+    applySse2,
+    sharpenSse2,
+    skinToneSse2,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_X86
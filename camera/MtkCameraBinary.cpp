@@ -0,0 +1,438 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MTKCameraParams"
+#include <utils/Log.h>
+
+#include <limits.h>
+#include <string.h>
+#include "MtkCameraBinary.h"
+
+namespace android {
+
+enum {
+    KIND_STRING = 0,
+    KIND_INT    = 1,
+    KIND_TABLE  = 2,
+};
+
+#define HEADER_SIZE     8
+#define STRING_MAX      0xffff
+
+bool mtkCameraNextEntry(const char **a, const char **key, size_t *keyLen,
+        const char **value, size_t *valueLen)
+{
+    const char *b = strchr(*a, '=');
+
+    if (b == 0)
+        return false;
+    *key = *a;
+    *keyLen = (size_t)(b - *a);
+    *value = b + 1;
+
+    b = strchr(*value, ';');
+    if (b == 0) {
+        *valueLen = strlen(*value);
+        *a = *value + *valueLen;
+    } else {
+        *valueLen = (size_t)(b - *value);
+        *a = b + 1;
+    }
+    return true;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Encoder
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static uint8_t *putVarint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint8_t *putU16(uint8_t *p, uint32_t v)
+{
+    *p++ = (uint8_t)v;
+    *p++ = (uint8_t)(v >> 8);
+    return p;
+}
+
+// Decimal integers that print back to the same text with "%d"
+static bool canonicalInt(const char *s, size_t len, int32_t *value)
+{
+    int64_t v = 0;
+    size_t i = 0;
+    bool negative = false;
+
+    if (len > 0 && s[0] == '-') {
+        negative = true;
+        i = 1;
+    }
+    if (i == len || len - i > 10)
+        return false;
+    // No leading zeroes and no "-0"
+    if (s[i] == '0' && (len - i > 1 || negative))
+        return false;
+    for (; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9')
+            return false;
+        v = v * 10 + (s[i] - '0');
+    }
+    if (negative)
+        v = -v;
+    if (v < INT_MIN || v > INT_MAX)
+        return false;
+    *value = (int32_t)v;
+    return true;
+}
+
+ssize_t MtkCameraBinaryWriter::addString(const char *s, size_t len)
+{
+    for (size_t i = 0; i < mStrings.size(); i++) {
+        const StringRef &r = mStrings.itemAt(i);
+        if (r.len == len && memcmp(r.s, s, len) == 0)
+            return i;
+    }
+
+    if (mBlobSize + len > STRING_MAX)
+        return -1;
+    StringRef r = { s, len };
+    mBlobSize += len;
+    return mStrings.add(r);
+}
+
+/*
+ * Entries are written past the largest string table there could be, and
+ * moved down once the table is known. Each entry takes at most three
+ * varints on top of its text.
+ */
+MtkCameraBinaryWriter::MtkCameraBinaryWriter(Vector<uint8_t> *out, size_t maxEntries,
+        size_t maxText)
+    : mOut(out),
+      mMaxEntries(maxEntries),
+      mMaxText(maxText),
+      mText(0),
+      mBlobSize(0),
+      mCount(0),
+      mError(NO_ERROR)
+{
+    size_t maxTable = 5 + 4 * maxEntries + 5 + maxText + 5;
+    out->resize(HEADER_SIZE + maxTable + maxText + 15 * maxEntries);
+    mEntries = out->editArray() + HEADER_SIZE + maxTable;
+    mPos = mEntries;
+}
+
+void MtkCameraBinaryWriter::add(MtkCameraKey id, const char *key, size_t keyLen,
+        const char *value, size_t valueLen)
+{
+    uint32_t ref = id == MTK_KEY_INVALID ? MTK_KEY_COUNT : id;
+    uint32_t kind = KIND_STRING;
+    int32_t number = 0;
+    ssize_t index = 0;
+    uint8_t *p = mPos;
+
+    if (mError != NO_ERROR)
+        return;
+    mText += keyLen + valueLen;
+    if (mCount == mMaxEntries || mText > mMaxText) {
+        mError = BAD_VALUE;
+        return;
+    }
+
+    if (canonicalInt(value, valueLen, &number)) {
+        kind = KIND_INT;
+    } else if (id != MTK_KEY_INVALID && mtkcamkeys::kKeys[id].type == MTK_KEY_TYPE_ENUM) {
+        index = addString(value, valueLen);
+        if (index < 0) {
+            mError = BAD_VALUE;
+            return;
+        }
+        kind = KIND_TABLE;
+    }
+
+    p = putVarint(p, ref << 2 | kind);
+    if (id == MTK_KEY_INVALID) {
+        p = putVarint(p, keyLen);
+        memcpy(p, key, keyLen);
+        p += keyLen;
+    }
+    if (kind == KIND_INT) {
+        p = putVarint(p, ((uint32_t)number << 1) ^ (uint32_t)(number >> 31));
+    } else if (kind == KIND_TABLE) {
+        p = putVarint(p, index);
+    } else {
+        p = putVarint(p, valueLen);
+        memcpy(p, value, valueLen);
+        p += valueLen;
+    }
+    mPos = p;
+    mCount++;
+}
+
+status_t MtkCameraBinaryWriter::finish()
+{
+    if (mError != NO_ERROR)
+        return mError;
+
+    size_t entriesSize = mPos - mEntries;
+    uint8_t *p = mOut->editArray();
+    memcpy(p, "MKP", 3);
+    p[3] = MTK_CAMERA_BINARY_VERSION;
+    p = putU16(p + 4, mtkcamkeys::kFingerprint);
+    p = putU16(p, mtkcamkeys::kFingerprint >> 16);
+
+    p = putVarint(p, mStrings.size());
+    size_t offset = 0;
+    for (size_t i = 0; i < mStrings.size(); i++) {
+        p = putU16(p, offset);
+        p = putU16(p, mStrings[i].len);
+        offset += mStrings[i].len;
+    }
+    p = putVarint(p, mBlobSize);
+    for (size_t i = 0; i < mStrings.size(); i++) {
+        memcpy(p, mStrings[i].s, mStrings[i].len);
+        p += mStrings[i].len;
+    }
+    p = putVarint(p, mCount);
+
+    memmove(p, mEntries, entriesSize);
+    mOut->resize(p + entriesSize - mOut->array());
+    return NO_ERROR;
+}
+
+status_t mtkCameraBinaryEncode(const char *a, Vector<uint8_t> *out)
+{
+    const char *key, *value;
+    size_t keyLen, valueLen;
+    size_t maxEntries = 1;
+
+    for (const char *c = a; (c = strchr(c, ';')) != NULL; c++)
+        maxEntries++;
+
+    MtkCameraBinaryWriter writer(out, maxEntries, strlen(a));
+    while (mtkCameraNextEntry(&a, &key, &keyLen, &value, &valueLen))
+        writer.add(mtkCameraKeyId(key, keyLen), key, keyLen, value, valueLen);
+    return writer.finish();
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Reader
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static bool getVarint(const uint8_t **pos, const uint8_t *end, uint32_t *v)
+{
+    const uint8_t *p = *pos;
+    uint32_t result = 0;
+
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end)
+            return false;
+        uint8_t b = *p++;
+        // The fifth byte only has room for four bits
+        if (shift == 28 && b > 0x0f)
+            return false;
+        result |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *pos = p;
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Characters "%d" prints for the value
+static size_t intLength(int32_t v)
+{
+    uint32_t u = v < 0 ? -(uint32_t)v : v;
+    size_t len = v < 0 ? 2 : 1;
+
+    while (u >= 10) {
+        u /= 10;
+        len++;
+    }
+    return len;
+}
+
+size_t mtkCameraFormatInt(int32_t v, char *out)
+{
+    uint32_t u = v < 0 ? -(uint32_t)v : v;
+    size_t len = intLength(v);
+    char *p = out + len;
+
+    do {
+        *--p = '0' + u % 10;
+        u /= 10;
+    } while (u != 0);
+    if (v < 0)
+        *--p = '-';
+    return len;
+}
+
+static uint32_t getU16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+MtkCameraBinaryReader::MtkCameraBinaryReader(const void *data, size_t size)
+    : mData((const uint8_t *)data),
+      mEnd((const uint8_t *)data + size),
+      mTable(NULL),
+      mBlob(NULL),
+      mEntries(NULL),
+      mPos(NULL),
+      mStrings(0),
+      mBlobSize(0),
+      mCount(0),
+      mRead(0),
+      mTextLength(0),
+      mSettable(true)
+{
+}
+
+status_t MtkCameraBinaryReader::init()
+{
+    const uint8_t *p = mData;
+    uint32_t count;
+    Entry entry;
+
+    mCount = 0;
+    if (mEnd - p < HEADER_SIZE || memcmp(p, "MKP", 3) != 0) {
+        ALOGE("Not a binary parameter set");
+        return BAD_VALUE;
+    }
+    if (p[3] != MTK_CAMERA_BINARY_VERSION ||
+            (getU16(p + 4) | getU16(p + 6) << 16) != mtkcamkeys::kFingerprint) {
+        ALOGE("Binary parameter set version %d does not match this build", p[3]);
+        return BAD_VALUE;
+    }
+    p += HEADER_SIZE;
+
+    if (!getVarint(&p, mEnd, &mStrings) || (size_t)(mEnd - p) / 4 < mStrings)
+        goto truncated;
+    mTable = p;
+    p += 4 * mStrings;
+
+    if (!getVarint(&p, mEnd, &mBlobSize) || (size_t)(mEnd - p) < mBlobSize)
+        goto truncated;
+    mBlob = p;
+    p += mBlobSize;
+
+    if (!getVarint(&p, mEnd, &count))
+        goto truncated;
+    mEntries = p;
+    mTextLength = 0;
+    mSettable = true;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!parse(&p, &entry, true))
+            goto truncated;
+        mTextLength += (i ? 2 : 1) + entry.keyLen +
+                (entry.value ? entry.valueLen : intLength(entry.intValue));
+        if (entry.value && memchr(entry.value, '=', entry.valueLen))
+            mSettable = false;
+    }
+
+    mCount = count;
+    rewind();
+    return NO_ERROR;
+
+truncated:
+    ALOGE("Malformed binary parameter set");
+    return BAD_VALUE;
+}
+
+bool MtkCameraBinaryReader::string(uint32_t index, const char **s, size_t *len) const
+{
+    if (index >= mStrings)
+        return false;
+
+    uint32_t offset = getU16(mTable + 4 * index);
+    uint32_t length = getU16(mTable + 4 * index + 2);
+    if (offset + length > mBlobSize)
+        return false;
+    *s = (const char *)mBlob + offset;
+    *len = length;
+    return true;
+}
+
+// Entries are only checked once, by init()
+bool MtkCameraBinaryReader::parse(const uint8_t **pos, Entry *entry, bool check) const
+{
+    uint32_t tag, v;
+
+    if (!getVarint(pos, mEnd, &tag))
+        return false;
+
+    uint32_t key = tag >> 2;
+    if (key < (uint32_t)MTK_KEY_COUNT) {
+        entry->id = MtkCameraKey(key);
+        entry->key = mtkcamkeys::kKeys[key].name;
+        entry->keyLen = strlen(entry->key);
+    } else if (key == (uint32_t)MTK_KEY_COUNT) {
+        if (!getVarint(pos, mEnd, &v) || v == 0 || (size_t)(mEnd - *pos) < v)
+            return false;
+        entry->id = MTK_KEY_INVALID;
+        entry->key = (const char *)*pos;
+        entry->keyLen = v;
+        *pos += v;
+        // Would not survive the trip through the text form
+        if (check && (memchr(entry->key, '=', entry->keyLen) ||
+                memchr(entry->key, ';', entry->keyLen) ||
+                memchr(entry->key, '\0', entry->keyLen)))
+            return false;
+    } else {
+        return false;
+    }
+
+    if (!getVarint(pos, mEnd, &v))
+        return false;
+
+    switch (tag & 3) {
+    case KIND_STRING:
+        if ((size_t)(mEnd - *pos) < v)
+            return false;
+        entry->value = (const char *)*pos;
+        entry->valueLen = v;
+        *pos += v;
+        break;
+    case KIND_INT:
+        entry->value = NULL;
+        entry->valueLen = 0;
+        entry->intValue = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+        return true;
+    case KIND_TABLE:
+        if (!string(v, &entry->value, &entry->valueLen))
+            return false;
+        break;
+    default:
+        return false;
+    }
+    return !check || (memchr(entry->value, ';', entry->valueLen) == NULL &&
+            memchr(entry->value, '\0', entry->valueLen) == NULL);
+}
+
+bool MtkCameraBinaryReader::next(Entry *entry)
+{
+    if (mRead == mCount)
+        return false;
+    mRead++;
+    return parse(&mPos, entry, false);
+}
+
+}; // namespace android
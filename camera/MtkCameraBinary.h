@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_CAMERA_BINARY_H
+#define ANDROID_HARDWARE_MTK_CAMERA_BINARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utils/Errors.h>
+#include <utils/Vector.h>
+
+#include "MtkCameraKeys.h"
+
+namespace android {
+
+/**
+ * Binary form of a flattened parameter set, version 1. Integers are
+ * little endian, varints are LEB128.
+ *
+ *   "MKP" version                  4 bytes
+ *   key registry fingerprint       u32
+ *   string count                   varint
+ *   string table                   count x (u16 offset, u16 length)
+ *   blob size, blob                varint, bytes the table points into
+ *   entry count                    varint
+ *   entries                        varint tag = key << 2 | kind,
+ *                                  for key MTK_KEY_COUNT the name as
+ *                                  varint length and bytes, then
+ *                                  kind 0: varint length, bytes
+ *                                  kind 1: zigzag varint
+ *                                  kind 2: varint string index
+ *
+ * A key below MTK_KEY_COUNT is a registry id, keys outside the registry
+ * are spelled out. Kind 1 is only used for decimal integers that print
+ * back to the same text, and kind 2 for the values of ENUM keys, which
+ * the string table stores once however often they repeat. Entries come
+ * in flatten() order, and decoding then encoding gives the same bytes.
+ *
+ * Ids depend on the registry of the build, a buffer written with another
+ * registry is rejected through the fingerprint.
+ */
+enum {
+    MTK_CAMERA_BINARY_VERSION = 1,
+};
+
+// Splits the next "key=value" off a flattened string, false at the end
+bool mtkCameraNextEntry(const char **a, const char **key, size_t *keyLen,
+        const char **value, size_t *valueLen);
+
+/**
+ * Writes a binary parameter set entry by entry, in flatten() order. The
+ * keys and values are copied or looked up as they come, except values of
+ * ENUM keys, which must stay put until finish().
+ */
+class MtkCameraBinaryWriter {
+public:
+    // At most maxEntries entries, with keys and values of maxText bytes in all
+    MtkCameraBinaryWriter(Vector<uint8_t> *out, size_t maxEntries, size_t maxText);
+
+    // id is MTK_KEY_INVALID for keys outside the registry
+    void add(MtkCameraKey id, const char *key, size_t keyLen,
+            const char *value, size_t valueLen);
+    // Writes the header and string table; reports an add() that failed
+    status_t finish();
+
+private:
+    struct StringRef {
+        const char *s;
+        size_t len;
+    };
+
+    ssize_t addString(const char *s, size_t len);
+
+    Vector<uint8_t> *mOut;
+    Vector<StringRef> mStrings;
+    uint8_t *mEntries;
+    uint8_t *mPos;
+    size_t mMaxEntries;
+    size_t mMaxText;
+    size_t mText;
+    size_t mBlobSize;
+    uint32_t mCount;
+    status_t mError;
+};
+
+// Writes the value as "%d" does, without a NUL; returns the length
+size_t mtkCameraFormatInt(int32_t value, char *out);
+
+// Encodes the output of CameraParameters::flatten()
+status_t mtkCameraBinaryEncode(const char *flattened, Vector<uint8_t> *out);
+
+/**
+ * Walks a binary parameter set in place, e.g. straight out of shared
+ * memory: keys and values point into the buffer, which must outlive the
+ * reader, and are not NUL terminated.
+ */
+class MtkCameraBinaryReader {
+public:
+    struct Entry {
+        MtkCameraKey id;        // MTK_KEY_INVALID for keys outside the registry
+        const char *key;
+        size_t keyLen;
+        const char *value;      // NULL for an integer
+        size_t valueLen;
+        int32_t intValue;
+    };
+
+    MtkCameraBinaryReader(const void *data, size_t size);
+
+    // Checks the header and every entry; next() is only valid after NO_ERROR
+    status_t init();
+    size_t count() const { return mCount; }
+    // Length of the flatten() text the entries stand for
+    size_t textLength() const { return mTextLength; }
+    // False when a value has a '=', which CameraParameters::set() turns down
+    bool settable() const { return mSettable; }
+    // Fills in the next entry, false after the last one
+    bool next(Entry *entry);
+    void rewind() { mPos = mEntries; mRead = 0; }
+
+private:
+    bool string(uint32_t index, const char **s, size_t *len) const;
+    bool parse(const uint8_t **pos, Entry *entry, bool check) const;
+
+    const uint8_t *mData;
+    const uint8_t *mEnd;
+    const uint8_t *mTable;
+    const uint8_t *mBlob;
+    const uint8_t *mEntries;
+    const uint8_t *mPos;
+    uint32_t mStrings;
+    uint32_t mBlobSize;
+    size_t mCount;
+    size_t mRead;
+    size_t mTextLength;
+    bool mSettable;
+};
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MTKCameraParams"
+#include <utils/Log.h>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkCameraBinary.h"
+#include "MtkCameraCapabilities.h"
+
+namespace android {
+
+// Lists of registry keys not named "<key>-values"
+static const struct {
+    MtkCameraKey id;
+    MtkCameraKey list;
+} kLists[] = {
+    { MTK_KEY_CAPTURE_MODE,     MTK_KEY_SUPPORTED_CAPTURE_MODES },
+    { MTK_KEY_ZSD_MODE,         MTK_KEY_SUPPORTED_ZSD_MODE },
+#ifdef MTK_SLOW_MOTION_VIDEO_SUPPORT
+    { MTK_KEY_HSVR_PRV_SIZE,    MTK_KEY_SUPPORTED_HSVR_PRV_SIZE },
+    { MTK_KEY_HSVR_PRV_FPS,     MTK_KEY_SUPPORTED_HSVR_PRV_FPS },
+#endif
+};
+
+static const char *listOf(const MtkCameraParameters &supported, MtkCameraKey id)
+{
+    const char *list = NULL;
+    size_t i = 0;
+
+    for (; i < sizeof(kLists) / sizeof(kLists[0]); i++) {
+        if (kLists[i].id == id) {
+            list = supported.get(kLists[i].list);
+            break;
+        }
+    }
+    if (i == sizeof(kLists) / sizeof(kLists[0])) {
+        String8 name(MtkCameraParameters::keyName(id));
+        name.append("-values");
+        list = supported.get(name.string());
+    }
+    return list != NULL && list[0] != '\0' ? list : NULL;
+}
+
+// Calls f(token, length) for every comma separated item of list, blanks trimmed
+template <typename F>
+static void forEachItem(const char *list, F f)
+{
+    for (const char *p = list; ; ) {
+        const char *end = strchr(p, ',');
+        size_t len = end != NULL ? (size_t)(end - p) : strlen(p);
+
+        while (len > 0 && *p == ' ') {
+            p++;
+            len--;
+        }
+        while (len > 0 && p[len - 1] == ' ')
+            len--;
+        if (len > 0)
+            f(p, len);
+        if (end == NULL)
+            break;
+        p = end + 1;
+    }
+}
+
+// A decimal number that is all of s
+static bool parseInt(const char *s, size_t len, int32_t *value)
+{
+    bool negative = false;
+    int64_t v = 0;
+    size_t i = 0;
+
+    if (len > 0 && (s[0] == '-' || s[0] == '+'))
+        negative = s[i++] == '-';
+    if (i == len)
+        return false;
+    for (; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9')
+            return false;
+        v = v * 10 + (s[i] - '0');
+        if (v > (int64_t)INT_MAX + 1)
+            return false;
+    }
+    if (negative)
+        v = -v;
+    if (v > INT_MAX)
+        return false;
+    *value = (int32_t)v;
+    return true;
+}
+
+// "<width>x<height>", both positive
+static bool parseSize(const char *s, size_t len, uint64_t *size)
+{
+    const char *x = (const char *)memchr(s, 'x', len);
+    int32_t width, height;
+
+    if (x == NULL || !parseInt(s, x - s, &width) ||
+            !parseInt(x + 1, len - (x + 1 - s), &height) || width <= 0 || height <= 0)
+        return false;
+    *size = (uint64_t)width << 32 | (uint32_t)height;
+    return true;
+}
+
+static int compareSizes(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int compareInts(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+template <typename T>
+static bool bisect(const T *a, size_t count, T value)
+{
+    size_t lo = 0, hi = count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < count && a[lo] == value;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Index
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+MtkCameraCapabilities::MtkCameraCapabilities()
+{
+    clear();
+}
+
+MtkCameraCapabilities::~MtkCameraCapabilities()
+{
+}
+
+void MtkCameraCapabilities::clear()
+{
+    memset(mEntries, 0, sizeof(mEntries));
+    mIndexed.clear();
+    mText.clear();
+    mWords.clear();
+    mSlots.clear();
+    mBits.clear();
+    mSizes.clear();
+    mInts.clear();
+}
+
+int MtkCameraCapabilities::findWord(const char *s, size_t len) const
+{
+    if (mSlots.isEmpty())
+        return -1;
+
+    size_t mask = mSlots.size() - 1;
+    for (size_t i = mtkcamkeys::hash(s, len, 0) & mask; ; i = (i + 1) & mask) {
+        int slot = mSlots[i];
+        if (slot == 0)
+            return -1;
+
+        const Word &w = mWords[slot - 1];
+        if (w.length == len && memcmp(mText.array() + w.offset, s, len) == 0)
+            return slot - 1;
+    }
+}
+
+// The table has room for every item of every list, so there is always a free slot
+int MtkCameraCapabilities::addWord(const char *s, size_t len)
+{
+    size_t mask = mSlots.size() - 1, i = mtkcamkeys::hash(s, len, 0) & mask;
+
+    for (; mSlots[i] != 0; i = (i + 1) & mask) {
+        const Word &w = mWords[mSlots[i] - 1];
+        if (w.length == len && memcmp(mText.array() + w.offset, s, len) == 0)
+            return mSlots[i] - 1;
+    }
+
+    Word w = { (uint32_t)mText.size(), (uint32_t)len };
+    mText.appendArray(s, len);
+    mSlots.editItemAt(i) = mWords.add(w) + 1;
+    return mWords.size() - 1;
+}
+
+status_t MtkCameraCapabilities::init(const MtkCameraParameters &supported)
+{
+    const char *lists[MTK_KEY_COUNT];
+    size_t items = 0, slots = 16;
+
+    clear();
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        MtkCameraKey id = MtkCameraKey(i);
+        MtkCameraKeyType type = MtkCameraParameters::keyType(id);
+
+        lists[i] = NULL;
+        if (type != MTK_KEY_TYPE_ENUM && type != MTK_KEY_TYPE_SIZE && type != MTK_KEY_TYPE_INT)
+            continue;
+        lists[i] = listOf(supported, id);
+        if (lists[i] != NULL && type == MTK_KEY_TYPE_ENUM)
+            forEachItem(lists[i], [&](const char *, size_t) { items++; });
+    }
+    while (slots < 2 * items)
+        slots *= 2;
+    // Slots hold word + 1 in 16 bits
+    if (items >= 0xffff) {
+        ALOGE("%zu supported values are too many to index", items);
+        return BAD_VALUE;
+    }
+
+    // Values first, bitsets over all of them after
+    mSlots.resize(slots);
+    memset(mSlots.editArray(), 0, slots * sizeof(uint16_t));
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        if (lists[i] != NULL && MtkCameraParameters::keyType(MtkCameraKey(i)) == MTK_KEY_TYPE_ENUM)
+            forEachItem(lists[i], [&](const char *s, size_t len) { addWord(s, len); });
+    }
+    size_t words = (mWords.size() + 63) / 64;
+
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        MtkCameraKey id = MtkCameraKey(i);
+        MtkCameraKeyType type = MtkCameraParameters::keyType(id);
+        Entry &e = mEntries[i];
+
+        if (lists[i] != NULL && type == MTK_KEY_TYPE_ENUM) {
+            e.flags |= HAS_WORDS;
+            e.first = mBits.size();
+            e.count = words;
+            mBits.resize(e.first + words);
+            memset(mBits.editArray() + e.first, 0, words * sizeof(uint64_t));
+            forEachItem(lists[i], [&](const char *s, size_t len) {
+                int w = findWord(s, len);
+                mBits.editItemAt(e.first + w / 64) |= (uint64_t)1 << (w % 64);
+            });
+        } else if (lists[i] != NULL && type == MTK_KEY_TYPE_SIZE) {
+            e.flags |= HAS_SIZES;
+            e.first = mSizes.size();
+            forEachItem(lists[i], [&](const char *s, size_t len) {
+                uint64_t size;
+                if (parseSize(s, len, &size))
+                    mSizes.add(size);
+                else
+                    ALOGW("Skipping size \"%.*s\" of %s", (int)len, s,
+                            MtkCameraParameters::keyName(id));
+            });
+            e.count = mSizes.size() - e.first;
+            qsort(mSizes.editArray() + e.first, e.count, sizeof(uint64_t), compareSizes);
+        } else if (lists[i] != NULL && type == MTK_KEY_TYPE_INT) {
+            e.flags |= HAS_INTS;
+            e.first = mInts.size();
+            forEachItem(lists[i], [&](const char *s, size_t len) {
+                int32_t value;
+                if (parseInt(s, len, &value))
+                    mInts.add(value);
+                else
+                    ALOGW("Skipping number \"%.*s\" of %s", (int)len, s,
+                            MtkCameraParameters::keyName(id));
+            });
+            e.count = mInts.size() - e.first;
+            qsort(mInts.editArray() + e.first, e.count, sizeof(int32_t), compareInts);
+        }
+
+        int min, max;
+        if (type == MTK_KEY_TYPE_INT && supported.getRange(id, &min, &max) == NO_ERROR) {
+            e.flags |= HAS_RANGE;
+            e.min = min;
+            e.max = max;
+        }
+        if (e.flags != 0)
+            mIndexed.add(id);
+    }
+    return NO_ERROR;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Validation
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+bool MtkCameraCapabilities::check(MtkCameraKey id, const char *value, size_t len,
+        MtkCameraViolationKind *kind) const
+{
+    const Entry &e = mEntries[id];
+
+    if (e.flags & HAS_WORDS) {
+        int w = findWord(value, len);
+        if (w >= 0 && (mBits[e.first + w / 64] >> (w % 64)) & 1)
+            return true;
+        *kind = MTK_VIOLATION_UNSUPPORTED;
+        return false;
+    }
+    if (e.flags & HAS_SIZES) {
+        uint64_t size;
+        if (!parseSize(value, len, &size)) {
+            *kind = MTK_VIOLATION_MALFORMED;
+            return false;
+        }
+        if (bisect(mSizes.array() + e.first, e.count, size))
+            return true;
+        *kind = MTK_VIOLATION_UNSUPPORTED;
+        return false;
+    }
+
+    int32_t number;
+    if (!parseInt(value, len, &number)) {
+        *kind = MTK_VIOLATION_MALFORMED;
+        return false;
+    }
+    if ((e.flags & HAS_INTS) && !bisect(mInts.array() + e.first, e.count, number)) {
+        *kind = MTK_VIOLATION_UNSUPPORTED;
+        return false;
+    }
+    if ((e.flags & HAS_RANGE) && (number < e.min || number > e.max)) {
+        *kind = MTK_VIOLATION_OUT_OF_RANGE;
+        return false;
+    }
+    return true;
+}
+
+void MtkCameraCapabilities::report(MtkCameraValidation *result, MtkCameraKey id,
+        MtkCameraViolationKind kind)
+{
+    // A flattened string can repeat a key, the array has room for each once
+    if (result->count == MTK_KEY_COUNT)
+        return;
+    result->violations[result->count].id = id;
+    result->violations[result->count].kind = kind;
+    result->count++;
+}
+
+// Both validate() calls go through here, so they agree on what is unset
+void MtkCameraCapabilities::checkValue(MtkCameraValidation *result, MtkCameraKey id,
+        const char *value, size_t len) const
+{
+    MtkCameraViolationKind kind;
+
+    if (value == NULL || len == 0)
+        return;
+    result->checked++;
+    if (!check(id, value, len, &kind))
+        report(result, id, kind);
+}
+
+status_t MtkCameraCapabilities::validate(const MtkCameraParameters &params,
+        MtkCameraValidation *result, const MtkCameraKeySet *keys) const
+{
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    result->count = 0;
+    result->checked = 0;
+    for (MtkCameraKey id = mIndexed.next(MTK_KEY_INVALID); id != MTK_KEY_INVALID;
+            id = mIndexed.next(id)) {
+        if (keys != NULL && !keys->contains(id))
+            continue;
+
+        const char *value = params.get(id);
+        checkValue(result, id, value, value != NULL ? strlen(value) : 0);
+    }
+    result->elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    return result->count > 0 ? BAD_VALUE : NO_ERROR;
+}
+
+status_t MtkCameraCapabilities::validate(const char *flattened, MtkCameraValidation *result) const
+{
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    const char *a = flattened, *key, *value;
+    size_t keyLen, valueLen;
+
+    result->count = 0;
+    result->checked = 0;
+    while (mtkCameraNextEntry(&a, &key, &keyLen, &value, &valueLen)) {
+        MtkCameraKey id = MtkCameraParameters::keyId(key, keyLen);
+        if (mIndexed.contains(id))
+            checkValue(result, id, value, valueLen);
+    }
+    result->elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    return result->count > 0 ? BAD_VALUE : NO_ERROR;
+}
+
+bool MtkCameraCapabilities::supports(MtkCameraKey id, const char *value) const
+{
+    MtkCameraViolationKind kind;
+
+    if (!mIndexed.contains(id))
+        return true;
+    return value != NULL && check(id, value, strlen(value), &kind);
+}
+
+const char *MtkCameraCapabilities::kindName(MtkCameraViolationKind kind)
+{
+    switch (kind) {
+    case MTK_VIOLATION_UNSUPPORTED:     return "unsupported";
+    case MTK_VIOLATION_OUT_OF_RANGE:    return "out of range";
+    case MTK_VIOLATION_MALFORMED:       return "malformed";
+    default:                            return "unknown";
+    }
+}
+
+}; // namespace android
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_CAMERA_CAPABILITIES_H
+#define ANDROID_HARDWARE_MTK_CAMERA_CAPABILITIES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+#include "MtkCameraKeys.h"
+#include "MtkCameraParameters.h"
+
+namespace android {
+
+enum MtkCameraViolationKind {
+    MTK_VIOLATION_UNSUPPORTED,      // not in the supported list
+    MTK_VIOLATION_OUT_OF_RANGE,     // outside the -min/-max limits
+    MTK_VIOLATION_MALFORMED,        // not a number or size where one is due
+};
+
+struct MtkCameraViolation {
+    MtkCameraKey id;
+    MtkCameraViolationKind kind;
+};
+
+// What one validate() found, in the order checked, one violation per key
+struct MtkCameraValidation {
+    int count;
+    int checked;                    // values looked at
+    nsecs_t elapsed;                // time the check took
+    MtkCameraViolation violations[MTK_KEY_COUNT];
+};
+
+/**
+ * What a sensor supports, indexed once from the parameters the HAL
+ * publishes for it, so that an incoming parameter set is checked in one
+ * pass without splitting a single comma list.
+ *
+ * Every value of the ENUM lists is interned once, and each ENUM key has
+ * a bitset over those values: a check is one hash of the value and one
+ * bit test. Supported sizes and numbers are sorted arrays searched by
+ * bisection, and -min/-max limits are kept as a pair. The index does not
+ * change after init(), so any number of threads can validate against it.
+ */
+class MtkCameraCapabilities {
+public:
+    MtkCameraCapabilities();
+    ~MtkCameraCapabilities();
+
+    /*
+     * Indexes the ENUM, SIZE and INT keys that have a supported list,
+     * "<key>-values" or the registry's own list key such as
+     * KEY_SUPPORTED_ZSD_MODE, and the INT keys with -min/-max limits.
+     * Keys without either are not checked. BAD_VALUE for more than 65534
+     * enum values in all.
+     */
+    status_t init(const MtkCameraParameters &supported);
+
+    /*
+     * Checks every indexed key that has a value, or only those in keys,
+     * and reports every violation. BAD_VALUE when there is any. An empty
+     * value counts as unset, as CameraParameters::get() reads it.
+     */
+    status_t validate(const MtkCameraParameters &params, MtkCameraValidation *result,
+            const MtkCameraKeySet *keys = NULL) const;
+    // The same straight off a flatten() string, before it is unflattened
+    status_t validate(const char *flattened, MtkCameraValidation *result) const;
+
+    // Whether value is fine for the key, true for keys not indexed
+    bool supports(MtkCameraKey id, const char *value) const;
+
+    bool isIndexed(MtkCameraKey id) const { return mIndexed.contains(id); }
+    static const char *kindName(MtkCameraViolationKind kind);
+
+private:
+    MtkCameraCapabilities(const MtkCameraCapabilities&);
+    MtkCameraCapabilities& operator=(const MtkCameraCapabilities&);
+
+    enum {
+        HAS_WORDS   = 1 << 0,
+        HAS_SIZES   = 1 << 1,
+        HAS_INTS    = 1 << 2,
+        HAS_RANGE   = 1 << 3,
+    };
+
+    struct Entry {
+        uint8_t flags;
+        uint32_t first;             // first bitset word, size or number
+        uint32_t count;
+        int32_t min;
+        int32_t max;
+    };
+
+    struct Word {
+        uint32_t offset;            // in mText
+        uint32_t length;
+    };
+
+    void clear();
+    int addWord(const char *s, size_t len);
+    int findWord(const char *s, size_t len) const;
+    bool check(MtkCameraKey id, const char *value, size_t len,
+            MtkCameraViolationKind *kind) const;
+    static void report(MtkCameraValidation *result, MtkCameraKey id,
+            MtkCameraViolationKind kind);
+    void checkValue(MtkCameraValidation *result, MtkCameraKey id, const char *value,
+            size_t len) const;
+
+    Entry mEntries[MTK_KEY_COUNT];
+    MtkCameraKeySet mIndexed;
+
+    // The interned values, and an open addressing table over them holding
+    // word index + 1, a power of two long
+    Vector<char> mText;
+    Vector<Word> mWords;
+    Vector<uint16_t> mSlots;
+    // Per ENUM key, bitset words over mWords
+    Vector<uint64_t> mBits;
+    // Per SIZE key sorted width << 32 | height, per INT key sorted numbers
+    Vector<uint64_t> mSizes;
+    Vector<int32_t> mInts;
+};
+
+}; // namespace android
+
+#endif
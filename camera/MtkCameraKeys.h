@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_CAMERA_KEYS_H
+#define ANDROID_HARDWARE_MTK_CAMERA_KEYS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Registry of the MTK parameter keys, one KEY(name, string, type) entry
+ * per MtkCameraParameters::name constant. Every key gets a dense id,
+ * MTK_<name>, usable with the id based accessors of MtkCameraParameters.
+ *
+ * MtkCameraParameters.cpp defines the class constants from this list,
+ * so the strings only live here.
+ *
+ * The type is what the value holds: STRING for free text and lists,
+ * INT and FLOAT for numbers, SIZE for "<width>x<height>" and ENUM for
+ * one out of a fixed set of names.
+ */
+#define MTK_CAMERA_KEYS(KEY) \
+    KEY(KEY_FB_SMOOTH_LEVEL,                        "fb-smooth-level",                          INT) \
+    KEY(KEY_FB_SMOOTH_LEVEL_MIN,                    "fb-smooth-level-min",                      INT) \
+    KEY(KEY_FB_SMOOTH_LEVEL_MAX,                    "fb-smooth-level-max",                      INT) \
+    KEY(KEY_FB_SKIN_COLOR,                          "fb-skin-color",                            INT) \
+    KEY(KEY_FB_SKIN_COLOR_MIN,                      "fb-skin-color-min",                        INT) \
+    KEY(KEY_FB_SKIN_COLOR_MAX,                      "fb-skin-color-max",                        INT) \
+    KEY(KEY_FB_SHARP,                               "fb-sharp",                                 INT) \
+    KEY(KEY_FB_SHARP_MIN,                           "fb-sharp-min",                             INT) \
+    KEY(KEY_FB_SHARP_MAX,                           "fb-sharp-max",                             INT) \
+    KEY(KEY_FB_ENLARGE_EYE,                         "fb-enlarge-eye",                           INT) \
+    KEY(KEY_FB_ENLARGE_EYE_MIN,                     "fb-enlarge-eye-min",                       INT) \
+    KEY(KEY_FB_ENLARGE_EYE_MAX,                     "fb-enlarge-eye-max",                       INT) \
+    KEY(KEY_FB_SLIM_FACE,                           "fb-slim-face",                             INT) \
+    KEY(KEY_FB_SLIM_FACE_MIN,                       "fb-slim-face-min",                         INT) \
+    KEY(KEY_FB_SLIM_FACE_MAX,                       "fb-slim-face-max",                         INT) \
+    KEY(KEY_FB_EXTREME_BEAUTY,                      "fb-extreme-beauty",                        ENUM) \
+    KEY(KEY_FACE_BEAUTY,                            "face-beauty",                              ENUM) \
+    KEY(KEY_EXPOSURE,                               "exposure",                                 STRING) \
+    KEY(KEY_EXPOSURE_METER,                         "exposure-meter",                           ENUM) \
+    KEY(KEY_ISO_SPEED,                              "iso-speed",                                ENUM) \
+    KEY(KEY_AE_MODE,                                "ae-mode",                                  ENUM) \
+    KEY(KEY_FOCUS_METER,                            "focus-meter",                              ENUM) \
+    KEY(KEY_EDGE,                                   "edge",                                     ENUM) \
+    KEY(KEY_HUE,                                    "hue",                                      ENUM) \
+    KEY(KEY_SATURATION,                             "saturation",                               ENUM) \
+    KEY(KEY_BRIGHTNESS,                             "brightness",                               ENUM) \
+    KEY(KEY_CONTRAST,                               "contrast",                                 ENUM) \
+    KEY(KEY_AF_LAMP_MODE,                           "aflamp-mode",                              ENUM) \
+    KEY(KEY_STEREO_3D_PREVIEW_SIZE,                 "stereo3d-preview-size",                    SIZE) \
+    KEY(KEY_STEREO_3D_PICTURE_SIZE,                 "stereo3d-picture-size",                    SIZE) \
+    KEY(KEY_STEREO_3D_TYPE,                         "stereo3d-type",                            ENUM) \
+    KEY(KEY_STEREO_3D_MODE,                         "stereo3d-mode",                            ENUM) \
+    KEY(KEY_STEREO_3D_IMAGE_FORMAT,                 "stereo3d-image-format",                    ENUM) \
+    KEY(KEY_ZSD_MODE,                               "zsd-mode",                                 ENUM) \
+    KEY(KEY_SUPPORTED_ZSD_MODE,                     "zsd-supported",                            STRING) \
+    KEY(KEY_FPS_MODE,                               "fps-mode",                                 INT) \
+    KEY(KEY_FOCUS_DRAW,                             "af-draw",                                  INT) \
+    KEY(KEY_CAPTURE_MODE,                           "cap-mode",                                 ENUM) \
+    KEY(KEY_SUPPORTED_CAPTURE_MODES,                "cap-mode-values",                          STRING) \
+    KEY(KEY_CAPTURE_PATH,                           "capfname",                                 STRING) \
+    KEY(KEY_BURST_SHOT_NUM,                         "burst-num",                                INT) \
+    KEY(KEY_MATV_PREVIEW_DELAY,                     "tv-delay",                                 INT) \
+    KEY(KEY_PANORAMA_IDX,                           "pano-idx",                                 INT) \
+    KEY(KEY_PANORAMA_DIR,                           "pano-dir",                                 ENUM) \
+    KEY(KEY_AWB2PASS,                               "awb-2pass",                                ENUM) \
+    KEY(KEY_CAMERA_MODE,                            "mtk-cam-mode",                             INT) \
+    KEY(KEY_PREVIEW_INT_FORMAT,                     "prv-int-fmt",                              ENUM) \
+    KEY(KEY_BRIGHTNESS_VALUE,                       "brightness_value",                         INT) \
+    KEY(KEY_ISP_MODE,                               "isp-mode",                                 INT) \
+    KEY(KEY_AF_X,                                   "af-x",                                     INT) \
+    KEY(KEY_AF_Y,                                   "af-y",                                     INT) \
+    KEY(KEY_RAW_SAVE_MODE,                          "rawsave-mode",                             INT) \
+    KEY(KEY_RAW_PATH,                               "rawfname",                                 STRING) \
+    KEY(KEY_FAST_CONTINUOUS_SHOT,                   "fast-continuous-shot",                     ENUM) \
+    KEY(KEY_CSHOT_INDICATOR,                        "cshot-indicator",                          ENUM) \
+    KEY(KEY_FOCUS_ENG_MODE,                         "afeng-mode",                               INT) \
+    KEY(KEY_FOCUS_ENG_STEP,                         "afeng-pos",                                INT) \
+    KEY(KEY_FOCUS_ENG_MAX_STEP,                     "afeng-max-focus-step",                     INT) \
+    KEY(KEY_FOCUS_ENG_MIN_STEP,                     "afeng-min-focus-step",                     INT) \
+    KEY(KEY_FOCUS_ENG_BEST_STEP,                    "afeng-best-focus-step",                    INT) \
+    KEY(KEY_RAW_DUMP_FLAG,                          "afeng_raw_dump_flag",                      INT) \
+    KEY(KEY_PREVIEW_DUMP_RESOLUTION,                "preview-dump-resolution",                  INT) \
+    KEY(KEY_MAX_NUM_DETECTED_OBJECT,                "max-num-ot",                               INT) \
+    KEY(KEY_VIDEO_HDR,                              "video-hdr",                                ENUM) \
+    KEY(KEY_ENG_AE_ENABLE,                          "eng-ae-enable",                            INT) \
+    KEY(KEY_ENG_PREVIEW_SHUTTER_SPEED,              "eng-preview-shutter-speed",                INT) \
+    KEY(KEY_ENG_PREVIEW_SENSOR_GAIN,                "eng-preview-sensor-gain",                  INT) \
+    KEY(KEY_ENG_PREVIEW_ISP_GAIN,                   "eng-preview-isp-gain",                     INT) \
+    KEY(KEY_ENG_PREVIEW_AE_INDEX,                   "eng-preview-ae-index",                     INT) \
+    KEY(KEY_ENG_CAPTURE_SENSOR_GAIN,                "eng-capture-sensor-gain",                  INT) \
+    KEY(KEY_ENG_CAPTURE_ISP_GAIN,                   "eng-capture-isp-gain",                     INT) \
+    KEY(KEY_ENG_CAPTURE_SHUTTER_SPEED,              "eng-capture-shutter-speed",                INT) \
+    KEY(KEY_ENG_CAPTURE_ISO,                        "eng-capture-iso",                          INT) \
+    KEY(KEY_ENG_FLASH_DUTY_VALUE,                   "eng-flash-duty-value",                     INT) \
+    KEY(KEY_ENG_FLASH_DUTY_MIN,                     "eng-flash-duty-min",                       INT) \
+    KEY(KEY_ENG_FLASH_DUTY_MAX,                     "eng-flash-duty-max",                       INT) \
+    KEY(KEY_ENG_ZSD_ENABLE,                         "eng-zsd-enable",                           INT) \
+    KEY(KEY_SENSOR_TYPE,                            "sensor-type",                              INT) \
+    KEY(KEY_ENG_PREVIEW_FPS,                        "eng-preview-fps",                          INT) \
+    KEY(KEY_ENG_MSG,                                "eng-msg",                                  STRING) \
+    KEY(KEY_ENG_FLASH_STEP_MIN,                     "eng-flash-step-min",                       INT) \
+    KEY(KEY_ENG_FLASH_STEP_MAX,                     "eng-flash-step-max",                       INT) \
+    KEY(KEY_ENG_FOCUS_FULLSCAN_FRAME_INTERVAL,      "eng-focus-fullscan-frame-interval",        INT) \
+    KEY(KEY_ENG_FOCUS_FULLSCAN_FRAME_INTERVAL_MAX,  "eng-focus-fullscan-frame-interval-max",    INT) \
+    KEY(KEY_ENG_FOCUS_FULLSCAN_FRAME_INTERVAL_MIN,  "eng-focus-fullscan-frame-interval-min",    INT) \
+    KEY(KEY_ENG_PREVIEW_FRAME_INTERVAL_IN_US,       "eng-preview-frame-interval-in-us",         INT) \
+    KEY(KEY_ENG_PARAMETER1,                         "key-eng-parameter1",                       STRING) \
+    KEY(KEY_ENG_PARAMETER2,                         "key-eng-parameter2",                       STRING) \
+    KEY(KEY_ENG_PARAMETER3,                         "key-eng-parameter3",                       STRING) \
+    KEY(KEY_ENG_SAVE_SHADING_TABLE,                 "eng-save-shading-table",                   INT) \
+    KEY(KEY_ENG_SHADING_TABLE,                      "eng-shading-table",                        INT) \
+    KEY(KEY_ENG_EV_CALBRATION_OFFSET_VALUE,         "eng-ev-cal-offset",                        INT) \
+    MTK_CAMERA_HSVR_KEYS(KEY) \
+    KEY(KEY_DXOEIS_ONOFF,                           "dxo-eis",                                  ENUM) \
+    KEY(KEY_FIX_EXPOSURE_TIME,                      "fix-exposure-time",                        INT)
+
+#ifdef MTK_SLOW_MOTION_VIDEO_SUPPORT
+#define MTK_CAMERA_HSVR_KEYS(KEY) \
+    KEY(KEY_HSVR_PRV_SIZE,                          "hsvr-prv-size",                            SIZE) \
+    KEY(KEY_SUPPORTED_HSVR_PRV_SIZE,                "hsvr-prv-size-values",                     STRING) \
+    KEY(KEY_HSVR_PRV_FPS,                           "hsvr-prv-fps",                             INT) \
+    KEY(KEY_SUPPORTED_HSVR_PRV_FPS,                 "hsvr-prv-fps-values",                      STRING)
+#else
+#define MTK_CAMERA_HSVR_KEYS(KEY)
+#endif
+
+namespace android {
+
+enum MtkCameraKey {
+#define MTK_CAMERA_KEY_ID(name, string, type) MTK_##name,
+    MTK_CAMERA_KEYS(MTK_CAMERA_KEY_ID)
+#undef MTK_CAMERA_KEY_ID
+    MTK_KEY_COUNT,
+    MTK_KEY_INVALID = -1
+};
+
+enum MtkCameraKeyType {
+    MTK_KEY_TYPE_STRING,
+    MTK_KEY_TYPE_INT,
+    MTK_KEY_TYPE_FLOAT,
+    MTK_KEY_TYPE_SIZE,
+    MTK_KEY_TYPE_ENUM,
+};
+
+struct MtkCameraKeyInfo {
+    const char *name;
+    MtkCameraKeyType type;
+};
+
+/**
+ * Set of key ids, one bit per key. Walk it with
+ *
+ *   for (MtkCameraKey id = keys.next(MTK_KEY_INVALID); id != MTK_KEY_INVALID;
+ *           id = keys.next(id))
+ */
+class MtkCameraKeySet {
+public:
+    MtkCameraKeySet() { clear(); }
+
+    void clear()
+    {
+        for (int i = 0; i < WORDS; i++)
+            mBits[i] = 0;
+    }
+
+    void add(MtkCameraKey id) { mBits[id / 32] |= 1u << (id % 32); }
+    void remove(MtkCameraKey id) { mBits[id / 32] &= ~(1u << (id % 32)); }
+
+    bool contains(MtkCameraKey id) const
+    {
+        return id >= 0 && id < MTK_KEY_COUNT && (mBits[id / 32] >> (id % 32)) & 1;
+    }
+
+    bool isEmpty() const
+    {
+        for (int i = 0; i < WORDS; i++) {
+            if (mBits[i] != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // First id after the given one, MTK_KEY_INVALID when there is none
+    MtkCameraKey next(MtkCameraKey id) const
+    {
+        for (int i = id + 1; i < MTK_KEY_COUNT; ) {
+            uint32_t bits = mBits[i / 32] >> (i % 32);
+            if (bits != 0)
+                return MtkCameraKey(i + __builtin_ctz(bits));
+            i = (i / 32 + 1) * 32;
+        }
+        return MTK_KEY_INVALID;
+    }
+
+private:
+    enum { WORDS = (MTK_KEY_COUNT + 31) / 32 };
+
+    uint32_t mBits[WORDS];
+};
+
+#if __cplusplus >= 201402L
+
+/**
+ * Compile-time perfect hash over the registry (hash and displace): the
+ * key hash picks one of BUCKETS buckets, and remixing it with the
+ * bucket's displacement lands every key of the registry in its own slot.
+ * A lookup is one hash of the key, one string compare and no probing.
+ *
+ * mtkCameraKeyId() is constexpr, so ids of literal keys resolve at
+ * compile time; MtkCameraParameters::keyId() is the runtime entry point.
+ */
+namespace mtkcamkeys {
+
+enum {
+    BUCKETS = 64,
+    SLOTS   = 256,
+};
+
+static_assert(int(MTK_KEY_COUNT) < int(SLOTS), "slot table too small for the key registry");
+
+constexpr MtkCameraKeyInfo kKeys[] = {
+#define MTK_CAMERA_KEY_INFO(name, string, type) { string, MTK_KEY_TYPE_##type },
+    MTK_CAMERA_KEYS(MTK_CAMERA_KEY_INFO)
+#undef MTK_CAMERA_KEY_INFO
+};
+
+constexpr size_t length(const char *s)
+{
+    size_t len = 0;
+
+    while (s[len] != '\0')
+        len++;
+    return len;
+}
+
+constexpr uint32_t hash(const char *s, size_t len, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+constexpr uint32_t hash(const char *s, uint32_t seed)
+{
+    return hash(s, length(s), seed);
+}
+
+// Rehashes a key hash for a bucket displacement, without another pass over the key
+constexpr uint32_t displace(uint32_t h, uint32_t d)
+{
+    h ^= d * 0x9e3779b9u;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+// True when the first len chars of key are all of name
+constexpr bool equal(const char *name, const char *key, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (name[i] != key[i] || name[i] == '\0')
+            return false;
+    }
+    return name[len] == '\0';
+}
+
+constexpr bool equal(const char *a, const char *b)
+{
+    return equal(a, b, length(b));
+}
+
+struct Table {
+    uint8_t displacement[BUCKETS];
+    uint8_t slots[SLOTS];   // key id + 1, 0 when empty
+    bool complete;
+};
+
+constexpr Table build()
+{
+    Table t = {};
+    int bucket[MTK_KEY_COUNT] = {};
+    int size[BUCKETS] = {};
+    int placed[MTK_KEY_COUNT] = {};
+
+    for (int k = 0; k < MTK_KEY_COUNT; k++) {
+        bucket[k] = hash(kKeys[k].name, 0) % BUCKETS;
+        size[bucket[k]]++;
+    }
+
+    t.complete = true;
+    // Largest buckets first, they are the hardest to place
+    for (int n = MTK_KEY_COUNT; n > 0; n--) {
+        for (int b = 0; b < BUCKETS; b++) {
+            if (size[b] != n)
+                continue;
+
+            int d = 1;
+            for (; d < 256; d++) {
+                int count = 0;
+                int k = 0;
+                for (; k < MTK_KEY_COUNT; k++) {
+                    if (bucket[k] != b)
+                        continue;
+                    int s = displace(hash(kKeys[k].name, 0), d) % SLOTS;
+                    if (t.slots[s] != 0)
+                        break;
+                    t.slots[s] = k + 1;
+                    placed[count++] = s;
+                }
+                if (k == MTK_KEY_COUNT)
+                    break;
+                // Collision, undo this attempt and try the next seed
+                while (count > 0)
+                    t.slots[placed[--count]] = 0;
+            }
+            if (d == 256)
+                t.complete = false;
+            t.displacement[b] = d;
+        }
+    }
+    return t;
+}
+
+constexpr Table kTable = build();
+
+static_assert(kTable.complete, "no perfect hash found for the key registry");
+
+// Changes whenever a key is added, removed, moved or retyped
+constexpr uint32_t fingerprint()
+{
+    uint32_t h = 0;
+
+    for (int k = 0; k < MTK_KEY_COUNT; k++)
+        h = hash(kKeys[k].name, h) + kKeys[k].type;
+    return h;
+}
+
+constexpr uint32_t kFingerprint = fingerprint();
+
+/*
+ * Limits of numeric keys: "<base>-min" and "<base>-max" bound the key
+ * "<base>" or "<base>-value", e.g. fb-smooth-level-min/-max bound
+ * fb-smooth-level.
+ */
+constexpr size_t baseLength(const char *name)
+{
+    size_t len = length(name);
+
+    return len > 6 && equal(name + len - 6, "-value") ? len - 6 : len;
+}
+
+// True when name is the first len chars of base followed by suffix
+constexpr bool suffixed(const char *name, const char *base, size_t len, const char *suffix)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (name[i] != base[i])
+            return false;
+    }
+    return equal(name + len, suffix);
+}
+
+struct Bounds {
+    uint8_t min[MTK_KEY_COUNT];     // key id + 1, 0 when unbounded
+    uint8_t max[MTK_KEY_COUNT];
+};
+
+constexpr Bounds buildBounds()
+{
+    Bounds b = {};
+
+    for (int k = 0; k < MTK_KEY_COUNT; k++) {
+        size_t len = baseLength(kKeys[k].name);
+        for (int o = 0; o < MTK_KEY_COUNT; o++) {
+            if (suffixed(kKeys[o].name, kKeys[k].name, len, "-min"))
+                b.min[k] = o + 1;
+            else if (suffixed(kKeys[o].name, kKeys[k].name, len, "-max"))
+                b.max[k] = o + 1;
+        }
+    }
+    return b;
+}
+
+constexpr Bounds kBounds = buildBounds();
+
+static_assert(kBounds.min[MTK_KEY_FB_SMOOTH_LEVEL] == MTK_KEY_FB_SMOOTH_LEVEL_MIN + 1 &&
+        kBounds.max[MTK_KEY_ENG_FLASH_DUTY_VALUE] == MTK_KEY_ENG_FLASH_DUTY_MAX + 1,
+        "key bounds do not match the registry");
+
+// Byte order of the names, which is the order of the CameraParameters map
+constexpr bool before(const char *a, const char *b)
+{
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
+    }
+    return (uint8_t)*a < (uint8_t)*b;
+}
+
+struct Order {
+    uint8_t ids[MTK_KEY_COUNT];
+};
+
+constexpr Order buildOrder()
+{
+    Order o = {};
+
+    for (int k = 0; k < MTK_KEY_COUNT; k++) {
+        int i = k;
+        for (; i > 0 && before(kKeys[k].name, kKeys[o.ids[i - 1]].name); i--)
+            o.ids[i] = o.ids[i - 1];
+        o.ids[i] = k;
+    }
+    return o;
+}
+
+// Ids in the order flatten() lists the keys
+constexpr Order kOrder = buildOrder();
+
+} // namespace mtkcamkeys
+
+constexpr MtkCameraKey mtkCameraKeyId(const char *key, size_t len)
+{
+    using namespace mtkcamkeys;
+
+    uint32_t h = hash(key, len, 0);
+    uint8_t d = kTable.displacement[h % BUCKETS];
+    uint8_t s = kTable.slots[displace(h, d) % SLOTS];
+
+    return s != 0 && equal(kKeys[s - 1].name, key, len) ? MtkCameraKey(s - 1) : MTK_KEY_INVALID;
+}
+
+constexpr MtkCameraKey mtkCameraKeyId(const char *key)
+{
+    return mtkCameraKeyId(key, mtkcamkeys::length(key));
+}
+
+#endif // __cplusplus >= 201402L
+
+}; // namespace android
+
+#endif
@@ -18,9 +18,12 @@
 #define LOG_TAG "MTKCameraParams"
 #include <utils/Log.h>
 
+#include <limits.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "MtkCameraParameters.h"
+#include "MtkCameraBinary.h"
 
 namespace android {
 
@@ -45,67 +48,12 @@ const char MtkCameraParameters::APP_MODE_NAME_MTK_ZSD[]         = "MtkZsd";
 const char MtkCameraParameters::SCENE_MODE_NORMAL[] = "normal";
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-//  Face Beauty
+//  Keys, the strings live in MtkCameraKeys.h.
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-const char MtkCameraParameters::KEY_FB_SMOOTH_LEVEL[]       = "fb-smooth-level";
-const char MtkCameraParameters::KEY_FB_SMOOTH_LEVEL_MIN[]   = "fb-smooth-level-min";
-const char MtkCameraParameters::KEY_FB_SMOOTH_LEVEL_MAX[]   = "fb-smooth-level-max";
-//
-const char MtkCameraParameters::KEY_FB_SKIN_COLOR[]         = "fb-skin-color";
-const char MtkCameraParameters::KEY_FB_SKIN_COLOR_MIN[]     = "fb-skin-color-min";
-const char MtkCameraParameters::KEY_FB_SKIN_COLOR_MAX[]     = "fb-skin-color-max";
-//
-const char MtkCameraParameters::KEY_FB_SHARP[]              = "fb-sharp";
-const char MtkCameraParameters::KEY_FB_SHARP_MIN[]          = "fb-sharp-min";
-const char MtkCameraParameters::KEY_FB_SHARP_MAX[]          = "fb-sharp-max";
-//
-const char MtkCameraParameters::KEY_FB_ENLARGE_EYE[]        = "fb-enlarge-eye";
-const char MtkCameraParameters::KEY_FB_ENLARGE_EYE_MIN[]    = "fb-enlarge-eye-min";
-const char MtkCameraParameters::KEY_FB_ENLARGE_EYE_MAX[]    = "fb-enlarge-eye-max";
-//
-const char MtkCameraParameters::KEY_FB_SLIM_FACE[]          = "fb-slim-face";
-const char MtkCameraParameters::KEY_FB_SLIM_FACE_MIN[]      = "fb-slim-face-min";
-const char MtkCameraParameters::KEY_FB_SLIM_FACE_MAX[]      = "fb-slim-face-max";
-//
-const char MtkCameraParameters::KEY_FB_EXTREME_BEAUTY[]     = "fb-extreme-beauty";
-//
-const char MtkCameraParameters::KEY_FACE_BEAUTY[]           = "face-beauty";
-
-
-//
-const char MtkCameraParameters::KEY_EXPOSURE[] = "exposure";
-const char MtkCameraParameters::KEY_EXPOSURE_METER[] = "exposure-meter";
-const char MtkCameraParameters::KEY_ISO_SPEED[] = "iso-speed";
-const char MtkCameraParameters::KEY_AE_MODE[] = "ae-mode";
-const char MtkCameraParameters::KEY_FOCUS_METER[] = "focus-meter";
-const char MtkCameraParameters::KEY_EDGE[] = "edge";
-const char MtkCameraParameters::KEY_HUE[] = "hue";
-const char MtkCameraParameters::KEY_SATURATION[] = "saturation";
-const char MtkCameraParameters::KEY_BRIGHTNESS[] = "brightness";
-const char MtkCameraParameters::KEY_CONTRAST[] = "contrast";
-const char MtkCameraParameters::KEY_AF_LAMP_MODE [] = "aflamp-mode";
-const char MtkCameraParameters::KEY_STEREO_3D_PREVIEW_SIZE[] = "stereo3d-preview-size";
-const char MtkCameraParameters::KEY_STEREO_3D_PICTURE_SIZE[] = "stereo3d-picture-size";
-const char MtkCameraParameters::KEY_STEREO_3D_TYPE [] = "stereo3d-type";
-const char MtkCameraParameters::KEY_STEREO_3D_MODE [] = "stereo3d-mode";
-const char MtkCameraParameters::KEY_STEREO_3D_IMAGE_FORMAT [] = "stereo3d-image-format";
-
-// ZSD
-const char MtkCameraParameters::KEY_ZSD_MODE[] = "zsd-mode"; 
-const char MtkCameraParameters::KEY_SUPPORTED_ZSD_MODE[] = "zsd-supported";
-//
-const char MtkCameraParameters::KEY_FPS_MODE[] = "fps-mode";
-//
-const char MtkCameraParameters::KEY_FOCUS_DRAW[] = "af-draw";
-//
-const char MtkCameraParameters::KEY_CAPTURE_MODE[] = "cap-mode";
-const char MtkCameraParameters::KEY_SUPPORTED_CAPTURE_MODES[] = "cap-mode-values";
-const char MtkCameraParameters::KEY_CAPTURE_PATH[] = "capfname";
-const char MtkCameraParameters::KEY_BURST_SHOT_NUM[] = "burst-num";
-//
-const char MtkCameraParameters::KEY_MATV_PREVIEW_DELAY[] = "tv-delay";
-const char MtkCameraParameters::KEY_PANORAMA_IDX[] = "pano-idx";
-const char MtkCameraParameters::KEY_PANORAMA_DIR[] = "pano-dir";
+#define MTK_CAMERA_KEY_DEFINE(name, string, type) \
+const char MtkCameraParameters::name[] = string;
+MTK_CAMERA_KEYS(MTK_CAMERA_KEY_DEFINE)
+#undef MTK_CAMERA_KEY_DEFINE
 
 // Values for KEY_EXPOSURE
 const char MtkCameraParameters::EXPOSURE_METER_SPOT[] = "spot";
@@ -120,19 +68,12 @@ const char MtkCameraParameters::ISO_SPEED_400[] = "400";
 const char MtkCameraParameters::ISO_SPEED_800[] = "800";
 const char MtkCameraParameters::ISO_SPEED_1600[] = "1600";
 
-// Values for KEY_AE_MODE = "ae-mode"
-
 // Values for KEY_FOCUS_METER
 const char MtkCameraParameters::FOCUS_METER_SPOT[] = "spot";
 const char MtkCameraParameters::FOCUS_METER_MULTI[] = "multi";
 
-// AWB2PASS
-const char MtkCameraParameters::KEY_AWB2PASS[] = "awb-2pass"; 
-
-
 //
 //  Camera Mode
-const char MtkCameraParameters::KEY_CAMERA_MODE[] = "mtk-cam-mode";
 // Values for KEY_CAMERA_MODE
 const int MtkCameraParameters::CAMERA_MODE_NORMAL  = 0;
 const int MtkCameraParameters::CAMERA_MODE_MTK_PRV = 1;
@@ -143,10 +84,6 @@ const int MtkCameraParameters::CAMERA_MODE_MTK_VT  = 3;
 const int MtkCameraParameters::FPS_MODE_NORMAL = 0;
 const int MtkCameraParameters::FPS_MODE_FIX = 1;
 
-// Values for raw save mode
-
-// Values for KEY_FOCUS_DRAW
-
 // Values for capture mode
 const char MtkCameraParameters::CAPTURE_MODE_PANORAMA_SHOT[] = "panoramashot";
 const char MtkCameraParameters::CAPTURE_MODE_BURST_SHOT[] = "burstshot";
@@ -182,9 +119,6 @@ const char MtkCameraParameters::HIGH[] = "high";
 const char MtkCameraParameters::MIDDLE[] = "middle";
 const char MtkCameraParameters::LOW[] = "low";
 
-// Preview Internal Format.
-const char MtkCameraParameters::KEY_PREVIEW_INT_FORMAT[] = "prv-int-fmt";
-
 // Pixel color formats for KEY_PREVIEW_FORMAT, KEY_PICTURE_FORMAT,
 // and KEY_VIDEO_FRAME_FORMAT
 const char MtkCameraParameters::PIXEL_FORMAT_YUV420I[] = "yuv420i-yyuvyy-3plane";
@@ -196,13 +130,7 @@ const char MtkCameraParameters::PIXEL_FORMAT_YUV422I_YVYU[] = "yuv422i-yvyu";
 const char MtkCameraParameters::PIXEL_FORMAT_BAYER8[] = "bayer8"; 
 const char MtkCameraParameters::PIXEL_FORMAT_BAYER10[] = "bayer10";  
 
-const char MtkCameraParameters::KEY_BRIGHTNESS_VALUE[] = "brightness_value";
 
-// ISP Operation mode for meta mode use 
-const char MtkCameraParameters::KEY_ISP_MODE[] = "isp-mode"; 
-// AF 
-const char MtkCameraParameters::KEY_AF_X[] = "af-x"; 
-const char MtkCameraParameters::KEY_AF_Y[] = "af-y"; 
 // Effect 
 const char MtkCameraParameters::EFFECT_SEPIA_BLUE[] = "sepiablue";
 const char MtkCameraParameters::EFFECT_SEPIA_GREEN[] = "sepiagreen";
@@ -211,84 +139,881 @@ const char MtkCameraParameters::EFFECT_SEPIA_GREEN[] = "sepiagreen";
 //  on/off => FIXME: should be replaced with TRUE[]
 const char MtkCameraParameters::ON[] = "on";
 const char MtkCameraParameters::OFF[] = "off";
-// 
+//
 const char MtkCameraParameters::WHITE_BALANCE_TUNGSTEN[] = "tungsten";
 //
 const char MtkCameraParameters::ISO_SPEED_ENG[] = "iso-speed-eng";
-const char MtkCameraParameters::KEY_RAW_SAVE_MODE[] = "rawsave-mode";
-const char MtkCameraParameters::KEY_RAW_PATH[] = "rawfname";
-
-const char MtkCameraParameters::KEY_FAST_CONTINUOUS_SHOT[] = "fast-continuous-shot";
-
-const char MtkCameraParameters::KEY_CSHOT_INDICATOR[] = "cshot-indicator";
 
-// AF EM MODE
-const char MtkCameraParameters::KEY_FOCUS_ENG_MODE[]		= "afeng-mode";
-const char MtkCameraParameters::KEY_FOCUS_ENG_STEP[] 		= "afeng-pos";
-const char MtkCameraParameters::KEY_FOCUS_ENG_MAX_STEP[] 	= "afeng-max-focus-step";
-const char MtkCameraParameters::KEY_FOCUS_ENG_MIN_STEP[] 	= "afeng-min-focus-step";
-const char MtkCameraParameters::KEY_FOCUS_ENG_BEST_STEP[]   = "afeng-best-focus-step";
-const char MtkCameraParameters::KEY_RAW_DUMP_FLAG[]         = "afeng_raw_dump_flag";
-const char MtkCameraParameters::KEY_PREVIEW_DUMP_RESOLUTION[] = "preview-dump-resolution";
 // Values for KEY_PREVIEW_DUMP_RESOLUTION
 const int MtkCameraParameters::PREVIEW_DUMP_RESOLUTION_NORMAL  = 0;
 const int MtkCameraParameters::PREVIEW_DUMP_RESOLUTION_CROP  = 1;
-//
-const char MtkCameraParameters::KEY_MAX_NUM_DETECTED_OBJECT[] = "max-num-ot";
-//
-const char MtkCameraParameters::KEY_VIDEO_HDR[] = "video-hdr"; 
 
 // KEY for [Engineer Mode] Add new camera paramters for new requirements
-const char MtkCameraParameters::KEY_ENG_AE_ENABLE[] = "eng-ae-enable";
-const char MtkCameraParameters::KEY_ENG_PREVIEW_SHUTTER_SPEED[] = "eng-preview-shutter-speed";
-const char MtkCameraParameters::KEY_ENG_PREVIEW_SENSOR_GAIN[] = "eng-preview-sensor-gain";
-const char MtkCameraParameters::KEY_ENG_PREVIEW_ISP_GAIN[] = "eng-preview-isp-gain";
-const char MtkCameraParameters::KEY_ENG_PREVIEW_AE_INDEX[] = "eng-preview-ae-index";
-const char MtkCameraParameters::KEY_ENG_CAPTURE_SENSOR_GAIN[] = "eng-capture-sensor-gain";
-const char MtkCameraParameters::KEY_ENG_CAPTURE_ISP_GAIN[] = "eng-capture-isp-gain";
-const char MtkCameraParameters::KEY_ENG_CAPTURE_SHUTTER_SPEED[] = "eng-capture-shutter-speed";
-const char MtkCameraParameters::KEY_ENG_CAPTURE_ISO[] = "eng-capture-iso";
-const char MtkCameraParameters::KEY_ENG_FLASH_DUTY_VALUE[] = "eng-flash-duty-value";
-const char MtkCameraParameters::KEY_ENG_FLASH_DUTY_MIN[] = "eng-flash-duty-min";
-const char MtkCameraParameters::KEY_ENG_FLASH_DUTY_MAX[] = "eng-flash-duty-max";
-const char MtkCameraParameters::KEY_ENG_ZSD_ENABLE[] = "eng-zsd-enable";
-const char MtkCameraParameters::KEY_SENSOR_TYPE[] = "sensor-type";
-const char MtkCameraParameters::KEY_ENG_PREVIEW_FPS[] = "eng-preview-fps";
-const char MtkCameraParameters::KEY_ENG_MSG[] = "eng-msg";
 const int  MtkCameraParameters::KEY_ENG_FLASH_DUTY_DEFAULT_VALUE = -1;
 const int  MtkCameraParameters::KEY_ENG_FLASH_STEP_DEFAULT_VALUE = -1;
-const char MtkCameraParameters::KEY_ENG_FLASH_STEP_MIN[] = "eng-flash-step-min";
-const char MtkCameraParameters::KEY_ENG_FLASH_STEP_MAX[] = "eng-flash-step-max";
-const char MtkCameraParameters::KEY_ENG_FOCUS_FULLSCAN_FRAME_INTERVAL[] = "eng-focus-fullscan-frame-interval";
-const char MtkCameraParameters::KEY_ENG_FOCUS_FULLSCAN_FRAME_INTERVAL_MAX[] = "eng-focus-fullscan-frame-interval-max";
-const char MtkCameraParameters::KEY_ENG_FOCUS_FULLSCAN_FRAME_INTERVAL_MIN[] = "eng-focus-fullscan-frame-interval-min";
 const int  MtkCameraParameters::KEY_ENG_FOCUS_FULLSCAN_FRAME_INTERVAL_MAX_DEFAULT = 65535;
 const int  MtkCameraParameters::KEY_ENG_FOCUS_FULLSCAN_FRAME_INTERVAL_MIN_DEFAULT = 0;
-const char MtkCameraParameters::KEY_ENG_PREVIEW_FRAME_INTERVAL_IN_US[] = "eng-preview-frame-interval-in-us";
-const char MtkCameraParameters::KEY_ENG_PARAMETER1[] = "key-eng-parameter1";
-const char MtkCameraParameters::KEY_ENG_PARAMETER2[] = "key-eng-parameter2";
-const char MtkCameraParameters::KEY_ENG_PARAMETER3[] = "key-eng-parameter3";
 
-const char MtkCameraParameters::KEY_ENG_SAVE_SHADING_TABLE[] = "eng-save-shading-table";
-const char MtkCameraParameters::KEY_ENG_SHADING_TABLE[] = "eng-shading-table";
 const int MtkCameraParameters::KEY_ENG_SHADING_TABLE_AUTO = 0;
 const int MtkCameraParameters::KEY_ENG_SHADING_TABLE_LOW = 1;
 const int MtkCameraParameters::KEY_ENG_SHADING_TABLE_MIDDLE = 2;
 const int MtkCameraParameters::KEY_ENG_SHADING_TABLE_HIGH = 3;
 const int MtkCameraParameters::KEY_ENG_SHADING_TABLE_TSF = 4;
 
-// KEY for [Engineer Mode] Add new camera paramters for ev calibration
-const char MtkCameraParameters::KEY_ENG_EV_CALBRATION_OFFSET_VALUE[] = "eng-ev-cal-offset";
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Key table.
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+MtkCameraKey MtkCameraParameters::keyId(const char *key)
+{
+    return key ? mtkCameraKeyId(key) : MTK_KEY_INVALID;
+}
+
+MtkCameraKey MtkCameraParameters::keyId(const char *key, size_t len)
+{
+    return mtkCameraKeyId(key, len);
+}
+
+const char *MtkCameraParameters::keyName(MtkCameraKey id)
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return NULL;
+    return mtkcamkeys::kKeys[id].name;
+}
+
+MtkCameraKeyType MtkCameraParameters::keyType(MtkCameraKey id)
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return MTK_KEY_TYPE_STRING;
+    return mtkcamkeys::kKeys[id].type;
+}
+
+void MtkCameraParameters::copyKeys(MtkCameraParameters const& params)
+{
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        mValues[i] = params.mValues[i];
+        mTyped[i] = params.mTyped[i];
+    }
+    mPresent = params.mPresent;
+    mOther = params.mOther;
+    mKeysSynced = params.mKeysSynced;
+    mLoadStamp = params.mLoadStamp;
+}
+
+// Empties the mirror, other keys stay behind as removed
+void MtkCameraParameters::clearKeys() const
+{
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        mValues[i].clear();
+        mTyped[i].parsed = 0;
+    }
+    mPresent.clear();
+    for (size_t i = 0; i < mOther.size(); i++) {
+        OtherKey &o = mOther.editValueAt(i);
+        o.value.clear();
+        o.present = false;
+    }
+}
 
-#ifdef MTK_SLOW_MOTION_VIDEO_SUPPORT
-// High Speed Video Record
-const char MtkCameraParameters::KEY_HSVR_PRV_SIZE[] = "hsvr-prv-size";
-const char MtkCameraParameters::KEY_SUPPORTED_HSVR_PRV_SIZE[] = "hsvr-prv-size-values";
-const char MtkCameraParameters::KEY_HSVR_PRV_FPS[] = "hsvr-prv-fps";
-const char MtkCameraParameters::KEY_SUPPORTED_HSVR_PRV_FPS[] = "hsvr-prv-fps-values";
-#endif
-const char MtkCameraParameters::KEY_DXOEIS_ONOFF[] = "dxo-eis";
-const char MtkCameraParameters::KEY_FIX_EXPOSURE_TIME[] = "fix-exposure-time";
+/*
+ * Same parsing as CameraParameters::unflatten(), later duplicates win.
+ * Other keys written before the sync keep their generations.
+ */
+void MtkCameraParameters::syncKeys(const char *a) const
+{
+    const char *key, *value;
+    size_t keyLen, valueLen;
+    MtkCameraKey id;
+    OtherKey other;
+    ssize_t index;
+
+    clearKeys();
+    other.changed = 0;
+    other.seen = 0;
+    other.present = true;
+    while (mtkCameraNextEntry(&a, &key, &keyLen, &value, &valueLen)) {
+        id = keyId(key, keyLen);
+        if (id != MTK_KEY_INVALID) {
+            mValues[id].setTo(value, valueLen);
+            mPresent.add(id);
+        } else if ((index = findOther(key, keyLen)) >= 0) {
+            OtherKey &o = mOther.editValueAt(index);
+            o.value.setTo(value, valueLen);
+            o.present = true;
+        } else {
+            other.value.setTo(value, valueLen);
+            mOther.add(String8(key, keyLen), other);
+        }
+    }
+    mKeysSynced = true;
+}
+
+// Orders keys the way String8 does, which is the order of the map
+static int compareKeys(const char *a, size_t aLen, const char *b, size_t bLen)
+{
+    int c = memcmp(a, b, aLen < bLen ? aLen : bLen);
+
+    if (c != 0)
+        return c;
+    return aLen < bLen ? -1 : aLen > bLen;
+}
+
+// Index of the key in mOther, without building a String8 for it
+ssize_t MtkCameraParameters::findOther(const char *key, size_t len) const
+{
+    ssize_t lo = 0, hi = (ssize_t)mOther.size() - 1;
+
+    while (lo <= hi) {
+        ssize_t mid = (lo + hi) / 2;
+        const String8 &k = mOther.keyAt(mid);
+        int c = compareKeys(k.string(), k.length(), key, len);
+        if (c == 0)
+            return mid;
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -1;
+}
 
-}; // namespace android
+/*
+ * Stores the value of the key in the mirror, or marks it removed for a
+ * NULL value, and records the change; true if the value changed.
+ */
+bool MtkCameraParameters::mirror(MtkCameraKey id, const char *key, size_t keyLen,
+        const char *value, size_t valueLen, uint32_t generation, uint32_t stamp)
+{
+    if (id != MTK_KEY_INVALID) {
+        String8 &v = mValues[id];
+        if (value == NULL) {
+            if (!mPresent.contains(id))
+                return false;
+            mPresent.remove(id);
+            v.clear();
+        } else {
+            if (mPresent.contains(id) && v.length() == valueLen &&
+                    memcmp(v.string(), value, valueLen) == 0)
+                return false;
+            mPresent.add(id);
+            v.setTo(value, valueLen);
+        }
+        mTyped[id].parsed = 0;
+        mChanged[id] = generation;
+        return true;
+    }
+
+    ssize_t i = findOther(key, keyLen);
+    if (i < 0) {
+        if (value == NULL)
+            return false;
+        OtherKey other;
+        other.value.setTo(value, valueLen);
+        other.changed = generation;
+        other.seen = stamp;
+        other.present = true;
+        mOther.add(String8(key, keyLen), other);
+        return true;
+    }
+
+    OtherKey &other = mOther.editValueAt(i);
+    other.seen = stamp;
+    if (value == NULL) {
+        if (!other.present)
+            return false;
+        other.present = false;
+        other.value.clear();
+    } else {
+        if (other.present && other.value.length() == valueLen &&
+                memcmp(other.value.string(), value, valueLen) == 0)
+            return false;
+        other.present = true;
+        other.value.setTo(value, valueLen);
+    }
+    other.changed = generation;
+    return true;
+}
 
+/*
+ * Brings the mirror to the contents of a flatten() string, keys it does
+ * not list count as removed; true if anything changed.
+ */
+bool MtkCameraParameters::load(const char *a)
+{
+    uint32_t generation = mGeneration + 1;
+    uint32_t stamp = ++mLoadStamp;
+    const char *key, *value;
+    size_t keyLen, valueLen;
+    MtkCameraKeySet seen;
+    MtkCameraKey id;
+    bool changed = false;
+
+    while (mtkCameraNextEntry(&a, &key, &keyLen, &value, &valueLen)) {
+        id = keyId(key, keyLen);
+        if (id != MTK_KEY_INVALID)
+            seen.add(id);
+        if (mirror(id, key, keyLen, value, valueLen, generation, stamp))
+            changed = true;
+    }
+    if (removeUnseen(seen, generation, stamp))
+        changed = true;
+
+    if (changed)
+        mGeneration = generation;
+    return changed;
+}
+
+/*
+ * Removes the MTK keys a load did not list and the other keys it did
+ * not stamp; true if there were any.
+ */
+bool MtkCameraParameters::removeUnseen(const MtkCameraKeySet &seen, uint32_t generation,
+        uint32_t stamp)
+{
+    bool changed = false;
+
+    for (MtkCameraKey id = mPresent.next(MTK_KEY_INVALID); id != MTK_KEY_INVALID;
+            id = mPresent.next(id)) {
+        if (!seen.contains(id) && mirror(id, NULL, 0, NULL, 0, generation, stamp))
+            changed = true;
+    }
+    for (size_t i = 0; i < mOther.size(); i++) {
+        if (!mOther.valueAt(i).present || mOther.valueAt(i).seen == stamp)
+            continue;
+        OtherKey &other = mOther.editValueAt(i);
+        other.present = false;
+        other.value.clear();
+        other.changed = generation;
+        changed = true;
+    }
+    return changed;
+}
+
+// CameraParameters::set() drops keys and values that would not unflatten
+bool MtkCameraParameters::storable(const char *key, const char *value)
+{
+    return strpbrk(key, "=;") == NULL && strpbrk(value, "=;") == NULL;
+}
+
+void MtkCameraParameters::copyChanges(MtkCameraParameters const& params)
+{
+    mGeneration = params.mGeneration;
+    mReplaceGeneration = params.mReplaceGeneration;
+    memcpy(mChanged, params.mChanged, sizeof(mChanged));
+}
+
+void MtkCameraParameters::replaced()
+{
+    mReplaceGeneration = ++mGeneration;
+    if (!mKeysSynced) {
+        // Start over with the keys written from now on, see update()
+        mPresent.clear();
+        mOther.clear();
+        return;
+    }
+    // Removals before this are reported as a full flatten(), forget them
+    for (size_t i = mOther.size(); i-- > 0; ) {
+        if (!mOther.valueAt(i).present)
+            mOther.removeItemsAt(i);
+    }
+}
+
+void MtkCameraParameters::replace(MtkCameraParameters const& params)
+{
+    if (&params == this)
+        return;
+    CameraParameters::operator=(params);
+    copyKeys(params);
+    mFrozen = false;
+    replaced();
+}
+
+// A change the mirror already has, the map got it some other way
+void MtkCameraParameters::markChanged(MtkCameraKey id, const char *key, size_t keyLen,
+        bool removed, uint32_t generation)
+{
+    if (id != MTK_KEY_INVALID) {
+        mChanged[id] = generation;
+        return;
+    }
+
+    ssize_t i = findOther(key, keyLen);
+    if (i >= 0) {
+        mOther.editValueAt(i).changed = generation;
+    } else if (removed) {
+        OtherKey other;
+        other.changed = generation;
+        other.seen = mLoadStamp;
+        other.present = false;
+        mOther.add(String8(key, keyLen), other);
+    }
+}
+
+// Writes the key, or removes it for a NULL value; true if the value changed
+bool MtkCameraParameters::update(const char *key, const char *value, uint32_t generation)
+{
+    if (value && !storable(key, value))
+        return false;
+
+    size_t keyLen = strlen(key);
+    MtkCameraKey id = keyId(key, keyLen);
+    const char *v = CameraParameters::get(key);
+    const char *want = value != NULL && *value != '\0' ? value : NULL;
+
+    /*
+     * The map has the last word, writes through a CameraParameters
+     * reference reach it without the mirror. get() reads "" as missing,
+     * between those two the mirror decides.
+     */
+    bool stale = v == NULL || want == NULL ? v != want : strcmp(v, want) != 0;
+
+    /*
+     * After a copy from CameraParameters the mirror only has the keys
+     * written since, syncing the rest would flatten the whole map. get()
+     * cannot tell "" from a missing key, so only a value it returns
+     * counts as unchanged; otherwise the mirror starts out from a state
+     * the write is sure to change.
+     */
+    if (!mKeysSynced && !(id != MTK_KEY_INVALID ? mChanged[id] > mReplaceGeneration
+            : findOther(key, keyLen) >= 0)) {
+        if (want != NULL && !stale)
+            return false;
+        mirror(id, key, keyLen, value ? NULL : "", 0, 0, mLoadStamp);
+    }
+
+    if (!mirror(id, key, keyLen, value, value ? strlen(value) : 0, generation, mLoadStamp)) {
+        if (!stale)
+            return false;
+        markChanged(id, key, keyLen, value == NULL, generation);
+    }
+
+    if (value)
+        CameraParameters::set(key, value);
+    else
+        CameraParameters::remove(key);
+    return true;
+}
+
+void MtkCameraParameters::unflatten(const String8 &params)
+{
+    CameraParameters::unflatten(params);
+    if (mKeysSynced) {
+        load(params.string());
+    } else {
+        // Nothing to compare with, it counts as replaced
+        syncKeys(params.string());
+        replaced();
+    }
+}
+
+void MtkCameraParameters::set(const char *key, const char *value)
+{
+    if (update(key, value, mGeneration + 1))
+        mGeneration++;
+}
+
+void MtkCameraParameters::set(const char *key, int value)
+{
+    char str[16];
+    snprintf(str, sizeof(str), "%d", value);
+    set(key, str);
+}
+
+void MtkCameraParameters::setFloat(const char *key, float value)
+{
+    char str[16];  // 14 should be enough. We overestimate to be safe.
+    snprintf(str, sizeof(str), "%g", value);
+    set(key, str);
+}
+
+void MtkCameraParameters::remove(const char *key)
+{
+    if (update(key, NULL, mGeneration + 1))
+        mGeneration++;
+}
+
+void MtkCameraParameters::setPreviewSize(int width, int height)
+{
+    char str[32];
+    snprintf(str, sizeof(str), "%dx%d", width, height);
+    set(KEY_PREVIEW_SIZE, str);
+}
+
+void MtkCameraParameters::setPreviewFrameRate(int fps)
+{
+    set(KEY_PREVIEW_FRAME_RATE, fps);
+}
+
+void MtkCameraParameters::setPreviewFormat(const char *format)
+{
+    set(KEY_PREVIEW_FORMAT, format);
+}
+
+void MtkCameraParameters::setPictureSize(int width, int height)
+{
+    char str[32];
+    snprintf(str, sizeof(str), "%dx%d", width, height);
+    set(KEY_PICTURE_SIZE, str);
+}
+
+void MtkCameraParameters::setPictureFormat(const char *format)
+{
+    set(KEY_PICTURE_FORMAT, format);
+}
+
+void MtkCameraParameters::setVideoSize(int width, int height)
+{
+    char str[32];
+    snprintf(str, sizeof(str), "%dx%d", width, height);
+    set(KEY_VIDEO_SIZE, str);
+}
+
+const char *MtkCameraParameters::get(MtkCameraKey id) const
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return NULL;
+    if (!mKeysSynced)
+        syncKeys(flatten().string());
+    return mValues[id].length() ? mValues[id].string() : NULL;
+}
+
+int MtkCameraParameters::getInt(MtkCameraKey id) const
+{
+    const TypedValue *t = typed(id, PARSED_INT);
+    if (t == 0 || mValues[id].length() == 0)
+        return -1;
+    return t->i;
+}
+
+float MtkCameraParameters::getFloat(MtkCameraKey id) const
+{
+    const TypedValue *t = typed(id, PARSED_FLOAT);
+    if (t == 0 || mValues[id].length() == 0)
+        return -1;
+    return t->f;
+}
+
+void MtkCameraParameters::set(MtkCameraKey id, const char *value)
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return;
+    set(mtkcamkeys::kKeys[id].name, value);
+}
+
+void MtkCameraParameters::set(MtkCameraKey id, int value)
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return;
+    set(mtkcamkeys::kKeys[id].name, value);
+}
+
+void MtkCameraParameters::setFloat(MtkCameraKey id, float value)
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return;
+    setFloat(mtkcamkeys::kKeys[id].name, value);
+}
+
+void MtkCameraParameters::remove(MtkCameraKey id)
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return;
+    remove(mtkcamkeys::kKeys[id].name);
+}
+
+
+// Parses the requested view of a key once, later calls reuse it
+const MtkCameraParameters::TypedValue *MtkCameraParameters::typed(MtkCameraKey id, int view) const
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return NULL;
+    if (!mKeysSynced)
+        syncKeys(flatten().string());
+
+    TypedValue &t = mTyped[id];
+    if (t.parsed == 0)
+        t.valid = 0;
+    if (t.parsed & view)
+        return &t;
+
+    const char *v = mValues[id].string();
+    char *end;
+    t.parsed |= view;
+    if (mValues[id].length() == 0)
+        return &t;
+
+    switch (view) {
+    case PARSED_INT:
+        t.i = strtol(v, &end, 0);
+        if (end != v)
+            t.valid |= PARSED_INT;
+        break;
+    case PARSED_FLOAT:
+        t.f = strtof(v, &end);
+        if (end != v)
+            t.valid |= PARSED_FLOAT;
+        break;
+    case PARSED_SIZE:
+        t.width = strtol(v, &end, 10);
+        if (end == v || *end != 'x')
+            break;
+        v = end + 1;
+        t.height = strtol(v, &end, 10);
+        if (end != v)
+            t.valid |= PARSED_SIZE;
+        break;
+    }
+    return &t;
+}
+
+status_t MtkCameraParameters::checkBounds(MtkCameraKey id, float value) const
+{
+    int min, max;
+
+    if (getRange(id, &min, &max) == NO_ERROR && (value < min || value > max))
+        return BAD_VALUE;
+    return NO_ERROR;
+}
+
+status_t MtkCameraParameters::getInt(MtkCameraKey id, int *value) const
+{
+    const TypedValue *t = typed(id, PARSED_INT);
+    if (t == 0 || !(t->valid & PARSED_INT))
+        return NAME_NOT_FOUND;
+    *value = t->i;
+    return checkBounds(id, t->i);
+}
+
+status_t MtkCameraParameters::getFloat(MtkCameraKey id, float *value) const
+{
+    const TypedValue *t = typed(id, PARSED_FLOAT);
+    if (t == 0 || !(t->valid & PARSED_FLOAT))
+        return NAME_NOT_FOUND;
+    *value = t->f;
+    return checkBounds(id, t->f);
+}
+
+status_t MtkCameraParameters::getSize(MtkCameraKey id, int *width, int *height) const
+{
+    const TypedValue *t = typed(id, PARSED_SIZE);
+    if (t == 0 || !(t->valid & PARSED_SIZE))
+        return NAME_NOT_FOUND;
+    *width = t->width;
+    *height = t->height;
+    return NO_ERROR;
+}
+
+status_t MtkCameraParameters::getRange(MtkCameraKey id, int *min, int *max) const
+{
+    const TypedValue *t;
+    bool found = false;
+
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return NAME_NOT_FOUND;
+
+    *min = INT_MIN;
+    *max = INT_MAX;
+    if (mtkcamkeys::kBounds.min[id] != 0) {
+        t = typed(MtkCameraKey(mtkcamkeys::kBounds.min[id] - 1), PARSED_INT);
+        if (t->valid & PARSED_INT) {
+            *min = t->i;
+            found = true;
+        }
+    }
+    if (mtkcamkeys::kBounds.max[id] != 0) {
+        t = typed(MtkCameraKey(mtkcamkeys::kBounds.max[id] - 1), PARSED_INT);
+        if (t->valid & PARSED_INT) {
+            *max = t->i;
+            found = true;
+        }
+    }
+    return found ? NO_ERROR : NAME_NOT_FOUND;
+}
+
+static int findEnum(const String8 &value, const char * const *values)
+{
+    for (int i = 0; values[i] != NULL; i++) {
+        if (value == values[i])
+            return i;
+    }
+    return -1;
+}
+
+int MtkCameraParameters::getEnum(MtkCameraKey id, const char * const *values) const
+{
+    if (id < 0 || id >= MTK_KEY_COUNT)
+        return -1;
+    // Shared between threads, look it up without touching the cache
+    if (mFrozen)
+        return findEnum(mValues[id], values);
+
+    typed(id, PARSED_ENUM);
+
+    // Cached per list, a caller passing another list reparses
+    TypedValue &e = mTyped[id];
+    if ((e.valid & PARSED_ENUM) && e.enumValues == values)
+        return e.enumIndex;
+
+    e.enumValues = values;
+    e.enumIndex = findEnum(mValues[id], values);
+    e.valid |= PARSED_ENUM;
+    return e.enumIndex;
+}
+
+void MtkCameraParameters::freeze()
+{
+    if (!mKeysSynced)
+        syncKeys(flatten().string());
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        typed(MtkCameraKey(i), PARSED_INT);
+        typed(MtkCameraKey(i), PARSED_FLOAT);
+        typed(MtkCameraKey(i), PARSED_SIZE);
+    }
+    mFrozen = true;
+}
+
+bool MtkCameraParameters::flattenDelta(uint32_t since, String8 *delta) const
+{
+    if (since < mReplaceGeneration) {
+        *delta = flatten();
+        return false;
+    }
+
+    delta->clear();
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        if (mChanged[i] <= since)
+            continue;
+        if (delta->length())
+            delta->append(";");
+        delta->append(mtkcamkeys::kKeys[i].name);
+        if (mPresent.contains(MtkCameraKey(i))) {
+            delta->append("=");
+            delta->append(mValues[i]);
+        }
+    }
+    for (size_t i = 0; i < mOther.size(); i++) {
+        OtherKey const& other = mOther.valueAt(i);
+        if (other.changed <= since)
+            continue;
+        if (delta->length())
+            delta->append(";");
+        delta->append(mOther.keyAt(i));
+        if (other.present) {
+            delta->append("=");
+            delta->append(other.value);
+        }
+    }
+    return true;
+}
+
+void MtkCameraParameters::unflattenDelta(const String8 &delta)
+{
+    uint32_t generation = mGeneration + 1;
+    bool changed = false;
+    const char *a = delta.string();
+
+    // Not mtkCameraNextEntry(), a removed key has no '='
+    while (*a) {
+        const char *end = strchr(a, ';');
+        size_t len = end ? (size_t)(end - a) : strlen(a);
+        const char *eq = (const char *)memchr(a, '=', len);
+
+        if (len) {
+            String8 k(a, eq ? (size_t)(eq - a) : len);
+            String8 v;
+            if (eq)
+                v.setTo(eq + 1, len - (eq + 1 - a));
+            if (update(k.string(), eq ? v.string() : NULL, generation))
+                changed = true;
+        }
+        a += len;
+        if (*a)
+            a++;
+    }
+
+    if (changed)
+        mGeneration = generation;
+}
+
+MtkCameraKeySet MtkCameraParameters::changedKeys(uint32_t since) const
+{
+    MtkCameraKeySet keys;
+
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        if (since < mReplaceGeneration || mChanged[i] > since)
+            keys.add(MtkCameraKey(i));
+    }
+    return keys;
+}
+
+bool MtkCameraParameters::isChanged(const char *key, uint32_t since) const
+{
+    if (since < mReplaceGeneration)
+        return true;
+
+    size_t len = strlen(key);
+    MtkCameraKey id = keyId(key, len);
+    if (id != MTK_KEY_INVALID)
+        return mChanged[id] > since;
+    ssize_t i = findOther(key, len);
+    return i >= 0 && mOther.valueAt(i).changed > since;
+}
+
+/*
+ * Straight from the mirror, which lists the keys of the map unless they
+ * were written through a plain CameraParameters reference. The map is
+ * sorted by key, so the registry keys go in name order, merged with the
+ * other keys.
+ */
+status_t MtkCameraParameters::flattenBinary(Vector<uint8_t> *out) const
+{
+    size_t entries = 0, text = 0, o = 0;
+
+    if (!mKeysSynced)
+        syncKeys(flatten().string());
+
+    for (MtkCameraKey id = mPresent.next(MTK_KEY_INVALID); id != MTK_KEY_INVALID;
+            id = mPresent.next(id)) {
+        entries++;
+        text += strlen(mtkcamkeys::kKeys[id].name) + mValues[id].length();
+    }
+    for (size_t i = 0; i < mOther.size(); i++) {
+        if (mOther.valueAt(i).present) {
+            entries++;
+            text += mOther.keyAt(i).length() + mOther.valueAt(i).value.length();
+        }
+    }
+
+    MtkCameraBinaryWriter writer(out, entries, text);
+    for (int k = 0; k <= MTK_KEY_COUNT; k++) {
+        const char *name = NULL;
+        size_t len = 0;
+        MtkCameraKey id = MTK_KEY_INVALID;
+
+        if (k < MTK_KEY_COUNT) {
+            id = MtkCameraKey(mtkcamkeys::kOrder.ids[k]);
+            if (!mPresent.contains(id))
+                continue;
+            name = mtkcamkeys::kKeys[id].name;
+            len = strlen(name);
+        }
+        // Other keys before this one, all that are left after the last
+        for (; o < mOther.size(); o++) {
+            const String8 &key = mOther.keyAt(o);
+            OtherKey const& other = mOther.valueAt(o);
+            if (name != NULL && compareKeys(key.string(), key.length(), name, len) > 0)
+                break;
+            if (other.present)
+                writer.add(MTK_KEY_INVALID, key.string(), key.length(),
+                        other.value.string(), other.value.length());
+        }
+        if (name != NULL)
+            writer.add(id, name, len, mValues[id].string(), mValues[id].length());
+    }
+    return writer.finish();
+}
+
+// The flatten() text of a binary parameter set
+static void binaryText(MtkCameraBinaryReader *reader, String8 *text)
+{
+    MtkCameraBinaryReader::Entry e;
+    char *p = text->lockBuffer(reader->textLength());
+    char *start = p;
+
+    while (reader->next(&e)) {
+        if (p != start)
+            *p++ = ';';
+        memcpy(p, e.key, e.keyLen);
+        p += e.keyLen;
+        *p++ = '=';
+        if (e.value == NULL) {
+            p += mtkCameraFormatInt(e.intValue, p);
+        } else {
+            memcpy(p, e.value, e.valueLen);
+            p += e.valueLen;
+        }
+    }
+    text->unlockBuffer(p - start);
+}
+
+/*
+ * Fills the map and the mirror entry by entry, the way load() does from
+ * text, without going through the text form.
+ */
+status_t MtkCameraParameters::unflattenBinary(const void *data, size_t size)
+{
+    MtkCameraBinaryReader reader(data, size);
+    MtkCameraBinaryReader::Entry e;
+    Vector<char> scratch;
+    MtkCameraKeySet seen;
+    bool changed = false;
+
+    // Nothing changes unless the whole buffer checks out
+    status_t err = reader.init();
+    if (err != NO_ERROR)
+        return err;
+
+    // Only unflatten() takes a value with '='
+    if (!reader.settable()) {
+        String8 text;
+        binaryText(&reader, &text);
+        unflatten(text);
+        return NO_ERROR;
+    }
+
+    uint32_t generation = mGeneration + 1;
+    uint32_t stamp = ++mLoadStamp;
+    bool synced = mKeysSynced;
+
+    // set() takes NUL terminated strings, any one entry fits the text length
+    scratch.resize(reader.textLength() + 1);
+    char *key = scratch.editArray();
+
+    CameraParameters::unflatten(String8());
+    if (!synced)
+        clearKeys();
+    while (reader.next(&e)) {
+        char *value = key + e.keyLen + 1;
+        size_t valueLen;
+
+        memcpy(key, e.key, e.keyLen);
+        key[e.keyLen] = '\0';
+        if (e.value == NULL) {
+            valueLen = mtkCameraFormatInt(e.intValue, value);
+            value[valueLen] = '\0';
+        } else {
+            memcpy(value, e.value, e.valueLen);
+            value[e.valueLen] = '\0';
+            valueLen = e.valueLen;
+        }
+        CameraParameters::set(key, value);
+
+        if (e.id != MTK_KEY_INVALID)
+            seen.add(e.id);
+        if (mirror(e.id, key, e.keyLen, value, valueLen, generation, stamp))
+            changed = true;
+
+        // Integers come already parsed
+        if (e.value == NULL && e.id != MTK_KEY_INVALID) {
+            TypedValue &t = mTyped[e.id];
+            if (t.parsed == 0)
+                t.valid = 0;
+            t.parsed |= PARSED_INT;
+            t.valid |= PARSED_INT;
+            t.i = e.intValue;
+        }
+    }
+
+    if (!synced) {
+        // Nothing to compare with, it counts as replaced
+        mKeysSynced = true;
+        replaced();
+    } else {
+        if (removeUnseen(seen, generation, stamp))
+            changed = true;
+        if (changed)
+            mGeneration = generation;
+    }
+    return NO_ERROR;
+}
+
+}; // namespace android
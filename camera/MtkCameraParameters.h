@@ -18,6 +18,9 @@
 #define ANDROID_HARDWARE_MTK_CAMERA_PARAMETERS_H
 
 #include <camera/CameraParameters.h>
+#include <utils/Errors.h>
+#include <utils/Vector.h>
+#include "MtkCameraKeys.h"
 
 namespace android {
 
@@ -30,15 +33,153 @@ namespace android {
 class MtkCameraParameters : public CameraParameters
 {
 public:
-    MtkCameraParameters() : CameraParameters() {}
-    MtkCameraParameters(const String8 &params) { unflatten(params); }
+    MtkCameraParameters()
+        : CameraParameters(), mTyped(), mKeysSynced(true), mFrozen(false), mLoadStamp(0),
+          mGeneration(0), mReplaceGeneration(0), mChanged() {}
+    MtkCameraParameters(const String8 &params)
+        : mTyped(), mKeysSynced(true), mFrozen(false), mLoadStamp(0),
+          mGeneration(0), mReplaceGeneration(0), mChanged() { unflatten(params); }
     ~MtkCameraParameters()  {}
 
+    /*
+     * The key/value map is a copy-on-write KeyedVector, so copies only
+     * take a reference on it; there is no need to go through flatten()
+     * and unflatten(), which rebuilds every key and value string.
+     *
+     * For change tracking a copy of an MtkCameraParameters, constructed
+     * or assigned, takes over its generations: changedKeys(since) on the
+     * copy answers exactly as on the original. Anything else replaces
+     * everything, see flattenDelta(). There are no move operations, the
+     * map cannot be moved from and sharing its buffer is just as cheap.
+     */
+    explicit MtkCameraParameters(CameraParameters const& params)
+        : CameraParameters(params), mTyped(), mKeysSynced(false), mFrozen(false), mLoadStamp(0),
+          mGeneration(0), mReplaceGeneration(0), mChanged() { replaced(); }
+    MtkCameraParameters(MtkCameraParameters const& params)
+        : CameraParameters(params), mFrozen(false) { copyKeys(params); copyChanges(params); }
+
     MtkCameraParameters& operator=(CameraParameters const& params)
     {
-        unflatten(params.flatten());
+        CameraParameters::operator=(params);
+        mKeysSynced = false;
+        mFrozen = false;
+        replaced();
         return  (*this);
     }
+    MtkCameraParameters& operator=(MtkCameraParameters const& params)
+    {
+        CameraParameters::operator=(params);
+        copyKeys(params);
+        copyChanges(params);
+        mFrozen = false;
+        return  (*this);
+    }
+
+    /*
+     * Takes the values of params as a change of this object instead of
+     * its history: generations keep counting from this object's own, and
+     * everything counts as changed for any earlier one. For holders of a
+     * generation of this object that may predate params.
+     */
+    void replace(MtkCameraParameters const& params);
+
+    /*
+     * Besides the map, the values of the keys in MtkCameraKeys.h are kept
+     * in a table indexed by MtkCameraKey, so the HAL can read them with an
+     * array access instead of a map lookup. The setters below keep both
+     * in sync, including those CameraParameters implements on its own
+     * set(). A key written through a plain CameraParameters reference
+     * reaches neither the table nor the change tracking below until it is
+     * written here again; that write always lands in the map, and counts
+     * as a change if the map had anything else.
+     */
+    void unflatten(const String8 &params);
+    void set(const char *key, const char *value);
+    void set(const char *key, int value);
+    void setFloat(const char *key, float value);
+    void remove(const char *key);
+    void setPreviewSize(int width, int height);
+    void setPreviewFrameRate(int fps);
+    void setPreviewFormat(const char *format);
+    void setPictureSize(int width, int height);
+    void setPictureFormat(const char *format);
+    void setVideoSize(int width, int height);
+
+    using CameraParameters::get;
+    using CameraParameters::getInt;
+    using CameraParameters::getFloat;
+
+    // Id of an MTK key, MTK_KEY_INVALID for anything else
+    static MtkCameraKey keyId(const char *key);
+    static MtkCameraKey keyId(const char *key, size_t len);
+    static const char *keyName(MtkCameraKey id);
+    static MtkCameraKeyType keyType(MtkCameraKey id);
+
+    // Same semantics as the string versions: NULL or -1 when unset
+    const char *get(MtkCameraKey id) const;
+    int getInt(MtkCameraKey id) const;
+    float getFloat(MtkCameraKey id) const;
+
+    void set(MtkCameraKey id, const char *value);
+    void set(MtkCameraKey id, int value);
+    void setFloat(MtkCameraKey id, float value);
+    void remove(MtkCameraKey id);
+
+    /*
+     * Typed views of the values, parsed on first use and kept until the
+     * key is written again, so reading them every frame parses nothing.
+     * They return NAME_NOT_FOUND when the key is unset or does not parse,
+     * and BAD_VALUE when the number is outside the limits given by the
+     * key's -min/-max companions; *value is filled in either way.
+     */
+    status_t getInt(MtkCameraKey id, int *value) const;
+    status_t getFloat(MtkCameraKey id, float *value) const;
+    status_t getSize(MtkCameraKey id, int *width, int *height) const;
+    // Limits of the key, INT_MIN/INT_MAX for a side that is not set
+    status_t getRange(MtkCameraKey id, int *min, int *max) const;
+    // Index of the value in a NULL terminated list, -1 if it is not there
+    int getEnum(MtkCameraKey id, const char * const *values) const;
+
+    /*
+     * Change tracking. Every write that changes a value, and every
+     * unflatten() or unflattenDelta() that changes any, moves generation()
+     * forward; writes that store the value already there do not.
+     *
+     * flattenDelta() returns the keys changed after the given generation
+     * in the flatten() format, except that a removed key is written bare,
+     * without '=', so it differs from one set to "". It is to be applied
+     * on the other side with unflattenDelta(). When the object
+     * was copied or assigned since, the changes are unknown: it returns
+     * false and the full flatten(), to be applied with unflatten().
+     */
+    uint32_t generation() const { return mGeneration; }
+    bool flattenDelta(uint32_t since, String8 *delta) const;
+    void unflattenDelta(const String8 &delta);
+
+    // MTK keys changed after the given generation
+    MtkCameraKeySet changedKeys(uint32_t since) const;
+    // Same for any key
+    bool isChanged(const char *key, uint32_t since) const;
+
+    /*
+     * Compact binary form of flatten(), laid out in MtkCameraBinary.h.
+     * flattenBinary() encodes the table and the other keys it tracks,
+     * so like flattenDelta() it misses keys written through a plain
+     * CameraParameters reference. unflattenBinary() reads the buffer in
+     * place and leaves the parameters alone when it does not check out.
+     * It is about as fast as unflatten(), which is mostly rebuilding the
+     * map either way: the binary form saves bytes, not time.
+     */
+    status_t flattenBinary(Vector<uint8_t> *out) const;
+    status_t unflattenBinary(const void *data, size_t size);
+
+    /*
+     * Reads fill the key table and the typed views lazily, so even const
+     * access writes to the object. freeze() fills everything in upfront;
+     * after that const access is safe from any number of threads, as long
+     * as nobody writes to the object anymore.
+     */
+    void freeze();
     //
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //  App Mode.
@@ -343,6 +484,70 @@ public:
 public:     ////    on/off => FIXME: should be replaced with TRUE[]
     static const char ON[];
     static const char OFF[];
+
+private:
+    enum {
+        PARSED_INT      = 1 << 0,
+        PARSED_FLOAT    = 1 << 1,
+        PARSED_SIZE     = 1 << 2,
+        PARSED_ENUM     = 1 << 3,
+    };
+
+    struct TypedValue {
+        uint8_t parsed;     // PARSED_* views computed since the last write
+        uint8_t valid;      // PARSED_* views that parsed successfully
+        int32_t i;
+        float f;
+        int32_t width;
+        int32_t height;
+        const char * const *enumValues;
+        int32_t enumIndex;
+    };
+
+    // A key that is not in MtkCameraKeys.h
+    struct OtherKey {
+        String8 value;
+        uint32_t changed;   // generation of the last change
+        uint32_t seen;      // load() that last found it
+        bool present;       // false once removed, kept to report that
+    };
+
+    void copyKeys(MtkCameraParameters const& params);
+    void clearKeys() const;
+    void syncKeys(const char *flattened) const;
+    const TypedValue *typed(MtkCameraKey id, int view) const;
+    status_t checkBounds(MtkCameraKey id, float value) const;
+    ssize_t findOther(const char *key, size_t len) const;
+    bool mirror(MtkCameraKey id, const char *key, size_t keyLen, const char *value,
+            size_t valueLen, uint32_t generation, uint32_t stamp);
+    void markChanged(MtkCameraKey id, const char *key, size_t keyLen, bool removed,
+            uint32_t generation);
+    bool load(const char *flattened);
+    bool removeUnseen(const MtkCameraKeySet &seen, uint32_t generation, uint32_t stamp);
+    static bool storable(const char *key, const char *value);
+    bool update(const char *key, const char *value, uint32_t generation);
+    void copyChanges(MtkCameraParameters const& params);
+    void replaced();
+
+    /*
+     * Mirror of the map, so changes are found without flatten() and a key
+     * set to "" is told apart from a missing one, which get() cannot do.
+     * After a copy from CameraParameters it only has the keys written
+     * since, until it is rebuilt from the map on first read.
+     */
+    mutable String8 mValues[MTK_KEY_COUNT];
+    mutable TypedValue mTyped[MTK_KEY_COUNT];
+    mutable MtkCameraKeySet mPresent;
+    mutable KeyedVector<String8, OtherKey> mOther;
+    mutable bool mKeysSynced;
+    bool mFrozen;
+    uint32_t mLoadStamp;
+
+    uint32_t mGeneration;
+    // Generation of the last copy or assignment
+    uint32_t mReplaceGeneration;
+    // Generation of the last change of each MTK key, see mOther for others
+    uint32_t mChanged[MTK_KEY_COUNT];
 };
 
 }; // namespace android
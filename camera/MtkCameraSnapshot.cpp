@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MTKCameraParams"
+#include <utils/Log.h>
+
+#include "MtkCameraSnapshot.h"
+
+namespace android {
+
+/*
+ * The reference count is split in two. Readers reserve a reference by
+ * adding kOne to the published word, which also tells them the pointer,
+ * and pay it back on the snapshot's own count. While published that own
+ * count carries kBias, so it stays above zero however far ahead of the
+ * reservations the paybacks run. On unpublish the writer moves the
+ * reservations over and drops the bias, and the count is exact again.
+ *
+ * User space pointers fit in 48 bits on 64 bit targets, which leaves 16
+ * bits for reservations. Readers fold them into the snapshot's count
+ * once they pass kFold, long before they could run into the pointer.
+ */
+static const int kPointerBits = sizeof(void *) == 8 ? 48 : 32;
+static const uint64_t kOne = 1ULL << kPointerBits;
+static const uint64_t kPointerMask = kOne - 1;
+static const uint64_t kFold = 1 << 10;
+static const int32_t kBias = 1 << 30;
+
+typedef MtkCameraParametersSnapshot Snapshot;
+
+static const Snapshot *pointerOf(uint64_t v)
+{
+    return (const Snapshot *)(uintptr_t)(v & kPointerMask);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Snapshot
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Created published, see MtkCameraParametersPublisher
+MtkCameraParametersSnapshot::MtkCameraParametersSnapshot(const MtkCameraParameters &params)
+    : mParams(params),
+      mRefs(kBias)
+{
+    mParams.freeze();
+}
+
+void MtkCameraParametersSnapshot::incStrong(const void * /* id */) const
+{
+    mRefs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MtkCameraParametersSnapshot::decStrong(const void * /* id */) const
+{
+    release(1);
+}
+
+void MtkCameraParametersSnapshot::release(int32_t refs) const
+{
+    if (mRefs.fetch_sub(refs, std::memory_order_acq_rel) == refs)
+        delete this;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Publisher
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+void MtkCameraParametersPublisher::unpublish(uint64_t current)
+{
+    int32_t reserved = (int32_t)(current >> kPointerBits);
+
+    pointerOf(current)->release(kBias - reserved);
+}
+
+MtkCameraParametersPublisher::MtkCameraParametersPublisher()
+    : mCurrent(0)
+{
+    publishLocked();
+}
+
+MtkCameraParametersPublisher::MtkCameraParametersPublisher(const MtkCameraParameters &params)
+    : mCurrent(0),
+      mWorking(params)
+{
+    publishLocked();
+}
+
+MtkCameraParametersPublisher::~MtkCameraParametersPublisher()
+{
+    unpublish(mCurrent.load(std::memory_order_acquire));
+}
+
+sp<const MtkCameraParametersSnapshot> MtkCameraParametersPublisher::snapshot() const
+{
+    uint64_t v = mCurrent.fetch_add(kOne, std::memory_order_acquire) + kOne;
+    const Snapshot *s = pointerOf(v);
+    sp<const Snapshot> result(s);
+
+    /*
+     * One attempt only, so readers never loop: if somebody got in first,
+     * the last reader of the burst folds or the writer does on unpublish.
+     * Folding before the exchange keeps the count from ever running low.
+     */
+    uint64_t reserved = v >> kPointerBits;
+    if (reserved >= kFold) {
+        s->mRefs.fetch_add((int32_t)reserved, std::memory_order_relaxed);
+        if (!mCurrent.compare_exchange_strong(v, v & kPointerMask, std::memory_order_acq_rel))
+            s->release((int32_t)reserved);
+    }
+
+    // The sp holds it now, pay back the reservation
+    s->release(1);
+    return result;
+}
+
+void MtkCameraParametersPublisher::publish(const MtkCameraParameters &params)
+{
+    Mutex::Autolock _l(mLock);
+    // Readers compare generations across snapshots, keep them going up
+    mWorking.replace(params);
+    publishLocked();
+}
+
+void MtkCameraParametersPublisher::publishLocked()
+{
+    Snapshot *s = new Snapshot(mWorking);
+
+    LOG_ALWAYS_FATAL_IF((uintptr_t)s & ~kPointerMask,
+            "Snapshot %p does not fit in %d bits", s, kPointerBits);
+    uint64_t old = mCurrent.exchange((uintptr_t)s, std::memory_order_acq_rel);
+    if (old != 0)
+        unpublish(old);
+}
+
+}; // namespace android
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_CAMERA_SNAPSHOT_H
+#define ANDROID_HARDWARE_MTK_CAMERA_SNAPSHOT_H
+
+#include <atomic>
+#include <stdint.h>
+#include <utils/Mutex.h>
+#include <utils/StrongPointer.h>
+
+#include "MtkCameraParameters.h"
+
+namespace android {
+
+/**
+ * An immutable, frozen copy of a parameter set. Any number of threads may
+ * read it at once without locking; it goes away with the last sp.
+ */
+class MtkCameraParametersSnapshot {
+public:
+    const MtkCameraParameters& params() const { return mParams; }
+    uint32_t generation() const { return mParams.generation(); }
+
+    void incStrong(const void *id) const;
+    void decStrong(const void *id) const;
+
+private:
+    friend class MtkCameraParametersPublisher;
+
+    explicit MtkCameraParametersSnapshot(const MtkCameraParameters &params);
+    MtkCameraParametersSnapshot(const MtkCameraParametersSnapshot&);
+    MtkCameraParametersSnapshot& operator=(const MtkCameraParametersSnapshot&);
+
+    void release(int32_t refs) const;
+
+    MtkCameraParameters mParams;
+    mutable std::atomic<int32_t> mRefs;
+};
+
+/**
+ * Publishes the current parameters as a snapshot, RCU style. snapshot()
+ * is wait-free: a single atomic add on the published word, it never
+ * blocks on or retries against a writer. Writers serialize on a lock,
+ * change a working copy and publish a new snapshot; readers holding the
+ * old one keep it until they drop it.
+ *
+ *     publisher.update([](MtkCameraParameters &p) {
+ *         p.set(MTK_KEY_ZSD_MODE, MtkCameraParameters::ON);
+ *     });
+ *
+ *     sp<const MtkCameraParametersSnapshot> s = publisher.snapshot();
+ *     const char *zsd = s->params().get(MTK_KEY_ZSD_MODE);
+ */
+class MtkCameraParametersPublisher {
+public:
+    MtkCameraParametersPublisher();
+    explicit MtkCameraParametersPublisher(const MtkCameraParameters &params);
+    ~MtkCameraParametersPublisher();
+
+    sp<const MtkCameraParametersSnapshot> snapshot() const;
+
+    // Replaces the working copy and publishes it
+    void publish(const MtkCameraParameters &params);
+
+    // Runs change(MtkCameraParameters&) on the working copy and publishes it
+    template <typename F>
+    void update(F change)
+    {
+        Mutex::Autolock _l(mLock);
+        change(mWorking);
+        publishLocked();
+    }
+
+private:
+    MtkCameraParametersPublisher(const MtkCameraParametersPublisher&);
+    MtkCameraParametersPublisher& operator=(const MtkCameraParametersPublisher&);
+
+    void publishLocked();
+    static void unpublish(uint64_t current);
+
+    // Snapshot pointer in the low bits, readers since the last fold above
+    mutable std::atomic<uint64_t> mCurrent;
+    Mutex mLock;
+    MtkCameraParameters mWorking;
+};
+
+}; // namespace android
+
+#endif
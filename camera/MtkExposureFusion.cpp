@@ -0,0 +1,601 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkExposureFusion.h"
+#include "MtkPixelKernels.h"
+
+namespace android {
+
+#define BAND_ROWS       16
+// Columns of apron left and right of every scratch row
+#define PAD             8
+#define MIN_LEVEL_SIZE  8
+#define MAX_LEVEL       4080
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Scalar reference
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+/*
+ * The filters are built from rounding averages, which vector units have
+ * for 16 bit lanes: 1 2 1 is avg(avg(a, c), b), two of them make the
+ * 1 4 6 4 1 of the pyramid, and 1 6 1 for expanding is
+ * avg(b, avg(b, avg(a, c))).
+ */
+static inline int s121(int a, int b, int c)
+{
+    return avg(avg(a, c), b);
+}
+
+static inline int s161(int a, int b, int c)
+{
+    return avg(b, avg(b, avg(a, c)));
+}
+
+static inline int clamp(int v, int lo, int hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static void widen(const uint8_t *src, int16_t *dst, int width)
+{
+    for (int x = 0; x < width; x++)
+        dst[x] = src[x] << 4;
+}
+
+static void widenVu(const uint8_t *vu, int16_t *v, int16_t *u, int width)
+{
+    for (int x = 0; x < width; x++) {
+        v[x] = vu[2 * x] << 4;
+        u[x] = vu[2 * x + 1] << 4;
+    }
+}
+
+/*
+ * Contrast is the absolute Laplacian of luma, saturation the distance of
+ * the chroma from grey, both capped to a byte and one added so neither
+ * alone zeroes a weight. Well-exposedness is (1 - ((Y - 128) / 128)^2)^2,
+ * a bump over mid grey close to Mertens' Gaussian. The product goes to
+ * 16 bits with one added, so a pixel clipped in every frame still has
+ * weights to normalize.
+ */
+static void weights(const uint8_t *const y[3], const uint8_t *vu, uint16_t *w, int width)
+{
+    const uint8_t *a = y[0], *c = y[1], *b = y[2];
+
+    for (int x = 0; x < width; x++) {
+        int contrast = abs(4 * c[x] - c[x - 1] - c[x + 1] - a[x] - b[x]);
+        const uint8_t *p = vu + (x & ~1);
+        int saturation = abs(p[0] - 128) + abs(p[1] - 128);
+        int d = c[x] - 128;
+        int e = 16384 - d * d;
+
+        contrast = (contrast < 254 ? contrast : 254) + 1;
+        saturation = (saturation < 254 ? saturation : 254) + 1;
+        e = (e * e) >> 20;
+        e = e < 255 ? e : 255;
+        w[x] = ((contrast * saturation * e) >> 8) + 1;
+    }
+}
+
+static void normalize(const uint16_t *const w[], int16_t *const out[], int count, int width)
+{
+    for (int x = 0; x < width; x++) {
+        int sum = 0;
+        for (int i = 0; i < count; i++)
+            sum += w[i][x];
+
+        float scale = 16384.0f / (float)sum;
+        for (int i = 0; i < count; i++)
+            out[i][x] = (int)((float)w[i][x] * scale);
+    }
+}
+
+static void reduceV(const int16_t *const r[5], int16_t *out, int width)
+{
+    for (int x = 0; x < width; x++) {
+        out[x] = s121(s121(r[0][x], r[1][x], r[2][x]), s121(r[1][x], r[2][x], r[3][x]),
+                s121(r[2][x], r[3][x], r[4][x]));
+    }
+}
+
+// tmp[j + 1] is the first 1 2 1 at column j, from -1 to 2 * width - 1
+static void reduceH(const int16_t *in, int16_t *tmp, int16_t *out, int width)
+{
+    for (int j = -1; j < 2 * width; j++)
+        tmp[j + 1] = s121(in[j - 1], in[j], in[j + 1]);
+    for (int x = 0; x < width; x++)
+        out[x] = s121(tmp[2 * x], tmp[2 * x + 1], tmp[2 * x + 2]);
+}
+
+static void expandV(const int16_t *const r[3], int16_t *out, int width, int odd)
+{
+    for (int x = 0; x < width; x++)
+        out[x] = odd ? avg(r[1][x], r[2][x]) : s161(r[0][x], r[1][x], r[2][x]);
+}
+
+static void expandH(const int16_t *in, int16_t *out, int width)
+{
+    for (int i = 0; i < (width + 1) / 2; i++) {
+        out[2 * i] = s161(in[i - 1], in[i], in[i + 1]);
+        out[2 * i + 1] = avg(in[i], in[i + 1]);
+    }
+}
+
+static void blend(const int16_t *const g[], const int16_t *const e[], const int16_t *const w[],
+        int count, int16_t *out, int width)
+{
+    for (int x = 0; x < width; x++) {
+        int acc = 0;
+        for (int i = 0; i < count; i++)
+            acc += (g[i][x] - e[i][x]) * w[i][x];
+        out[x] = (acc + 8192) >> 14;
+    }
+}
+
+static void collapse(const int16_t *r, const int16_t *e, int16_t *out, int width)
+{
+    for (int x = 0; x < width; x++)
+        out[x] = clamp(r[x] + e[x], 0, MAX_LEVEL);
+}
+
+static void narrow(const int16_t *src, uint8_t *dst, int width)
+{
+    for (int x = 0; x < width; x++)
+        dst[x] = (src[x] + 8) >> 4;
+}
+
+static void narrowVu(const int16_t *v, const int16_t *u, uint8_t *vu, int width)
+{
+    for (int x = 0; x < width; x++) {
+        vu[2 * x] = (v[x] + 8) >> 4;
+        vu[2 * x + 1] = (u[x] + 8) >> 4;
+    }
+}
+
+const MtkFusionKernels kMtkFusionScalar = {
+    widen,
+    widenVu,
+    weights,
+    normalize,
+    reduceV,
+    reduceH,
+    expandV,
+    expandH,
+    blend,
+    collapse,
+    narrow,
+    narrowVu,
+};
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Passes
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// A worker's rows, each with PAD columns of apron
+struct Scratch {
+    uint8_t *luma;
+    uint16_t *raw[MtkExposureFusion::MAX_FRAMES];
+    int16_t *g[MtkExposureFusion::MAX_FRAMES];
+    int16_t *e[MtkExposureFusion::MAX_FRAMES];
+    int16_t *src[5];
+    int16_t *tmp;
+    int16_t *t;
+    int16_t *expanded;
+    int16_t *r[3];
+};
+
+#define SCRATCH_ROWS(count)     (1 + 3 * (count) + 5 + 3 + 3)
+
+struct MtkExposureFusion::Pass {
+    const MtkExposureFusion *fusion;
+    const MtkFusionKernels *k;
+    const MtkImage *const *frames;
+    MtkImage *dst;
+    int level;
+    Scratch *scratch;       // one per worker
+};
+
+static void setupScratch(Scratch *s, int16_t *rows, size_t rowSize, int count)
+{
+    int16_t *p = rows + PAD;
+
+    s->luma = (uint8_t *)p;
+    p += rowSize;
+    for (int i = 0; i < count; i++) {
+        s->raw[i] = (uint16_t *)p;
+        s->g[i] = p + rowSize;
+        s->e[i] = p + 2 * rowSize;
+        p += 3 * rowSize;
+    }
+    for (int i = 0; i < 5; i++, p += rowSize)
+        s->src[i] = p;
+    s->tmp = p;
+    s->t = p + rowSize;
+    s->expanded = p + 2 * rowSize;
+    p += 3 * rowSize;
+    for (int i = 0; i < 3; i++, p += rowSize)
+        s->r[i] = p;
+}
+
+// Row y of the level above coarse, width columns of it
+static void expandRow(const MtkFusionKernels *k, const int16_t *coarse, int cw, int ch,
+        int y, int width, int16_t *tmp, int16_t *out)
+{
+    int i = y / 2;
+    const int16_t *const rows[3] = {
+        coarse + (size_t)cw * reflect(i - 1, ch),
+        coarse + (size_t)cw * i,
+        coarse + (size_t)cw * reflect(i + 1, ch),
+    };
+
+    k->expandV(rows, tmp, cw, y & 1);
+    tmp[-1] = tmp[1];
+    tmp[cw] = tmp[cw - 2];
+    k->expandH(tmp, out, width);
+}
+
+// One row of the next level from five of this one
+static void reduceRow(const MtkFusionKernels *k, const int16_t *const rows[5], int width,
+        Scratch *s, int16_t *out, int outWidth)
+{
+    int16_t *v = s->tmp;
+
+    k->reduceV(rows, v, width);
+    v[-2] = v[2];
+    v[-1] = v[1];
+    v[width] = v[width - 2];
+    v[width + 1] = v[width - 3];
+    k->reduceH(v, s->t, out, outWidth);
+}
+
+void MtkExposureFusion::weightsBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkExposureFusion &f = *p.fusion;
+    const MtkFusionKernels *k = p.k;
+    Scratch *s = &p.scratch[worker];
+    int w = f.mWidth, h = f.mHeight;
+    int y1 = band * BAND_ROWS + BAND_ROWS < h ? band * BAND_ROWS + BAND_ROWS : h;
+    int16_t *out[MAX_FRAMES];
+
+    for (int y = band * BAND_ROWS; y < y1; y++) {
+        for (int i = 0; i < f.mCount; i++) {
+            const MtkImage &frame = *p.frames[i];
+            const uint8_t *luma = frame.planes[0];
+            size_t stride = frame.strides[0];
+            const uint8_t *row = luma + stride * y;
+
+            memcpy(s->luma, row, w);
+            s->luma[-1] = row[1];
+            s->luma[w] = row[w - 2];
+            const uint8_t *const rows[3] = {
+                luma + stride * reflect(y - 1, h), s->luma, luma + stride * reflect(y + 1, h),
+            };
+            k->weights(rows, frame.planes[1] + frame.strides[1] * (y / 2), s->raw[i], w);
+            out[i] = f.mW[i][0].row(y);
+
+            if ((y & 1) == 0) {
+                k->widenVu(frame.planes[1] + frame.strides[1] * (y / 2),
+                        f.mV[i][0].row(y / 2), f.mU[i][0].row(y / 2), w / 2);
+            }
+        }
+        k->normalize(s->raw, out, f.mCount, w);
+    }
+}
+
+void MtkExposureFusion::reduceBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkExposureFusion &f = *p.fusion;
+    const MtkFusionKernels *k = p.k;
+    Scratch *s = &p.scratch[worker];
+    int l = p.level;
+    const Plane &from = f.mW[0][l], &to = f.mW[0][l + 1];
+    int y1 = band * BAND_ROWS + BAND_ROWS < to.height ? band * BAND_ROWS + BAND_ROWS : to.height;
+
+    for (int y = band * BAND_ROWS; y < y1; y++) {
+        int src[5];
+        for (int r = 0; r < 5; r++)
+            src[r] = reflect(2 * y + r - 2, from.height);
+
+        for (int i = 0; i < f.mCount; i++) {
+            const Plane &w = f.mW[i][l];
+            const int16_t *const weights[5] = {
+                w.row(src[0]), w.row(src[1]), w.row(src[2]), w.row(src[3]), w.row(src[4]),
+            };
+            reduceRow(k, weights, from.width, s, f.mW[i][l + 1].row(y), to.width);
+
+            if (l == 0) {
+                const MtkImage &frame = *p.frames[i];
+                for (int r = 0; r < 5; r++)
+                    k->widen(frame.planes[0] + frame.strides[0] * src[r], s->src[r], from.width);
+                reduceRow(k, s->src, from.width, s, f.mY[i][1].row(y), to.width);
+                continue;
+            }
+
+            const Plane *planes[3][2] = {
+                { &f.mY[i][l], &f.mY[i][l + 1] },
+                { &f.mV[i][l - 1], &f.mV[i][l] },
+                { &f.mU[i][l - 1], &f.mU[i][l] },
+            };
+            for (int c = 0; c < 3; c++) {
+                const Plane &g = *planes[c][0];
+                const int16_t *const rows[5] = {
+                    g.row(src[0]), g.row(src[1]), g.row(src[2]), g.row(src[3]), g.row(src[4]),
+                };
+                reduceRow(k, rows, from.width, s, planes[c][1]->row(y), to.width);
+            }
+        }
+    }
+}
+
+void MtkExposureFusion::blendBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkExposureFusion &f = *p.fusion;
+    const MtkFusionKernels *k = p.k;
+    Scratch *s = &p.scratch[worker];
+    int l = p.level;
+    bool top = l == f.mLevels - 1;
+    int w = f.mW[0][l].width, h = f.mW[0][l].height;
+    int y1 = band * BAND_ROWS + BAND_ROWS < h ? band * BAND_ROWS + BAND_ROWS : h;
+    const int16_t *g[MAX_FRAMES], *e[MAX_FRAMES], *weights[MAX_FRAMES];
+
+    for (int y = band * BAND_ROWS; y < y1; y++) {
+        for (int i = 0; i < f.mCount; i++)
+            weights[i] = f.mW[i][l].row(y);
+
+        // Luma, straight into the frame on level 0
+        for (int i = 0; i < f.mCount; i++) {
+            if (l == 0) {
+                const MtkImage &frame = *p.frames[i];
+                k->widen(frame.planes[0] + frame.strides[0] * y, s->g[i], w);
+                g[i] = s->g[i];
+            } else {
+                g[i] = f.mY[i][l].row(y);
+            }
+            e[i] = f.mZero;
+            if (!top) {
+                const Plane &c = f.mY[i][l + 1];
+                expandRow(k, c.data, c.width, c.height, y, w, s->tmp, s->e[i]);
+                e[i] = s->e[i];
+            }
+        }
+        int16_t *r = l == 0 ? s->r[0] : f.mResultY[l].row(y);
+        k->blend(g, e, weights, f.mCount, r, w);
+        if (!top) {
+            const Plane &c = f.mResultY[l + 1];
+            expandRow(k, c.data, c.width, c.height, y, w, s->tmp, s->expanded);
+        }
+        k->collapse(r, top ? f.mZero : s->expanded, r, w);
+        if (l == 0) {
+            k->narrow(r, p.dst->planes[0] + p.dst->strides[0] * y, w);
+            continue;
+        }
+
+        // Chroma level l - 1, the frame's VU on chroma level 0
+        int j = l - 1;
+        const Plane (*sources[2])[MAX_LEVELS] = { f.mV, f.mU };
+        const Plane *results[2] = { f.mResultV, f.mResultU };
+        for (int c = 0; c < 2; c++) {
+            for (int i = 0; i < f.mCount; i++) {
+                g[i] = sources[c][i][j].row(y);
+                e[i] = f.mZero;
+                if (!top) {
+                    const Plane &coarse = sources[c][i][j + 1];
+                    expandRow(k, coarse.data, coarse.width, coarse.height, y, w, s->tmp, s->e[i]);
+                    e[i] = s->e[i];
+                }
+            }
+            r = j == 0 ? s->r[1 + c] : results[c][j].row(y);
+            k->blend(g, e, weights, f.mCount, r, w);
+            if (!top) {
+                const Plane &coarse = results[c][j + 1];
+                expandRow(k, coarse.data, coarse.width, coarse.height, y, w, s->tmp, s->expanded);
+            }
+            k->collapse(r, top ? f.mZero : s->expanded, r, w);
+        }
+        if (j == 0)
+            k->narrowVu(s->r[1], s->r[2], p.dst->planes[1] + p.dst->strides[1] * y, w);
+    }
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Fusion
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+MtkExposureFusion::MtkExposureFusion()
+    : mWidth(0),
+      mHeight(0),
+      mCount(0),
+      mLevels(0),
+      mMemory(NULL),
+      mZero(NULL)
+{
+}
+
+MtkExposureFusion::~MtkExposureFusion()
+{
+    clear();
+}
+
+void MtkExposureFusion::clear()
+{
+    free(mMemory);
+    mMemory = NULL;
+    mZero = NULL;
+    mWidth = mHeight = mCount = mLevels = 0;
+}
+
+int MtkExposureFusion::frameCount(const MtkCameraParameters &params)
+{
+    static const char *const modes[] = {
+        MtkCameraParameters::CAPTURE_MODE_HDR_SHOT,
+        MtkCameraParameters::CAPTURE_MODE_EV_BRACKET_SHOT,
+        NULL
+    };
+    static const char *const onOff[] = {
+        MtkCameraParameters::OFF,
+        MtkCameraParameters::ON,
+        NULL
+    };
+
+    // Under, normal and over exposed for stills, long and short for video
+    if (params.getEnum(MTK_KEY_CAPTURE_MODE, modes) >= 0)
+        return 3;
+    if (params.getEnum(MTK_KEY_VIDEO_HDR, onOff) == 1)
+        return 2;
+    return 0;
+}
+
+status_t MtkExposureFusion::init(int width, int height, int count)
+{
+    int widths[MAX_LEVELS], heights[MAX_LEVELS];
+    int levels = 1;
+    size_t total;
+
+    if (width < 16 || height < 16 || ((width | height) & 1) ||
+            mtkImageSize(MTK_PIXEL_FORMAT_NV21, width, height) == 0 ||
+            count <= 0 || count > MAX_FRAMES) {
+        ALOGE("Cannot fuse %d frames of %dx%d", count, width, height);
+        return BAD_VALUE;
+    }
+
+    widths[0] = width;
+    heights[0] = height;
+    while (levels < MAX_LEVELS && (widths[levels - 1] + 1) / 2 >= MIN_LEVEL_SIZE &&
+            (heights[levels - 1] + 1) / 2 >= MIN_LEVEL_SIZE) {
+        widths[levels] = (widths[levels - 1] + 1) / 2;
+        heights[levels] = (heights[levels - 1] + 1) / 2;
+        levels++;
+    }
+
+    // Weights on every level, luma and results on all but 0, chroma on all but the top
+    total = width + 2 * PAD;
+    for (int l = 0; l < levels; l++) {
+        size_t size = (size_t)widths[l] * heights[l];
+        total += size * count;
+        if (l > 0)
+            total += size * (count + 1) * 3;
+    }
+
+    clear();
+    mMemory = calloc(total, sizeof(int16_t));
+    if (mMemory == NULL) {
+        ALOGE("Cannot allocate %zu bytes of pyramids", total * sizeof(int16_t));
+        return NO_MEMORY;
+    }
+
+    int16_t *p = (int16_t *)mMemory;
+    mZero = p + PAD;
+    p += width + 2 * PAD;
+    memset(mY, 0, sizeof(mY));
+    memset(mV, 0, sizeof(mV));
+    memset(mU, 0, sizeof(mU));
+    memset(mResultY, 0, sizeof(mResultY));
+    memset(mResultV, 0, sizeof(mResultV));
+    memset(mResultU, 0, sizeof(mResultU));
+    for (int l = 0; l < levels; l++) {
+        Plane plane = { NULL, widths[l], heights[l] };
+        size_t size = (size_t)widths[l] * heights[l];
+
+        for (int i = 0; i < count; i++) {
+            mW[i][l] = plane;
+            mW[i][l].data = p;
+            p += size;
+            if (l == 0)
+                continue;
+            Plane *planes[3] = { &mY[i][l], &mV[i][l - 1], &mU[i][l - 1] };
+            for (int c = 0; c < 3; c++, p += size) {
+                *planes[c] = plane;
+                planes[c]->data = p;
+            }
+        }
+        if (l == 0)
+            continue;
+        Plane *results[3] = { &mResultY[l], &mResultV[l - 1], &mResultU[l - 1] };
+        for (int c = 0; c < 3; c++, p += size) {
+            *results[c] = plane;
+            results[c]->data = p;
+        }
+    }
+
+    mWidth = width;
+    mHeight = height;
+    mCount = count;
+    mLevels = levels;
+    return NO_ERROR;
+}
+
+status_t MtkExposureFusion::process(const MtkImage *const frames[], MtkImage *dst,
+        MtkThreadPool *pool, MtkPixelIsa isa)
+{
+    // AVX2 would only widen loops that are bound by memory already
+    const MtkFusionKernels *k = mtkPixelPick(isa, &kMtkFusionScalar,
+            MTK_PIXEL_NEON(kMtkFusionNeon), MTK_PIXEL_X86(kMtkFusionSse2),
+            MTK_PIXEL_X86(kMtkFusionSse2));
+
+    if (k == NULL) {
+        ALOGE("No %s kernels on this CPU", mtkPixelIsaName(isa));
+        return INVALID_OPERATION;
+    }
+    if (mMemory == NULL) {
+        ALOGE("Fusion is not set up");
+        return INVALID_OPERATION;
+    }
+    for (int i = 0; i <= mCount; i++) {
+        const MtkImage &image = i < mCount ? *frames[i] : *dst;
+        if (image.format != MTK_PIXEL_FORMAT_NV21 || image.width != mWidth ||
+                image.height != mHeight) {
+            ALOGE("Cannot fuse format %d %dx%d at %dx%d", image.format,
+                    image.width, image.height, mWidth, mHeight);
+            return BAD_VALUE;
+        }
+    }
+
+    int workers = pool != NULL ? pool->size() : 1;
+    size_t rowSize = mWidth + 2 * PAD;
+    size_t rows = SCRATCH_ROWS(mCount);
+    Pass pass;
+
+    pass.scratch = (Scratch *)malloc(workers * (sizeof(Scratch) + rows * rowSize * sizeof(int16_t)));
+    if (pass.scratch == NULL)
+        return NO_MEMORY;
+
+    int16_t *scratch = (int16_t *)(pass.scratch + workers);
+    for (int i = 0; i < workers; i++)
+        setupScratch(&pass.scratch[i], scratch + i * rows * rowSize, rowSize, mCount);
+    pass.fusion = this;
+    pass.k = k;
+    pass.frames = frames;
+    pass.dst = dst;
+
+    pass.level = 0;
+    runBands(pool, weightsBand, &pass, mHeight, BAND_ROWS);
+    for (pass.level = 0; pass.level + 1 < mLevels; pass.level++)
+        runBands(pool, reduceBand, &pass, mW[0][pass.level + 1].height, BAND_ROWS);
+    for (pass.level = mLevels - 1; pass.level >= 0; pass.level--)
+        runBands(pool, blendBand, &pass, mW[0][pass.level].height, BAND_ROWS);
+
+    free(pass.scratch);
+    return NO_ERROR;
+}
+
+}; // namespace android
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_EXPOSURE_FUSION_H
+#define ANDROID_HARDWARE_MTK_EXPOSURE_FUSION_H
+
+#include <stdint.h>
+#include <utils/Errors.h>
+
+#include "MtkCameraParameters.h"
+#include "MtkImage.h"
+#include "MtkPixelConvert.h"
+#include "MtkThreadPool.h"
+
+namespace android {
+
+/**
+ * Mertens style exposure fusion of bracketed NV21 frames, for HDR shot,
+ * EV bracket shot and video HDR. Every pixel of every frame gets a
+ * weight from how well exposed, saturated and sharp it is; the frames'
+ * Laplacian pyramids are then blended with the Gaussian pyramids of the
+ * weights and collapsed. Chroma is blended on the pyramid level of its
+ * resolution with the same weights.
+ *
+ * Each pyramid level is one pass over bands of rows shared by the
+ * pool's threads, with SIMD row kernels. The pyramids stay allocated
+ * between frames, so video HDR only pays for init() once.
+ */
+class MtkExposureFusion {
+public:
+    enum {
+        MAX_FRAMES = 8,
+    };
+
+    MtkExposureFusion();
+    ~MtkExposureFusion();
+
+    // Pyramids for count frames of width x height, both even and at least 16
+    status_t init(int width, int height, int count);
+
+    /*
+     * Fuses the frames, as many as init() was given, all NV21 of the
+     * init() size, into dst, which may be one of them. The output does
+     * not depend on the thread count.
+     */
+    status_t process(const MtkImage *const frames[], MtkImage *dst,
+            MtkThreadPool *pool = NULL, MtkPixelIsa isa = MTK_PIXEL_ISA_BEST);
+
+    // Frames to fuse for the capture mode and KEY_VIDEO_HDR, 0 for none
+    static int frameCount(const MtkCameraParameters &params);
+
+private:
+    MtkExposureFusion(const MtkExposureFusion&);
+    MtkExposureFusion& operator=(const MtkExposureFusion&);
+
+    enum {
+        MAX_LEVELS = 12,
+    };
+
+    struct Plane {
+        int16_t *data;
+        int width;
+        int height;
+
+        int16_t *row(int y) const { return data + (size_t)width * y; }
+    };
+
+    struct Pass;
+
+    void clear();
+    static void weightsBand(void *arg, int band, int worker);
+    static void reduceBand(void *arg, int band, int worker);
+    static void blendBand(void *arg, int band, int worker);
+
+    int mWidth;
+    int mHeight;
+    int mCount;
+    int mLevels;
+
+    /*
+     * Per frame: Y from level 1, the frame itself is level 0; weights
+     * from level 0; V and U from chroma level 0, which has the size of
+     * luma level 1 and uses its weights. The results likewise.
+     */
+    Plane mY[MAX_FRAMES][MAX_LEVELS];
+    Plane mW[MAX_FRAMES][MAX_LEVELS];
+    Plane mV[MAX_FRAMES][MAX_LEVELS];
+    Plane mU[MAX_FRAMES][MAX_LEVELS];
+    Plane mResultY[MAX_LEVELS];
+    Plane mResultV[MAX_LEVELS];
+    Plane mResultU[MAX_LEVELS];
+    void *mMemory;
+    int16_t *mZero;
+};
+
+}; // namespace android
+
+#endif
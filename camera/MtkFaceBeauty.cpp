@@ -0,0 +1,580 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkFaceBeauty.h"
+#include "MtkPixelKernels.h"
+
+namespace android {
+
+#define GRID            4
+// Grid rows per coefficient task, image rows per filter task
+#define GRID_BAND_ROWS  8
+#define BAND_ROWS       32
+#define MAX_RADIUS      8
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Scalar reference
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Skin likeness of a VU pair, 0 to 255
+static inline int skin(int v, int u)
+{
+    int m = 320 - 8 * (abs(v - BEAUTY_SKIN_V) + abs(u - BEAUTY_SKIN_U));
+    return m < 0 ? 0 : m > 255 ? 255 : m;
+}
+
+static void downsample(const uint8_t *const y[4], uint16_t *out, int width)
+{
+    for (int x = 0; x < width; x++) {
+        int sum = 0;
+        for (int r = 0; r < 4; r++)
+            sum += y[r][4 * x] + y[r][4 * x + 1] + y[r][4 * x + 2] + y[r][4 * x + 3];
+        out[x] = sum;
+    }
+}
+
+static void downsampleVu(const uint8_t *const vu[2], uint16_t *v, uint16_t *u, int width)
+{
+    for (int x = 0; x < width; x++) {
+        v[x] = vu[0][4 * x] + vu[0][4 * x + 2] + vu[1][4 * x] + vu[1][4 * x + 2];
+        u[x] = vu[0][4 * x + 1] + vu[0][4 * x + 3] + vu[1][4 * x + 1] + vu[1][4 * x + 3];
+    }
+}
+
+/*
+ * Eighths from rounding averages, which vector units have: 7 1 is
+ * avg(a, avg(a, avg(a, b))), 5 3 the average of avg(a, b) and
+ * avg(a, avg(a, b)).
+ */
+static inline int lerp8(int a, int b, int eighths)
+{
+    int m = avg(a, b);
+
+    switch (eighths) {
+    case 1:     return avg(a, avg(a, m));
+    case 3:     return avg(m, avg(a, m));
+    case 5:     return avg(m, avg(b, m));
+    default:    return avg(b, avg(b, m));
+    }
+}
+
+static void lerp(const uint16_t *a, const uint16_t *b, int eighths, uint16_t *out, int width)
+{
+    for (int x = 0; x < width; x++)
+        out[x] = lerp8(a[x], b[x], eighths);
+}
+
+// Block centres sit at 1.5 + 4i, so pixels are 5/8 and 7/8 on from the
+// block before, then 1/8 and 3/8 on to the one after
+static void expand4(const uint16_t *in, uint16_t *out, int width)
+{
+    for (int i = 0; i < width / 4; i++) {
+        out[4 * i] = lerp8(in[i - 1], in[i], 5);
+        out[4 * i + 1] = lerp8(in[i - 1], in[i], 7);
+        out[4 * i + 2] = lerp8(in[i], in[i + 1], 1);
+        out[4 * i + 3] = lerp8(in[i], in[i + 1], 3);
+    }
+}
+
+static void apply(const uint8_t *y, const uint16_t *a, const uint16_t *b, uint8_t *out,
+        int width)
+{
+    for (int x = 0; x < width; x++) {
+        int v = a[x] * y[x] + b[x] + 128;
+        out[x] = (v < 65535 ? v : 65535) >> 8;
+    }
+}
+
+static void sharpen(const uint8_t *const rows[3], uint8_t *tmp, uint8_t *out, int amount,
+        int width)
+{
+    const uint8_t *c = rows[1];
+
+    for (int x = -1; x <= width; x++)
+        tmp[x] = avg(avg(rows[0][x], rows[2][x]), c[x]);
+    for (int x = 0; x < width; x++) {
+        int d = c[x] - avg(avg(tmp[x - 1], tmp[x + 1]), tmp[x]);
+        int v = c[x] + ((d * amount + 8) >> 4);
+        out[x] = v < 0 ? 0 : v > 255 ? 255 : v;
+    }
+}
+
+static void skinTone(const uint8_t *vu, uint8_t *out, int level, int width)
+{
+    for (int x = 0; x < width; x++) {
+        int v = vu[2 * x], u = vu[2 * x + 1];
+        int k = (skin(v, u) * level) >> 8;
+
+        out[2 * x] = v + (((BEAUTY_TARGET_V - v) * k + 64) >> 7);
+        out[2 * x + 1] = u + (((BEAUTY_TARGET_U - u) * k + 64) >> 7);
+    }
+}
+
+const MtkBeautyKernels kMtkBeautyScalar = {
+    downsample,
+    downsampleVu,
+    lerp,
+    expand4,
+    apply,
+    sharpen,
+    skinTone,
+};
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Passes
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+/*
+ * The grid passes are plain C on every instruction set: the grid has a
+ * sixteenth of the pixels, and one implementation of the float math
+ * keeps the output the same whichever kernels run.
+ */
+struct MtkFaceBeauty::Pass {
+    const MtkFaceBeauty *beauty;
+    const MtkBeautyKernels *k;
+    const MtkImage *src;
+    MtkImage *dst;
+    int radius;
+    float eps;
+    float smooth;
+    float light;
+    int tone;
+    int amount;
+    uint8_t *scratch;
+    size_t scratchSize;     // per worker
+};
+
+static inline int clampInt(int v, int lo, int hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+// Means of two grid planes over the box of radius r around row y, the
+// box cut down to the grid at the edges
+static void boxMeans(const float *const planes[2], int gw, int gh, int r, int y,
+        float *column, double *prefix, float *const means[2])
+{
+    int y0 = y - r > 0 ? y - r : 0, y1 = y + r < gh - 1 ? y + r : gh - 1;
+
+    for (int c = 0; c < 2; c++) {
+        memcpy(column, planes[c] + (size_t)gw * y0, gw * sizeof(float));
+        for (int yy = y0 + 1; yy <= y1; yy++) {
+            const float *row = planes[c] + (size_t)gw * yy;
+            for (int x = 0; x < gw; x++)
+                column[x] += row[x];
+        }
+
+        prefix[0] = 0;
+        for (int x = 0; x < gw; x++)
+            prefix[x + 1] = prefix[x] + column[x];
+        for (int x = 0; x < gw; x++) {
+            int x0 = x - r > 0 ? x - r : 0, x1 = x + r < gw - 1 ? x + r : gw - 1;
+            means[c][x] = (float)((prefix[x1 + 1] - prefix[x0]) /
+                    ((x1 - x0 + 1) * (y1 - y0 + 1)));
+        }
+    }
+}
+
+void MtkFaceBeauty::downsampleBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkFaceBeauty &b = *p.beauty;
+    const MtkImage &src = *p.src;
+    uint16_t *sums = (uint16_t *)(p.scratch + p.scratchSize * worker);
+    int gw = b.mGridWidth;
+    int y1 = clampInt((band + 1) * GRID_BAND_ROWS, 0, b.mGridHeight);
+
+    for (int gy = band * GRID_BAND_ROWS; gy < y1; gy++) {
+        const uint8_t *y = src.planes[0] + src.strides[0] * GRID * gy;
+        const uint8_t *const rows[4] = {
+            y, y + src.strides[0], y + 2 * src.strides[0], y + 3 * src.strides[0],
+        };
+        const uint8_t *vu = src.planes[1] + src.strides[1] * GRID / 2 * gy;
+        const uint8_t *const vuRows[2] = { vu, vu + src.strides[1] };
+        float *i = b.mI + (size_t)gw * gy, *ii = b.mII + (size_t)gw * gy;
+
+        p.k->downsample(rows, sums, gw);
+        for (int x = 0; x < gw; x++) {
+            i[x] = sums[x] * (1.0f / 16);
+            ii[x] = i[x] * i[x];
+        }
+        p.k->downsampleVu(vuRows, b.mV + (size_t)gw * gy, b.mU + (size_t)gw * gy, gw);
+    }
+}
+
+// The guided filter's a and b per block, from the local mean and variance
+void MtkFaceBeauty::coefficientBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkFaceBeauty &b = *p.beauty;
+    int gw = b.mGridWidth, gh = b.mGridHeight;
+    float *column = (float *)(p.scratch + p.scratchSize * worker);
+    float *mean = column + gw, *meanSq = mean + gw;
+    double *prefix = (double *)(meanSq + gw + (gw & 1));
+    const float *const planes[2] = { b.mI, b.mII };
+    float *const means[2] = { mean, meanSq };
+    int y1 = clampInt((band + 1) * GRID_BAND_ROWS, 0, gh);
+
+    for (int y = band * GRID_BAND_ROWS; y < y1; y++) {
+        float *a = b.mA + (size_t)gw * y, *c = b.mB + (size_t)gw * y;
+
+        boxMeans(planes, gw, gh, p.radius, y, column, prefix, means);
+        for (int x = 0; x < gw; x++) {
+            float var = meanSq[x] - mean[x] * mean[x];
+            if (var < 0)
+                var = 0;
+            a[x] = var / (var + p.eps);
+            c[x] = mean[x] * (1 - a[x]);
+        }
+    }
+}
+
+/*
+ * Averaged a and b, blended with the identity by smoothing strength
+ * times skin likeness, then lightened or darkened on skin, to Q8.
+ */
+void MtkFaceBeauty::blendBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkFaceBeauty &b = *p.beauty;
+    int gw = b.mGridWidth, gh = b.mGridHeight;
+    float *column = (float *)(p.scratch + p.scratchSize * worker);
+    float *meanA = column + gw, *meanB = meanA + gw;
+    double *prefix = (double *)(meanB + gw + (gw & 1));
+    const float *const planes[2] = { b.mA, b.mB };
+    float *const means[2] = { meanA, meanB };
+    int y1 = clampInt((band + 1) * GRID_BAND_ROWS, 0, gh);
+
+    for (int y = band * GRID_BAND_ROWS; y < y1; y++) {
+        const uint16_t *v = b.mV + (size_t)gw * y, *u = b.mU + (size_t)gw * y;
+        uint16_t *coeffA = b.mCoeffA + (size_t)(gw + 2) * y + 1;
+        uint16_t *coeffB = b.mCoeffB + (size_t)(gw + 2) * y + 1;
+
+        boxMeans(planes, gw, gh, p.radius, y, column, prefix, means);
+        for (int x = 0; x < gw; x++) {
+            float m = skin((v[x] + 2) >> 2, (u[x] + 2) >> 2) * (1.0f / 255);
+            float s = p.smooth * m, t = p.light * m;
+            float a = 1 - s * (1 - meanA[x]), c = s * meanB[x];
+
+            if (t >= 0) {
+                c = (1 - t) * c + 255 * t;
+                a = (1 - t) * a;
+            } else {
+                c = (1 + t) * c;
+                a = (1 + t) * a;
+            }
+            coeffA[x] = clampInt((int)(a * 256 + 0.5f), 0, 256);
+            coeffB[x] = clampInt((int)(c * 256 + 0.5f), 0, 65535);
+        }
+        coeffA[-1] = coeffA[0];
+        coeffA[gw] = coeffA[gw - 1];
+        coeffB[-1] = coeffB[0];
+        coeffB[gw] = coeffB[gw - 1];
+    }
+}
+
+// Per worker rows of the filter pass, each with a column of apron
+struct FilterScratch {
+    uint16_t *gridA;
+    uint16_t *gridB;
+    uint16_t *a;
+    uint16_t *b;
+    uint8_t *ring[3];
+    uint8_t *tmp;
+};
+
+static void setupFilterScratch(FilterScratch *s, uint8_t *p, int width, int gw)
+{
+    s->gridA = (uint16_t *)p + 1;
+    s->gridB = s->gridA + gw + 2;
+    s->a = s->gridB + gw + 1;
+    s->b = s->a + width;
+    p = (uint8_t *)(s->b + width);
+    for (int i = 0; i < 3; i++, p += width + 2)
+        s->ring[i] = p + 1;
+    s->tmp = p + 1;
+}
+
+static size_t filterScratchSize(int width, int gw)
+{
+    return (2 * (gw + 2) + 2 * width) * sizeof(uint16_t) + 4 * (width + 2);
+}
+
+// Smoothed row y, clamped to the frame, into out with its apron
+static void smoothRow(const MtkBeautyKernels *k, const MtkImage &src,
+        const uint16_t *coeffA, const uint16_t *coeffB, int gw, int gh, int y,
+        FilterScratch *s, uint8_t *out)
+{
+    int height = src.height, width = src.width;
+    int yc = clampInt(y, 0, height - 1), gy = yc / GRID, phase = yc % GRID;
+    int r0, r1, eighths;
+    size_t stride = gw + 2;
+
+    if (phase < 2) {
+        r0 = gy > 0 ? gy - 1 : 0;
+        r1 = gy;
+        eighths = phase == 0 ? 5 : 7;
+    } else {
+        r0 = gy;
+        r1 = gy + 1 < gh ? gy + 1 : gh - 1;
+        eighths = phase == 2 ? 1 : 3;
+    }
+    k->lerp(coeffA + stride * r0, coeffA + stride * r1, eighths, s->gridA - 1, gw + 2);
+    k->lerp(coeffB + stride * r0, coeffB + stride * r1, eighths, s->gridB - 1, gw + 2);
+    k->expand4(s->gridA, s->a, width);
+    k->expand4(s->gridB, s->b, width);
+    k->apply(src.planes[0] + src.strides[0] * yc, s->a, s->b, out, width);
+    out[-1] = out[0];
+    out[width] = out[width - 1];
+}
+
+void MtkFaceBeauty::filterBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkFaceBeauty &b = *p.beauty;
+    const MtkBeautyKernels *k = p.k;
+    const MtkImage &src = *p.src;
+    MtkImage &dst = *p.dst;
+    int width = b.mWidth, gw = b.mGridWidth, gh = b.mGridHeight;
+    int y0 = band * BAND_ROWS, y1 = clampInt(y0 + BAND_ROWS, 0, b.mHeight);
+    FilterScratch s;
+
+    setupFilterScratch(&s, p.scratch + p.scratchSize * worker, width, gw);
+
+    // ring[(y + 1) % 3] holds smoothed row y
+    smoothRow(k, src, b.mCoeffA, b.mCoeffB, gw, gh, y0 - 1, &s, s.ring[y0 % 3]);
+    smoothRow(k, src, b.mCoeffA, b.mCoeffB, gw, gh, y0, &s, s.ring[(y0 + 1) % 3]);
+    for (int y = y0; y < y1; y++) {
+        smoothRow(k, src, b.mCoeffA, b.mCoeffB, gw, gh, y + 1, &s, s.ring[(y + 2) % 3]);
+
+        const uint8_t *const rows[3] = {
+            s.ring[y % 3], s.ring[(y + 1) % 3], s.ring[(y + 2) % 3],
+        };
+        uint8_t *out = dst.planes[0] + dst.strides[0] * y;
+        if (p.amount > 0)
+            k->sharpen(rows, s.tmp, out, p.amount, width);
+        else
+            memcpy(out, rows[1], width);
+
+        if (y & 1)
+            continue;
+        const uint8_t *vu = src.planes[1] + src.strides[1] * (y / 2);
+        uint8_t *outVu = dst.planes[1] + dst.strides[1] * (y / 2);
+        if (p.tone > 0)
+            k->skinTone(vu, outVu, p.tone, width / 2);
+        else
+            memcpy(outVu, vu, width);
+    }
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Face beauty
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+MtkFaceBeauty::MtkFaceBeauty()
+    : mWidth(0),
+      mHeight(0),
+      mGridWidth(0),
+      mGridHeight(0),
+      mI(NULL),
+      mII(NULL),
+      mV(NULL),
+      mU(NULL),
+      mA(NULL),
+      mB(NULL),
+      mCoeffA(NULL),
+      mCoeffB(NULL),
+      mMemory(NULL)
+{
+}
+
+MtkFaceBeauty::~MtkFaceBeauty()
+{
+    clear();
+}
+
+void MtkFaceBeauty::clear()
+{
+    free(mMemory);
+    mMemory = NULL;
+    mI = mII = mA = mB = NULL;
+    mV = mU = mCoeffA = mCoeffB = NULL;
+    mWidth = mHeight = mGridWidth = mGridHeight = 0;
+}
+
+// "on" or "true"
+static bool isOn(const MtkCameraParameters &params, MtkCameraKey id)
+{
+    static const char *const onOff[] = {
+        MtkCameraParameters::OFF,
+        MtkCameraParameters::ON,
+        CameraParameters::FALSE,
+        CameraParameters::TRUE,
+        NULL
+    };
+    int index = params.getEnum(id, onOff);
+
+    return index >= 0 && (index & 1) == 1;
+}
+
+bool MtkFaceBeauty::enabled(const MtkCameraParameters &params)
+{
+    static const char *const modes[] = {
+        MtkCameraParameters::CAPTURE_MODE_FACE_BEAUTY,
+        NULL
+    };
+
+    return isOn(params, MTK_KEY_FACE_BEAUTY) ||
+            params.getEnum(MTK_KEY_CAPTURE_MODE, modes) == 0;
+}
+
+// 0 to 1 over the key's range, -1 when the key is not set
+static float level(const MtkCameraParameters &params, MtkCameraKey id)
+{
+    int value, min, max;
+
+    if (params.getInt(id, &value) == NAME_NOT_FOUND)
+        return -1;
+    if (params.getRange(id, &min, &max) != NO_ERROR || min == INT_MIN || max == INT_MAX ||
+            max <= min) {
+        min = -4;
+        max = 4;
+    }
+    return (float)(clampInt(value, min, max) - min) / (max - min);
+}
+
+void MtkFaceBeauty::settings(const MtkCameraParameters &params, MtkBeautySettings *settings)
+{
+    float skinColor = level(params, MTK_KEY_FB_SKIN_COLOR);
+
+    settings->smooth = level(params, MTK_KEY_FB_SMOOTH_LEVEL);
+    settings->skinColor = skinColor < 0 ? 0 : 2 * skinColor - 1;
+    settings->sharp = level(params, MTK_KEY_FB_SHARP);
+    settings->enlargeEye = level(params, MTK_KEY_FB_ENLARGE_EYE);
+    settings->slimFace = level(params, MTK_KEY_FB_SLIM_FACE);
+    settings->extreme = isOn(params, MTK_KEY_FB_EXTREME_BEAUTY);
+
+    float *unset[] = {
+        &settings->smooth, &settings->sharp, &settings->enlargeEye, &settings->slimFace,
+    };
+    for (size_t i = 0; i < sizeof(unset) / sizeof(unset[0]); i++) {
+        if (*unset[i] < 0)
+            *unset[i] = 0;
+    }
+}
+
+status_t MtkFaceBeauty::init(int width, int height)
+{
+    if (width < 16 || height < 16 || (width % GRID) != 0 || (height % GRID) != 0 ||
+            mtkImageSize(MTK_PIXEL_FORMAT_NV21, width, height) == 0) {
+        ALOGE("No face beauty for %dx%d", width, height);
+        return BAD_VALUE;
+    }
+
+    int gw = width / GRID, gh = height / GRID;
+    size_t grid = (size_t)gw * gh;
+    size_t floats = 4 * grid, shorts = 2 * grid + 2 * (size_t)(gw + 2) * gh;
+
+    clear();
+    mMemory = malloc(floats * sizeof(float) + shorts * sizeof(uint16_t));
+    if (mMemory == NULL) {
+        ALOGE("Cannot allocate face beauty planes for %dx%d", width, height);
+        return NO_MEMORY;
+    }
+
+    mI = (float *)mMemory;
+    mII = mI + grid;
+    mA = mII + grid;
+    mB = mA + grid;
+    mV = (uint16_t *)(mB + grid);
+    mU = mV + grid;
+    mCoeffA = mU + grid;
+    mCoeffB = mCoeffA + (size_t)(gw + 2) * gh;
+    mWidth = width;
+    mHeight = height;
+    mGridWidth = gw;
+    mGridHeight = gh;
+    return NO_ERROR;
+}
+
+status_t MtkFaceBeauty::process(const MtkImage &src, MtkImage *dst,
+        const MtkBeautySettings &settings, MtkThreadPool *pool, MtkPixelIsa isa)
+{
+    const MtkBeautyKernels *k = mtkPixelPick(isa, &kMtkBeautyScalar,
+            MTK_PIXEL_NEON(kMtkBeautyNeon), MTK_PIXEL_X86(kMtkBeautySse2),
+            MTK_PIXEL_X86(kMtkBeautySse2));
+
+    if (k == NULL) {
+        ALOGE("No %s kernels on this CPU", mtkPixelIsaName(isa));
+        return INVALID_OPERATION;
+    }
+    if (mMemory == NULL) {
+        ALOGE("Face beauty is not set up");
+        return INVALID_OPERATION;
+    }
+    for (int i = 0; i < 2; i++) {
+        const MtkImage &image = i == 0 ? src : *dst;
+        if (image.format != MTK_PIXEL_FORMAT_NV21 || image.width != mWidth ||
+                image.height != mHeight) {
+            ALOGE("Cannot filter format %d %dx%d at %dx%d", image.format,
+                    image.width, image.height, mWidth, mHeight);
+            return BAD_VALUE;
+        }
+    }
+    if (src.planes[0] == dst->planes[0] || src.planes[1] == dst->planes[1]) {
+        ALOGE("Face beauty cannot filter in place");
+        return BAD_VALUE;
+    }
+
+    float boost = settings.extreme ? 1.5f : 1.0f;
+    float smooth = settings.smooth * boost;
+    float sigma = 3 + 12 * settings.smooth * boost;
+    int workers = pool != NULL ? pool->size() : 1;
+    Pass pass;
+
+    // About 1% of the width, which is the scale of skin texture
+    pass.radius = clampInt((int)(mGridWidth * boost / 96 + 0.5f), 1, MAX_RADIUS);
+    pass.eps = sigma * sigma;
+    pass.smooth = smooth < 1 ? smooth : 1;
+    pass.light = 0.15f * settings.skinColor;
+    pass.tone = settings.skinColor > 0 ? (int)(settings.skinColor * 48 + 0.5f) : 0;
+    pass.amount = (int)(settings.sharp * 24 + 0.5f);
+    pass.beauty = this;
+    pass.k = k;
+    pass.src = &src;
+    pass.dst = dst;
+
+    size_t grid = (3 * mGridWidth + 1) * sizeof(float) + (mGridWidth + 1) * sizeof(double);
+    size_t filter = filterScratchSize(mWidth, mGridWidth);
+    pass.scratchSize = ((grid > filter ? grid : filter) + 15) & ~(size_t)15;
+    pass.scratch = (uint8_t *)malloc(pass.scratchSize * workers);
+    if (pass.scratch == NULL)
+        return NO_MEMORY;
+
+    runBands(pool, downsampleBand, &pass, mGridHeight, GRID_BAND_ROWS);
+    runBands(pool, coefficientBand, &pass, mGridHeight, GRID_BAND_ROWS);
+    runBands(pool, blendBand, &pass, mGridHeight, GRID_BAND_ROWS);
+    runBands(pool, filterBand, &pass, mHeight, BAND_ROWS);
+
+    free(pass.scratch);
+    return NO_ERROR;
+}
+
+}; // namespace android
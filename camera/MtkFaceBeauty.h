@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_FACE_BEAUTY_H
+#define ANDROID_HARDWARE_MTK_FACE_BEAUTY_H
+
+#include <stdint.h>
+#include <utils/Errors.h>
+
+#include "MtkCameraParameters.h"
+#include "MtkImage.h"
+#include "MtkPixelConvert.h"
+#include "MtkThreadPool.h"
+
+namespace android {
+
+// Strengths from 0 for none to 1 for the most, skinColor -1 to 1
+struct MtkBeautySettings {
+    float smooth;
+    float skinColor;                // darker below 0, fairer and rosier above
+    float sharp;
+    float enlargeEye;
+    float slimFace;
+    bool extreme;
+};
+
+/**
+ * Face beauty for NV21 preview and capture frames. Skin is smoothed with
+ * an edge preserving guided filter, lightened or darkened and moved
+ * towards a rosier tone, and the result gets an unsharp mask.
+ *
+ * The guided filter runs the fast way: its coefficients are worked out
+ * on a grid of 4x4 luma blocks, where they also take the skin mask and
+ * the skin lightening, which are affine in luma as well. Full resolution
+ * only sees interpolating the coefficients, one multiply-add, the chroma
+ * shift and the sharpening, all in SIMD row kernels over bands of rows
+ * shared by the pool's threads.
+ *
+ * enlargeEye and slimFace are warps around facial features, which
+ * need face landmarks this engine does not get; they are read from the
+ * parameters but not applied.
+ */
+class MtkFaceBeauty {
+public:
+    MtkFaceBeauty();
+    ~MtkFaceBeauty();
+
+    // Buffers for width x height frames, both multiples of 4 and at least 16
+    status_t init(int width, int height);
+
+    // Whether KEY_FACE_BEAUTY or the face beauty capture mode is on
+    static bool enabled(const MtkCameraParameters &params);
+
+    /*
+     * The KEY_FB_* levels mapped onto their -min/-max range, -4 to 4
+     * where the range is not set; levels that are not set are 0
+     * strength.
+     */
+    static void settings(const MtkCameraParameters &params, MtkBeautySettings *settings);
+
+    /*
+     * Filters src into dst, NV21 frames of the init() size that do not
+     * overlap. The output does not depend on the thread count.
+     */
+    status_t process(const MtkImage &src, MtkImage *dst, const MtkBeautySettings &settings,
+            MtkThreadPool *pool = NULL, MtkPixelIsa isa = MTK_PIXEL_ISA_BEST);
+
+private:
+    MtkFaceBeauty(const MtkFaceBeauty&);
+    MtkFaceBeauty& operator=(const MtkFaceBeauty&);
+
+    struct Pass;
+
+    void clear();
+    static void downsampleBand(void *arg, int band, int worker);
+    static void coefficientBand(void *arg, int band, int worker);
+    static void blendBand(void *arg, int band, int worker);
+    static void filterBand(void *arg, int band, int worker);
+
+    int mWidth;
+    int mHeight;
+    // The grid of 4x4 blocks
+    int mGridWidth;
+    int mGridHeight;
+
+    // Grid planes: mean luma and its square, V and U sums, the filter's
+    // a and b, and the final coefficients, padded by a sample each side
+    float *mI;
+    float *mII;
+    uint16_t *mV;
+    uint16_t *mU;
+    float *mA;
+    float *mB;
+    uint16_t *mCoeffA;
+    uint16_t *mCoeffB;
+    void *mMemory;
+};
+
+}; // namespace android
+
+#endif
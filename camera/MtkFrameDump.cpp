@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "MtkFrameDump.h"
+
+namespace android {
+
+#define ALIGN(x, a)     (((x) + (a) - 1) & ~((uint64_t)(a) - 1))
+
+static uint8_t *putU16(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t *putU32(uint8_t *p, uint32_t v)
+{
+    return putU16(putU16(p, v), v >> 16);
+}
+
+static uint8_t *putU64(uint8_t *p, uint64_t v)
+{
+    return putU32(putU32(p, v), v >> 32);
+}
+
+// Entry KEY_ZOOM of KEY_ZOOM_RATIOS, 100 when either is missing
+static int zoomRatio(const MtkCameraParameters &params)
+{
+    const char *p = params.get(CameraParameters::KEY_ZOOM_RATIOS);
+    int zoom = params.getInt(CameraParameters::KEY_ZOOM);
+
+    if (p == NULL || zoom < 0)
+        return 100;
+    for (; zoom > 0; zoom--) {
+        p = strchr(p, ',');
+        if (p == NULL)
+            return 100;
+        p++;
+    }
+
+    int ratio = atoi(p);
+    return ratio > 100 ? ratio : 100;
+}
+
+MtkFrameDumper::MtkFrameDumper()
+    : mQueue(NULL),
+      mDepth(0),
+      mHead(0),
+      mCount(0),
+      mRunning(false),
+      mExit(false),
+      mSequence(0),
+      mZoom(100),
+      mData(-1),
+      mIndex(-1),
+      mOffset(0),
+      mIndexOffset(0),
+      mStaging(NULL),
+      mStagingSize(0)
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+MtkFrameDumper::~MtkFrameDumper()
+{
+    stop();
+    free(mStaging);
+}
+
+bool MtkFrameDumper::enabled(const MtkCameraParameters &params)
+{
+    return params.getInt(MTK_KEY_RAW_DUMP_FLAG) > 0;
+}
+
+status_t MtkFrameDumper::start(const MtkCameraParameters &params, int depth)
+{
+    const char *path = params.get(MTK_KEY_CAPTURE_PATH);
+
+    if (path == NULL || path[0] == '\0') {
+        ALOGE("No %s to dump to", MtkCameraParameters::KEY_CAPTURE_PATH);
+        return BAD_VALUE;
+    }
+    setZoomCrop(params.getInt(MTK_KEY_PREVIEW_DUMP_RESOLUTION) ==
+            MtkCameraParameters::PREVIEW_DUMP_RESOLUTION_CROP ? zoomRatio(params) : 100);
+    return start(path, depth);
+}
+
+status_t MtkFrameDumper::start(const char *path, int depth)
+{
+    char name[PATH_MAX];
+    uint8_t header[8] = { 'M', 'K', 'D', MTK_DUMP_VERSION };
+    status_t err;
+
+    if (mRunning) {
+        ALOGE("Already dumping");
+        return INVALID_OPERATION;
+    }
+    if (path == NULL || depth <= 0)
+        return BAD_VALUE;
+
+    snprintf(name, sizeof(name), "%s.frames", path);
+    mData = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+    // tmpfs and some FUSE mounts refuse O_DIRECT
+    if (mData < 0 && errno == EINVAL) {
+        ALOGW("%s: no O_DIRECT, dumping through the page cache", name);
+        mData = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (mData < 0) {
+        err = -errno;
+        ALOGE("Cannot create %s: %s", name, strerror(errno));
+        return err;
+    }
+
+    snprintf(name, sizeof(name), "%s.idx", path);
+    mIndex = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    putU32(header + 4, MTK_DUMP_RECORD_SIZE);
+    if (mIndex < 0 || pwrite(mIndex, header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        err = -errno;
+        ALOGE("Cannot create %s: %s", name, strerror(errno));
+        goto fail;
+    }
+
+    mQueue = new Request[depth];
+    mDepth = depth;
+    mHead = mCount = 0;
+    mSequence = 0;
+    mOffset = 0;
+    mIndexOffset = sizeof(header);
+    memset(&mStats, 0, sizeof(mStats));
+    mStats.depth = depth;
+    mExit = false;
+    if (pthread_create(&mThread, NULL, threadLoop, this) != 0) {
+        err = NO_MEMORY;
+        ALOGE("Cannot start the dump writer");
+        delete[] mQueue;
+        mQueue = NULL;
+        goto fail;
+    }
+    mRunning = true;
+    return NO_ERROR;
+
+fail:
+    close(mData);
+    if (mIndex >= 0)
+        close(mIndex);
+    mData = mIndex = -1;
+    return err;
+}
+
+void MtkFrameDumper::setZoomCrop(int ratio)
+{
+    Mutex::Autolock _l(mLock);
+    mZoom = ratio > 100 ? ratio : 100;
+}
+
+status_t MtkFrameDumper::queue(const MtkImage &image, nsecs_t timestamp, Done done, void *cookie)
+{
+    Request request;
+
+    request.image = image;
+    request.timestamp = timestamp;
+    request.done = done;
+    request.cookie = cookie;
+    request.pool = NULL;
+    request.frame = NULL;
+    return push(request);
+}
+
+status_t MtkFrameDumper::queue(MtkFrame *frame, MtkFramePool *pool, nsecs_t timestamp)
+{
+    Request request;
+
+    request.image = frame->image;
+    request.timestamp = timestamp;
+    request.done = NULL;
+    request.cookie = NULL;
+    request.pool = pool;
+    request.frame = frame;
+    return push(request);
+}
+
+// Never waits for the writer, only for the lock it holds between frames
+status_t MtkFrameDumper::push(const Request &request)
+{
+    if (mtkImageSize(request.image.format, request.image.width, request.image.height) == 0)
+        return BAD_VALUE;
+
+    Mutex::Autolock _l(mLock);
+    // Past stop() the writer may have seen the queue empty for the last time
+    if (!mRunning || mExit)
+        return INVALID_OPERATION;
+    if (mCount == mDepth) {
+        mSequence++;
+        mStats.dropped++;
+        return WOULD_BLOCK;
+    }
+
+    Request &r = mQueue[(mHead + mCount) % mDepth];
+    r = request;
+    r.sequence = mSequence++;
+    r.zoom = mZoom;
+    mCount++;
+    mStats.queued++;
+    if (mCount > mStats.highWater)
+        mStats.highWater = mCount;
+    mQueued.signal();
+    return NO_ERROR;
+}
+
+status_t MtkFrameDumper::stop()
+{
+    mLock.lock();
+    if (!mRunning) {
+        mLock.unlock();
+        return NO_ERROR;
+    }
+    mExit = true;
+    mQueued.signal();
+    mLock.unlock();
+
+    pthread_join(mThread, NULL);
+
+    status_t err = NO_ERROR;
+    if (fdatasync(mData) != 0 || fdatasync(mIndex) != 0) {
+        err = -errno;
+        ALOGE("Cannot sync the dump: %s", strerror(errno));
+    }
+    close(mData);
+    close(mIndex);
+    mData = mIndex = -1;
+
+    /*
+     * The writer drains the queue before it exits, and push() takes
+     * nothing once mExit is set; this is only a backstop, and it runs
+     * the callbacks without the lock like the writer does.
+     */
+    int left = mCount;
+    for (; mCount > 0; mCount--) {
+        finish(mQueue[mHead]);
+        mHead = (mHead + 1) % mDepth;
+    }
+
+    mLock.lock();
+    mRunning = false;
+    mStats.dropped += left;
+    delete[] mQueue;
+    mQueue = NULL;
+    mLock.unlock();
+    return err;
+}
+
+void MtkFrameDumper::stats(MtkFrameDumpStats *stats) const
+{
+    Mutex::Autolock _l(mLock);
+    *stats = mStats;
+}
+
+// Gives the frame back to its owner
+void MtkFrameDumper::finish(const Request &request)
+{
+    if (request.pool != NULL)
+        request.pool->release(request.frame);
+    else if (request.done != NULL)
+        request.done(request.cookie, &request.image);
+}
+
+void *MtkFrameDumper::threadLoop(void *arg)
+{
+    MtkFrameDumper *d = (MtkFrameDumper *)arg;
+
+    for (;;) {
+        d->mLock.lock();
+        while (d->mCount == 0 && !d->mExit)
+            d->mQueued.wait(d->mLock);
+        if (d->mCount == 0) {
+            d->mLock.unlock();
+            return NULL;
+        }
+        Request request = d->mQueue[d->mHead];
+        d->mLock.unlock();
+
+        d->write(request);
+        finish(request);
+
+        // Only now does the slot count as free
+        d->mLock.lock();
+        d->mHead = (d->mHead + 1) % d->mDepth;
+        d->mCount--;
+        d->mLock.unlock();
+    }
+}
+
+uint8_t *MtkFrameDumper::staging(size_t size)
+{
+    if (size > mStagingSize) {
+        free(mStaging);
+        mStagingSize = 0;
+        if (posix_memalign((void **)&mStaging, MTK_DUMP_ALIGNMENT, size) != 0) {
+            mStaging = NULL;
+            return NULL;
+        }
+        mStagingSize = size;
+    }
+    return mStaging;
+}
+
+bool MtkFrameDumper::writeAt(const uint8_t *data, size_t size, uint64_t offset)
+{
+    while (size > 0) {
+        ssize_t n = pwrite(mData, data, size, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            ALOGE("Dump write of %zu bytes failed: %s", size, n < 0 ? strerror(errno) : "short");
+            return false;
+        }
+        data += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+/*
+ * A frame that is already one aligned block in the standard layout goes
+ * out from where it is, all but the last partial block of it; anything
+ * else is packed into the staging buffer first.
+ */
+void MtkFrameDumper::write(const Request &request)
+{
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    MtkImage src = request.image, packed;
+    uint8_t flags = 0;
+    bool ok;
+
+    if (request.zoom > 100) {
+        int w = src.width * 100 / request.zoom & ~3;
+        int h = src.height * 100 / request.zoom & ~1;
+        MtkImage crop;
+        if (w > 0 && h > 0 && mtkImageCrop(request.image, (src.width - w) / 2 & ~3,
+                (src.height - h) / 2 & ~1, w, h, &crop) == NO_ERROR) {
+            src = crop;
+            flags |= MTK_DUMP_CROPPED;
+        }
+    }
+
+    size_t size = mtkImageSize(src.format, src.width, src.height);
+    size_t padded = ALIGN(size, MTK_DUMP_ALIGNMENT);
+    bool direct = flags == 0 && ((uintptr_t)src.planes[0] & (MTK_DUMP_ALIGNMENT - 1)) == 0 &&
+            mtkImageInit(&packed, src.format, src.width, src.height, src.planes[0]) == NO_ERROR &&
+            memcmp(packed.planes, src.planes, sizeof(src.planes)) == 0 &&
+            memcmp(packed.strides, src.strides, sizeof(src.strides)) == 0;
+
+    if (direct) {
+        size_t body = size & ~(size_t)(MTK_DUMP_ALIGNMENT - 1);
+        uint8_t *tail = size > body ? staging(MTK_DUMP_ALIGNMENT) : NULL;
+
+        ok = size == body || tail != NULL;
+        if (ok && body > 0)
+            ok = writeAt(src.planes[0], body, mOffset);
+        if (ok && tail != NULL) {
+            memcpy(tail, src.planes[0] + body, size - body);
+            memset(tail + size - body, 0, padded - size);
+            ok = writeAt(tail, MTK_DUMP_ALIGNMENT, mOffset + body);
+        }
+    } else {
+        uint8_t *buffer = staging(padded);
+
+        ok = buffer != NULL;
+        if (ok) {
+            mtkImageInit(&packed, src.format, src.width, src.height, buffer);
+            mtkImageCopy(src, &packed);
+            memset(buffer + size, 0, padded - size);
+            ok = writeAt(buffer, padded, mOffset);
+        }
+    }
+
+    if (ok) {
+        uint8_t record[MTK_DUMP_RECORD_SIZE] = { 0 }, *p = record;
+
+        p = putU32(p, request.sequence);
+        p = putU64(p, request.timestamp);
+        p = putU64(p, mOffset);
+        p = putU32(p, size);
+        p = putU16(p, src.width);
+        p = putU16(p, src.height);
+        *p++ = src.format;
+        *p++ = flags;
+        ok = pwrite(mIndex, record, sizeof(record), mIndexOffset) == (ssize_t)sizeof(record);
+        ALOGE_IF(!ok, "Cannot index frame %u", request.sequence);
+        mIndexOffset += sizeof(record);
+        mOffset += padded;
+    }
+
+    nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    Mutex::Autolock _l(mLock);
+    if (ok) {
+        mStats.written++;
+        mStats.bytes += size;
+    } else {
+        mStats.failed++;
+    }
+    if (elapsed > mStats.slowestWrite)
+        mStats.slowestWrite = elapsed;
+}
+
+}; // namespace android
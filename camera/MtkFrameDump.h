@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_FRAME_DUMP_H
+#define ANDROID_HARDWARE_MTK_FRAME_DUMP_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <utils/Condition.h>
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
+
+#include "MtkCameraParameters.h"
+#include "MtkFramePool.h"
+#include "MtkImage.h"
+
+namespace android {
+
+/**
+ * Frame index of a dump, version 1, next to the frame data. Integers are
+ * little endian.
+ *
+ *   "MKD" version                  4 bytes
+ *   record size                    u32, 32
+ *   records                        one per frame written:
+ *     sequence                     u32, queue order, gaps are drops
+ *     timestamp                    i64, as given to queue()
+ *     offset                       u64 of the frame in the data file
+ *     size                         u32, bytes of the frame there
+ *     width, height                u16 each
+ *     format                       u8, MtkPixelFormat
+ *     flags                        u8, MTK_DUMP_CROPPED
+ *     reserved                     u16
+ *
+ * Frames are in the standard layout of mtkImageInit() at offsets
+ * aligned to MTK_DUMP_ALIGNMENT, zero filled up to the next one.
+ */
+enum {
+    MTK_DUMP_VERSION = 1,
+    MTK_DUMP_RECORD_SIZE = 32,
+    MTK_DUMP_ALIGNMENT = 4096,
+    MTK_DUMP_CROPPED = 1,
+};
+
+struct MtkFrameDumpStats {
+    uint64_t queued;
+    uint64_t written;
+    uint64_t dropped;               // queue full or stopping, not dumped
+    uint64_t failed;                // could not be written
+    uint64_t bytes;
+    int depth;                      // bound on frames in flight
+    int highWater;                  // most frames in flight at once
+    nsecs_t slowestWrite;
+};
+
+/**
+ * Dumps preview and raw frames to storage without holding up the camera
+ * thread. queue() only takes a reference: the frame stays the caller's,
+ * untouched, until the writer thread is done with it and says so. At
+ * most depth frames are in flight; queue() on a full queue drops the
+ * dump of that frame, never the frame itself.
+ *
+ * The data file is opened with O_DIRECT, so frames go from their own
+ * buffers to the device without a copy through the page cache, and the
+ * dump does not leave dirty pages behind for writeback to stall the
+ * camera with later. Buffers O_DIRECT cannot take as they are, and
+ * crops, are copied into the writer's own aligned buffer first.
+ */
+class MtkFrameDumper {
+public:
+    // Called on the writer thread once the frame is no longer needed
+    typedef void (*Done)(void *cookie, const MtkImage *image);
+
+    MtkFrameDumper();
+    ~MtkFrameDumper();
+
+    // Whether KEY_RAW_DUMP_FLAG asks for dumps
+    static bool enabled(const MtkCameraParameters &params);
+
+    /*
+     * Starts dumping to path.frames and path.idx, path being
+     * KEY_CAPTURE_PATH for the parameters version, which also takes
+     * KEY_PREVIEW_DUMP_RESOLUTION: with PREVIEW_DUMP_RESOLUTION_CROP the
+     * frames are cropped to the current zoom on the way out.
+     */
+    status_t start(const char *path, int depth = 8);
+    status_t start(const MtkCameraParameters &params, int depth = 8);
+
+    // Crops to the centre 100 / ratio of each frame, 100 for none
+    void setZoomCrop(int ratio);
+
+    /*
+     * Hands the frame over to the writer, which calls done when it is
+     * finished with it. WOULD_BLOCK when depth frames are in flight
+     * already, and INVALID_OPERATION when not started or stopping; done
+     * is not called for those. Frames queued before stop() are all
+     * handed back by the time it returns.
+     */
+    status_t queue(const MtkImage &image, nsecs_t timestamp, Done done, void *cookie);
+    // The same for a pool frame, which goes back to the pool when written
+    status_t queue(MtkFrame *frame, MtkFramePool *pool, nsecs_t timestamp);
+
+    // Writes out what is queued and closes the files
+    status_t stop();
+
+    void stats(MtkFrameDumpStats *stats) const;
+
+private:
+    MtkFrameDumper(const MtkFrameDumper&);
+    MtkFrameDumper& operator=(const MtkFrameDumper&);
+
+    struct Request {
+        MtkImage image;
+        nsecs_t timestamp;
+        uint32_t sequence;
+        int zoom;
+        Done done;
+        void *cookie;
+        MtkFramePool *pool;
+        MtkFrame *frame;
+    };
+
+    static void *threadLoop(void *arg);
+    static void finish(const Request &request);
+    status_t push(const Request &request);
+    void write(const Request &request);
+    bool writeAt(const uint8_t *data, size_t size, uint64_t offset);
+    uint8_t *staging(size_t size);
+
+    mutable Mutex mLock;
+    Condition mQueued;
+    Request *mQueue;                // ring of mDepth
+    int mDepth;
+    int mHead;
+    int mCount;
+    bool mRunning;
+    bool mExit;
+    pthread_t mThread;
+    uint32_t mSequence;
+    int mZoom;
+    MtkFrameDumpStats mStats;
+
+    // Writer thread only
+    int mData;
+    int mIndex;
+    uint64_t mOffset;
+    uint64_t mIndexOffset;
+    uint8_t *mStaging;
+    size_t mStagingSize;
+};
+
+}; // namespace android
+
+#endif
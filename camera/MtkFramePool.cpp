@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkFramePool.h"
+
+namespace android {
+
+#define NO_FRAME        0xffffffffu
+#define TAG_ONE         (1ULL << 32)
+
+static inline uint32_t headIndex(uint64_t v)
+{
+    return (uint32_t)v;
+}
+
+MtkFramePool::MtkFramePool()
+    : mFrames(NULL),
+      mCount(0),
+      mMemory(NULL),
+      mFree(NO_FRAME),
+      mInUse(0),
+      mHighWater(0),
+      mAcquired(0),
+      mWaits(0),
+      mTimeouts(0),
+      mWaiters(0)
+{
+}
+
+MtkFramePool::~MtkFramePool()
+{
+    int inUse = mInUse.load(std::memory_order_relaxed);
+
+    ALOGE_IF(inUse > 0, "Frame pool destroyed with %d frames out", inUse);
+    clear();
+}
+
+void MtkFramePool::clear()
+{
+    delete[] mFrames;
+    free(mMemory);
+    mFrames = NULL;
+    mMemory = NULL;
+    mCount = 0;
+    mFree.store(NO_FRAME, std::memory_order_relaxed);
+}
+
+status_t MtkFramePool::init(MtkPixelFormat format, int width, int height, int count,
+        size_t alignment)
+{
+    size_t size = mtkImageSize(format, width, height);
+
+    if (mInUse.load(std::memory_order_acquire) > 0) {
+        ALOGE("Cannot resize a frame pool with frames out");
+        return INVALID_OPERATION;
+    }
+    if (size == 0 || count <= 0 || alignment < sizeof(void *) ||
+            (alignment & (alignment - 1)) != 0) {
+        ALOGE("No pool of %d %dx%d frames of format %d", count, width, height, format);
+        return BAD_VALUE;
+    }
+
+    size_t stride = (size + alignment - 1) & ~(alignment - 1);
+    if (stride > SIZE_MAX / count)
+        return NO_MEMORY;
+
+    clear();
+    if (posix_memalign(&mMemory, alignment, stride * count) != 0) {
+        mMemory = NULL;
+        ALOGE("Cannot allocate %d frames of %zu bytes", count, stride);
+        return NO_MEMORY;
+    }
+    // Fault every page in now rather than on the first shot
+    memset(mMemory, 0, stride * count);
+
+    mFrames = new MtkFrame[count];
+    mCount = count;
+    for (int i = 0; i < count; i++) {
+        MtkFrame *frame = &mFrames[i];
+        frame->data = (uint8_t *)mMemory + stride * i;
+        frame->size = size;
+        frame->index = i;
+        frame->next.store(i + 1 < count ? i + 1 : (int32_t)NO_FRAME, std::memory_order_relaxed);
+        mtkImageInit(&frame->image, format, width, height, frame->data);
+    }
+    mFree.store(0, std::memory_order_release);
+
+    mHighWater.store(0, std::memory_order_relaxed);
+    mAcquired.store(0, std::memory_order_relaxed);
+    mWaits.store(0, std::memory_order_relaxed);
+    mTimeouts.store(0, std::memory_order_relaxed);
+    return NO_ERROR;
+}
+
+int MtkFramePool::frameCount(const MtkCameraParameters &params, int maxFrames)
+{
+    static const char *const modes[] = {
+        MtkCameraParameters::CAPTURE_MODE_BURST_SHOT,
+        MtkCameraParameters::CAPTURE_MODE_CONTINUOUS_SHOT,
+        NULL
+    };
+    static const char *const onOff[] = {
+        MtkCameraParameters::OFF,
+        MtkCameraParameters::ON,
+        NULL
+    };
+    int mode = params.getEnum(MTK_KEY_CAPTURE_MODE, modes);
+    int count = 2;
+
+    if (mode >= 0) {
+        int shots = params.getInt(MTK_KEY_BURST_SHOT_NUM);
+        count = shots > 0 ? shots : maxFrames;
+        // The sensor keeps going while the consumer holds a frame
+        if (mode == 1 && params.getEnum(MTK_KEY_FAST_CONTINUOUS_SHOT, onOff) == 1)
+            count++;
+    }
+    if (count > maxFrames)
+        count = maxFrames;
+    return count > 0 ? count : 1;
+}
+
+status_t MtkFramePool::init(const MtkCameraParameters &params, int maxFrames)
+{
+    MtkPixelFormat format = mtkPixelFormat(params.getPictureFormat());
+    int width, height;
+
+    if (format == MTK_PIXEL_FORMAT_INVALID)
+        format = MTK_PIXEL_FORMAT_NV21;
+    params.getPictureSize(&width, &height);
+    return init(format, width, height, frameCount(params, maxFrames));
+}
+
+/*
+ * Treiber stack over frame indices. The tag goes up on every change of
+ * the head, so a head that was popped and pushed back in between does
+ * not compare equal.
+ */
+MtkFrame *MtkFramePool::pop()
+{
+    uint64_t head = mFree.load(std::memory_order_seq_cst);
+
+    for (;;) {
+        uint32_t index = headIndex(head);
+        if (index == NO_FRAME)
+            return NULL;
+
+        uint32_t next = (uint32_t)mFrames[index].next.load(std::memory_order_relaxed);
+        uint64_t want = ((head & ~(TAG_ONE - 1)) + TAG_ONE) | next;
+        if (mFree.compare_exchange_weak(head, want, std::memory_order_seq_cst))
+            return &mFrames[index];
+    }
+}
+
+void MtkFramePool::push(MtkFrame *frame)
+{
+    uint64_t head = mFree.load(std::memory_order_relaxed);
+    uint64_t want;
+
+    do {
+        frame->next.store((int32_t)headIndex(head), std::memory_order_relaxed);
+        want = ((head & ~(TAG_ONE - 1)) + TAG_ONE) | (uint32_t)frame->index;
+    } while (!mFree.compare_exchange_weak(head, want, std::memory_order_seq_cst));
+}
+
+MtkFrame *MtkFramePool::acquire(nsecs_t timeout)
+{
+    MtkFrame *frame = pop();
+
+    if (frame == NULL) {
+        mWaits.fetch_add(1, std::memory_order_relaxed);
+        if (timeout != 0) {
+            nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + timeout;
+
+            /*
+             * Registered before looking again, so a release either puts
+             * its frame where this pop sees it or finds us waiting.
+             */
+            Mutex::Autolock _l(mLock);
+            mWaiters.fetch_add(1, std::memory_order_seq_cst);
+            while ((frame = pop()) == NULL) {
+                if (timeout < 0) {
+                    mReleased.wait(mLock);
+                    continue;
+                }
+                nsecs_t left = deadline - systemTime(SYSTEM_TIME_MONOTONIC);
+                if (left <= 0)
+                    break;
+                mReleased.waitRelative(mLock, left);
+            }
+            mWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (frame == NULL) {
+            mTimeouts.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+    }
+
+    int inUse = mInUse.fetch_add(1, std::memory_order_relaxed) + 1;
+    int high = mHighWater.load(std::memory_order_relaxed);
+    while (inUse > high &&
+            !mHighWater.compare_exchange_weak(high, inUse, std::memory_order_relaxed))
+        ;
+    mAcquired.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+void MtkFramePool::release(MtkFrame *frame)
+{
+    if (frame == NULL || frame < mFrames || frame >= mFrames + mCount) {
+        ALOGE("Frame %p is not from this pool", frame);
+        return;
+    }
+
+    mInUse.fetch_sub(1, std::memory_order_relaxed);
+    push(frame);
+    if (mWaiters.load(std::memory_order_seq_cst) > 0) {
+        Mutex::Autolock _l(mLock);
+        mReleased.signal();
+    }
+}
+
+void MtkFramePool::stats(MtkFramePoolStats *stats) const
+{
+    stats->capacity = mCount;
+    stats->inUse = mInUse.load(std::memory_order_relaxed);
+    stats->highWater = mHighWater.load(std::memory_order_relaxed);
+    stats->acquired = mAcquired.load(std::memory_order_relaxed);
+    stats->waits = mWaits.load(std::memory_order_relaxed);
+    stats->timeouts = mTimeouts.load(std::memory_order_relaxed);
+}
+
+void MtkFramePool::resetHighWater()
+{
+    mHighWater.store(mInUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+}; // namespace android
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_FRAME_POOL_H
+#define ANDROID_HARDWARE_MTK_FRAME_POOL_H
+
+#include <atomic>
+#include <stdint.h>
+#include <utils/Condition.h>
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
+
+#include "MtkCameraParameters.h"
+#include "MtkImage.h"
+
+namespace android {
+
+// A buffer of an MtkFramePool, valid from acquire() to release()
+struct MtkFrame {
+    MtkImage image;
+    uint8_t *data;
+    size_t size;
+    int index;
+    // Free list link, owned by the pool
+    std::atomic<int32_t> next;
+};
+
+struct MtkFramePoolStats {
+    int capacity;
+    int inUse;
+    int highWater;                  // most frames out at once since init()
+    uint64_t acquired;
+    uint64_t waits;                 // acquires that found the pool empty
+    uint64_t timeouts;              // and gave up
+};
+
+/**
+ * Preallocated frames for burst and continuous shot. All buffers come
+ * from one allocation made and touched in init(), so no page faults or
+ * allocator calls land between shots. acquire() and release() go through
+ * a lock-free free list; only an acquire on an empty pool takes a lock,
+ * to wait for a consumer to give a frame back. That wait is the
+ * backpressure: a producer cannot run more than capacity frames ahead.
+ */
+class MtkFramePool {
+public:
+    MtkFramePool();
+    ~MtkFramePool();
+
+    // count frames, each with buffers aligned to alignment, a power of two
+    status_t init(MtkPixelFormat format, int width, int height, int count,
+            size_t alignment = 4096);
+
+    /*
+     * Sized for the capture the parameters set up: KEY_BURST_SHOT_NUM
+     * frames for burst and continuous shot, capped at maxFrames, one
+     * more with KEY_FAST_CONTINUOUS_SHOT on, two for anything else.
+     * Frames have the picture size, in the picture format when it is
+     * one MtkImage knows and in NV21, what JPEG is encoded from, when
+     * it is not.
+     */
+    status_t init(const MtkCameraParameters &params, int maxFrames);
+
+    static int frameCount(const MtkCameraParameters &params, int maxFrames);
+
+    /*
+     * A free frame, waiting up to timeout for one when there is none:
+     * 0 does not wait, a negative timeout waits for ever. NULL when none
+     * came back in time.
+     */
+    MtkFrame *acquire(nsecs_t timeout = -1);
+    void release(MtkFrame *frame);
+
+    int capacity() const { return mCount; }
+    void stats(MtkFramePoolStats *stats) const;
+    // Starts the high-water mark over at the frames out now
+    void resetHighWater();
+
+private:
+    MtkFramePool(const MtkFramePool&);
+    MtkFramePool& operator=(const MtkFramePool&);
+
+    MtkFrame *pop();
+    void push(MtkFrame *frame);
+    void clear();
+
+    MtkFrame *mFrames;
+    int mCount;
+    void *mMemory;
+
+    // Index of the first free frame in the low half, ABA tag in the high one
+    std::atomic<uint64_t> mFree;
+
+    std::atomic<int> mInUse;
+    std::atomic<int> mHighWater;
+    std::atomic<uint64_t> mAcquired;
+    std::atomic<uint64_t> mWaits;
+    std::atomic<uint64_t> mTimeouts;
+
+    // Only for acquires that have to wait
+    std::atomic<int> mWaiters;
+    Mutex mLock;
+    Condition mReleased;
+};
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_NEON
+
+#include <arm_neon.h>
+
+#include "MtkExposureFusion.h"
+
+namespace android {
+
+/*
+ * vrhadd is the rounding average of the scalar filters, vrshrn and
+ * vqrshrun its "+ half, then shift"; the levels are handled as unsigned
+ * wherever they cannot be negative.
+ */
+static inline uint16x8_t load(const int16_t *p)
+{
+    return vld1q_u16((const uint16_t *)p);
+}
+
+static inline void store(int16_t *p, uint16x8_t v)
+{
+    vst1q_u16((uint16_t *)p, v);
+}
+
+static inline uint16x8_t s121(uint16x8_t a, uint16x8_t b, uint16x8_t c)
+{
+    return vrhaddq_u16(vrhaddq_u16(a, c), b);
+}
+
+static inline uint16x8_t s161(uint16x8_t a, uint16x8_t b, uint16x8_t c)
+{
+    return vrhaddq_u16(b, vrhaddq_u16(b, vrhaddq_u16(a, c)));
+}
+
+static void widenNeon(const uint8_t *src, int16_t *dst, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+        store(dst + x, vshlq_n_u16(vmovl_u8(vld1_u8(src + x)), 4));
+    if (x < width)
+        kMtkFusionScalar.widen(src + x, dst + x, width - x);
+}
+
+static void widenVuNeon(const uint8_t *vu, int16_t *v, int16_t *u, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x2_t p = vld2_u8(vu + 2 * x);
+        store(v + x, vshlq_n_u16(vmovl_u8(p.val[0]), 4));
+        store(u + x, vshlq_n_u16(vmovl_u8(p.val[1]), 4));
+    }
+    if (x < width)
+        kMtkFusionScalar.widenVu(vu + 2 * x, v + x, u + x, width - x);
+}
+
+static void weightsNeon(const uint8_t *const y[3], const uint8_t *vu, uint16_t *w, int width)
+{
+    const uint16x8_t one = vdupq_n_u16(1), cap = vdupq_n_u16(254);
+    const uint16x8_t grey = vdupq_n_u16(128);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t c = vmovl_u8(vld1_u8(y[1] + x));
+        uint16x8_t around = vaddq_u16(vaddl_u8(vld1_u8(y[1] + x - 1), vld1_u8(y[1] + x + 1)),
+                vaddl_u8(vld1_u8(y[0] + x), vld1_u8(y[2] + x)));
+        uint16x8_t contrast = vaddq_u16(vminq_u16(vabdq_u16(vshlq_n_u16(c, 2), around), cap), one);
+
+        // |V - 128| + |U - 128| of each pair, then once per pixel
+        uint16x4_t s = vmovn_u32(vpaddlq_u16(vabdq_u16(vmovl_u8(vld1_u8(vu + x)), grey)));
+        uint16x4x2_t pairs = vzip_u16(s, s);
+        uint16x8_t saturation = vaddq_u16(vminq_u16(vcombine_u16(pairs.val[0], pairs.val[1]), cap), one);
+
+        uint16x8_t d = vabdq_u16(c, grey);
+        uint16x8_t e = vsubq_u16(vdupq_n_u16(16384), vmulq_u16(d, d));
+        e = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(e), vget_low_u16(e)), 16),
+                vshrn_n_u32(vmull_u16(vget_high_u16(e), vget_high_u16(e)), 16));
+        e = vminq_u16(vshrq_n_u16(e, 4), vdupq_n_u16(255));
+
+        uint16x8_t cs = vmulq_u16(contrast, saturation);
+        uint16x8_t r = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(cs), vget_low_u16(e)), 8),
+                vshrn_n_u32(vmull_u16(vget_high_u16(cs), vget_high_u16(e)), 8));
+        vst1q_u16(w + x, vaddq_u16(r, one));
+    }
+    if (x < width) {
+        const uint8_t *const rows[3] = { y[0] + x, y[1] + x, y[2] + x };
+        kMtkFusionScalar.weights(rows, vu + x, w + x, width - x);
+    }
+}
+
+// 16384 / sum, the same correctly rounded division as the scalar code
+static inline float32x4_t scale(uint32x4_t sum)
+{
+#ifdef __aarch64__
+    return vdivq_f32(vdupq_n_f32(16384.0f), vcvtq_f32_u32(sum));
+#else
+    float s[4];
+
+    vst1q_f32(s, vcvtq_f32_u32(sum));
+    for (int i = 0; i < 4; i++)
+        s[i] = 16384.0f / s[i];
+    return vld1q_f32(s);
+#endif
+}
+
+static void normalizeNeon(const uint16_t *const w[], int16_t *const out[], int count, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint32x4_t lo = vdupq_n_u32(0), hi = vdupq_n_u32(0);
+        for (int i = 0; i < count; i++) {
+            uint16x8_t v = vld1q_u16(w[i] + x);
+            lo = vaddq_u32(lo, vmovl_u16(vget_low_u16(v)));
+            hi = vaddq_u32(hi, vmovl_u16(vget_high_u16(v)));
+        }
+
+        float32x4_t scaleLo = scale(lo), scaleHi = scale(hi);
+        for (int i = 0; i < count; i++) {
+            uint16x8_t v = vld1q_u16(w[i] + x);
+            uint32x4_t l = vcvtq_u32_f32(vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), scaleLo));
+            uint32x4_t h = vcvtq_u32_f32(vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), scaleHi));
+            store(out[i] + x, vcombine_u16(vmovn_u32(l), vmovn_u32(h)));
+        }
+    }
+    if (x < width) {
+        const uint16_t *ws[MtkExposureFusion::MAX_FRAMES];
+        int16_t *outs[MtkExposureFusion::MAX_FRAMES];
+        for (int i = 0; i < count; i++) {
+            ws[i] = w[i] + x;
+            outs[i] = out[i] + x;
+        }
+        kMtkFusionScalar.normalize(ws, outs, count, width - x);
+    }
+}
+
+static void reduceVNeon(const int16_t *const r[5], int16_t *out, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t r0 = load(r[0] + x), r1 = load(r[1] + x), r2 = load(r[2] + x);
+        uint16x8_t r3 = load(r[3] + x), r4 = load(r[4] + x);
+        store(out + x, s121(s121(r0, r1, r2), s121(r1, r2, r3), s121(r2, r3, r4)));
+    }
+    if (x < width) {
+        const int16_t *const rows[5] = { r[0] + x, r[1] + x, r[2] + x, r[3] + x, r[4] + x };
+        kMtkFusionScalar.reduceV(rows, out + x, width - x);
+    }
+}
+
+static void reduceHNeon(const int16_t *in, int16_t *tmp, int16_t *out, int width)
+{
+    int j = -1, x = 0;
+
+    for (; j + 8 <= 2 * width; j += 8)
+        store(tmp + j + 1, s121(load(in + j - 1), load(in + j), load(in + j + 1)));
+    for (; j < 2 * width; j++)
+        tmp[j + 1] = (((in[j - 1] + in[j + 1] + 1) >> 1) + in[j] + 1) >> 1;
+
+    // vld2 splits tmp[2x + 2i] from tmp[2x + 2i + 1]; the second one
+    // reads one past tmp[2 * width], hence the spare column
+    for (; x + 9 <= width; x += 8) {
+        const uint16_t *t = (const uint16_t *)tmp + 2 * x;
+        uint16x8x2_t a = vld2q_u16(t), b = vld2q_u16(t + 2);
+        store(out + x, s121(a.val[0], a.val[1], b.val[0]));
+    }
+    for (; x < width; x++)
+        out[x] = (((tmp[2 * x] + tmp[2 * x + 2] + 1) >> 1) + tmp[2 * x + 1] + 1) >> 1;
+}
+
+static void expandVNeon(const int16_t *const r[3], int16_t *out, int width, int odd)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t b = load(r[1] + x), c = load(r[2] + x);
+        store(out + x, odd ? vrhaddq_u16(b, c) : s161(load(r[0] + x), b, c));
+    }
+    if (x < width) {
+        const int16_t *const rows[3] = { r[0] + x, r[1] + x, r[2] + x };
+        kMtkFusionScalar.expandV(rows, out + x, width - x, odd);
+    }
+}
+
+static void expandHNeon(const int16_t *in, int16_t *out, int width)
+{
+    int i = 0;
+
+    for (; i + 8 <= (width + 1) / 2; i += 8) {
+        uint16x8_t a = load(in + i - 1), b = load(in + i), c = load(in + i + 1);
+        uint16x8x2_t r = { { s161(a, b, c), vrhaddq_u16(b, c) } };
+        vst2q_u16((uint16_t *)out + 2 * i, r);
+    }
+    if (2 * i < width)
+        kMtkFusionScalar.expandH(in + i, out + 2 * i, width - 2 * i);
+}
+
+static void blendNeon(const int16_t *const g[], const int16_t *const e[], const int16_t *const w[],
+        int count, int16_t *out, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        int32x4_t lo = vdupq_n_s32(0), hi = vdupq_n_s32(0);
+        for (int i = 0; i < count; i++) {
+            int16x8_t l = vsubq_s16(vld1q_s16(g[i] + x), vld1q_s16(e[i] + x));
+            int16x8_t v = vld1q_s16(w[i] + x);
+            lo = vmlal_s16(lo, vget_low_s16(l), vget_low_s16(v));
+            hi = vmlal_s16(hi, vget_high_s16(l), vget_high_s16(v));
+        }
+        vst1q_s16(out + x, vcombine_s16(vrshrn_n_s32(lo, 14), vrshrn_n_s32(hi, 14)));
+    }
+    if (x < width) {
+        const int16_t *gs[MtkExposureFusion::MAX_FRAMES], *es[MtkExposureFusion::MAX_FRAMES];
+        const int16_t *ws[MtkExposureFusion::MAX_FRAMES];
+        for (int i = 0; i < count; i++) {
+            gs[i] = g[i] + x;
+            es[i] = e[i] + x;
+            ws[i] = w[i] + x;
+        }
+        kMtkFusionScalar.blend(gs, es, ws, count, out + x, width - x);
+    }
+}
+
+static void collapseNeon(const int16_t *r, const int16_t *e, int16_t *out, int width)
+{
+    const int16x8_t max = vdupq_n_s16(4080);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        int16x8_t v = vaddq_s16(vld1q_s16(r + x), vld1q_s16(e + x));
+        vst1q_s16(out + x, vminq_s16(vmaxq_s16(v, vdupq_n_s16(0)), max));
+    }
+    if (x < width)
+        kMtkFusionScalar.collapse(r + x, e + x, out + x, width - x);
+}
+
+static void narrowNeon(const int16_t *src, uint8_t *dst, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+        vst1_u8(dst + x, vqrshrun_n_s16(vld1q_s16(src + x), 4));
+    if (x < width)
+        kMtkFusionScalar.narrow(src + x, dst + x, width - x);
+}
+
+static void narrowVuNeon(const int16_t *v, const int16_t *u, uint8_t *vu, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x2_t r = { { vqrshrun_n_s16(vld1q_s16(v + x), 4),
+                vqrshrun_n_s16(vld1q_s16(u + x), 4) } };
+        vst2_u8(vu + 2 * x, r);
+    }
+    if (x < width)
+        kMtkFusionScalar.narrowVu(v + x, u + x, vu + 2 * x, width - x);
+}
+
+const MtkFusionKernels kMtkFusionNeon = {
+    widenNeon,
+    widenVuNeon,
+    weightsNeon,
+    normalizeNeon,
+    reduceVNeon,
+    reduceHNeon,
+    expandVNeon,
+    expandHNeon,
+    blendNeon,
+    collapseNeon,
+    narrowNeon,
+    narrowVuNeon,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_NEON
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_X86
+
+#include <emmintrin.h>
+
+#include "MtkExposureFusion.h"
+
+namespace android {
+
+/*
+ * pavgw is the rounding average the filters are made of; it is unsigned,
+ * which is fine as only the Laplacian and blended levels go negative,
+ * and those are never averaged.
+ */
+static inline __m128i load(const void *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void store(void *p, __m128i v)
+{
+    _mm_storeu_si128((__m128i *)p, v);
+}
+
+static inline __m128i s121(__m128i a, __m128i b, __m128i c)
+{
+    return _mm_avg_epu16(_mm_avg_epu16(a, c), b);
+}
+
+static inline __m128i s161(__m128i a, __m128i b, __m128i c)
+{
+    return _mm_avg_epu16(b, _mm_avg_epu16(b, _mm_avg_epu16(a, c)));
+}
+
+static inline __m128i abs16(__m128i v)
+{
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+static inline __m128i bytes(const uint8_t *p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128());
+}
+
+static void widenSse2(const uint8_t *src, int16_t *dst, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = load(src + x);
+        store(dst + x, _mm_slli_epi16(_mm_unpacklo_epi8(v, _mm_setzero_si128()), 4));
+        store(dst + x + 8, _mm_slli_epi16(_mm_unpackhi_epi8(v, _mm_setzero_si128()), 4));
+    }
+    if (x < width)
+        kMtkFusionScalar.widen(src + x, dst + x, width - x);
+}
+
+static void widenVuSse2(const uint8_t *vu, int16_t *v, int16_t *u, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i p = load(vu + 2 * x);
+        store(v + x, _mm_slli_epi16(_mm_and_si128(p, _mm_set1_epi16(0xff)), 4));
+        store(u + x, _mm_slli_epi16(_mm_srli_epi16(p, 8), 4));
+    }
+    if (x < width)
+        kMtkFusionScalar.widenVu(vu + 2 * x, v + x, u + x, width - x);
+}
+
+static void weightsSse2(const uint8_t *const y[3], const uint8_t *vu, uint16_t *w, int width)
+{
+    const __m128i one = _mm_set1_epi16(1), cap = _mm_set1_epi16(254);
+    const __m128i grey = _mm_set1_epi16(128);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i c = bytes(y[1] + x);
+        __m128i lap = _mm_sub_epi16(_mm_slli_epi16(c, 2),
+                _mm_add_epi16(_mm_add_epi16(bytes(y[1] + x - 1), bytes(y[1] + x + 1)),
+                        _mm_add_epi16(bytes(y[0] + x), bytes(y[2] + x))));
+        __m128i contrast = _mm_add_epi16(_mm_min_epi16(abs16(lap), cap), one);
+
+        // |V - 128| + |U - 128| of each pair, then once per pixel
+        __m128i s = _mm_madd_epi16(abs16(_mm_sub_epi16(bytes(vu + x), grey)), one);
+        s = _mm_or_si128(s, _mm_slli_epi32(s, 16));
+        __m128i saturation = _mm_add_epi16(_mm_min_epi16(s, cap), one);
+
+        __m128i d = _mm_sub_epi16(c, grey);
+        __m128i e = _mm_sub_epi16(_mm_set1_epi16(16384), _mm_mullo_epi16(d, d));
+        e = _mm_min_epi16(_mm_srli_epi16(_mm_mulhi_epu16(e, e), 4), _mm_set1_epi16(255));
+
+        __m128i cs = _mm_mullo_epi16(contrast, saturation);
+        store(w + x, _mm_add_epi16(_mm_mulhi_epu16(cs, _mm_slli_epi16(e, 8)), one));
+    }
+    if (x < width) {
+        const uint8_t *const rows[3] = { y[0] + x, y[1] + x, y[2] + x };
+        kMtkFusionScalar.weights(rows, vu + x, w + x, width - x);
+    }
+}
+
+static void normalizeSse2(const uint16_t *const w[], int16_t *const out[], int count, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 one = _mm_set1_ps(16384.0f);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i lo = zero, hi = zero;
+        for (int i = 0; i < count; i++) {
+            __m128i v = load(w[i] + x);
+            lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(v, zero));
+            hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(v, zero));
+        }
+
+        __m128 scaleLo = _mm_div_ps(one, _mm_cvtepi32_ps(lo));
+        __m128 scaleHi = _mm_div_ps(one, _mm_cvtepi32_ps(hi));
+        for (int i = 0; i < count; i++) {
+            __m128i v = load(w[i] + x);
+            __m128i l = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), scaleLo));
+            __m128i h = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), scaleHi));
+            store(out[i] + x, _mm_packs_epi32(l, h));
+        }
+    }
+    if (x < width) {
+        const uint16_t *ws[MtkExposureFusion::MAX_FRAMES];
+        int16_t *outs[MtkExposureFusion::MAX_FRAMES];
+        for (int i = 0; i < count; i++) {
+            ws[i] = w[i] + x;
+            outs[i] = out[i] + x;
+        }
+        kMtkFusionScalar.normalize(ws, outs, count, width - x);
+    }
+}
+
+static void reduceVSse2(const int16_t *const r[5], int16_t *out, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i r0 = load(r[0] + x), r1 = load(r[1] + x), r2 = load(r[2] + x);
+        __m128i r3 = load(r[3] + x), r4 = load(r[4] + x);
+        store(out + x, s121(s121(r0, r1, r2), s121(r1, r2, r3), s121(r2, r3, r4)));
+    }
+    if (x < width) {
+        const int16_t *const rows[5] = { r[0] + x, r[1] + x, r[2] + x, r[3] + x, r[4] + x };
+        kMtkFusionScalar.reduceV(rows, out + x, width - x);
+    }
+}
+
+static inline __m128i evens(__m128i a, __m128i b)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+            _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+
+static inline __m128i odds(__m128i a, __m128i b)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+
+static void reduceHSse2(const int16_t *in, int16_t *tmp, int16_t *out, int width)
+{
+    int j = -1, x = 0;
+
+    for (; j + 8 <= 2 * width; j += 8)
+        store(tmp + j + 1, s121(load(in + j - 1), load(in + j), load(in + j + 1)));
+    for (; j < 2 * width; j++)
+        tmp[j + 1] = (((in[j - 1] + in[j + 1] + 1) >> 1) + in[j] + 1) >> 1;
+
+    // tmp[2x + 2i] and tmp[2x + 2i + 2] around tmp[2x + 2i + 1]; the
+    // last load runs one past tmp[2 * width], hence the spare column
+    for (; x + 9 <= width; x += 8) {
+        const int16_t *t = tmp + 2 * x;
+        __m128i a0 = load(t), a1 = load(t + 8), b0 = load(t + 2), b1 = load(t + 10);
+        store(out + x, s121(evens(a0, a1), odds(a0, a1), evens(b0, b1)));
+    }
+    for (; x < width; x++)
+        out[x] = (((tmp[2 * x] + tmp[2 * x + 2] + 1) >> 1) + tmp[2 * x + 1] + 1) >> 1;
+}
+
+static void expandVSse2(const int16_t *const r[3], int16_t *out, int width, int odd)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i b = load(r[1] + x), c = load(r[2] + x);
+        store(out + x, odd ? _mm_avg_epu16(b, c) : s161(load(r[0] + x), b, c));
+    }
+    if (x < width) {
+        const int16_t *const rows[3] = { r[0] + x, r[1] + x, r[2] + x };
+        kMtkFusionScalar.expandV(rows, out + x, width - x, odd);
+    }
+}
+
+static void expandHSse2(const int16_t *in, int16_t *out, int width)
+{
+    int i = 0;
+
+    for (; i + 8 <= (width + 1) / 2; i += 8) {
+        __m128i a = load(in + i - 1), b = load(in + i), c = load(in + i + 1);
+        __m128i even = s161(a, b, c), odd = _mm_avg_epu16(b, c);
+        store(out + 2 * i, _mm_unpacklo_epi16(even, odd));
+        store(out + 2 * i + 8, _mm_unpackhi_epi16(even, odd));
+    }
+    if (2 * i < width)
+        kMtkFusionScalar.expandH(in + i, out + 2 * i, width - 2 * i);
+}
+
+// Two frames per madd, the Laplacians interleaved with their weights
+static void blendSse2(const int16_t *const g[], const int16_t *const e[], const int16_t *const w[],
+        int count, int16_t *out, int width)
+{
+    const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi32(8192);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i lo = round, hi = round;
+        for (int i = 0; i < count; i += 2) {
+            __m128i l0 = _mm_sub_epi16(load(g[i] + x), load(e[i] + x)), w0 = load(w[i] + x);
+            __m128i l1 = zero, w1 = zero;
+            if (i + 1 < count) {
+                l1 = _mm_sub_epi16(load(g[i + 1] + x), load(e[i + 1] + x));
+                w1 = load(w[i + 1] + x);
+            }
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(l0, l1),
+                    _mm_unpacklo_epi16(w0, w1)));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(l0, l1),
+                    _mm_unpackhi_epi16(w0, w1)));
+        }
+        store(out + x, _mm_packs_epi32(_mm_srai_epi32(lo, 14), _mm_srai_epi32(hi, 14)));
+    }
+    if (x < width) {
+        const int16_t *gs[MtkExposureFusion::MAX_FRAMES], *es[MtkExposureFusion::MAX_FRAMES], *ws[MtkExposureFusion::MAX_FRAMES];
+        for (int i = 0; i < count; i++) {
+            gs[i] = g[i] + x;
+            es[i] = e[i] + x;
+            ws[i] = w[i] + x;
+        }
+        kMtkFusionScalar.blend(gs, es, ws, count, out + x, width - x);
+    }
+}
+
+static void collapseSse2(const int16_t *r, const int16_t *e, int16_t *out, int width)
+{
+    const __m128i max = _mm_set1_epi16(4080);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_add_epi16(load(r + x), load(e + x));
+        store(out + x, _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), max));
+    }
+    if (x < width)
+        kMtkFusionScalar.collapse(r + x, e + x, out + x, width - x);
+}
+
+static inline __m128i narrowed(const int16_t *p)
+{
+    return _mm_srai_epi16(_mm_add_epi16(load(p), _mm_set1_epi16(8)), 4);
+}
+
+static void narrowSse2(const int16_t *src, uint8_t *dst, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+        store(dst + x, _mm_packus_epi16(narrowed(src + x), narrowed(src + x + 8)));
+    if (x < width)
+        kMtkFusionScalar.narrow(src + x, dst + x, width - x);
+}
+
+static void narrowVuSse2(const int16_t *v, const int16_t *u, uint8_t *vu, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+        store(vu + 2 * x, _mm_or_si128(narrowed(v + x), _mm_slli_epi16(narrowed(u + x), 8)));
+    if (x < width)
+        kMtkFusionScalar.narrowVu(v + x, u + x, vu + 2 * x, width - x);
+}
+
+const MtkFusionKernels kMtkFusionSse2 = {
+    widenSse2,
+    widenVuSse2,
+    weightsSse2,
+    normalizeSse2,
+    reduceVSse2,
+    reduceHSse2,
+    expandVSse2,
+    expandHSse2,
+    blendSse2,
+    collapseSse2,
+    narrowSse2,
+    narrowVuSse2,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_X86
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <string.h>
+
+#include "MtkCameraParameters.h"
+#include "MtkImage.h"
+
+namespace android {
+
+// Way beyond any sensor, keeps the size arithmetic far from overflowing
+#define MAX_DIMENSION   16384
+
+#define ALIGN(x, a)     (((x) + (a) - 1) & ~((a) - 1))
+
+static const struct {
+    const char *name;
+    MtkPixelFormat format;
+} kFormats[] = {
+    { CameraParameters::PIXEL_FORMAT_YUV420SP,          MTK_PIXEL_FORMAT_NV21 },
+    { MtkCameraParameters::PIXEL_FORMAT_YUV420I,        MTK_PIXEL_FORMAT_YUV420I },
+    { MtkCameraParameters::PIXEL_FORMAT_YV12_GPU,       MTK_PIXEL_FORMAT_YV12_GPU },
+    { MtkCameraParameters::PIXEL_FORMAT_YUV422I_UYVY,   MTK_PIXEL_FORMAT_UYVY },
+    { MtkCameraParameters::PIXEL_FORMAT_YUV422I_VYUY,   MTK_PIXEL_FORMAT_VYUY },
+    { MtkCameraParameters::PIXEL_FORMAT_YUV422I_YVYU,   MTK_PIXEL_FORMAT_YVYU },
+    { CameraParameters::PIXEL_FORMAT_RGBA8888,          MTK_PIXEL_FORMAT_RGBA },
+    { MtkCameraParameters::PIXEL_FORMAT_BAYER8,         MTK_PIXEL_FORMAT_BAYER8 },
+    { MtkCameraParameters::PIXEL_FORMAT_BAYER10,        MTK_PIXEL_FORMAT_BAYER10 },
+};
+
+MtkPixelFormat mtkPixelFormat(const char *name)
+{
+    if (name == NULL)
+        return MTK_PIXEL_FORMAT_INVALID;
+    for (size_t i = 0; i < sizeof(kFormats) / sizeof(kFormats[0]); i++) {
+        if (strcmp(name, kFormats[i].name) == 0)
+            return kFormats[i].format;
+    }
+    return MTK_PIXEL_FORMAT_INVALID;
+}
+
+/*
+ * Plane offsets rather than pointers, so sizes can be worked out without
+ * a buffer. Returns the number of planes, 0 if there is no layout.
+ */
+static int layout(MtkImage *image, MtkPixelFormat format, int width, int height,
+        size_t offsets[3], size_t *size)
+{
+    size_t w = width, h = height;
+    size_t yStride, cStride, ySize, cSize;
+
+    if (width <= 0 || height <= 0 || width > MAX_DIMENSION || height > MAX_DIMENSION)
+        return 0;
+
+    memset(image, 0, sizeof(*image));
+    image->format = format;
+    image->width = width;
+    image->height = height;
+    offsets[0] = 0;
+
+    switch (format) {
+    case MTK_PIXEL_FORMAT_NV21:
+        if ((width | height) & 1)
+            return 0;
+        offsets[1] = w * h;
+        image->strides[0] = image->strides[1] = w;
+        *size = w * h * 3 / 2;
+        return 2;
+    case MTK_PIXEL_FORMAT_YUV420I:
+        if ((width | height) & 1)
+            return 0;
+        offsets[1] = w * h;
+        offsets[2] = w * h + w * h / 4;
+        image->strides[0] = w;
+        image->strides[1] = image->strides[2] = w / 2;
+        *size = w * h * 3 / 2;
+        return 3;
+    case MTK_PIXEL_FORMAT_YV12_GPU:
+        if ((width | height) & 1)
+            return 0;
+        yStride = ALIGN(w, 32);
+        cStride = yStride / 2;
+        ySize = yStride * h;
+        cSize = cStride * h / 2;
+        offsets[1] = ySize + cSize;     // cb_offset
+        offsets[2] = ySize;             // cr_offset
+        image->strides[0] = yStride;
+        image->strides[1] = image->strides[2] = cStride;
+        *size = ySize + cSize * 2;
+        return 3;
+    case MTK_PIXEL_FORMAT_UYVY:
+    case MTK_PIXEL_FORMAT_VYUY:
+    case MTK_PIXEL_FORMAT_YVYU:
+        if (width & 1)
+            return 0;
+        image->strides[0] = w * 2;
+        *size = w * h * 2;
+        return 1;
+    case MTK_PIXEL_FORMAT_RGBA:
+        image->strides[0] = w * 4;
+        *size = w * h * 4;
+        return 1;
+    case MTK_PIXEL_FORMAT_BAYER8:
+        if ((width | height) & 1)
+            return 0;
+        image->strides[0] = w;
+        *size = w * h;
+        return 1;
+    case MTK_PIXEL_FORMAT_BAYER10:
+        if ((width & 3) || (height & 1))
+            return 0;
+        image->strides[0] = w * 5 / 4;
+        *size = w * 5 / 4 * h;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+size_t mtkImageSize(MtkPixelFormat format, int width, int height)
+{
+    MtkImage image;
+    size_t offsets[3], size;
+
+    if (layout(&image, format, width, height, offsets, &size) == 0)
+        return 0;
+    return size;
+}
+
+status_t mtkImageInit(MtkImage *image, MtkPixelFormat format,
+        int width, int height, void *base)
+{
+    size_t offsets[3], size;
+
+    int planes = layout(image, format, width, height, offsets, &size);
+    if (planes == 0) {
+        ALOGE("No %dx%d layout for format %d", width, height, format);
+        return BAD_VALUE;
+    }
+    for (int i = 0; i < planes; i++)
+        image->planes[i] = (uint8_t *)base + offsets[i];
+    return NO_ERROR;
+}
+
+/*
+ * Bytes across and rows of each plane of a width x height image of the
+ * format, ignoring stride padding. Returns the number of planes.
+ */
+static int planeSizes(MtkPixelFormat format, int width, int height,
+        size_t rowBytes[3], int rows[3])
+{
+    size_t w = width;
+
+    rows[0] = height;
+    switch (format) {
+    case MTK_PIXEL_FORMAT_NV21:
+        rowBytes[0] = rowBytes[1] = w;
+        rows[1] = height / 2;
+        return 2;
+    case MTK_PIXEL_FORMAT_YUV420I:
+    case MTK_PIXEL_FORMAT_YV12_GPU:
+        rowBytes[0] = w;
+        rowBytes[1] = rowBytes[2] = w / 2;
+        rows[1] = rows[2] = height / 2;
+        return 3;
+    case MTK_PIXEL_FORMAT_UYVY:
+    case MTK_PIXEL_FORMAT_VYUY:
+    case MTK_PIXEL_FORMAT_YVYU:
+        rowBytes[0] = w * 2;
+        return 1;
+    case MTK_PIXEL_FORMAT_RGBA:
+        rowBytes[0] = w * 4;
+        return 1;
+    case MTK_PIXEL_FORMAT_BAYER8:
+        rowBytes[0] = w;
+        return 1;
+    case MTK_PIXEL_FORMAT_BAYER10:
+        rowBytes[0] = w * 5 / 4;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Steps crop edges have to fall on, 0 if there is no layout
+static int cropStep(MtkPixelFormat format, int *yStep)
+{
+    *yStep = 1;
+    switch (format) {
+    case MTK_PIXEL_FORMAT_NV21:
+    case MTK_PIXEL_FORMAT_YUV420I:
+    case MTK_PIXEL_FORMAT_YV12_GPU:
+    case MTK_PIXEL_FORMAT_BAYER8:
+        *yStep = 2;
+        return 2;
+    case MTK_PIXEL_FORMAT_UYVY:
+    case MTK_PIXEL_FORMAT_VYUY:
+    case MTK_PIXEL_FORMAT_YVYU:
+        return 2;
+    case MTK_PIXEL_FORMAT_RGBA:
+        return 1;
+    case MTK_PIXEL_FORMAT_BAYER10:
+        *yStep = 2;
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+status_t mtkImageCrop(const MtkImage &src, int x, int y, int width, int height,
+        MtkImage *dst)
+{
+    size_t rowBytes[3];
+    int rows[3], yStep;
+    int xStep = cropStep(src.format, &yStep);
+
+    if (xStep == 0 || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+            x > src.width - width || y > src.height - height ||
+            (x | width) % xStep != 0 || (y | height) % yStep != 0) {
+        ALOGE("Cannot crop %dx%d at %d,%d out of %dx%d format %d", width, height,
+                x, y, src.width, src.height, src.format);
+        return BAD_VALUE;
+    }
+
+    // Each plane starts the bytes across and the rows of an x by y block in
+    int planes = planeSizes(src.format, x, y, rowBytes, rows);
+    *dst = src;
+    dst->width = width;
+    dst->height = height;
+    for (int i = 0; i < planes; i++)
+        dst->planes[i] = src.planes[i] + src.strides[i] * rows[i] + rowBytes[i];
+    return NO_ERROR;
+}
+
+status_t mtkImageCopy(const MtkImage &src, MtkImage *dst)
+{
+    size_t rowBytes[3];
+    int rows[3];
+
+    if (src.format != dst->format || src.width != dst->width || src.height != dst->height) {
+        ALOGE("Cannot copy a %dx%d format %d image into a %dx%d format %d one",
+                src.width, src.height, src.format, dst->width, dst->height, dst->format);
+        return BAD_VALUE;
+    }
+
+    int planes = planeSizes(src.format, src.width, src.height, rowBytes, rows);
+    for (int i = 0; i < planes; i++) {
+        const uint8_t *s = src.planes[i];
+        uint8_t *d = dst->planes[i];
+
+        if (src.strides[i] == rowBytes[i] && dst->strides[i] == rowBytes[i]) {
+            memcpy(d, s, rowBytes[i] * rows[i]);
+            continue;
+        }
+        for (int r = 0; r < rows[i]; r++, s += src.strides[i], d += dst->strides[i])
+            memcpy(d, s, rowBytes[i]);
+    }
+    return NO_ERROR;
+}
+
+}; // namespace android
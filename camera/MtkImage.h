@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_IMAGE_H
+#define ANDROID_HARDWARE_MTK_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+/**
+ * Pixel formats of preview, picture and video frames, see the
+ * PIXEL_FORMAT_* values in MtkCameraParameters.h.
+ */
+enum MtkPixelFormat {
+    MTK_PIXEL_FORMAT_INVALID = -1,
+    MTK_PIXEL_FORMAT_NV21,          // yuv420sp: Y plane, interleaved VU plane
+    MTK_PIXEL_FORMAT_YUV420I,       // I420: Y, U and V planes
+    MTK_PIXEL_FORMAT_YV12_GPU,      // Y, V and U planes, 32/16/16 aligned strides
+    MTK_PIXEL_FORMAT_UYVY,          // 4:2:2, one plane
+    MTK_PIXEL_FORMAT_VYUY,
+    MTK_PIXEL_FORMAT_YVYU,
+    MTK_PIXEL_FORMAT_RGBA,          // rgba8888
+    MTK_PIXEL_FORMAT_BAYER8,        // raw, one byte per sample
+    MTK_PIXEL_FORMAT_BAYER10,       // raw, MIPI RAW10: four samples in five bytes
+};
+
+/**
+ * A frame in memory the caller owns. Planes are in logical order: Y (or
+ * the packed pixels), then U and V for planar formats or VU for NV21,
+ * whatever order they have in memory. Strides are in bytes.
+ */
+struct MtkImage {
+    MtkPixelFormat format;
+    int width;
+    int height;
+    uint8_t *planes[3];
+    size_t strides[3];
+};
+
+// The format for a KEY_PREVIEW_FORMAT style name, INVALID if unknown
+MtkPixelFormat mtkPixelFormat(const char *name);
+
+// Bytes of a frame in the format's standard layout, 0 if not valid
+size_t mtkImageSize(MtkPixelFormat format, int width, int height);
+
+/**
+ * Describes a frame in the standard layout starting at base: tightly
+ * packed planes, except for YV12_GPU which follows the stride and offset
+ * rules of PIXEL_FORMAT_YV12_GPU. YUV formats need an even width, 4:2:0
+ * and Bayer ones an even height too, BAYER10 a width that is a multiple
+ * of 4.
+ */
+status_t mtkImageInit(MtkImage *image, MtkPixelFormat format,
+        int width, int height, void *base);
+
+/**
+ * A view of the width x height rectangle at (x, y) of src, in src's
+ * memory and with its strides. The rectangle has to keep whole chroma
+ * samples and Bayer quads: even edges for YUV 4:2:0 and Bayer formats,
+ * even x and width for 4:2:2, x and width multiples of 4 for BAYER10.
+ */
+status_t mtkImageCrop(const MtkImage &src, int x, int y, int width, int height,
+        MtkImage *dst);
+
+// Copies the pixels of src into dst, same format and size, any strides
+status_t mtkImageCopy(const MtkImage &src, MtkImage *dst);
+
+}; // namespace android
+
+#endif
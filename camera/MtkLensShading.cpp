@@ -0,0 +1,611 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MtkLensShading.h"
+#include "MtkPixelKernels.h"
+
+// Gains are used straight from the file mapping
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Shading tables are little endian"
+#endif
+
+namespace android {
+
+#define BAND_ROWS       16
+// Fraction bits of the interpolation weights
+#define WEIGHT_BITS     12
+#define WEIGHT_ONE      (1 << WEIGHT_BITS)
+
+static const char *const kTableNames[MTK_SHADING_TABLES] = {
+    "auto", "low", "middle", "high", "tsf",
+};
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Kernels
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static void gain8(uint8_t *row, const uint16_t *gain, int width)
+{
+    for (int x = 0; x < width; x++) {
+        uint32_t v = ((uint32_t)row[x] << 6) * gain[x] >> 16;
+        row[x] = v < 255 ? v : 255;
+    }
+}
+
+static void gain10(uint16_t *row, const uint16_t *gain, int width)
+{
+    for (int x = 0; x < width; x++) {
+        uint32_t v = ((uint32_t)row[x] << 6) * gain[x] >> 16;
+        row[x] = v < 1023 ? v : 1023;
+    }
+}
+
+const MtkShadingKernels kMtkShadingScalar = {
+    gain8,
+    gain10,
+};
+
+// Back to MIPI RAW10, width a multiple of 4
+static void pack10(const uint16_t *src, uint8_t *dst, int width)
+{
+    for (int x = 0; x < width; x += 4, src += 4, dst += 5) {
+        dst[0] = src[0] >> 2;
+        dst[1] = src[1] >> 2;
+        dst[2] = src[2] >> 2;
+        dst[3] = src[3] >> 2;
+        dst[4] = (src[0] & 3) | (src[1] & 3) << 2 | (src[2] & 3) << 4 | (src[3] & 3) << 6;
+    }
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Tables
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static uint16_t getU16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static size_t gainsSize(int width, int height)
+{
+    return (size_t)MTK_SHADING_CHANNELS * width * height * sizeof(uint16_t);
+}
+
+MtkLensShading::MtkLensShading()
+    : mDir(NULL),
+      mTable(0),
+      mMaps(NULL),
+      mMaxMaps(0),
+      mMapCount(0),
+      mClock(0),
+      mHits(0),
+      mMisses(0)
+{
+    memset(mTables, 0, sizeof(mTables));
+}
+
+MtkLensShading::~MtkLensShading()
+{
+    clear();
+}
+
+void MtkLensShading::clear()
+{
+    for (int i = 0; i < MTK_SHADING_TABLES; i++)
+        unload(i);
+    for (int i = 0; i < mMapCount; i++)
+        free(mMaps[i].gains);
+    delete[] mMaps;
+    free(mDir);
+    mMaps = NULL;
+    mDir = NULL;
+    mMapCount = mMaxMaps = 0;
+    mTable = 0;
+}
+
+status_t MtkLensShading::init(const char *dir, int maxMaps)
+{
+    if (dir == NULL || maxMaps <= 0)
+        return BAD_VALUE;
+
+    clear();
+    mDir = strdup(dir);
+    if (mDir == NULL)
+        return NO_MEMORY;
+    mMaps = new Map[maxMaps];
+    mMaxMaps = maxMaps;
+    mClock = mHits = mMisses = 0;
+    return NO_ERROR;
+}
+
+void MtkLensShading::path(int table, char *name, size_t size) const
+{
+    snprintf(name, size, "%s/shading_%s.tbl", mDir, kTableNames[table]);
+}
+
+void MtkLensShading::unload(int table)
+{
+    Table &t = mTables[table];
+
+    if (t.mapping != NULL)
+        munmap(t.mapping, t.mappingSize);
+    free(t.owned);
+    memset(&t, 0, sizeof(t));
+}
+
+// The table, mapping its file on first use; NULL when there is none
+const MtkLensShading::Table *MtkLensShading::load(int table)
+{
+    Table &t = mTables[table];
+    char name[PATH_MAX];
+    struct stat st;
+
+    if (t.loaded)
+        return t.gains != NULL ? &t : NULL;
+    t.loaded = true;
+
+    path(table, name, sizeof(name));
+    int fd = open(name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("Cannot open %s: %s", name, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < MTK_SHADING_HEADER_SIZE) {
+        ALOGE("%s is not a shading table", name);
+        close(fd);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        ALOGE("Cannot map %s: %s", name, strerror(errno));
+        return NULL;
+    }
+
+    const uint8_t *p = (const uint8_t *)mapping;
+    int width = getU16(p + 4), height = getU16(p + 6);
+    if (memcmp(p, "MKS", 3) != 0 || p[3] != MTK_SHADING_VERSION ||
+            getU16(p + 8) != MTK_SHADING_CHANNELS || width < 2 || height < 2 ||
+            (size_t)st.st_size < MTK_SHADING_HEADER_SIZE + gainsSize(width, height)) {
+        ALOGE("%s is not a version %d shading table", name, MTK_SHADING_VERSION);
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+
+    t.mapping = mapping;
+    t.mappingSize = st.st_size;
+    t.gains = (const uint16_t *)(p + MTK_SHADING_HEADER_SIZE);
+    t.width = width;
+    t.height = height;
+    return &t;
+}
+
+int MtkLensShading::table(const MtkCameraParameters &params, int cct)
+{
+    int table = params.getInt(MTK_KEY_ENG_SHADING_TABLE);
+
+    if (table >= MtkCameraParameters::KEY_ENG_SHADING_TABLE_LOW &&
+            table <= MtkCameraParameters::KEY_ENG_SHADING_TABLE_TSF)
+        return table;
+    if (cct > 0 && cct < 4000)
+        return MtkCameraParameters::KEY_ENG_SHADING_TABLE_LOW;
+    if (cct > 5500)
+        return MtkCameraParameters::KEY_ENG_SHADING_TABLE_HIGH;
+    return MtkCameraParameters::KEY_ENG_SHADING_TABLE_MIDDLE;
+}
+
+status_t MtkLensShading::select(int table)
+{
+    if (table < MtkCameraParameters::KEY_ENG_SHADING_TABLE_LOW ||
+            table > MtkCameraParameters::KEY_ENG_SHADING_TABLE_TSF)
+        return BAD_VALUE;
+    mTable = table;
+    return NO_ERROR;
+}
+
+status_t MtkLensShading::configure(const MtkCameraParameters &params, int cct)
+{
+    status_t err = select(table(params, cct));
+
+    if (err != NO_ERROR || params.getInt(MTK_KEY_ENG_SAVE_SHADING_TABLE) <= 0)
+        return err;
+    for (int i = 0; i < MTK_SHADING_TABLES; i++) {
+        if (mTables[i].dirty) {
+            status_t e = save(i);
+            if (err == NO_ERROR)
+                err = e;
+        }
+    }
+    return err;
+}
+
+status_t MtkLensShading::setTable(int table, const MtkShadingGrid &grid)
+{
+    if (table < MtkCameraParameters::KEY_ENG_SHADING_TABLE_LOW ||
+            table > MtkCameraParameters::KEY_ENG_SHADING_TABLE_TSF ||
+            grid.width < 2 || grid.height < 2 || grid.width > 65535 || grid.height > 65535 ||
+            grid.gains == NULL)
+        return BAD_VALUE;
+
+    size_t size = gainsSize(grid.width, grid.height);
+    uint16_t *gains = (uint16_t *)malloc(size);
+    if (gains == NULL)
+        return NO_MEMORY;
+    memcpy(gains, grid.gains, size);
+
+    unload(table);
+    dropMaps(table);
+    Table &t = mTables[table];
+    t.owned = gains;
+    t.gains = gains;
+    t.width = grid.width;
+    t.height = grid.height;
+    t.loaded = true;
+    t.dirty = true;
+    return NO_ERROR;
+}
+
+static status_t writeAll(int fd, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return n < 0 ? -errno : -EIO;
+        p += n;
+        size -= n;
+    }
+    return NO_ERROR;
+}
+
+status_t MtkLensShading::save(int table)
+{
+    char name[PATH_MAX], tmp[PATH_MAX + 4];
+    uint8_t header[MTK_SHADING_HEADER_SIZE] = { 'M', 'K', 'S', MTK_SHADING_VERSION };
+    status_t err = NO_ERROR;
+
+    if (table < MtkCameraParameters::KEY_ENG_SHADING_TABLE_LOW ||
+            table > MtkCameraParameters::KEY_ENG_SHADING_TABLE_TSF || mDir == NULL)
+        return BAD_VALUE;
+    const Table *t = load(table);
+    if (t == NULL)
+        return NAME_NOT_FOUND;
+
+    header[4] = t->width;
+    header[5] = t->width >> 8;
+    header[6] = t->height;
+    header[7] = t->height >> 8;
+    header[8] = MTK_SHADING_CHANNELS;
+
+    // Written next to the old one and renamed over it, so a table that
+    // is mapped, or a crash halfway, never sees a partial file
+    path(table, name, sizeof(name));
+    snprintf(tmp, sizeof(tmp), "%s.new", name);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        err = -errno;
+        ALOGE("Cannot create %s: %s", tmp, strerror(errno));
+        return err;
+    }
+    size_t size = gainsSize(t->width, t->height);
+    err = writeAll(fd, header, sizeof(header));
+    if (err == NO_ERROR)
+        err = writeAll(fd, t->gains, size);
+    if (err == NO_ERROR && fsync(fd) != 0)
+        err = -errno;
+    if (close(fd) != 0 && err == NO_ERROR)
+        err = -errno;
+    if (err == NO_ERROR && rename(tmp, name) != 0)
+        err = -errno;
+    if (err != NO_ERROR) {
+        ALOGE("Cannot save %s: %s", name, strerror(-err));
+        unlink(tmp);
+        return err;
+    }
+
+    mTables[table].dirty = false;
+    return NO_ERROR;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Gain maps
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Grid cell left of or above pixel i of n, and the weight of the next point
+struct Cell {
+    int index;
+    int weight;
+};
+
+static Cell cell(int i, int n, int grid)
+{
+    int64_t pos = (int64_t)i * (grid - 1) * WEIGHT_ONE / (n - 1);
+    Cell c;
+
+    c.index = pos >> WEIGHT_BITS;
+    if (c.index > grid - 2)
+        c.index = grid - 2;
+    c.weight = pos - ((int64_t)c.index << WEIGHT_BITS);
+    return c;
+}
+
+struct MtkLensShading::Pass {
+    const Table *table;
+    const MtkShadingKernels *k;
+    const MtkRawKernels *raw;
+    int width;
+    int height;
+    int layout;
+    const Cell *columns;        // cell() of every column
+    uint32_t *rows;             // two blended grid rows per worker
+    uint16_t *map;              // built by buildBand()
+    const uint16_t *gains;      // applied by the gain bands
+    MtkImage *frame;
+    uint16_t *samples;          // one unpacked row per worker
+};
+
+/*
+ * Bilinear upsampling of the grid to width x height. Every row needs two
+ * channels, or the two greens for luma; the grid rows are blended first,
+ * then each pixel between two columns of that.
+ */
+void MtkLensShading::buildBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const Table &table = *p.table;
+    int gw = table.width, gh = table.height;
+    size_t plane = (size_t)gw * gh;
+    bool redX = p.layout == MTK_BAYER_GRBG || p.layout == MTK_BAYER_BGGR;
+    bool redY = p.layout == MTK_BAYER_GBRG || p.layout == MTK_BAYER_BGGR;
+    uint32_t *blend[2] = { p.rows + 2 * gw * worker, p.rows + 2 * gw * worker + gw };
+    int y1 = (band + 1) * BAND_ROWS < p.height ? (band + 1) * BAND_ROWS : p.height;
+
+    for (int y = band * BAND_ROWS; y < y1; y++) {
+        Cell r = cell(y, p.height, gh);
+        bool redRow = ((y & 1) ^ redY) == 0;
+        // Channels on even and odd columns: R Gr, Gb B, or the greens
+        int channels[2];
+        if (p.layout == LUMA) {
+            channels[0] = 1;
+            channels[1] = 2;
+        } else {
+            channels[redX] = redRow ? 0 : 2;
+            channels[!redX] = redRow ? 1 : 3;
+        }
+
+        for (int c = 0; c < 2; c++) {
+            const uint16_t *g0 = table.gains + plane * channels[c] + (size_t)gw * r.index;
+            const uint16_t *g1 = g0 + gw;
+            for (int i = 0; i < gw; i++)
+                blend[c][i] = g0[i] * (WEIGHT_ONE - r.weight) + g1[i] * r.weight;
+        }
+
+        uint16_t *out = p.map + (size_t)p.width * y;
+        for (int x = 0; x < p.width; x++) {
+            const Cell &col = p.columns[x];
+            uint64_t v[2];
+            for (int c = 0; c < 2; c++) {
+                v[c] = ((uint64_t)blend[c][col.index] * (WEIGHT_ONE - col.weight) +
+                        (uint64_t)blend[c][col.index + 1] * col.weight +
+                        (1 << (2 * WEIGHT_BITS - 1))) >> (2 * WEIGHT_BITS);
+            }
+            out[x] = p.layout == LUMA ? (v[0] + v[1] + 1) >> 1 : v[x & 1];
+        }
+    }
+}
+
+status_t MtkLensShading::build(const Table &table, int width, int height, int layout,
+        uint16_t *gains, MtkThreadPool *pool)
+{
+    int gw = table.width;
+    int workers = pool != NULL ? pool->size() : 1;
+    Cell *columns = (Cell *)malloc(width * sizeof(Cell));
+    uint32_t *rows = (uint32_t *)malloc(2 * gw * sizeof(uint32_t) * workers);
+    Pass pass;
+
+    if (columns == NULL || rows == NULL) {
+        free(columns);
+        free(rows);
+        return NO_MEMORY;
+    }
+    for (int x = 0; x < width; x++)
+        columns[x] = cell(x, width, gw);
+
+    pass.table = &table;
+    pass.width = width;
+    pass.height = height;
+    pass.layout = layout;
+    pass.columns = columns;
+    pass.rows = rows;
+    pass.map = gains;
+    runBands(pool, buildBand, &pass, height, BAND_ROWS);
+
+    free(columns);
+    free(rows);
+    return NO_ERROR;
+}
+
+void MtkLensShading::dropMaps(int table)
+{
+    for (int i = 0; i < mMapCount;) {
+        if (mMaps[i].table == table) {
+            free(mMaps[i].gains);
+            mMaps[i] = mMaps[--mMapCount];
+        } else {
+            i++;
+        }
+    }
+}
+
+// The cached map, built and put in place of the least recently used one if need be
+const uint16_t *MtkLensShading::map(int table, int width, int height, int layout,
+        MtkThreadPool *pool)
+{
+    const Table *t = load(table);
+
+    if (t == NULL)
+        return NULL;
+    for (int i = 0; i < mMapCount; i++) {
+        Map &m = mMaps[i];
+        if (m.table == table && m.width == width && m.height == height && m.layout == layout) {
+            m.lastUse = ++mClock;
+            mHits++;
+            return m.gains;
+        }
+    }
+
+    uint16_t *gains = (uint16_t *)malloc((size_t)width * height * sizeof(uint16_t));
+    if (gains == NULL || build(*t, width, height, layout, gains, pool) != NO_ERROR) {
+        free(gains);
+        return NULL;
+    }
+
+    int slot = mMapCount;
+    if (mMapCount == mMaxMaps) {
+        slot = 0;
+        for (int i = 1; i < mMapCount; i++) {
+            if (mMaps[i].lastUse < mMaps[slot].lastUse)
+                slot = i;
+        }
+        free(mMaps[slot].gains);
+    } else {
+        mMapCount++;
+    }
+    Map &m = mMaps[slot];
+    m.table = table;
+    m.width = width;
+    m.height = height;
+    m.layout = layout;
+    m.gains = gains;
+    m.lastUse = ++mClock;
+    mMisses++;
+    return gains;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Frames
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+void MtkLensShading::gain8Band(void *arg, int band, int)
+{
+    const Pass &p = *(const Pass *)arg;
+    MtkImage &frame = *p.frame;
+    int y1 = (band + 1) * BAND_ROWS < p.height ? (band + 1) * BAND_ROWS : p.height;
+
+    for (int y = band * BAND_ROWS; y < y1; y++)
+        p.k->gain8(frame.planes[0] + frame.strides[0] * y, p.gains + (size_t)p.width * y,
+                p.width);
+}
+
+// BAYER10 goes through a row of samples, unpacked and packed in place
+void MtkLensShading::gain10Band(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    MtkImage &frame = *p.frame;
+    int y1 = (band + 1) * BAND_ROWS < p.height ? (band + 1) * BAND_ROWS : p.height;
+    uint16_t *row = p.samples + (size_t)p.width * worker;
+
+    for (int y = band * BAND_ROWS; y < y1; y++) {
+        uint8_t *packed = frame.planes[0] + frame.strides[0] * y;
+        p.raw->unpack10(packed, row, p.width);
+        p.k->gain10(row, p.gains + (size_t)p.width * y, p.width);
+        pack10(row, packed, p.width);
+    }
+}
+
+status_t MtkLensShading::apply(MtkImage *frame, MtkBayerPattern pattern, MtkThreadPool *pool,
+        MtkPixelIsa isa)
+{
+    const MtkShadingKernels *k = mtkPixelPick(isa, &kMtkShadingScalar,
+            MTK_PIXEL_NEON(kMtkShadingNeon), MTK_PIXEL_X86(kMtkShadingSse2),
+            MTK_PIXEL_X86(kMtkShadingSse2));
+    // The raw kernels are there for unpacking BAYER10
+    const MtkRawKernels *raw = mtkPixelPick(isa, &kMtkRawScalar, MTK_PIXEL_NEON(kMtkRawNeon),
+            MTK_PIXEL_X86(kMtkRawSse2), MTK_PIXEL_X86(kMtkRawAvx2));
+    int width = frame->width, height = frame->height;
+
+    if (k == NULL) {
+        ALOGE("No %s kernels on this CPU", mtkPixelIsaName(isa));
+        return INVALID_OPERATION;
+    }
+    if (frame->format != MTK_PIXEL_FORMAT_BAYER8 && frame->format != MTK_PIXEL_FORMAT_BAYER10 &&
+            frame->format != MTK_PIXEL_FORMAT_NV21) {
+        ALOGE("Cannot correct shading of format %d", frame->format);
+        return INVALID_OPERATION;
+    }
+    if (width < 2 || height < 2 || (frame->format == MTK_PIXEL_FORMAT_BAYER10 && (width & 3)) ||
+            pattern < MTK_BAYER_RGGB || pattern > MTK_BAYER_BGGR) {
+        ALOGE("Cannot correct shading of %dx%d", width, height);
+        return BAD_VALUE;
+    }
+    if (mTable == 0) {
+        ALOGE("No shading table selected");
+        return INVALID_OPERATION;
+    }
+
+    int layout = frame->format == MTK_PIXEL_FORMAT_NV21 ? (int)LUMA : (int)pattern;
+    const uint16_t *gains = map(mTable, width, height, layout, pool);
+    if (gains == NULL)
+        return mTables[mTable].gains == NULL ? NAME_NOT_FOUND : NO_MEMORY;
+
+    Pass pass;
+    pass.k = k;
+    pass.raw = raw;
+    pass.width = width;
+    pass.height = height;
+    pass.gains = gains;
+    pass.frame = frame;
+    if (frame->format != MTK_PIXEL_FORMAT_BAYER10) {
+        runBands(pool, gain8Band, &pass, height, BAND_ROWS);
+        return NO_ERROR;
+    }
+
+    int workers = pool != NULL ? pool->size() : 1;
+    pass.samples = (uint16_t *)malloc(width * sizeof(uint16_t) * workers);
+    if (pass.samples == NULL)
+        return NO_MEMORY;
+    runBands(pool, gain10Band, &pass, height, BAND_ROWS);
+    free(pass.samples);
+    return NO_ERROR;
+}
+
+void MtkLensShading::stats(MtkShadingStats *stats) const
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < MTK_SHADING_TABLES; i++) {
+        if (mTables[i].gains != NULL)
+            stats->tables++;
+    }
+    stats->maps = mMapCount;
+    for (int i = 0; i < mMapCount; i++)
+        stats->mapBytes += (size_t)mMaps[i].width * mMaps[i].height * sizeof(uint16_t);
+    stats->hits = mHits;
+    stats->misses = mMisses;
+}
+
+}; // namespace android
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_LENS_SHADING_H
+#define ANDROID_HARDWARE_MTK_LENS_SHADING_H
+
+#include <stdint.h>
+#include <utils/Errors.h>
+
+#include "MtkCameraParameters.h"
+#include "MtkImage.h"
+#include "MtkPixelConvert.h"
+#include "MtkRawProcessor.h"
+#include "MtkThreadPool.h"
+
+namespace android {
+
+/**
+ * Shading table file, version 1, one per KEY_ENG_SHADING_TABLE value.
+ * Integers are little endian.
+ *
+ *   "MKS" version                  4 bytes
+ *   grid width, grid height        u16 each, at least 2
+ *   channels                       u16, 4
+ *   reserved                       u16 x 5
+ *   gains                          u16 Q10, channel after channel in
+ *                                  R, Gr, Gb, B order, rows top down
+ *
+ * Grid points are spread evenly over the frame, the outer ones on its
+ * edge pixels. Gr is the green on the rows with R, as in MtkRawSettings.
+ * Gains are read in place from the mapping, which is why the header
+ * keeps them 16 bit aligned.
+ */
+enum {
+    MTK_SHADING_VERSION = 1,
+    MTK_SHADING_HEADER_SIZE = 20,
+    MTK_SHADING_CHANNELS = 4,
+    // KEY_ENG_SHADING_TABLE_LOW to _TSF, AUTO picks one of them
+    MTK_SHADING_TABLES = 5,
+};
+
+// A table in memory, gains as in the file
+struct MtkShadingGrid {
+    int width;
+    int height;
+    const uint16_t *gains;
+};
+
+struct MtkShadingStats {
+    int tables;                     // mapped or set
+    int maps;                       // gain maps cached
+    size_t mapBytes;
+    uint64_t hits;
+    uint64_t misses;                // maps built
+};
+
+/**
+ * Lens shading correction of Bayer and NV21 frames. Tables are mapped
+ * from dir the first time they are used and stay mapped. A frame needs
+ * a gain per pixel, so the grid is upsampled once per table, size and
+ * Bayer pattern, and the result kept in a small LRU cache: changing
+ * preview size and back, or switching tables with the light, does not
+ * rebuild the maps. Applying is then one multiply per sample, in SIMD
+ * row kernels over bands of rows shared by the pool's threads.
+ *
+ * NV21 frames get the average of the green gains on luma. That fixes
+ * the fall-off in brightness; colour shading has to be corrected on the
+ * raw frame, before the channels mix.
+ *
+ * Not thread safe: one camera thread drives it.
+ */
+class MtkLensShading {
+public:
+    MtkLensShading();
+    ~MtkLensShading();
+
+    // Tables in dir, up to maxMaps upsampled maps cached at once
+    status_t init(const char *dir, int maxMaps = 4);
+
+    /*
+     * The table KEY_ENG_SHADING_TABLE asks for. AUTO goes by the colour
+     * temperature of the scene in kelvin, from white balance: LOW below
+     * 4000, HIGH above 5500, MIDDLE in between and when cct is 0.
+     */
+    static int table(const MtkCameraParameters &params, int cct = 0);
+
+    /*
+     * Selects table(params, cct) for apply(), and with
+     * KEY_ENG_SAVE_SHADING_TABLE set writes the tables set since the
+     * last save to their files.
+     */
+    status_t configure(const MtkCameraParameters &params, int cct = 0);
+    status_t select(int table);
+
+    // Replaces a table in memory, e.g. with a calibrated one
+    status_t setTable(int table, const MtkShadingGrid &grid);
+    // Writes it to its file, atomically replacing the one there
+    status_t save(int table);
+
+    /*
+     * Corrects a BAYER8, BAYER10 or NV21 frame in place with the
+     * selected table; pattern is only used for Bayer frames. The output
+     * does not depend on the thread count or instruction set.
+     */
+    status_t apply(MtkImage *frame, MtkBayerPattern pattern = MTK_BAYER_RGGB,
+            MtkThreadPool *pool = NULL, MtkPixelIsa isa = MTK_PIXEL_ISA_BEST);
+
+    void stats(MtkShadingStats *stats) const;
+
+private:
+    MtkLensShading(const MtkLensShading&);
+    MtkLensShading& operator=(const MtkLensShading&);
+
+    struct Table {
+        const uint16_t *gains;
+        int width;
+        int height;
+        void *mapping;              // of the file, or NULL
+        size_t mappingSize;
+        uint16_t *owned;            // from setTable()
+        bool loaded;                // tried the file already
+        bool dirty;                 // set and not saved
+    };
+
+    // Gain per pixel of one table at one size and layout
+    struct Map {
+        int table;
+        int width;
+        int height;
+        int layout;                 // MtkBayerPattern, or LUMA
+        uint16_t *gains;
+        uint64_t lastUse;
+    };
+
+    enum {
+        LUMA = 4,
+    };
+
+    struct Pass;
+
+    void clear();
+    void path(int table, char *name, size_t size) const;
+    const Table *load(int table);
+    void unload(int table);
+    void dropMaps(int table);
+    const uint16_t *map(int table, int width, int height, int layout, MtkThreadPool *pool);
+    static status_t build(const Table &table, int width, int height, int layout, uint16_t *gains,
+            MtkThreadPool *pool);
+    static void buildBand(void *arg, int band, int worker);
+    static void gain8Band(void *arg, int band, int worker);
+    static void gain10Band(void *arg, int band, int worker);
+
+    char *mDir;
+    Table mTables[MTK_SHADING_TABLES];
+    int mTable;
+    Map *mMaps;
+    int mMaxMaps;
+    int mMapCount;
+    uint64_t mClock;
+    uint64_t mHits;
+    uint64_t mMisses;
+};
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,619 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkPanorama.h"
+#include "MtkPixelKernels.h"
+
+namespace android {
+
+// Candidates per search task, frame rows per task elsewhere
+#define SEARCH_CHUNK    32
+#define BAND_ROWS       32
+// Widest seam feather, and the worst match that is still stitched
+#define FEATHER         64
+#define MAX_MAD         20.0f
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Scalar reference
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static uint32_t sad(const uint8_t *a, const uint8_t *b, int width)
+{
+    uint32_t sum = 0;
+
+    for (int x = 0; x < width; x++)
+        sum += abs(a[x] - b[x]);
+    return sum;
+}
+
+static void half(const uint8_t *row0, const uint8_t *row1, uint8_t *out, int width)
+{
+    for (int x = 0; x < width; x++)
+        out[x] = avg(avg(row0[2 * x], row1[2 * x]), avg(row0[2 * x + 1], row1[2 * x + 1]));
+}
+
+static void blend(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int width)
+{
+    for (int x = 0; x < width; x++)
+        dst[x] += ((src[x] - dst[x]) * alpha[x] + 64) >> 7;
+}
+
+const MtkPanoramaKernels kMtkPanoramaScalar = {
+    sad,
+    half,
+    blend,
+};
+
+static inline int minInt(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+static inline int maxInt(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+static inline bool horizontal(MtkPanoramaDir dir)
+{
+    return dir == MTK_PANORAMA_RIGHT || dir == MTK_PANORAMA_LEFT;
+}
+
+// Whether frames move to higher coordinates in the strip
+static inline bool forward(MtkPanoramaDir dir)
+{
+    return dir == MTK_PANORAMA_RIGHT || dir == MTK_PANORAMA_DOWN;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Registration
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+/*
+ * Motion is (dx, dy) when the new frame at (x, y) shows what the last
+ * one had at (x + dx, y + dy). A level allows it one way along the sweep
+ * and both ways across.
+ */
+void MtkPanorama::limits(int level, int *dx0, int *dx1, int *dy0, int *dy1) const
+{
+    int shift = mMaxShift >> level, drift = maxInt(mMaxDrift >> level, 1);
+    int lo = forward(mDir) ? 0 : -shift, hi = forward(mDir) ? shift : 0;
+
+    if (horizontal(mDir)) {
+        *dx0 = lo;
+        *dx1 = hi;
+        *dy0 = -drift;
+        *dy1 = drift;
+    } else {
+        *dx0 = -drift;
+        *dx1 = drift;
+        *dy0 = lo;
+        *dy1 = hi;
+    }
+}
+
+/*
+ * What the tasks of a pass share. src is the new frame or a level of
+ * it, width by height, stride apart; the rest is per pass.
+ */
+struct MtkPanorama::Pass {
+    const MtkPanorama *panorama;
+    const MtkPanoramaKernels *k;
+    const uint8_t *src;
+    size_t stride;
+    int width;
+    int height;
+    // pyramid(): the next level, width by height
+    uint8_t *dst;
+    // search(): candidates from (dx0, dy0), across of them to a row, over
+    // the box of the new frame that stays inside the last one
+    const uint8_t *prev;
+    int dx0, dy0, across, count;
+    int x0, x1, y0, y1;
+    // place(): the frame goes to (x, y) of the strip, its chroma to (cx, cy);
+    // luma columns x0 to x1 and chroma pairs c0 to c1 of it are in the strip
+    const MtkImage *frame;
+    int x, y, cx, cy;
+    int c0, c1;
+    int first, last;            // rows down the sweep, from the feather on
+    uint8_t *fill;              // a row of weights per worker
+};
+
+void MtkPanorama::halfBand(void *arg, int band, int)
+{
+    const Pass &p = *(const Pass *)arg;
+    int y1 = minInt(p.height, (band + 1) * BAND_ROWS);
+
+    for (int y = band * BAND_ROWS; y < y1; y++)
+        p.k->half(p.src + p.stride * 2 * y, p.src + p.stride * (2 * y + 1),
+                p.dst + (size_t)p.width * y, p.width);
+}
+
+void MtkPanorama::pyramid(const MtkPanoramaKernels *k, const MtkImage &frame,
+        MtkThreadPool *pool)
+{
+    Pass pass;
+
+    memset(&pass, 0, sizeof(pass));
+    pass.panorama = this;
+    pass.k = k;
+    for (int l = 1; l < mLevels; l++) {
+        pass.src = l == 1 ? frame.planes[0] : mCur[l - 1];
+        pass.stride = l == 1 ? frame.strides[0] : (size_t)mLevelWidth[l - 1];
+        pass.dst = mCur[l];
+        pass.width = mLevelWidth[l];
+        pass.height = mLevelHeight[l];
+        runBands(pool, halfBand, &pass, pass.height, BAND_ROWS);
+    }
+}
+
+void MtkPanorama::searchTask(void *arg, int task, int)
+{
+    const Pass &p = *(const Pass *)arg;
+    int end = minInt(p.count, (task + 1) * SEARCH_CHUNK);
+
+    for (int i = task * SEARCH_CHUNK; i < end; i++) {
+        int dx = p.dx0 + i % p.across, dy = p.dy0 + i / p.across;
+        uint32_t cost = 0;
+        for (int y = p.y0; y < p.y1; y++)
+            cost += p.k->sad(p.src + p.stride * y + p.x0,
+                    p.prev + (size_t)p.width * (y + dy) + p.x0 + dx, p.x1 - p.x0);
+        p.panorama->mCosts[i] = cost;
+    }
+}
+
+/*
+ * Best motion in the box, by the sum of absolute differences over the
+ * part of the new frame that stays inside the last one for all of it.
+ * Ties go to the first candidate in row order, whichever task found it.
+ */
+void MtkPanorama::search(const MtkPanoramaKernels *k, const MtkImage &frame, int level,
+        int dx0, int dx1, int dy0, int dy1, Match *match, MtkThreadPool *pool)
+{
+    Pass pass;
+    int w = mLevelWidth[level], h = mLevelHeight[level];
+
+    memset(&pass, 0, sizeof(pass));
+    pass.panorama = this;
+    pass.k = k;
+    pass.src = level == 0 ? frame.planes[0] : mCur[level];
+    pass.stride = level == 0 ? frame.strides[0] : (size_t)w;
+    pass.width = w;
+    pass.height = h;
+    pass.prev = mPrev[level];
+    pass.dx0 = dx0;
+    pass.dy0 = dy0;
+    pass.across = dx1 - dx0 + 1;
+    pass.count = pass.across * (dy1 - dy0 + 1);
+    pass.x0 = maxInt(0, -dx0);
+    pass.x1 = minInt(w, w - dx1);
+    pass.y0 = maxInt(0, -dy0);
+    pass.y1 = minInt(h, h - dy1);
+    runBands(pool, searchTask, &pass, pass.count, SEARCH_CHUNK);
+
+    int across = pass.across, count = pass.count;
+    int best = 0;
+    for (int i = 1; i < count; i++) {
+        if (mCosts[i] < mCosts[best])
+            best = i;
+    }
+    match->dx = dx0 + best % across;
+    match->dy = dy0 + best / across;
+    match->cost = mCosts[best];
+    match->area = (uint32_t)(pass.x1 - pass.x0) * (pass.y1 - pass.y0);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Seams
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Rows of a frame going across, a weight per column
+void MtkPanorama::columnWeightsBand(void *arg, int band, int)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkPanorama &pano = *p.panorama;
+    const MtkImage &strip = pano.mStrip, &frame = *p.frame;
+    int r1 = minInt(pano.mHeight, (band + 1) * BAND_ROWS);
+
+    for (int r = band * BAND_ROWS; r < r1; r++) {
+        if (p.y + r >= 0 && p.y + r < strip.height && p.x0 < p.x1)
+            p.k->blend(strip.planes[0] + strip.strides[0] * (p.y + r) + p.x + p.x0,
+                    frame.planes[0] + frame.strides[0] * r + p.x0, pano.mAlpha + p.x0,
+                    p.x1 - p.x0);
+        if ((r & 1) || p.cy + r / 2 < 0 || p.cy + r / 2 >= strip.height / 2 || p.c0 >= p.c1)
+            continue;
+        p.k->blend(strip.planes[1] + strip.strides[1] * (p.cy + r / 2) + 2 * (p.cx + p.c0),
+                frame.planes[1] + frame.strides[1] * (r / 2) + 2 * p.c0,
+                pano.mAlphaVu + 2 * p.c0, 2 * (p.c1 - p.c0));
+    }
+}
+
+// Rows of a frame going down, a weight per row from first on
+void MtkPanorama::rowWeightsBand(void *arg, int band, int worker)
+{
+    const Pass &p = *(const Pass *)arg;
+    const MtkPanorama &pano = *p.panorama;
+    const MtkImage &strip = pano.mStrip, &frame = *p.frame;
+    uint8_t *alpha = p.fill + (size_t)pano.mWidth * worker;
+    int r1 = minInt(p.last, p.first + (band + 1) * BAND_ROWS);
+
+    for (int r = p.first + band * BAND_ROWS; r < r1; r++) {
+        if (pano.mAlpha[r] == 0)
+            continue;
+        memset(alpha, pano.mAlpha[r], pano.mWidth);
+        if (p.y + r >= 0 && p.y + r < strip.height && p.x0 < p.x1)
+            p.k->blend(strip.planes[0] + strip.strides[0] * (p.y + r) + p.x + p.x0,
+                    frame.planes[0] + frame.strides[0] * r + p.x0, alpha, p.x1 - p.x0);
+        if ((r & 1) || p.cy + r / 2 < 0 || p.cy + r / 2 >= strip.height / 2 || p.c0 >= p.c1)
+            continue;
+        p.k->blend(strip.planes[1] + strip.strides[1] * (p.cy + r / 2) + 2 * (p.cx + p.c0),
+                frame.planes[1] + frame.strides[1] * (r / 2) + 2 * p.c0,
+                alpha, 2 * (p.c1 - p.c0));
+    }
+}
+
+/*
+ * Blends the frame in at (x, y) of the strip, overlap pixels of it along
+ * the sweep being in the last frame already. The seam sits in the middle
+ * of the overlap; the strip before the feather around it is left alone,
+ * past it the frame replaces the strip. Chroma goes to (x / 2, y / 2)
+ * rounded down, half a chroma sample off for odd positions.
+ */
+status_t MtkPanorama::place(const MtkPanoramaKernels *k, const MtkImage &frame, int x, int y,
+        int overlap, MtkThreadPool *pool)
+{
+    int along = horizontal(mDir) ? mWidth : mHeight;
+    int feather = minInt(overlap, FEATHER) & ~1;
+    int start = overlap / 2 - feather / 2;
+
+    // Weights by distance into the frame along the sweep, mirrored when
+    // the sweep goes to lower coordinates
+    for (int i = 0; i < along; i++) {
+        int m = forward(mDir) ? i : along - 1 - i;
+        int a = m < start ? 0 : m >= start + feather ? 128 :
+                ((m - start) * 2 + 1) * 64 / feather;
+        mAlpha[i] = a;
+    }
+
+    Pass pass;
+
+    memset(&pass, 0, sizeof(pass));
+    pass.panorama = this;
+    pass.k = k;
+    pass.frame = &frame;
+    pass.x = x;
+    pass.y = y;
+    pass.cx = x >> 1;
+    pass.cy = y >> 1;
+    pass.first = forward(mDir) ? start : 0;
+    pass.last = forward(mDir) ? along : along - start;
+
+    if (horizontal(mDir)) {
+        for (int i = 0; i < along / 2; i++)
+            mAlphaVu[2 * i] = mAlphaVu[2 * i + 1] = mAlpha[2 * i];
+
+        pass.x0 = maxInt(pass.first, -x);
+        pass.x1 = minInt(pass.last, mStrip.width - x);
+        pass.c0 = maxInt(pass.first / 2, -pass.cx);
+        pass.c1 = minInt((pass.last + 1) / 2, mStrip.width / 2 - pass.cx);
+        runBands(pool, columnWeightsBand, &pass, mHeight, BAND_ROWS);
+        return NO_ERROR;
+    }
+
+    // Down the sweep every row has one weight, spread over a row per worker
+    int workers = pool != NULL ? pool->size() : 1;
+    pass.fill = (uint8_t *)malloc((size_t)mWidth * workers);
+    if (pass.fill == NULL)
+        return NO_MEMORY;
+
+    pass.x0 = maxInt(0, -x);
+    pass.x1 = minInt(mWidth, mStrip.width - x);
+    pass.c0 = maxInt(0, -pass.cx);
+    pass.c1 = minInt(mWidth / 2, mStrip.width / 2 - pass.cx);
+    runBands(pool, rowWeightsBand, &pass, pass.last - pass.first, BAND_ROWS);
+    free(pass.fill);
+    return NO_ERROR;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Panorama
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+MtkPanorama::MtkPanorama()
+    : mWidth(0),
+      mHeight(0),
+      mDir(MTK_PANORAMA_RIGHT),
+      mLevels(0),
+      mMaxShift(0),
+      mMaxDrift(0),
+      mCosts(NULL),
+      mAlpha(NULL),
+      mAlphaVu(NULL),
+      mMemory(NULL),
+      mFrames(0),
+      mX(0),
+      mY(0),
+      mLeft(0),
+      mTop(0),
+      mRight(0),
+      mBottom(0)
+{
+    memset(mLevelWidth, 0, sizeof(mLevelWidth));
+    memset(mLevelHeight, 0, sizeof(mLevelHeight));
+    memset(mPrev, 0, sizeof(mPrev));
+    memset(mCur, 0, sizeof(mCur));
+    memset(&mStrip, 0, sizeof(mStrip));
+}
+
+MtkPanorama::~MtkPanorama()
+{
+    clear();
+}
+
+void MtkPanorama::clear()
+{
+    free(mMemory);
+    mMemory = NULL;
+    memset(mPrev, 0, sizeof(mPrev));
+    memset(mCur, 0, sizeof(mCur));
+    memset(&mStrip, 0, sizeof(mStrip));
+    mCosts = NULL;
+    mAlpha = mAlphaVu = NULL;
+    mWidth = mHeight = mLevels = 0;
+    mFrames = 0;
+}
+
+bool MtkPanorama::enabled(const MtkCameraParameters &params)
+{
+    static const char *const modes[] = {
+        MtkCameraParameters::CAPTURE_MODE_PANORAMA_SHOT,
+        MtkCameraParameters::CAPTURE_MODE_AUTO_PANORAMA_SHOT,
+        NULL
+    };
+
+    return params.getEnum(MTK_KEY_CAPTURE_MODE, modes) >= 0;
+}
+
+MtkPanoramaDir MtkPanorama::direction(const MtkCameraParameters &params)
+{
+    // In MtkPanoramaDir order
+    static const char *const dirs[] = {
+        MtkCameraParameters::PANORAMA_DIR_RIGHT,
+        MtkCameraParameters::PANORAMA_DIR_LEFT,
+        MtkCameraParameters::PANORAMA_DIR_TOP,
+        MtkCameraParameters::PANORAMA_DIR_DOWN,
+        NULL
+    };
+    int index = params.getEnum(MTK_KEY_PANORAMA_DIR, dirs);
+
+    return index >= 0 ? (MtkPanoramaDir)index : MTK_PANORAMA_RIGHT;
+}
+
+status_t MtkPanorama::init(int width, int height, MtkPanoramaDir direction, int length)
+{
+    bool across = horizontal(direction);
+    int along = across ? width : height, cross = across ? height : width;
+
+    length &= ~1;
+    if (width < 64 || height < 64 || (width | height) & 1 || length < along ||
+            direction < MTK_PANORAMA_RIGHT || direction > MTK_PANORAMA_DOWN) {
+        ALOGE("No panorama of %dx%d frames %d long, direction %d", width, height, length,
+                direction);
+        return BAD_VALUE;
+    }
+
+    // Room across the strip for drift, frames start in the middle of it
+    int margin = (cross / 16) & ~1;
+    int stripWidth = across ? length : width + 2 * margin;
+    int stripHeight = across ? height + 2 * margin : length;
+    size_t strip = mtkImageSize(MTK_PIXEL_FORMAT_NV21, stripWidth, stripHeight);
+    if (strip == 0) {
+        ALOGE("No panorama strip of %dx%d", stripWidth, stripHeight);
+        return BAD_VALUE;
+    }
+
+    int levels = 1;
+    while (levels < MAX_LEVELS && (width >> levels) >= 32 && (height >> levels) >= 32)
+        levels++;
+
+    int maxShift = 2 * along / 3, maxDrift = cross / 32;
+    int top = levels - 1;
+    size_t costs = (size_t)((maxShift >> top) + 1) * (2 * maxInt(maxDrift >> top, 1) + 1);
+    size_t pyramid = (size_t)width * height;
+    for (int l = 1; l < levels; l++)
+        pyramid += 2 * (size_t)(width >> l) * (height >> l);
+    if (costs < 25)
+        costs = 25;
+
+    clear();
+    mMemory = malloc(costs * sizeof(uint32_t) + strip + pyramid + 2 * (size_t)along);
+    if (mMemory == NULL) {
+        ALOGE("Cannot allocate a panorama strip of %dx%d", stripWidth, stripHeight);
+        return NO_MEMORY;
+    }
+
+    mCosts = (uint32_t *)mMemory;
+    uint8_t *p = (uint8_t *)(mCosts + costs);
+    mtkImageInit(&mStrip, MTK_PIXEL_FORMAT_NV21, stripWidth, stripHeight, p);
+    memset(p, 0, (size_t)stripWidth * stripHeight);
+    memset(p + (size_t)stripWidth * stripHeight, 128, strip - (size_t)stripWidth * stripHeight);
+    p += strip;
+    for (int l = 0; l < levels; l++) {
+        mLevelWidth[l] = width >> l;
+        mLevelHeight[l] = height >> l;
+        mPrev[l] = p;
+        p += (size_t)mLevelWidth[l] * mLevelHeight[l];
+        if (l > 0) {
+            mCur[l] = p;
+            p += (size_t)mLevelWidth[l] * mLevelHeight[l];
+        }
+    }
+    mAlpha = p;
+    mAlphaVu = p + along;
+
+    mWidth = width;
+    mHeight = height;
+    mDir = direction;
+    mLevels = levels;
+    mMaxShift = maxShift;
+    mMaxDrift = maxDrift;
+    reset();
+    return NO_ERROR;
+}
+
+void MtkPanorama::reset()
+{
+    bool across = horizontal(mDir);
+    int stripAlong = across ? mStrip.width : mStrip.height;
+    int along = across ? mWidth : mHeight;
+    int margin = across ? (mStrip.height - mHeight) / 2 : (mStrip.width - mWidth) / 2;
+    int start = forward(mDir) ? 0 : stripAlong - along;
+
+    mFrames = 0;
+    mX = across ? start : margin;
+    mY = across ? margin : start;
+    mLeft = mRight = mX;
+    mTop = mBottom = mY;
+}
+
+bool MtkPanorama::full() const
+{
+    switch (mDir) {
+    case MTK_PANORAMA_RIGHT:    return mFrames > 0 && mRight >= mStrip.width;
+    case MTK_PANORAMA_LEFT:     return mFrames > 0 && mLeft <= 0;
+    case MTK_PANORAMA_TOP:      return mFrames > 0 && mTop <= 0;
+    default:                    return mFrames > 0 && mBottom >= mStrip.height;
+    }
+}
+
+void MtkPanorama::setIndex(MtkCameraParameters *params) const
+{
+    params->set(MTK_KEY_PANORAMA_IDX, mFrames);
+}
+
+status_t MtkPanorama::add(const MtkImage &frame, MtkPanoramaFrame *info,
+        MtkThreadPool *pool, MtkPixelIsa isa)
+{
+    const MtkPanoramaKernels *k = mtkPixelPick(isa, &kMtkPanoramaScalar,
+            MTK_PIXEL_NEON(kMtkPanoramaNeon), MTK_PIXEL_X86(kMtkPanoramaSse2),
+            MTK_PIXEL_X86(kMtkPanoramaSse2));
+    MtkPanoramaFrame unused;
+
+    if (k == NULL) {
+        ALOGE("No %s kernels on this CPU", mtkPixelIsaName(isa));
+        return INVALID_OPERATION;
+    }
+    if (mMemory == NULL) {
+        ALOGE("Panorama is not set up");
+        return INVALID_OPERATION;
+    }
+    if (frame.format != MTK_PIXEL_FORMAT_NV21 || frame.width != mWidth ||
+            frame.height != mHeight) {
+        ALOGE("Cannot stitch format %d %dx%d at %dx%d", frame.format, frame.width,
+                frame.height, mWidth, mHeight);
+        return BAD_VALUE;
+    }
+
+    if (info == NULL)
+        info = &unused;
+    memset(info, 0, sizeof(*info));
+    if (full())
+        return NO_ERROR;
+
+    bool across = horizontal(mDir);
+    int along = across ? mWidth : mHeight;
+    int x = mX, y = mY, overlap = 0;
+    status_t err;
+
+    pyramid(k, frame, pool);
+    if (mFrames > 0) {
+        int top = mLevels - 1, dx0, dx1, dy0, dy1;
+        Match match;
+
+        limits(top, &dx0, &dx1, &dy0, &dy1);
+        search(k, frame, top, dx0, dx1, dy0, dy1, &match, pool);
+        // Each level down halves the step; two either way covers the
+        // rounding of the level above
+        for (int l = top - 1; l >= 0; l--) {
+            limits(l, &dx0, &dx1, &dy0, &dy1);
+            search(k, frame, l,
+                    maxInt(dx0, 2 * match.dx - 2), minInt(dx1, 2 * match.dx + 2),
+                    maxInt(dy0, 2 * match.dy - 2), minInt(dy1, 2 * match.dy + 2),
+                    &match, pool);
+        }
+
+        int shift = abs(across ? match.dx : match.dy);
+        info->dx = match.dx;
+        info->dy = match.dy;
+        info->mad = match.area > 0 ? (float)match.cost / match.area : 0;
+        if (shift < along / 16 || info->mad > MAX_MAD)
+            return NO_ERROR;
+        x += match.dx;
+        y += match.dy;
+        overlap = along - shift;
+    }
+
+    err = place(k, frame, x, y, overlap, pool);
+    if (err != NO_ERROR)
+        return err;
+
+    // The strip so far: everything along the sweep, what all frames
+    // share across it
+    if (across) {
+        mLeft = mFrames > 0 ? minInt(mLeft, x) : x;
+        mRight = mFrames > 0 ? maxInt(mRight, x + mWidth) : x + mWidth;
+        mTop = mFrames > 0 ? maxInt(mTop, y) : y;
+        mBottom = mFrames > 0 ? minInt(mBottom, y + mHeight) : y + mHeight;
+    } else {
+        mLeft = mFrames > 0 ? maxInt(mLeft, x) : x;
+        mRight = mFrames > 0 ? minInt(mRight, x + mWidth) : x + mWidth;
+        mTop = mFrames > 0 ? minInt(mTop, y) : y;
+        mBottom = mFrames > 0 ? maxInt(mBottom, y + mHeight) : y + mHeight;
+    }
+    mX = x;
+    mY = y;
+    mFrames++;
+    info->added = true;
+    info->x = x;
+    info->y = y;
+
+    // The frame is the one to match the next against
+    for (int r = 0; r < mHeight; r++)
+        memcpy(mPrev[0] + (size_t)mWidth * r, frame.planes[0] + frame.strides[0] * r, mWidth);
+    for (int l = 1; l < mLevels; l++) {
+        uint8_t *t = mPrev[l];
+        mPrev[l] = mCur[l];
+        mCur[l] = t;
+    }
+    return NO_ERROR;
+}
+
+status_t MtkPanorama::result(MtkImage *image) const
+{
+    // Inwards to whole chroma samples
+    int left = (maxInt(mLeft, 0) + 1) & ~1, top = (maxInt(mTop, 0) + 1) & ~1;
+    int right = minInt(mRight, mStrip.width) & ~1, bottom = minInt(mBottom, mStrip.height) & ~1;
+
+    if (mFrames == 0 || right <= left || bottom <= top) {
+        ALOGE("No panorama stitched");
+        return INVALID_OPERATION;
+    }
+    return mtkImageCrop(mStrip, left, top, right - left, bottom - top, image);
+}
+
+}; // namespace android
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_PANORAMA_H
+#define ANDROID_HARDWARE_MTK_PANORAMA_H
+
+#include <stdint.h>
+#include <utils/Errors.h>
+
+#include "MtkCameraParameters.h"
+#include "MtkImage.h"
+#include "MtkPixelConvert.h"
+#include "MtkThreadPool.h"
+
+namespace android {
+
+struct MtkPanoramaKernels;
+
+// The way the camera sweeps, KEY_PANORAMA_DIR
+enum MtkPanoramaDir {
+    MTK_PANORAMA_RIGHT,
+    MTK_PANORAMA_LEFT,
+    MTK_PANORAMA_TOP,
+    MTK_PANORAMA_DOWN,
+};
+
+// What add() did with a frame
+struct MtkPanoramaFrame {
+    bool added;                     // false when left out
+    int dx, dy;                     // motion from the last frame added, in pixels
+    int x, y;                       // where the frame went in the strip
+    float mad;                      // mean absolute luma difference of the match
+};
+
+/**
+ * Stitches a panorama sweep of NV21 frames as they come. Each frame is
+ * registered against the previous one by block matching its luma: a
+ * full search over the motion the sweep direction allows on a 1/8 scale
+ * pyramid level, refined level by level down to whole pixels, with the
+ * sums of absolute differences in SIMD row kernels. The frame then goes
+ * into the strip past a seam in the middle of the overlap, feathered
+ * over up to 64 pixels, so only the new part of the strip is written.
+ *
+ * Memory is the strip, allocated up front, plus pyramids of two frames;
+ * it does not grow with the number of frames.
+ */
+class MtkPanorama {
+public:
+    MtkPanorama();
+    ~MtkPanorama();
+
+    // Whether the capture mode is a panorama one
+    static bool enabled(const MtkCameraParameters &params);
+    // KEY_PANORAMA_DIR, right when it is not set
+    static MtkPanoramaDir direction(const MtkCameraParameters &params);
+
+    /*
+     * Width x height frames, even and at least 64, into a strip length
+     * pixels long along the sweep. Frames have to move less than two
+     * thirds of themselves from one to the next, and drift across the
+     * sweep by less than 1/32 of themselves.
+     */
+    status_t init(int width, int height, MtkPanoramaDir direction, int length);
+
+    // Starts a new sweep
+    void reset();
+
+    /*
+     * Stitches in the next frame of the sweep. Frames that moved less
+     * than 1/16 of themselves, that do not match, or that come once the
+     * strip is full are left out, which info says; that is not an error.
+     * The output does not depend on the thread count.
+     */
+    status_t add(const MtkImage &frame, MtkPanoramaFrame *info = NULL,
+            MtkThreadPool *pool = NULL, MtkPixelIsa isa = MTK_PIXEL_ISA_BEST);
+
+    // A view of the part of the strip all frames cover, in the strip's memory
+    status_t result(MtkImage *image) const;
+
+    int frames() const { return mFrames; }
+    bool full() const;
+
+    // KEY_PANORAMA_IDX to the number of frames stitched
+    void setIndex(MtkCameraParameters *params) const;
+
+private:
+    MtkPanorama(const MtkPanorama&);
+    MtkPanorama& operator=(const MtkPanorama&);
+
+    enum {
+        MAX_LEVELS = 4,
+    };
+
+    struct Match {
+        int dx;
+        int dy;
+        uint32_t cost;
+        uint32_t area;
+    };
+
+    struct Pass;
+
+    void clear();
+    static void halfBand(void *arg, int band, int worker);
+    static void searchTask(void *arg, int task, int worker);
+    static void columnWeightsBand(void *arg, int band, int worker);
+    static void rowWeightsBand(void *arg, int band, int worker);
+    void limits(int level, int *dx0, int *dx1, int *dy0, int *dy1) const;
+    void pyramid(const MtkPanoramaKernels *k, const MtkImage &frame, MtkThreadPool *pool);
+    void search(const MtkPanoramaKernels *k, const MtkImage &frame, int level,
+            int dx0, int dx1, int dy0, int dy1, Match *match, MtkThreadPool *pool);
+    status_t place(const MtkPanoramaKernels *k, const MtkImage &frame, int x, int y,
+            int overlap, MtkThreadPool *pool);
+
+    int mWidth;
+    int mHeight;
+    MtkPanoramaDir mDir;
+    int mLevels;
+    int mLevelWidth[MAX_LEVELS];
+    int mLevelHeight[MAX_LEVELS];
+    // Most motion along the sweep and drift across it, full scale
+    int mMaxShift;
+    int mMaxDrift;
+
+    // Luma pyramids, tightly packed: the last frame added from level 0,
+    // the new one from level 1, its level 0 being the frame itself
+    uint8_t *mPrev[MAX_LEVELS];
+    uint8_t *mCur[MAX_LEVELS];
+    uint32_t *mCosts;
+    // Seam weights of the frame being placed along the sweep, per luma
+    // sample and per VU byte
+    uint8_t *mAlpha;
+    uint8_t *mAlphaVu;
+    MtkImage mStrip;
+    void *mMemory;
+
+    int mFrames;
+    // The last frame added, and the box all of them cover, in the strip
+    int mX;
+    int mY;
+    int mLeft;
+    int mTop;
+    int mRight;
+    int mBottom;
+};
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_NEON
+
+#include <arm_neon.h>
+
+namespace android {
+
+static uint32_t sadNeon(const uint8_t *a, const uint8_t *b, int width)
+{
+    uint32x4_t sum = vdupq_n_u32(0);
+    uint32_t lanes[4];
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+        sum = vpadalq_u16(sum, vpaddlq_u8(vabdq_u8(vld1q_u8(a + x), vld1q_u8(b + x))));
+    vst1q_u32(lanes, sum);
+
+    uint32_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    if (x < width)
+        total += kMtkPanoramaScalar.sad(a + x, b + x, width - x);
+    return total;
+}
+
+// vld2 splits even and odd columns, so both averages are vrhadd
+static void halfNeon(const uint8_t *row0, const uint8_t *row1, uint8_t *out, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t a = vld2q_u8(row0 + 2 * x), b = vld2q_u8(row1 + 2 * x);
+        vst1q_u8(out + x, vrhaddq_u8(vrhaddq_u8(a.val[0], b.val[0]),
+                vrhaddq_u8(a.val[1], b.val[1])));
+    }
+    if (x < width)
+        kMtkPanoramaScalar.half(row0 + 2 * x, row1 + 2 * x, out + x, width - x);
+}
+
+static inline uint8x8_t blended(uint8x8_t d, uint8x8_t s, uint8x8_t a)
+{
+    int16x8_t diff = vreinterpretq_s16_u16(vsubl_u8(s, d));
+    int16x8_t step = vrshrq_n_s16(vmulq_s16(diff, vreinterpretq_s16_u16(vmovl_u8(a))), 7);
+
+    return vqmovun_s16(vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(d)), step));
+}
+
+static void blendNeon(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t d = vld1q_u8(dst + x), s = vld1q_u8(src + x), a = vld1q_u8(alpha + x);
+        vst1q_u8(dst + x, vcombine_u8(
+                blended(vget_low_u8(d), vget_low_u8(s), vget_low_u8(a)),
+                blended(vget_high_u8(d), vget_high_u8(s), vget_high_u8(a))));
+    }
+    if (x < width)
+        kMtkPanoramaScalar.blend(dst + x, src + x, alpha + x, width - x);
+}
+
+const MtkPanoramaKernels kMtkPanoramaNeon = {
+    sadNeon,
+    halfNeon,
+    blendNeon,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_NEON
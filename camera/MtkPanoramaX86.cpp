@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_X86
+
+#include <emmintrin.h>
+
+namespace android {
+
+static inline __m128i load(const void *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void store(void *p, __m128i v)
+{
+    _mm_storeu_si128((__m128i *)p, v);
+}
+
+static uint32_t sadSse2(const uint8_t *a, const uint8_t *b, int width)
+{
+    __m128i sum = _mm_setzero_si128();
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(load(a + x), load(b + x)));
+    sum = _mm_add_epi64(sum, _mm_srli_si128(sum, 8));
+
+    uint32_t total = _mm_cvtsi128_si32(sum);
+    if (x < width)
+        total += kMtkPanoramaScalar.sad(a + x, b + x, width - x);
+    return total;
+}
+
+// pavgb down the rows, then pavgw of the even and odd columns
+static void halfSse2(const uint8_t *row0, const uint8_t *row1, uint8_t *out, int width)
+{
+    const __m128i low = _mm_set1_epi16(0xff);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_avg_epu8(load(row0 + 2 * x), load(row1 + 2 * x));
+        __m128i b = _mm_avg_epu8(load(row0 + 2 * x + 16), load(row1 + 2 * x + 16));
+        __m128i lo = _mm_avg_epu16(_mm_and_si128(a, low), _mm_srli_epi16(a, 8));
+        __m128i hi = _mm_avg_epu16(_mm_and_si128(b, low), _mm_srli_epi16(b, 8));
+        store(out + x, _mm_packus_epi16(lo, hi));
+    }
+    if (x < width)
+        kMtkPanoramaScalar.half(row0 + 2 * x, row1 + 2 * x, out + x, width - x);
+}
+
+static inline __m128i blended(__m128i d, __m128i s, __m128i a)
+{
+    const __m128i round = _mm_set1_epi16(64);
+
+    return _mm_add_epi16(d, _mm_srai_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_sub_epi16(s, d), a), round), 7));
+}
+
+static void blendSse2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i d = load(dst + x), s = load(src + x), a = load(alpha + x);
+        __m128i lo = blended(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero),
+                _mm_unpacklo_epi8(a, zero));
+        __m128i hi = blended(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero),
+                _mm_unpackhi_epi8(a, zero));
+        store(dst + x, _mm_packus_epi16(lo, hi));
+    }
+    if (x < width)
+        kMtkPanoramaScalar.blend(dst + x, src + x, alpha + x, width - x);
+}
+
+const MtkPanoramaKernels kMtkPanoramaSse2 = {
+    sadSse2,
+    halfSse2,
+    blendSse2,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_X86
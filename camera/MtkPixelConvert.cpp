@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <string.h>
+
+#include "MtkPixelConvert.h"
+#include "MtkPixelKernels.h"
+
+namespace android {
+
+// Lines go through RGBA in chunks this wide, the staging stays in L1
+#define CHUNK   512
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Scalar reference
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static void packedOffsets(MtkPackedOrder order, int *y, int *u, int *v)
+{
+    switch (order) {
+    case MTK_PACKED_UYVY:
+        *y = 1; *u = 0; *v = 2;
+        break;
+    case MTK_PACKED_VYUY:
+        *y = 1; *u = 2; *v = 0;
+        break;
+    default:
+        *y = 0; *u = 3; *v = 1;
+        break;
+    }
+}
+
+static void packedToNv21(const uint8_t *src0, const uint8_t *src1,
+        uint8_t *y0, uint8_t *y1, uint8_t *vu, int width, MtkPackedOrder order)
+{
+    int yo, uo, vo;
+
+    packedOffsets(order, &yo, &uo, &vo);
+    for (int x = 0; x < width; x += 2, src0 += 4, src1 += 4) {
+        y0[x] = src0[yo];
+        y0[x + 1] = src0[yo + 2];
+        if (y1 != NULL) {
+            y1[x] = src1[yo];
+            y1[x + 1] = src1[yo + 2];
+        }
+        vu[x] = (src0[vo] + src1[vo] + 1) >> 1;
+        vu[x + 1] = (src0[uo] + src1[uo] + 1) >> 1;
+    }
+}
+
+static void interleaveVu(const uint8_t *u, const uint8_t *v, uint8_t *vu, int width)
+{
+    for (int i = 0; i < width; i++) {
+        vu[2 * i] = v[i];
+        vu[2 * i + 1] = u[i];
+    }
+}
+
+static inline uint8_t clamp8(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static void nv21ToRgba(const uint8_t *y, const uint8_t *vu, uint8_t *rgba, int width)
+{
+    for (int x = 0; x < width; x += 2, vu += 2) {
+        int v = vu[0] - 128;
+        int u = vu[1] - 128;
+        int r = YUV_V_TO_R * v;
+        int g = YUV_U_TO_G * u + YUV_V_TO_G * v;
+        int b = YUV_U_TO_B * u;
+
+        for (int i = 0; i < 2; i++, rgba += 4) {
+            int l = (y[x + i] - YUV_Y_OFFSET) * YUV_Y_SCALE + YUV_ROUND;
+            rgba[0] = clamp8((l + r) >> 6);
+            rgba[1] = clamp8((l - g) >> 6);
+            rgba[2] = clamp8((l + b) >> 6);
+            rgba[3] = 255;
+        }
+    }
+}
+
+const MtkPixelKernels kMtkPixelScalar = {
+    packedToNv21,
+    interleaveVu,
+    nv21ToRgba,
+};
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Dispatch
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+MtkPixelIsa mtkPixelIsaResolve(MtkPixelIsa isa)
+{
+    switch (isa) {
+    case MTK_PIXEL_ISA_BEST:
+        for (int i = MTK_PIXEL_ISA_COUNT - 1; i > MTK_PIXEL_ISA_SCALAR; i--) {
+            if (mtkPixelIsaResolve(MtkPixelIsa(i)) == i)
+                return MtkPixelIsa(i);
+        }
+        return MTK_PIXEL_ISA_SCALAR;
+    case MTK_PIXEL_ISA_SCALAR:
+        return isa;
+#ifdef MTK_PIXEL_HAVE_NEON
+    case MTK_PIXEL_ISA_NEON:
+        return isa;
+#endif
+#ifdef MTK_PIXEL_HAVE_X86
+    case MTK_PIXEL_ISA_SSE2:
+        return __builtin_cpu_supports("sse2") ? isa : MTK_PIXEL_ISA_COUNT;
+    case MTK_PIXEL_ISA_AVX2:
+        return __builtin_cpu_supports("avx2") ? isa : MTK_PIXEL_ISA_COUNT;
+#endif
+    default:
+        return MTK_PIXEL_ISA_COUNT;
+    }
+}
+
+bool mtkPixelIsaSupported(MtkPixelIsa isa)
+{
+    return mtkPixelIsaResolve(isa) != MTK_PIXEL_ISA_COUNT;
+}
+
+const char *mtkPixelIsaName(MtkPixelIsa isa)
+{
+    static const char *const names[MTK_PIXEL_ISA_COUNT] = {
+        "scalar", "neon", "sse2", "avx2",
+    };
+
+    if (isa == MTK_PIXEL_ISA_BEST)
+        isa = mtkPixelIsaResolve(isa);
+    if (isa < 0 || isa >= MTK_PIXEL_ISA_COUNT)
+        return "unknown";
+    return names[isa];
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Frame conversion
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static bool packedOrder(MtkPixelFormat format, MtkPackedOrder *order)
+{
+    switch (format) {
+    case MTK_PIXEL_FORMAT_UYVY:
+        *order = MTK_PACKED_UYVY;
+        return true;
+    case MTK_PIXEL_FORMAT_VYUY:
+        *order = MTK_PACKED_VYUY;
+        return true;
+    case MTK_PIXEL_FORMAT_YVYU:
+        *order = MTK_PACKED_YVYU;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static const uint8_t *line(const MtkImage &image, int plane, int y)
+{
+    return image.planes[plane] + image.strides[plane] * y;
+}
+
+static uint8_t *line(MtkImage *image, int plane, int y)
+{
+    return image->planes[plane] + image->strides[plane] * y;
+}
+
+static void toNv21(const MtkPixelKernels *k, const MtkImage &src, MtkImage *dst)
+{
+    MtkPackedOrder order;
+    int w = src.width, h = src.height;
+
+    if (packedOrder(src.format, &order)) {
+        for (int y = 0; y < h; y += 2) {
+            k->packedToNv21(line(src, 0, y), line(src, 0, y + 1),
+                    line(dst, 0, y), line(dst, 0, y + 1), line(dst, 1, y / 2), w, order);
+        }
+        return;
+    }
+
+    for (int y = 0; y < h; y++)
+        memcpy(line(dst, 0, y), line(src, 0, y), w);
+    for (int y = 0; y < h / 2; y++) {
+        if (src.format == MTK_PIXEL_FORMAT_NV21)
+            memcpy(line(dst, 1, y), line(src, 1, y), w);
+        else
+            k->interleaveVu(line(src, 1, y), line(src, 2, y), line(dst, 1, y), w / 2);
+    }
+}
+
+static void toRgba(const MtkPixelKernels *k, const MtkImage &src, MtkImage *dst)
+{
+    uint8_t yBuf[CHUNK], vuBuf[CHUNK];
+    MtkPackedOrder order;
+    bool packed = packedOrder(src.format, &order);
+    int w = src.width, h = src.height;
+
+    for (int y = 0; y < h; y++) {
+        uint8_t *out = line(dst, 0, y);
+
+        if (src.format == MTK_PIXEL_FORMAT_NV21) {
+            k->nv21ToRgba(line(src, 0, y), line(src, 1, y / 2), out, w);
+            continue;
+        }
+        for (int x = 0; x < w; x += CHUNK) {
+            int n = w - x < CHUNK ? w - x : CHUNK;
+            if (packed) {
+                const uint8_t *in = line(src, 0, y) + x * 2;
+                k->packedToNv21(in, in, yBuf, NULL, vuBuf, n, order);
+                k->nv21ToRgba(yBuf, vuBuf, out + x * 4, n);
+            } else {
+                k->interleaveVu(line(src, 1, y / 2) + x / 2, line(src, 2, y / 2) + x / 2,
+                        vuBuf, n / 2);
+                k->nv21ToRgba(line(src, 0, y) + x, vuBuf, out + x * 4, n);
+            }
+        }
+    }
+}
+
+status_t mtkPixelConvert(const MtkImage &src, MtkImage *dst, MtkPixelIsa isa)
+{
+    const MtkPixelKernels *k = mtkPixelPick(isa, &kMtkPixelScalar,
+            MTK_PIXEL_NEON(kMtkPixelNeon), MTK_PIXEL_X86(kMtkPixelSse2),
+            MTK_PIXEL_X86(kMtkPixelAvx2));
+
+    if (k == NULL) {
+        ALOGE("No %s kernels on this CPU", mtkPixelIsaName(isa));
+        return INVALID_OPERATION;
+    }
+    if (src.width != dst->width || src.height != dst->height ||
+            src.width <= 0 || src.height <= 0 || (src.width & 1)) {
+        ALOGE("Cannot convert %dx%d to %dx%d", src.width, src.height,
+                dst->width, dst->height);
+        return BAD_VALUE;
+    }
+
+    switch (src.format) {
+    case MTK_PIXEL_FORMAT_NV21:
+    case MTK_PIXEL_FORMAT_YUV420I:
+    case MTK_PIXEL_FORMAT_YV12_GPU:
+        if (src.height & 1)
+            return BAD_VALUE;
+        break;
+    case MTK_PIXEL_FORMAT_UYVY:
+    case MTK_PIXEL_FORMAT_VYUY:
+    case MTK_PIXEL_FORMAT_YVYU:
+        if (dst->format == MTK_PIXEL_FORMAT_NV21 && (src.height & 1))
+            return BAD_VALUE;
+        break;
+    default:
+        ALOGE("Cannot convert from format %d", src.format);
+        return INVALID_OPERATION;
+    }
+
+    switch (dst->format) {
+    case MTK_PIXEL_FORMAT_NV21:
+        toNv21(k, src, dst);
+        return NO_ERROR;
+    case MTK_PIXEL_FORMAT_RGBA:
+        toRgba(k, src, dst);
+        return NO_ERROR;
+    default:
+        ALOGE("Cannot convert to format %d", dst->format);
+        return INVALID_OPERATION;
+    }
+}
+
+}; // namespace android
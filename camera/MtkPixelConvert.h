@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_PIXEL_CONVERT_H
+#define ANDROID_HARDWARE_MTK_PIXEL_CONVERT_H
+
+#include "MtkImage.h"
+
+namespace android {
+
+/**
+ * Instruction sets the converters have kernels for. All of them produce
+ * the same bytes as the scalar reference.
+ */
+enum MtkPixelIsa {
+    MTK_PIXEL_ISA_BEST = -1,        // fastest the CPU supports
+    MTK_PIXEL_ISA_SCALAR,
+    MTK_PIXEL_ISA_NEON,
+    MTK_PIXEL_ISA_SSE2,
+    MTK_PIXEL_ISA_AVX2,
+    MTK_PIXEL_ISA_COUNT,
+};
+
+bool mtkPixelIsaSupported(MtkPixelIsa isa);
+const char *mtkPixelIsaName(MtkPixelIsa isa);
+
+/**
+ * Converts src into dst, which must have the same size. Sources are
+ * NV21, YUV420I, YV12_GPU and the packed 4:2:2 formats, destinations NV21
+ * and RGBA.
+ *
+ * 4:2:2 to NV21 averages the chroma of each pair of lines. RGBA uses
+ * BT.601 video range in fixed point with 6 fraction bits, alpha is 255.
+ */
+status_t mtkPixelConvert(const MtkImage &src, MtkImage *dst,
+        MtkPixelIsa isa = MTK_PIXEL_ISA_BEST);
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_NEON
+
+#include <arm_neon.h>
+
+namespace android {
+
+/*
+ * The structure loads and stores do the (de)interleaving, vrhadd rounds
+ * like the scalar average and vqshrun clamps like packus.
+ */
+static void packedToNv21Neon(const uint8_t *src0, const uint8_t *src1,
+        uint8_t *y0, uint8_t *y1, uint8_t *vu, int width, MtkPackedOrder order)
+{
+    int yo = order == MTK_PACKED_YVYU ? 0 : 1;
+    int uo = order == MTK_PACKED_UYVY ? 0 : order == MTK_PACKED_VYUY ? 2 : 3;
+    int vo = order == MTK_PACKED_UYVY ? 2 : order == MTK_PACKED_VYUY ? 0 : 1;
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        uint8x16x4_t a = vld4q_u8(src0 + 2 * x);
+        uint8x16x4_t b = vld4q_u8(src1 + 2 * x);
+        uint8x16x2_t out;
+
+        out.val[0] = a.val[yo];
+        out.val[1] = a.val[yo + 2];
+        vst2q_u8(y0 + x, out);
+        if (y1 != NULL) {
+            out.val[0] = b.val[yo];
+            out.val[1] = b.val[yo + 2];
+            vst2q_u8(y1 + x, out);
+        }
+        out.val[0] = vrhaddq_u8(a.val[vo], b.val[vo]);
+        out.val[1] = vrhaddq_u8(a.val[uo], b.val[uo]);
+        vst2q_u8(vu + x, out);
+    }
+    if (x < width) {
+        kMtkPixelScalar.packedToNv21(src0 + 2 * x, src1 + 2 * x, y0 + x,
+                y1 != NULL ? y1 + x : NULL, vu + x, width - x, order);
+    }
+}
+
+static void interleaveVuNeon(const uint8_t *u, const uint8_t *v, uint8_t *vu, int width)
+{
+    int i = 0;
+
+    for (; i + 16 <= width; i += 16) {
+        uint8x16x2_t out;
+        out.val[0] = vld1q_u8(v + i);
+        out.val[1] = vld1q_u8(u + i);
+        vst2q_u8(vu + 2 * i, out);
+    }
+    if (i < width)
+        kMtkPixelScalar.interleaveVu(u + i, v + i, vu + 2 * i, width - i);
+}
+
+static inline uint8x8_t channel(int16x8_t l, int16x8_t c, bool subtract)
+{
+    return vqshrun_n_s16(subtract ? vqsubq_s16(l, c) : vqaddq_s16(l, c), 6);
+}
+
+static void nv21ToRgbaNeon(const uint8_t *y, const uint8_t *vu, uint8_t *rgba, int width)
+{
+    const int16x8_t offset = vdupq_n_s16(YUV_Y_OFFSET);
+    const int16x8_t round = vdupq_n_s16(YUV_ROUND);
+    const int16x8_t bias = vdupq_n_s16(128);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t yy = vld1q_u8(y + x);
+        uint8x8x2_t c = vld2_u8(vu + x);
+        int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(c.val[0])), bias);
+        int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(c.val[1])), bias);
+
+        // Chroma terms per pair, then spread over both pixels
+        int16x8x2_t r = vzipq_s16(vmulq_n_s16(v, YUV_V_TO_R), vmulq_n_s16(v, YUV_V_TO_R));
+        int16x8_t gc = vaddq_s16(vmulq_n_s16(u, YUV_U_TO_G), vmulq_n_s16(v, YUV_V_TO_G));
+        int16x8x2_t g = vzipq_s16(gc, gc);
+        int16x8x2_t b = vzipq_s16(vmulq_n_s16(u, YUV_U_TO_B), vmulq_n_s16(u, YUV_U_TO_B));
+
+        int16x8_t l0 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(yy))), offset);
+        int16x8_t l1 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(yy))), offset);
+        l0 = vmlaq_n_s16(round, l0, YUV_Y_SCALE);
+        l1 = vmlaq_n_s16(round, l1, YUV_Y_SCALE);
+
+        uint8x16x4_t out;
+        out.val[0] = vcombine_u8(channel(l0, r.val[0], false), channel(l1, r.val[1], false));
+        out.val[1] = vcombine_u8(channel(l0, g.val[0], true), channel(l1, g.val[1], true));
+        out.val[2] = vcombine_u8(channel(l0, b.val[0], false), channel(l1, b.val[1], false));
+        out.val[3] = vdupq_n_u8(255);
+        vst4q_u8(rgba + 4 * x, out);
+    }
+    if (x < width)
+        kMtkPixelScalar.nv21ToRgba(y + x, vu + x, rgba + 4 * x, width - x);
+}
+
+const MtkPixelKernels kMtkPixelNeon = {
+    packedToNv21Neon,
+    interleaveVuNeon,
+    nv21ToRgbaNeon,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_NEON
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_X86
+
+#include <immintrin.h>
+
+namespace android {
+
+/*
+ * SSE2 is the baseline of both x86 ABIs. The AVX2 kernels are built with
+ * a target attribute so the file needs no extra flags, and are only ever
+ * called after a CPU check.
+ */
+#define AVX2 __attribute__((target("avx2")))
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  SSE2
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+/*
+ * Splits 16 bytes of packed 4:2:2 (8 pixels) into Y and the two chroma
+ * bytes of each macropixel, in memory order, as 16 bit lanes.
+ */
+static inline void split(__m128i p, bool yOdd, __m128i *y, __m128i *c)
+{
+    const __m128i low = _mm_set1_epi16(0xff);
+
+    if (yOdd) {
+        *y = _mm_srli_epi16(p, 8);
+        *c = _mm_and_si128(p, low);
+    } else {
+        *y = _mm_and_si128(p, low);
+        *c = _mm_srli_epi16(p, 8);
+    }
+}
+
+static inline __m128i swapBytes(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static void packedToNv21Sse2(const uint8_t *src0, const uint8_t *src1,
+        uint8_t *y0, uint8_t *y1, uint8_t *vu, int width, MtkPackedOrder order)
+{
+    bool yOdd = order != MTK_PACKED_YVYU;
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i ya, yb, ca, cb, c0, c1;
+
+        split(_mm_loadu_si128((const __m128i *)(src0 + 2 * x)), yOdd, &ya, &ca);
+        split(_mm_loadu_si128((const __m128i *)(src0 + 2 * x + 16)), yOdd, &yb, &cb);
+        _mm_storeu_si128((__m128i *)(y0 + x), _mm_packus_epi16(ya, yb));
+        c0 = _mm_packus_epi16(ca, cb);
+
+        split(_mm_loadu_si128((const __m128i *)(src1 + 2 * x)), yOdd, &ya, &ca);
+        split(_mm_loadu_si128((const __m128i *)(src1 + 2 * x + 16)), yOdd, &yb, &cb);
+        if (y1 != NULL)
+            _mm_storeu_si128((__m128i *)(y1 + x), _mm_packus_epi16(ya, yb));
+        c1 = _mm_packus_epi16(ca, cb);
+
+        c0 = _mm_avg_epu8(c0, c1);
+        if (order == MTK_PACKED_UYVY)
+            c0 = swapBytes(c0);
+        _mm_storeu_si128((__m128i *)(vu + x), c0);
+    }
+    if (x < width) {
+        kMtkPixelScalar.packedToNv21(src0 + 2 * x, src1 + 2 * x, y0 + x,
+                y1 != NULL ? y1 + x : NULL, vu + x, width - x, order);
+    }
+}
+
+static void interleaveVuSse2(const uint8_t *u, const uint8_t *v, uint8_t *vu, int width)
+{
+    int i = 0;
+
+    for (; i + 16 <= width; i += 16) {
+        __m128i uu = _mm_loadu_si128((const __m128i *)(u + i));
+        __m128i vv = _mm_loadu_si128((const __m128i *)(v + i));
+        _mm_storeu_si128((__m128i *)(vu + 2 * i), _mm_unpacklo_epi8(vv, uu));
+        _mm_storeu_si128((__m128i *)(vu + 2 * i + 16), _mm_unpackhi_epi8(vv, uu));
+    }
+    if (i < width)
+        kMtkPixelScalar.interleaveVu(u + i, v + i, vu + 2 * i, width - i);
+}
+
+/*
+ * 8 pixels: l is Y as 16 bit lanes, vu the 4 VU pairs as 16 bit lanes.
+ * Each pair is spread over its two pixels within a 32 bit lane.
+ */
+static inline __m128i yuvToRgba8(__m128i l, __m128i vu, __m128i *hi)
+{
+    const __m128i lowHalf = _mm_set1_epi32(0xffff);
+    const __m128i bias = _mm_set1_epi16(128);
+    __m128i v = _mm_or_si128(_mm_and_si128(vu, lowHalf), _mm_slli_epi32(vu, 16));
+    __m128i u = _mm_or_si128(_mm_srli_epi32(vu, 16), _mm_andnot_si128(lowHalf, vu));
+    __m128i r, g, b;
+
+    v = _mm_sub_epi16(v, bias);
+    u = _mm_sub_epi16(u, bias);
+    l = _mm_sub_epi16(l, _mm_set1_epi16(YUV_Y_OFFSET));
+    l = _mm_add_epi16(_mm_mullo_epi16(l, _mm_set1_epi16(YUV_Y_SCALE)),
+            _mm_set1_epi16(YUV_ROUND));
+
+    r = _mm_adds_epi16(l, _mm_mullo_epi16(v, _mm_set1_epi16(YUV_V_TO_R)));
+    g = _mm_subs_epi16(l, _mm_add_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(YUV_U_TO_G)),
+            _mm_mullo_epi16(v, _mm_set1_epi16(YUV_V_TO_G))));
+    b = _mm_adds_epi16(l, _mm_mullo_epi16(u, _mm_set1_epi16(YUV_U_TO_B)));
+
+    __m128i rb = _mm_packus_epi16(_mm_srai_epi16(r, 6), _mm_srai_epi16(b, 6));
+    __m128i ga = _mm_packus_epi16(_mm_srai_epi16(g, 6), _mm_set1_epi16(255));
+    __m128i rg = _mm_unpacklo_epi8(rb, ga);
+    __m128i ba = _mm_unpackhi_epi8(rb, ga);
+    *hi = _mm_unpackhi_epi16(rg, ba);
+    return _mm_unpacklo_epi16(rg, ba);
+}
+
+static void nv21ToRgbaSse2(const uint8_t *y, const uint8_t *vu, uint8_t *rgba, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i l = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(y + x)), zero);
+        __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(vu + x)), zero);
+        __m128i hi, lo = yuvToRgba8(l, c, &hi);
+        _mm_storeu_si128((__m128i *)(rgba + 4 * x), lo);
+        _mm_storeu_si128((__m128i *)(rgba + 4 * x + 16), hi);
+    }
+    if (x < width)
+        kMtkPixelScalar.nv21ToRgba(y + x, vu + x, rgba + 4 * x, width - x);
+}
+
+const MtkPixelKernels kMtkPixelSse2 = {
+    packedToNv21Sse2,
+    interleaveVuSse2,
+    nv21ToRgbaSse2,
+};
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  AVX2, packs and unpacks work per 128 bit lane and need a permute after
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static inline AVX2 void split(__m256i p, bool yOdd, __m256i *y, __m256i *c)
+{
+    const __m256i low = _mm256_set1_epi16(0xff);
+
+    if (yOdd) {
+        *y = _mm256_srli_epi16(p, 8);
+        *c = _mm256_and_si256(p, low);
+    } else {
+        *y = _mm256_and_si256(p, low);
+        *c = _mm256_srli_epi16(p, 8);
+    }
+}
+
+static inline AVX2 __m256i pack(__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+}
+
+static AVX2 void packedToNv21Avx2(const uint8_t *src0, const uint8_t *src1,
+        uint8_t *y0, uint8_t *y1, uint8_t *vu, int width, MtkPackedOrder order)
+{
+    bool yOdd = order != MTK_PACKED_YVYU;
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        __m256i ya, yb, ca, cb, c0, c1;
+
+        split(_mm256_loadu_si256((const __m256i *)(src0 + 2 * x)), yOdd, &ya, &ca);
+        split(_mm256_loadu_si256((const __m256i *)(src0 + 2 * x + 32)), yOdd, &yb, &cb);
+        _mm256_storeu_si256((__m256i *)(y0 + x), pack(ya, yb));
+        c0 = pack(ca, cb);
+
+        split(_mm256_loadu_si256((const __m256i *)(src1 + 2 * x)), yOdd, &ya, &ca);
+        split(_mm256_loadu_si256((const __m256i *)(src1 + 2 * x + 32)), yOdd, &yb, &cb);
+        if (y1 != NULL)
+            _mm256_storeu_si256((__m256i *)(y1 + x), pack(ya, yb));
+        c1 = pack(ca, cb);
+
+        c0 = _mm256_avg_epu8(c0, c1);
+        if (order == MTK_PACKED_UYVY)
+            c0 = _mm256_or_si256(_mm256_slli_epi16(c0, 8), _mm256_srli_epi16(c0, 8));
+        _mm256_storeu_si256((__m256i *)(vu + x), c0);
+    }
+    if (x < width) {
+        packedToNv21Sse2(src0 + 2 * x, src1 + 2 * x, y0 + x,
+                y1 != NULL ? y1 + x : NULL, vu + x, width - x, order);
+    }
+}
+
+static AVX2 void interleaveVuAvx2(const uint8_t *u, const uint8_t *v, uint8_t *vu, int width)
+{
+    int i = 0;
+
+    for (; i + 32 <= width; i += 32) {
+        __m256i uu = _mm256_loadu_si256((const __m256i *)(u + i));
+        __m256i vv = _mm256_loadu_si256((const __m256i *)(v + i));
+        __m256i lo = _mm256_unpacklo_epi8(vv, uu);
+        __m256i hi = _mm256_unpackhi_epi8(vv, uu);
+        _mm256_storeu_si256((__m256i *)(vu + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(vu + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    if (i < width)
+        interleaveVuSse2(u + i, v + i, vu + 2 * i, width - i);
+}
+
+static AVX2 void nv21ToRgbaAvx2(const uint8_t *y, const uint8_t *vu, uint8_t *rgba, int width)
+{
+    const __m256i lowHalf = _mm256_set1_epi32(0xffff);
+    const __m256i bias = _mm256_set1_epi16(128);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m256i l = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(y + x)));
+        __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(vu + x)));
+        __m256i v = _mm256_or_si256(_mm256_and_si256(c, lowHalf), _mm256_slli_epi32(c, 16));
+        __m256i u = _mm256_or_si256(_mm256_srli_epi32(c, 16), _mm256_andnot_si256(lowHalf, c));
+        __m256i r, g, b;
+
+        v = _mm256_sub_epi16(v, bias);
+        u = _mm256_sub_epi16(u, bias);
+        l = _mm256_sub_epi16(l, _mm256_set1_epi16(YUV_Y_OFFSET));
+        l = _mm256_add_epi16(_mm256_mullo_epi16(l, _mm256_set1_epi16(YUV_Y_SCALE)),
+                _mm256_set1_epi16(YUV_ROUND));
+
+        r = _mm256_adds_epi16(l, _mm256_mullo_epi16(v, _mm256_set1_epi16(YUV_V_TO_R)));
+        g = _mm256_subs_epi16(l, _mm256_add_epi16(
+                _mm256_mullo_epi16(u, _mm256_set1_epi16(YUV_U_TO_G)),
+                _mm256_mullo_epi16(v, _mm256_set1_epi16(YUV_V_TO_G))));
+        b = _mm256_adds_epi16(l, _mm256_mullo_epi16(u, _mm256_set1_epi16(YUV_U_TO_B)));
+
+        // Lane 0 holds pixels 0-7, lane 1 pixels 8-15, all the way through
+        __m256i rb = _mm256_packus_epi16(_mm256_srai_epi16(r, 6), _mm256_srai_epi16(b, 6));
+        __m256i ga = _mm256_packus_epi16(_mm256_srai_epi16(g, 6), _mm256_set1_epi16(255));
+        __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+        __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+        __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+        __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+        _mm256_storeu_si256((__m256i *)(rgba + 4 * x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(rgba + 4 * x + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    if (x < width)
+        nv21ToRgbaSse2(y + x, vu + x, rgba + 4 * x, width - x);
+}
+
+const MtkPixelKernels kMtkPixelAvx2 = {
+    packedToNv21Avx2,
+    interleaveVuAvx2,
+    nv21ToRgbaAvx2,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_X86
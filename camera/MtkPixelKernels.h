@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_PIXEL_KERNELS_H
+#define ANDROID_HARDWARE_MTK_PIXEL_KERNELS_H
+
+#include <stdint.h>
+
+#include "MtkPixelConvert.h"
+#include "MtkThreadPool.h"
+
+namespace android {
+
+// The instruction set to use for isa, MTK_PIXEL_ISA_COUNT if the CPU lacks it
+MtkPixelIsa mtkPixelIsaResolve(MtkPixelIsa isa);
+
+// Byte order of a packed 4:2:2 macropixel
+enum MtkPackedOrder {
+    MTK_PACKED_UYVY,
+    MTK_PACKED_VYUY,
+    MTK_PACKED_YVYU,
+};
+
+/*
+ * Fixed point BT.601 video range, 6 fraction bits. Every term fits in
+ * 16 bits; only blue can go past 32767, and the vector kernels saturate
+ * there, which clamps to 255 just like the scalar code does.
+ */
+#define YUV_Y_OFFSET    16
+#define YUV_Y_SCALE     74      // 1.164
+#define YUV_V_TO_R      102     // 1.596
+#define YUV_U_TO_G      25      // 0.391
+#define YUV_V_TO_G      52      // 0.813
+#define YUV_U_TO_B      129     // 2.018
+#define YUV_ROUND       32
+
+/*
+ * Row kernels, one set per instruction set. Widths are in pixels and
+ * even; the vector kernels hand whatever does not fill a vector to the
+ * scalar ones.
+ */
+struct MtkPixelKernels {
+    // Two lines of 4:2:2 to their Y lines and one averaged VU line, y1 may be NULL
+    void (*packedToNv21)(const uint8_t *src0, const uint8_t *src1,
+            uint8_t *y0, uint8_t *y1, uint8_t *vu, int width, MtkPackedOrder order);
+    // Separate U and V to interleaved VU, width in pairs
+    void (*interleaveVu)(const uint8_t *u, const uint8_t *v, uint8_t *vu, int width);
+    // One line of Y with its VU line to RGBA
+    void (*nv21ToRgba)(const uint8_t *y, const uint8_t *vu, uint8_t *rgba, int width);
+};
+
+/*
+ * Raw row kernels. Samples are 10 bit in uint16_t. The demosaic kernels
+ * read one sample left and right of the row, and phase is the parity of
+ * the columns that hold red or blue: "same" gets the color of this row,
+ * "other" the one of the rows above and below.
+ */
+struct MtkRawKernels {
+    // MIPI RAW10 to samples, width a multiple of 4
+    void (*unpack10)(const uint8_t *src, uint16_t *dst, int width);
+    // Black level, then gain in Q10 clamped to 1023, per column parity
+    void (*levels)(uint16_t *row, int width, const uint16_t black[2], const uint16_t gain[2]);
+    void (*bilinear)(const uint16_t *above, const uint16_t *row, const uint16_t *below,
+            uint16_t *same, uint16_t *green, uint16_t *other, int width, int phase);
+    // Edge aware: green along the flatter direction, then red and blue
+    // from the color differences around them
+    void (*green)(const uint16_t *above, const uint16_t *row, const uint16_t *below,
+            uint16_t *green, int width, int phase);
+    void (*chroma)(const uint16_t *const cfa[3], const uint16_t *const green[3],
+            uint16_t *same, uint16_t *other, int width, int phase);
+    void (*toRgba)(const uint16_t *r, const uint16_t *g, const uint16_t *b,
+            uint8_t *rgba, int width);
+    // Two lines to two Y lines and one VU line, chroma from 2x2 averages
+    void (*toNv21)(const uint16_t *const r[2], const uint16_t *const g[2],
+            const uint16_t *const b[2], uint8_t *y0, uint8_t *y1, uint8_t *vu, int width);
+};
+
+/*
+ * Exposure fusion row kernels. Pyramid levels are int16 with 4 fraction
+ * bits (0 to 4080), weights Q14; everything but the Laplacian and the
+ * blended levels is non-negative, which the rounding averages rely on.
+ * Rows marked padded have valid samples that many columns left and
+ * right of [0, width).
+ */
+struct MtkFusionKernels {
+    void (*widen)(const uint8_t *src, int16_t *dst, int width);
+    // Interleaved VU to separate planes, width in pairs
+    void (*widenVu)(const uint8_t *vu, int16_t *v, int16_t *u, int width);
+    // Raw well-exposedness x saturation x contrast, rows padded by 1
+    void (*weights)(const uint8_t *const y[3], const uint8_t *vu, uint16_t *w, int width);
+    // Raw weights of count frames to Q14 ones that add up to 1
+    void (*normalize)(const uint16_t *const w[], int16_t *const out[], int count, int width);
+    // 1 4 6 4 1 down: the vertical pass over five rows, then the
+    // horizontal one into half the columns, in padded by 2
+    void (*reduceV)(const int16_t *const rows[5], int16_t *out, int width);
+    void (*reduceH)(const int16_t *in, int16_t *tmp, int16_t *out, int width);
+    // And up: even rows from three, odd ones from two, then columns from
+    // in padded by 1; expandH writes up to width + 1 samples
+    void (*expandV)(const int16_t *const rows[3], int16_t *out, int width, int odd);
+    void (*expandH)(const int16_t *in, int16_t *out, int width);
+    // Sum over frames of (g - e) * w, e the expanded next level
+    void (*blend)(const int16_t *const g[], const int16_t *const e[], const int16_t *const w[],
+            int count, int16_t *out, int width);
+    // r + e clamped to the level range, out may be r
+    void (*collapse)(const int16_t *r, const int16_t *e, int16_t *out, int width);
+    void (*narrow)(const int16_t *src, uint8_t *dst, int width);
+    void (*narrowVu)(const int16_t *v, const int16_t *u, uint8_t *vu, int width);
+};
+
+/*
+ * Face beauty row kernels. Coefficients live on a grid of 4x4 luma
+ * blocks and are Q8: a in 0 to 256, b in luma x 256.
+ */
+// Centre of the skin colours in VU, and where skinTone() moves them
+#define BEAUTY_SKIN_V       152
+#define BEAUTY_SKIN_U       108
+#define BEAUTY_TARGET_V     162
+#define BEAUTY_TARGET_U     112
+
+struct MtkBeautyKernels {
+    // Sums of 4x4 luma and of 2x2 V and U, one per block
+    void (*downsample)(const uint8_t *const y[4], uint16_t *out, int width);
+    void (*downsampleVu)(const uint8_t *const vu[2], uint16_t *v, uint16_t *u, int width);
+    // (8 - eighths) / 8 of a plus eighths / 8 of b, eighths 1, 3, 5 or 7
+    void (*lerp)(const uint16_t *a, const uint16_t *b, int eighths, uint16_t *out, int width);
+    // Four samples per one of in, which is padded by 1; width a multiple of 4
+    void (*expand4)(const uint16_t *in, uint16_t *out, int width);
+    // (a * y + b) / 256, saturated
+    void (*apply)(const uint8_t *y, const uint16_t *a, const uint16_t *b, uint8_t *out,
+            int width);
+    // Unsharp mask of rows[1] with a 1 2 1 blur, amount Q4; rows and tmp
+    // padded by 1
+    void (*sharpen)(const uint8_t *const rows[3], uint8_t *tmp, uint8_t *out, int amount,
+            int width);
+    // Moves skin coloured VU pairs towards the target tone by level / 128
+    void (*skinTone)(const uint8_t *vu, uint8_t *out, int level, int width);
+};
+
+/*
+ * Lens shading row kernels, gains Q10 per sample. Products are truncated
+ * like those of the raw levels kernel.
+ */
+struct MtkShadingKernels {
+    void (*gain8)(uint8_t *row, const uint16_t *gain, int width);
+    // 10 bit samples, clamped to 1023
+    void (*gain10)(uint16_t *row, const uint16_t *gain, int width);
+};
+
+/*
+ * Panorama row kernels for registering luma and blending it into the
+ * stitched strip. Alpha is 0 to 128 per sample.
+ */
+struct MtkPanoramaKernels {
+    // Sum of absolute differences
+    uint32_t (*sad)(const uint8_t *a, const uint8_t *b, int width);
+    // Rounding 2x2 averages of two rows, width the output one
+    void (*half)(const uint8_t *row0, const uint8_t *row1, uint8_t *out, int width);
+    // dst + (src - dst) * alpha / 128, rounded, in place
+    void (*blend)(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int width);
+};
+
+extern const MtkPixelKernels kMtkPixelScalar;
+extern const MtkRawKernels kMtkRawScalar;
+extern const MtkFusionKernels kMtkFusionScalar;
+extern const MtkBeautyKernels kMtkBeautyScalar;
+extern const MtkShadingKernels kMtkShadingScalar;
+extern const MtkPanoramaKernels kMtkPanoramaScalar;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MTK_PIXEL_HAVE_NEON
+extern const MtkPixelKernels kMtkPixelNeon;
+extern const MtkRawKernels kMtkRawNeon;
+extern const MtkFusionKernels kMtkFusionNeon;
+extern const MtkBeautyKernels kMtkBeautyNeon;
+extern const MtkShadingKernels kMtkShadingNeon;
+extern const MtkPanoramaKernels kMtkPanoramaNeon;
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+#define MTK_PIXEL_HAVE_X86
+extern const MtkPixelKernels kMtkPixelSse2;
+extern const MtkPixelKernels kMtkPixelAvx2;
+extern const MtkRawKernels kMtkRawSse2;
+extern const MtkRawKernels kMtkRawAvx2;
+extern const MtkFusionKernels kMtkFusionSse2;
+extern const MtkBeautyKernels kMtkBeautySse2;
+extern const MtkShadingKernels kMtkShadingSse2;
+extern const MtkPanoramaKernels kMtkPanoramaSse2;
+#endif
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Front end helpers
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// A table for MTK_PIXEL_ISA_NEON or the x86 ones, NULL where it is not built
+#ifdef MTK_PIXEL_HAVE_NEON
+#define MTK_PIXEL_NEON(kernels)     (&(kernels))
+#else
+#define MTK_PIXEL_NEON(kernels)     NULL
+#endif
+#ifdef MTK_PIXEL_HAVE_X86
+#define MTK_PIXEL_X86(kernels)      (&(kernels))
+#else
+#define MTK_PIXEL_X86(kernels)      NULL
+#endif
+
+template <typename K>
+struct MtkPixelTable {
+    typedef const K *type;
+};
+
+/*
+ * The table of a kind for isa, NULL if the CPU lacks it. Kinds without
+ * AVX2 kernels pass their SSE2 table for it.
+ */
+template <typename K>
+static inline const K *mtkPixelPick(MtkPixelIsa isa, const K *scalar,
+        typename MtkPixelTable<K>::type neon, typename MtkPixelTable<K>::type sse2,
+        typename MtkPixelTable<K>::type avx2)
+{
+    switch (mtkPixelIsaResolve(isa)) {
+    case MTK_PIXEL_ISA_SCALAR:
+        return scalar;
+    case MTK_PIXEL_ISA_NEON:
+        return neon;
+    case MTK_PIXEL_ISA_SSE2:
+        return sse2;
+    case MTK_PIXEL_ISA_AVX2:
+        return avx2;
+    default:
+        return NULL;
+    }
+}
+
+// Rounding average, what the vector averages do
+static inline int avg(int a, int b)
+{
+    return (a + b + 1) >> 1;
+}
+
+// Mirrors around the edge sample, which also keeps the Bayer phase
+static inline int reflect(int v, int size)
+{
+    if (v < 0)
+        return -v;
+    if (v >= size)
+        return 2 * size - 2 - v;
+    return v;
+}
+
+// A band of rows per task, on the caller when there is no pool
+static inline void runBands(MtkThreadPool *pool, MtkThreadPool::Task task, void *arg,
+        int height, int rows)
+{
+    int bands = (height + rows - 1) / rows;
+
+    if (pool != NULL) {
+        pool->run(bands, task, arg);
+        return;
+    }
+    for (int b = 0; b < bands; b++)
+        task(arg, b, 0);
+}
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_NEON
+
+#include <arm_neon.h>
+
+namespace android {
+
+/*
+ * vrhadd rounds like the scalar average and vrshr like its "+ half, then
+ * shift"; the 10 bit samples leave room for the signed color differences.
+ */
+static const uint16_t kPhaseLanes[2][8] = {
+    { 0xffff, 0, 0xffff, 0, 0xffff, 0, 0xffff, 0 },
+    { 0, 0xffff, 0, 0xffff, 0, 0xffff, 0, 0xffff },
+};
+
+static inline uint16x8_t pair(const uint16_t v[2])
+{
+    const uint16_t lanes[8] = { v[0], v[1], v[0], v[1], v[0], v[1], v[0], v[1] };
+    return vld1q_u16(lanes);
+}
+
+static void unpack10Neon(const uint8_t *src, uint16_t *dst, int width)
+{
+    static const uint8_t kHigh[8] = { 0, 1, 2, 3, 5, 6, 7, 8 };
+    static const uint8_t kLow[8] = { 4, 4, 4, 4, 9, 9, 9, 9 };
+    static const int16_t kShift[8] = { 0, -2, -4, -6, 0, -2, -4, -6 };
+    const uint8x8_t high = vld1_u8(kHigh), low = vld1_u8(kLow);
+    const int16x8_t shift = vld1q_s16(kShift);
+    const uint16x8_t three = vdupq_n_u16(3);
+    int bytes = width / 4 * 5;
+    int x = 0;
+
+    // Eight samples from ten bytes, read as sixteen
+    for (; x / 4 * 5 + 16 <= bytes; x += 8) {
+        uint8x16_t t = vld1q_u8(src + x / 4 * 5);
+        uint8x8x2_t table = { { vget_low_u8(t), vget_high_u8(t) } };
+        uint16x8_t hi = vshlq_n_u16(vmovl_u8(vtbl2_u8(table, high)), 2);
+        uint16x8_t lo = vandq_u16(vshlq_u16(vmovl_u8(vtbl2_u8(table, low)), shift), three);
+        vst1q_u16(dst + x, vorrq_u16(hi, lo));
+    }
+    if (x < width)
+        kMtkRawScalar.unpack10(src + x / 4 * 5, dst + x, width - x);
+}
+
+static void levelsNeon(uint16_t *row, int width, const uint16_t black[2], const uint16_t gain[2])
+{
+    const uint16x8_t b = pair(black), g = pair(gain), max = vdupq_n_u16(1023);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t v = vshlq_n_u16(vqsubq_u16(vld1q_u16(row + x), b), 6);
+        uint16x4_t l = vshrn_n_u32(vmull_u16(vget_low_u16(v), vget_low_u16(g)), 16);
+        uint16x4_t h = vshrn_n_u32(vmull_u16(vget_high_u16(v), vget_high_u16(g)), 16);
+        vst1q_u16(row + x, vminq_u16(vcombine_u16(l, h), max));
+    }
+    if (x < width)
+        kMtkRawScalar.levels(row + x, width - x, black, gain);
+}
+
+static void bilinearNeon(const uint16_t *a, const uint16_t *c, const uint16_t *b,
+        uint16_t *same, uint16_t *green, uint16_t *other, int width, int phase)
+{
+    const uint16x8_t m = vld1q_u16(kPhaseLanes[phase]);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t cc = vld1q_u16(c + x);
+        uint16x8_t h = vrhaddq_u16(vld1q_u16(c + x - 1), vld1q_u16(c + x + 1));
+        uint16x8_t v = vrhaddq_u16(vld1q_u16(a + x), vld1q_u16(b + x));
+        uint16x8_t diag = vrhaddq_u16(vrhaddq_u16(vld1q_u16(a + x - 1), vld1q_u16(a + x + 1)),
+                vrhaddq_u16(vld1q_u16(b + x - 1), vld1q_u16(b + x + 1)));
+
+        vst1q_u16(same + x, vbslq_u16(m, cc, h));
+        vst1q_u16(green + x, vbslq_u16(m, vrhaddq_u16(h, v), cc));
+        vst1q_u16(other + x, vbslq_u16(m, diag, v));
+    }
+    if (x < width) {
+        kMtkRawScalar.bilinear(a + x, c + x, b + x, same + x, green + x, other + x,
+                width - x, phase);
+    }
+}
+
+static void greenNeon(const uint16_t *a, const uint16_t *c, const uint16_t *b,
+        uint16_t *green, int width, int phase)
+{
+    const uint16x8_t m = vld1q_u16(kPhaseLanes[phase]);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t l = vld1q_u16(c + x - 1), r = vld1q_u16(c + x + 1);
+        uint16x8_t u = vld1q_u16(a + x), d = vld1q_u16(b + x);
+        uint16x8_t h = vrhaddq_u16(l, r), v = vrhaddq_u16(u, d);
+        uint16x8_t gh = vabdq_u16(l, r), gv = vabdq_u16(u, d);
+        uint16x8_t dir = vbslq_u16(vcltq_u16(gh, gv), h,
+                vbslq_u16(vcgtq_u16(gh, gv), v, vrhaddq_u16(h, v)));
+
+        vst1q_u16(green + x, vbslq_u16(m, dir, vld1q_u16(c + x)));
+    }
+    if (x < width)
+        kMtkRawScalar.green(a + x, c + x, b + x, green + x, width - x, phase);
+}
+
+static inline uint16x8_t clampLevel(int16x8_t v)
+{
+    return vreinterpretq_u16_s16(vmaxq_s16(vminq_s16(v, vdupq_n_s16(1023)), vdupq_n_s16(0)));
+}
+
+static void chromaNeon(const uint16_t *const cfa[3], const uint16_t *const green[3],
+        uint16_t *same, uint16_t *other, int width, int phase)
+{
+    const uint16x8_t m = vld1q_u16(kPhaseLanes[phase]);
+    int x = 0;
+
+#define DIFF(row, dx) vreinterpretq_s16_u16(vsubq_u16(vld1q_u16(cfa[row] + x + (dx)), \
+        vld1q_u16(green[row] + x + (dx))))
+    for (; x + 8 <= width; x += 8) {
+        int16x8_t g = vreinterpretq_s16_u16(vld1q_u16(green[1] + x));
+        int16x8_t diag = vaddq_s16(vaddq_s16(DIFF(0, -1), DIFF(0, 1)),
+                vaddq_s16(DIFF(2, -1), DIFF(2, 1)));
+        int16x8_t h = vrshrq_n_s16(vaddq_s16(DIFF(1, -1), DIFF(1, 1)), 1);
+        int16x8_t v = vrshrq_n_s16(vaddq_s16(DIFF(0, 0), DIFF(2, 0)), 1);
+        uint16x8_t o = vbslq_u16(m, vreinterpretq_u16_s16(vrshrq_n_s16(diag, 2)),
+                vreinterpretq_u16_s16(v));
+
+        vst1q_u16(same + x, vbslq_u16(m, vld1q_u16(cfa[1] + x), clampLevel(vaddq_s16(g, h))));
+        vst1q_u16(other + x, clampLevel(vaddq_s16(g, vreinterpretq_s16_u16(o))));
+    }
+#undef DIFF
+    if (x < width) {
+        const uint16_t *const c[3] = { cfa[0] + x, cfa[1] + x, cfa[2] + x };
+        const uint16_t *const gr[3] = { green[0] + x, green[1] + x, green[2] + x };
+        kMtkRawScalar.chroma(c, gr, same + x, other + x, width - x, phase);
+    }
+}
+
+static void toRgbaNeon(const uint16_t *r, const uint16_t *g, const uint16_t *b,
+        uint8_t *rgba, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t out;
+        out.val[0] = vshrn_n_u16(vld1q_u16(r + x), 2);
+        out.val[1] = vshrn_n_u16(vld1q_u16(g + x), 2);
+        out.val[2] = vshrn_n_u16(vld1q_u16(b + x), 2);
+        out.val[3] = vdup_n_u8(255);
+        vst4_u8(rgba + 4 * x, out);
+    }
+    if (x < width)
+        kMtkRawScalar.toRgba(r + x, g + x, b + x, rgba + 4 * x, width - x);
+}
+
+static inline uint8x8_t luma(uint16x8_t r, uint16x8_t g, uint16x8_t b)
+{
+    uint16x8_t y = vmlaq_n_u16(vmlaq_n_u16(vmulq_n_u16(r, 66), g, 129), b, 25);
+    return vmovn_u16(vaddq_u16(vrshrq_n_u16(y, 8), vdupq_n_u16(16)));
+}
+
+// Rounded means of the 2x2 blocks of sixteen columns
+static inline int16x8_t blockMean(const uint16_t *const p[2], int x)
+{
+    uint32x4_t l = vaddq_u32(vpaddlq_u16(vshrq_n_u16(vld1q_u16(p[0] + x), 2)),
+            vpaddlq_u16(vshrq_n_u16(vld1q_u16(p[1] + x), 2)));
+    uint32x4_t h = vaddq_u32(vpaddlq_u16(vshrq_n_u16(vld1q_u16(p[0] + x + 8), 2)),
+            vpaddlq_u16(vshrq_n_u16(vld1q_u16(p[1] + x + 8), 2)));
+    return vreinterpretq_s16_u16(vcombine_u16(vmovn_u32(vrshrq_n_u32(l, 2)),
+            vmovn_u32(vrshrq_n_u32(h, 2))));
+}
+
+static inline uint8x8_t chromaOf(int16x8_t r, int16x8_t g, int16x8_t b, int cr, int cg, int cb)
+{
+    int16x8_t c = vmlaq_n_s16(vmlaq_n_s16(vmulq_n_s16(r, cr), g, cg), b, cb);
+    c = vaddq_s16(vrshrq_n_s16(c, 8), vdupq_n_s16(128));
+    return vmovn_u16(vreinterpretq_u16_s16(c));
+}
+
+static void toNv21Neon(const uint16_t *const r[2], const uint16_t *const g[2],
+        const uint16_t *const b[2], uint8_t *y0, uint8_t *y1, uint8_t *vu, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        for (int i = 0; i < 16; i += 8) {
+            for (int row = 0; row < 2; row++) {
+                uint8x8_t l = luma(vshrq_n_u16(vld1q_u16(r[row] + x + i), 2),
+                        vshrq_n_u16(vld1q_u16(g[row] + x + i), 2),
+                        vshrq_n_u16(vld1q_u16(b[row] + x + i), 2));
+                vst1_u8((row ? y1 : y0) + x + i, l);
+            }
+        }
+
+        int16x8_t rm = blockMean(r, x), gm = blockMean(g, x), bm = blockMean(b, x);
+        uint8x8x2_t out;
+        out.val[0] = chromaOf(rm, gm, bm, 112, -94, -18);
+        out.val[1] = chromaOf(rm, gm, bm, -38, -74, 112);
+        vst2_u8(vu + x, out);
+    }
+    if (x < width) {
+        const uint16_t *const rr[2] = { r[0] + x, r[1] + x };
+        const uint16_t *const gg[2] = { g[0] + x, g[1] + x };
+        const uint16_t *const bb[2] = { b[0] + x, b[1] + x };
+        kMtkRawScalar.toNv21(rr, gg, bb, y0 + x, y1 + x, vu + x, width - x);
+    }
+}
+
+const MtkRawKernels kMtkRawNeon = {
+    unpack10Neon,
+    levelsNeon,
+    bilinearNeon,
+    greenNeon,
+    chromaNeon,
+    toRgbaNeon,
+    toNv21Neon,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_NEON
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkPixelKernels.h"
+#include "MtkRawProcessor.h"
+
+namespace android {
+
+/*
+ * A tile plus two samples of apron on each side is what the edge aware
+ * demosaic reads, 512 columns keep a worker's buffers in L2.
+ */
+#define TILE_WIDTH      512
+#define TILE_HEIGHT     32
+#define APRON           2
+#define MAX_LEVEL       1023
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Scalar reference
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static void unpack10(const uint8_t *src, uint16_t *dst, int width)
+{
+    for (int x = 0; x < width; x += 4, src += 5, dst += 4) {
+        for (int i = 0; i < 4; i++)
+            dst[i] = src[i] << 2 | ((src[4] >> (2 * i)) & 3);
+    }
+}
+
+static void levels(uint16_t *row, int width, const uint16_t black[2], const uint16_t gain[2])
+{
+    for (int x = 0; x < width; x++) {
+        uint32_t v = row[x] > black[x & 1] ? row[x] - black[x & 1] : 0;
+        v = ((v << 6) * gain[x & 1]) >> 16;
+        row[x] = v < MAX_LEVEL ? v : MAX_LEVEL;
+    }
+}
+
+static void bilinear(const uint16_t *a, const uint16_t *c, const uint16_t *b,
+        uint16_t *same, uint16_t *green, uint16_t *other, int width, int phase)
+{
+    for (int x = 0; x < width; x++) {
+        uint16_t h = avg(c[x - 1], c[x + 1]);
+        uint16_t v = avg(a[x], b[x]);
+
+        if ((x & 1) == phase) {
+            same[x] = c[x];
+            green[x] = avg(h, v);
+            other[x] = avg(avg(a[x - 1], a[x + 1]), avg(b[x - 1], b[x + 1]));
+        } else {
+            same[x] = h;
+            green[x] = c[x];
+            other[x] = v;
+        }
+    }
+}
+
+static void green(const uint16_t *a, const uint16_t *c, const uint16_t *b,
+        uint16_t *green, int width, int phase)
+{
+    for (int x = 0; x < width; x++) {
+        if ((x & 1) != phase) {
+            green[x] = c[x];
+            continue;
+        }
+
+        uint16_t h = avg(c[x - 1], c[x + 1]);
+        uint16_t v = avg(a[x], b[x]);
+        int gh = abs(c[x - 1] - c[x + 1]);
+        int gv = abs(a[x] - b[x]);
+        green[x] = gh < gv ? h : gv < gh ? v : avg(h, v);
+    }
+}
+
+static inline uint16_t clampLevel(int v)
+{
+    return v < 0 ? 0 : v > MAX_LEVEL ? MAX_LEVEL : v;
+}
+
+static void chroma(const uint16_t *const cfa[3], const uint16_t *const green[3],
+        uint16_t *same, uint16_t *other, int width, int phase)
+{
+    for (int x = 0; x < width; x++) {
+        int g = green[1][x];
+
+        if ((x & 1) == phase) {
+            int d = cfa[0][x - 1] - green[0][x - 1] + cfa[0][x + 1] - green[0][x + 1] +
+                    cfa[2][x - 1] - green[2][x - 1] + cfa[2][x + 1] - green[2][x + 1];
+            same[x] = cfa[1][x];
+            other[x] = clampLevel(g + ((d + 2) >> 2));
+        } else {
+            int h = cfa[1][x - 1] - green[1][x - 1] + cfa[1][x + 1] - green[1][x + 1];
+            int v = cfa[0][x] - green[0][x] + cfa[2][x] - green[2][x];
+            same[x] = clampLevel(g + ((h + 1) >> 1));
+            other[x] = clampLevel(g + ((v + 1) >> 1));
+        }
+    }
+}
+
+static void toRgba(const uint16_t *r, const uint16_t *g, const uint16_t *b,
+        uint8_t *rgba, int width)
+{
+    for (int x = 0; x < width; x++, rgba += 4) {
+        rgba[0] = r[x] >> 2;
+        rgba[1] = g[x] >> 2;
+        rgba[2] = b[x] >> 2;
+        rgba[3] = 255;
+    }
+}
+
+// BT.601 video range, 8 bit fixed point
+static inline uint8_t lumaOf(int r, int g, int b)
+{
+    return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+static void toNv21(const uint16_t *const r[2], const uint16_t *const g[2],
+        const uint16_t *const b[2], uint8_t *y0, uint8_t *y1, uint8_t *vu, int width)
+{
+    for (int x = 0; x < width; x += 2) {
+        int rs = 0, gs = 0, bs = 0;
+
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 2; j++) {
+                int rr = r[i][x + j] >> 2, gg = g[i][x + j] >> 2, bb = b[i][x + j] >> 2;
+                (i ? y1 : y0)[x + j] = lumaOf(rr, gg, bb);
+                rs += rr;
+                gs += gg;
+                bs += bb;
+            }
+        }
+        rs = (rs + 2) >> 2;
+        gs = (gs + 2) >> 2;
+        bs = (bs + 2) >> 2;
+        vu[x] = ((112 * rs - 94 * gs - 18 * bs + 128) >> 8) + 128;
+        vu[x + 1] = ((-38 * rs - 74 * gs + 112 * bs + 128) >> 8) + 128;
+    }
+}
+
+const MtkRawKernels kMtkRawScalar = {
+    unpack10,
+    levels,
+    bilinear,
+    green,
+    chroma,
+    toRgba,
+    toNv21,
+};
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Tiles
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Row and column strides of the scratch, padded for the apron and vector tails
+#define SCRATCH_STRIDE  (TILE_WIDTH + 2 * APRON + 32)
+#define CFA_ROWS        (TILE_HEIGHT + 2 * APRON)
+#define GREEN_ROWS      (TILE_HEIGHT + 2)
+
+struct Scratch {
+    uint16_t line[SCRATCH_STRIDE + 8];
+    uint16_t cfa[CFA_ROWS][SCRATCH_STRIDE];
+    uint16_t green[GREEN_ROWS][SCRATCH_STRIDE];
+    uint16_t planes[2][3][SCRATCH_STRIDE];     // same, green, other for two rows
+};
+
+struct Job {
+    const MtkRawKernels *k;
+    const MtkImage *raw;
+    MtkImage *dst;
+    const MtkRawSettings *settings;
+    Scratch *scratch;
+    int tilesX;
+    int redX, redY;
+    // Per row parity: black and gain for even and odd columns
+    uint16_t black[2][2];
+    uint16_t gain[2][2];
+};
+
+// Samples [x0 - APRON, x1 + APRON) of row y, leveled, into out[0 ...]
+static void loadRow(const Job &job, Scratch *s, int y, int x0, int x1, uint16_t *out)
+{
+    const MtkImage &raw = *job.raw;
+    int w = raw.width;
+    int sy = reflect(y, raw.height);
+    int ux0 = x0 - 4 < 0 ? 0 : x0 - 4;
+    int ux1 = x1 + 4 > w ? w : x1 + 4;
+    const uint8_t *src = raw.planes[0] + raw.strides[0] * sy;
+
+    if (raw.format == MTK_PIXEL_FORMAT_BAYER10) {
+        job.k->unpack10(src + ux0 / 4 * 5, s->line, ux1 - ux0);
+    } else {
+        for (int x = ux0; x < ux1; x++)
+            s->line[x - ux0] = src[x] << 2;
+    }
+    job.k->levels(s->line, ux1 - ux0, job.black[sy & 1], job.gain[sy & 1]);
+
+    int first = x0 - APRON, last = x1 + APRON;
+    if (first >= 0 && last <= w) {
+        memcpy(out, s->line + first - ux0, (last - first) * sizeof(uint16_t));
+        return;
+    }
+    for (int x = first; x < last; x++)
+        out[x - first] = s->line[reflect(x, w) - ux0];
+}
+
+static void processTile(void *arg, int index, int worker)
+{
+    const Job &job = *(const Job *)arg;
+    const MtkRawKernels *k = job.k;
+    Scratch *s = &job.scratch[worker];
+    MtkImage *dst = job.dst;
+    int x0 = (index % job.tilesX) * TILE_WIDTH;
+    int y0 = (index / job.tilesX) * TILE_HEIGHT;
+    int x1 = x0 + TILE_WIDTH < dst->width ? x0 + TILE_WIDTH : dst->width;
+    int y1 = y0 + TILE_HEIGHT < dst->height ? y0 + TILE_HEIGHT : dst->height;
+    int n = x1 - x0;
+    bool edgeAware = job.settings->demosaic == MTK_DEMOSAIC_EDGE_AWARE;
+
+    // Index 0 is column x0, the apron sits at negative indices
+#define CFA(y)      (s->cfa[(y) - y0 + APRON] + APRON)
+#define GREEN(y)    (s->green[(y) - y0 + 1] + APRON)
+
+    for (int y = y0 - APRON; y < y1 + APRON; y++)
+        loadRow(job, s, y, x0, x1, CFA(y) - APRON);
+
+    if (edgeAware) {
+        for (int y = y0 - 1; y < y1 + 1; y++) {
+            int phase = (y + x0 + job.redX + job.redY) & 1;
+            k->green(CFA(y - 1) - 1, CFA(y) - 1, CFA(y + 1) - 1, GREEN(y) - 1, n + 2, phase ^ 1);
+        }
+    }
+
+    for (int y = y0; y < y1; y++) {
+        int phase = (y + x0 + job.redX + job.redY) & 1;
+        bool redRow = ((y ^ job.redY) & 1) == 0;
+        uint16_t *same = s->planes[y & 1][0];
+        uint16_t *green = s->planes[y & 1][1];
+        uint16_t *other = s->planes[y & 1][2];
+
+        if (edgeAware) {
+            const uint16_t *const cfa[3] = { CFA(y - 1), CFA(y), CFA(y + 1) };
+            const uint16_t *const greens[3] = { GREEN(y - 1), GREEN(y), GREEN(y + 1) };
+            k->chroma(cfa, greens, same, other, n, phase);
+            memcpy(green, GREEN(y), n * sizeof(uint16_t));
+        } else {
+            k->bilinear(CFA(y - 1), CFA(y), CFA(y + 1), same, green, other, n, phase);
+        }
+
+        const uint16_t *r = redRow ? same : other;
+        const uint16_t *b = redRow ? other : same;
+        if (dst->format == MTK_PIXEL_FORMAT_RGBA) {
+            k->toRgba(r, green, b, dst->planes[0] + dst->strides[0] * y + x0 * 4, n);
+        } else if (y & 1) {
+            bool prevRed = !redRow;
+            const uint16_t *p = s->planes[0][0], *q = s->planes[0][2];
+            const uint16_t *const rs[2] = { prevRed ? p : q, r };
+            const uint16_t *const gs[2] = { s->planes[0][1], green };
+            const uint16_t *const bs[2] = { prevRed ? q : p, b };
+            k->toNv21(rs, gs, bs,
+                    dst->planes[0] + dst->strides[0] * (y - 1) + x0,
+                    dst->planes[0] + dst->strides[0] * y + x0,
+                    dst->planes[1] + dst->strides[1] * (y / 2) + x0, n);
+        }
+    }
+#undef CFA
+#undef GREEN
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Frame
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+void mtkRawDefaultSettings(MtkRawSettings *settings)
+{
+    memset(settings, 0, sizeof(*settings));
+    settings->pattern = MTK_BAYER_RGGB;
+    settings->demosaic = MTK_DEMOSAIC_EDGE_AWARE;
+    settings->whiteLevel = MAX_LEVEL;
+    settings->gains[0] = settings->gains[1] = settings->gains[2] = 1.0f;
+}
+
+// Q10 gain that also stretches [black, white] back to the full range
+static uint16_t levelGain(float gain, int black, int white)
+{
+    float q = gain * 1024.0f * MAX_LEVEL / (white - black) + 0.5f;
+
+    if (q < 0)
+        return 0;
+    return q > 65535 ? 65535 : (uint16_t)q;
+}
+
+status_t mtkRawProcess(const MtkImage &raw, MtkImage *dst, const MtkRawSettings &settings,
+        MtkThreadPool *pool, MtkPixelIsa isa)
+{
+    const MtkRawKernels *k = mtkPixelPick(isa, &kMtkRawScalar, MTK_PIXEL_NEON(kMtkRawNeon),
+            MTK_PIXEL_X86(kMtkRawSse2), MTK_PIXEL_X86(kMtkRawAvx2));
+    Job job;
+
+    if (k == NULL) {
+        ALOGE("No %s kernels on this CPU", mtkPixelIsaName(isa));
+        return INVALID_OPERATION;
+    }
+    if ((raw.format != MTK_PIXEL_FORMAT_BAYER8 && raw.format != MTK_PIXEL_FORMAT_BAYER10) ||
+            (dst->format != MTK_PIXEL_FORMAT_RGBA && dst->format != MTK_PIXEL_FORMAT_NV21)) {
+        ALOGE("Cannot develop format %d into %d", raw.format, dst->format);
+        return INVALID_OPERATION;
+    }
+    if (raw.width != dst->width || raw.height != dst->height ||
+            raw.width < 4 || raw.height < 4 || ((raw.width | raw.height) & 1) ||
+            (raw.format == MTK_PIXEL_FORMAT_BAYER10 && (raw.width & 3))) {
+        ALOGE("Cannot develop %dx%d into %dx%d", raw.width, raw.height,
+                dst->width, dst->height);
+        return BAD_VALUE;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (settings.blackLevel[i] >= settings.whiteLevel || settings.whiteLevel > MAX_LEVEL)
+            return BAD_VALUE;
+    }
+
+    job.k = k;
+    job.raw = &raw;
+    job.dst = dst;
+    job.settings = &settings;
+    job.tilesX = (raw.width + TILE_WIDTH - 1) / TILE_WIDTH;
+    job.redX = settings.pattern == MTK_BAYER_GRBG || settings.pattern == MTK_BAYER_BGGR;
+    job.redY = settings.pattern == MTK_BAYER_GBRG || settings.pattern == MTK_BAYER_BGGR;
+
+    // Red rows hold R and Gr, blue rows Gb and B, with B one column off from R
+    for (int row = 0; row < 2; row++) {
+        bool redRow = (row ^ job.redY) == 0;
+        int col = redRow ? job.redX : job.redX ^ 1;
+        int color = redRow ? 0 : 3;
+        int greenColor = redRow ? 1 : 2;
+        int rgb = redRow ? 0 : 2;
+
+        job.black[row][col] = settings.blackLevel[color];
+        job.black[row][col ^ 1] = settings.blackLevel[greenColor];
+        job.gain[row][col] = levelGain(settings.gains[rgb],
+                settings.blackLevel[color], settings.whiteLevel);
+        job.gain[row][col ^ 1] = levelGain(settings.gains[1],
+                settings.blackLevel[greenColor], settings.whiteLevel);
+    }
+
+    int workers = pool != NULL ? pool->size() : 1;
+    job.scratch = (Scratch *)malloc(workers * sizeof(Scratch));
+    if (job.scratch == NULL)
+        return NO_MEMORY;
+
+    int tiles = job.tilesX * ((raw.height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+    if (pool != NULL) {
+        pool->run(tiles, processTile, &job);
+    } else {
+        for (int i = 0; i < tiles; i++)
+            processTile(&job, i, 0);
+    }
+
+    free(job.scratch);
+    return NO_ERROR;
+}
+
+}; // namespace android
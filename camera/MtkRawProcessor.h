@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_RAW_PROCESSOR_H
+#define ANDROID_HARDWARE_MTK_RAW_PROCESSOR_H
+
+#include "MtkImage.h"
+#include "MtkPixelConvert.h"
+#include "MtkThreadPool.h"
+
+namespace android {
+
+// Color of the top left 2x2 block, row by row
+enum MtkBayerPattern {
+    MTK_BAYER_RGGB,
+    MTK_BAYER_GRBG,
+    MTK_BAYER_GBRG,
+    MTK_BAYER_BGGR,
+};
+
+enum MtkDemosaic {
+    MTK_DEMOSAIC_BILINEAR,
+    MTK_DEMOSAIC_EDGE_AWARE,        // green along edges, red/blue by color difference
+};
+
+/**
+ * How to develop a raw frame, as dumped in raw save mode (KEY_RAW_SAVE_MODE).
+ * Levels are 10 bit, BAYER8 samples are scaled up to match.
+ */
+struct MtkRawSettings {
+    MtkBayerPattern pattern;
+    MtkDemosaic demosaic;
+    uint16_t blackLevel[4];         // R, Gr, Gb, B; Gr shares the row with R
+    uint16_t whiteLevel;
+    float gains[3];                 // white balance R, G, B
+};
+
+// No black level, full 10 bit range, unity gains, edge aware, RGGB
+void mtkRawDefaultSettings(MtkRawSettings *settings);
+
+/**
+ * Develops a BAYER8 or BAYER10 frame into an RGBA or NV21 one of the same
+ * size: black level and white balance, then demosaic. The frame is cut in
+ * tiles that the pool's threads share, without a pool it all runs on the
+ * calling thread. Output does not depend on the thread count.
+ */
+status_t mtkRawProcess(const MtkImage &raw, MtkImage *dst, const MtkRawSettings &settings,
+        MtkThreadPool *pool = NULL, MtkPixelIsa isa = MTK_PIXEL_ISA_BEST);
+
+}; // namespace android
+
+#endif
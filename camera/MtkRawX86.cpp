@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_X86
+
+#include <immintrin.h>
+
+namespace android {
+
+#define AVX2 __attribute__((target("avx2")))
+
+/*
+ * Samples are at most 10 bit, so signed 16 bit compares, min and max
+ * work on them; the only unsigned ones needed are averages and
+ * saturating subtraction, which SSE2 has.
+ */
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  SSE2
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static inline __m128i load(const uint16_t *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void store(uint16_t *p, __m128i v)
+{
+    _mm_storeu_si128((__m128i *)p, v);
+}
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Lanes of the columns with parity phase, vectors start on even columns
+static inline __m128i phaseMask(int phase)
+{
+    return phase ? _mm_set1_epi32(0xffff0000) : _mm_set1_epi32(0x0000ffff);
+}
+
+static inline __m128i pair(const uint16_t v[2])
+{
+    return _mm_set1_epi32(v[0] | v[1] << 16);
+}
+
+static void levelsSse2(uint16_t *row, int width, const uint16_t black[2], const uint16_t gain[2])
+{
+    const __m128i b = pair(black), g = pair(gain), max = _mm_set1_epi16(1023);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_subs_epu16(load(row + x), b);
+        v = _mm_mulhi_epu16(_mm_slli_epi16(v, 6), g);
+        store(row + x, _mm_sub_epi16(v, _mm_subs_epu16(v, max)));
+    }
+    if (x < width)
+        kMtkRawScalar.levels(row + x, width - x, black, gain);
+}
+
+static void bilinearSse2(const uint16_t *a, const uint16_t *c, const uint16_t *b,
+        uint16_t *same, uint16_t *green, uint16_t *other, int width, int phase)
+{
+    const __m128i m = phaseMask(phase);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i cc = load(c + x), h = _mm_avg_epu16(load(c + x - 1), load(c + x + 1));
+        __m128i v = _mm_avg_epu16(load(a + x), load(b + x));
+        __m128i diag = _mm_avg_epu16(_mm_avg_epu16(load(a + x - 1), load(a + x + 1)),
+                _mm_avg_epu16(load(b + x - 1), load(b + x + 1)));
+
+        store(same + x, select(m, cc, h));
+        store(green + x, select(m, _mm_avg_epu16(h, v), cc));
+        store(other + x, select(m, diag, v));
+    }
+    if (x < width) {
+        kMtkRawScalar.bilinear(a + x, c + x, b + x, same + x, green + x, other + x,
+                width - x, phase ^ (x & 1));
+    }
+}
+
+static inline __m128i absDiff(__m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a));
+}
+
+static void greenSse2(const uint16_t *a, const uint16_t *c, const uint16_t *b,
+        uint16_t *green, int width, int phase)
+{
+    const __m128i m = phaseMask(phase);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i l = load(c + x - 1), r = load(c + x + 1);
+        __m128i u = load(a + x), d = load(b + x);
+        __m128i h = _mm_avg_epu16(l, r), v = _mm_avg_epu16(u, d);
+        __m128i gh = absDiff(l, r), gv = absDiff(u, d);
+        __m128i dir = select(_mm_cmplt_epi16(gh, gv), h,
+                select(_mm_cmpgt_epi16(gh, gv), v, _mm_avg_epu16(h, v)));
+
+        store(green + x, select(m, dir, load(c + x)));
+    }
+    if (x < width)
+        kMtkRawScalar.green(a + x, c + x, b + x, green + x, width - x, phase ^ (x & 1));
+}
+
+static inline __m128i clampLevel(__m128i v)
+{
+    return _mm_max_epi16(_mm_min_epi16(v, _mm_set1_epi16(1023)), _mm_setzero_si128());
+}
+
+static void chromaSse2(const uint16_t *const cfa[3], const uint16_t *const green[3],
+        uint16_t *same, uint16_t *other, int width, int phase)
+{
+    const __m128i m = phaseMask(phase);
+    const __m128i one = _mm_set1_epi16(1), two = _mm_set1_epi16(2);
+    int x = 0;
+
+#define DIFF(row, dx) _mm_sub_epi16(load(cfa[row] + x + (dx)), load(green[row] + x + (dx)))
+    for (; x + 8 <= width; x += 8) {
+        __m128i g = load(green[1] + x);
+        __m128i diag = _mm_add_epi16(_mm_add_epi16(DIFF(0, -1), DIFF(0, 1)),
+                _mm_add_epi16(DIFF(2, -1), DIFF(2, 1)));
+        __m128i h = _mm_add_epi16(DIFF(1, -1), DIFF(1, 1));
+        __m128i v = _mm_add_epi16(DIFF(0, 0), DIFF(2, 0));
+
+        diag = _mm_srai_epi16(_mm_add_epi16(diag, two), 2);
+        h = _mm_srai_epi16(_mm_add_epi16(h, one), 1);
+        v = _mm_srai_epi16(_mm_add_epi16(v, one), 1);
+
+        store(same + x, clampLevel(select(m, load(cfa[1] + x), _mm_add_epi16(g, h))));
+        store(other + x, clampLevel(_mm_add_epi16(g, select(m, diag, v))));
+    }
+#undef DIFF
+    if (x < width) {
+        const uint16_t *const c[3] = { cfa[0] + x, cfa[1] + x, cfa[2] + x };
+        const uint16_t *const gr[3] = { green[0] + x, green[1] + x, green[2] + x };
+        kMtkRawScalar.chroma(c, gr, same + x, other + x, width - x, phase ^ (x & 1));
+    }
+}
+
+static void toRgbaSse2(const uint16_t *r, const uint16_t *g, const uint16_t *b,
+        uint8_t *rgba, int width)
+{
+    const __m128i alpha = _mm_set1_epi16(255);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i rb = _mm_packus_epi16(_mm_srli_epi16(load(r + x), 2), _mm_srli_epi16(load(b + x), 2));
+        __m128i ga = _mm_packus_epi16(_mm_srli_epi16(load(g + x), 2), alpha);
+        __m128i rg = _mm_unpacklo_epi8(rb, ga);
+        __m128i ba = _mm_unpackhi_epi8(rb, ga);
+        _mm_storeu_si128((__m128i *)(rgba + 4 * x), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i *)(rgba + 4 * x + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+    if (x < width)
+        kMtkRawScalar.toRgba(r + x, g + x, b + x, rgba + 4 * x, width - x);
+}
+
+static inline __m128i luma(__m128i r, __m128i g, __m128i b)
+{
+    // Up to 56228, fits unsigned 16 bit
+    __m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+            _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+    y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+    y = _mm_add_epi16(y, _mm_set1_epi16(128));
+    return _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+}
+
+// Rounded mean of each 2x2 block, in the low four 16 bit lanes
+static inline __m128i blockMean(__m128i top, __m128i bottom)
+{
+    __m128i s = _mm_add_epi32(_mm_madd_epi16(top, _mm_set1_epi16(1)),
+            _mm_madd_epi16(bottom, _mm_set1_epi16(1)));
+    s = _mm_srai_epi32(_mm_add_epi32(s, _mm_set1_epi32(2)), 2);
+    return _mm_packs_epi32(s, s);
+}
+
+static inline __m128i chromaOf(__m128i r, __m128i g, __m128i b, int cr, int cg, int cb)
+{
+    __m128i c = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)),
+            _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+    c = _mm_add_epi16(c, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+    c = _mm_srai_epi16(_mm_add_epi16(c, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(c, _mm_set1_epi16(128));
+}
+
+static void toNv21Sse2(const uint16_t *const r[2], const uint16_t *const g[2],
+        const uint16_t *const b[2], uint8_t *y0, uint8_t *y1, uint8_t *vu, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i r0 = _mm_srli_epi16(load(r[0] + x), 2), r1 = _mm_srli_epi16(load(r[1] + x), 2);
+        __m128i g0 = _mm_srli_epi16(load(g[0] + x), 2), g1 = _mm_srli_epi16(load(g[1] + x), 2);
+        __m128i b0 = _mm_srli_epi16(load(b[0] + x), 2), b1 = _mm_srli_epi16(load(b[1] + x), 2);
+
+        __m128i l0 = luma(r0, g0, b0), l1 = luma(r1, g1, b1);
+        _mm_storel_epi64((__m128i *)(y0 + x), _mm_packus_epi16(l0, l0));
+        _mm_storel_epi64((__m128i *)(y1 + x), _mm_packus_epi16(l1, l1));
+
+        __m128i rm = blockMean(r0, r1), gm = blockMean(g0, g1), bm = blockMean(b0, b1);
+        __m128i v = chromaOf(rm, gm, bm, 112, -94, -18);
+        __m128i u = chromaOf(rm, gm, bm, -38, -74, 112);
+        _mm_storel_epi64((__m128i *)(vu + x), _mm_or_si128(v, _mm_slli_epi16(u, 8)));
+    }
+    if (x < width) {
+        const uint16_t *const rr[2] = { r[0] + x, r[1] + x };
+        const uint16_t *const gg[2] = { g[0] + x, g[1] + x };
+        const uint16_t *const bb[2] = { b[0] + x, b[1] + x };
+        kMtkRawScalar.toNv21(rr, gg, bb, y0 + x, y1 + x, vu + x, width - x);
+    }
+}
+
+// No byte shuffle before SSSE3, unpacking stays scalar
+static void unpack10Sse2(const uint8_t *src, uint16_t *dst, int width)
+{
+    kMtkRawScalar.unpack10(src, dst, width);
+}
+
+const MtkRawKernels kMtkRawSse2 = {
+    unpack10Sse2,
+    levelsSse2,
+    bilinearSse2,
+    greenSse2,
+    chromaSse2,
+    toRgbaSse2,
+    toNv21Sse2,
+};
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  AVX2, the output kernels cross lanes and stay on SSE2
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static inline AVX2 __m256i load8(const uint16_t *p)
+{
+    return _mm256_loadu_si256((const __m256i *)p);
+}
+
+static inline AVX2 void store8(uint16_t *p, __m256i v)
+{
+    _mm256_storeu_si256((__m256i *)p, v);
+}
+
+static inline AVX2 __m256i phaseMask8(int phase)
+{
+    return phase ? _mm256_set1_epi32(0xffff0000) : _mm256_set1_epi32(0x0000ffff);
+}
+
+static inline AVX2 __m256i select8(__m256i mask, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+/*
+ * Two groups of eight samples, ten bytes each, one per lane. Every 16 bit
+ * lane gets its high byte above the byte with the low bits, which are
+ * then moved into place by multiplying up and shifting down.
+ */
+static AVX2 void unpack10Avx2(const uint8_t *src, uint16_t *dst, int width)
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+            4, 0, 4, 1, 4, 2, 4, 3, 9, 5, 9, 6, 9, 7, 9, 8,
+            4, 0, 4, 1, 4, 2, 4, 3, 9, 5, 9, 6, 9, 7, 9, 8);
+    const __m256i scale = _mm256_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1,
+            64, 16, 4, 1, 64, 16, 4, 1);
+    const __m256i low = _mm256_set1_epi16(0xff);
+    int bytes = width / 4 * 5;
+    int x = 0;
+
+    // Each load reads 16 bytes for the 10 it uses
+    for (; x / 4 * 5 + 26 <= bytes; x += 16) {
+        const uint8_t *p = src + x / 4 * 5;
+        __m256i t = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p)),
+                _mm_loadu_si128((const __m128i *)(p + 10)), 1);
+        t = _mm256_shuffle_epi8(t, shuffle);
+
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(t, 6), _mm256_set1_epi16(0x3fc));
+        __m256i lo = _mm256_mullo_epi16(_mm256_and_si256(t, low), scale);
+        lo = _mm256_and_si256(_mm256_srli_epi16(lo, 6), _mm256_set1_epi16(3));
+        store8(dst + x, _mm256_or_si256(hi, lo));
+    }
+    if (x < width)
+        kMtkRawScalar.unpack10(src + x / 4 * 5, dst + x, width - x);
+}
+
+static AVX2 void levelsAvx2(uint16_t *row, int width, const uint16_t black[2], const uint16_t gain[2])
+{
+    const __m256i b = _mm256_set1_epi32(black[0] | black[1] << 16);
+    const __m256i g = _mm256_set1_epi32(gain[0] | gain[1] << 16);
+    const __m256i max = _mm256_set1_epi16(1023);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm256_subs_epu16(load8(row + x), b);
+        v = _mm256_mulhi_epu16(_mm256_slli_epi16(v, 6), g);
+        store8(row + x, _mm256_min_epu16(v, max));
+    }
+    if (x < width)
+        levelsSse2(row + x, width - x, black, gain);
+}
+
+static AVX2 void bilinearAvx2(const uint16_t *a, const uint16_t *c, const uint16_t *b,
+        uint16_t *same, uint16_t *green, uint16_t *other, int width, int phase)
+{
+    const __m256i m = phaseMask8(phase);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m256i cc = load8(c + x), h = _mm256_avg_epu16(load8(c + x - 1), load8(c + x + 1));
+        __m256i v = _mm256_avg_epu16(load8(a + x), load8(b + x));
+        __m256i diag = _mm256_avg_epu16(_mm256_avg_epu16(load8(a + x - 1), load8(a + x + 1)),
+                _mm256_avg_epu16(load8(b + x - 1), load8(b + x + 1)));
+
+        store8(same + x, select8(m, cc, h));
+        store8(green + x, select8(m, _mm256_avg_epu16(h, v), cc));
+        store8(other + x, select8(m, diag, v));
+    }
+    if (x < width)
+        bilinearSse2(a + x, c + x, b + x, same + x, green + x, other + x, width - x, phase);
+}
+
+static AVX2 void greenAvx2(const uint16_t *a, const uint16_t *c, const uint16_t *b,
+        uint16_t *green, int width, int phase)
+{
+    const __m256i m = phaseMask8(phase);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m256i l = load8(c + x - 1), r = load8(c + x + 1);
+        __m256i u = load8(a + x), d = load8(b + x);
+        __m256i h = _mm256_avg_epu16(l, r), v = _mm256_avg_epu16(u, d);
+        __m256i gh = _mm256_abs_epi16(_mm256_sub_epi16(l, r));
+        __m256i gv = _mm256_abs_epi16(_mm256_sub_epi16(u, d));
+        __m256i dir = select8(_mm256_cmpgt_epi16(gv, gh), h,
+                select8(_mm256_cmpgt_epi16(gh, gv), v, _mm256_avg_epu16(h, v)));
+
+        store8(green + x, select8(m, dir, load8(c + x)));
+    }
+    if (x < width)
+        greenSse2(a + x, c + x, b + x, green + x, width - x, phase);
+}
+
+static AVX2 void chromaAvx2(const uint16_t *const cfa[3], const uint16_t *const green[3],
+        uint16_t *same, uint16_t *other, int width, int phase)
+{
+    const __m256i m = phaseMask8(phase);
+    const __m256i one = _mm256_set1_epi16(1), two = _mm256_set1_epi16(2);
+    const __m256i max = _mm256_set1_epi16(1023), zero = _mm256_setzero_si256();
+    int x = 0;
+
+#define DIFF(row, dx) _mm256_sub_epi16(load8(cfa[row] + x + (dx)), load8(green[row] + x + (dx)))
+    for (; x + 16 <= width; x += 16) {
+        __m256i g = load8(green[1] + x);
+        __m256i diag = _mm256_add_epi16(_mm256_add_epi16(DIFF(0, -1), DIFF(0, 1)),
+                _mm256_add_epi16(DIFF(2, -1), DIFF(2, 1)));
+        __m256i h = _mm256_add_epi16(DIFF(1, -1), DIFF(1, 1));
+        __m256i v = _mm256_add_epi16(DIFF(0, 0), DIFF(2, 0));
+
+        diag = _mm256_srai_epi16(_mm256_add_epi16(diag, two), 2);
+        h = _mm256_srai_epi16(_mm256_add_epi16(h, one), 1);
+        v = _mm256_srai_epi16(_mm256_add_epi16(v, one), 1);
+
+        __m256i s = select8(m, load8(cfa[1] + x), _mm256_add_epi16(g, h));
+        __m256i o = _mm256_add_epi16(g, select8(m, diag, v));
+        store8(same + x, _mm256_max_epi16(_mm256_min_epi16(s, max), zero));
+        store8(other + x, _mm256_max_epi16(_mm256_min_epi16(o, max), zero));
+    }
+#undef DIFF
+    if (x < width) {
+        const uint16_t *const c[3] = { cfa[0] + x, cfa[1] + x, cfa[2] + x };
+        const uint16_t *const gr[3] = { green[0] + x, green[1] + x, green[2] + x };
+        chromaSse2(c, gr, same + x, other + x, width - x, phase);
+    }
+}
+
+const MtkRawKernels kMtkRawAvx2 = {
+    unpack10Avx2,
+    levelsAvx2,
+    bilinearAvx2,
+    greenAvx2,
+    chromaAvx2,
+    toRgbaSse2,
+    toNv21Sse2,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_X86
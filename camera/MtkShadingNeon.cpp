@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_NEON
+
+#include <arm_neon.h>
+
+namespace android {
+
+// Full products, then the scalar ">> 10" as a narrowing shift
+static inline uint16x8_t gained(uint16x8_t v, const uint16_t *gain)
+{
+    uint16x8_t g = vld1q_u16(gain);
+    uint32x4_t lo = vmull_u16(vget_low_u16(v), vget_low_u16(g));
+    uint32x4_t hi = vmull_u16(vget_high_u16(v), vget_high_u16(g));
+
+    return vcombine_u16(vshrn_n_u32(lo, 10), vshrn_n_u32(hi, 10));
+}
+
+static void gain8Neon(uint8_t *row, const uint16_t *gain, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t v = vld1q_u8(row + x);
+        vst1q_u8(row + x, vcombine_u8(vqmovn_u16(gained(vmovl_u8(vget_low_u8(v)), gain + x)),
+                vqmovn_u16(gained(vmovl_u8(vget_high_u8(v)), gain + x + 8))));
+    }
+    if (x < width)
+        kMtkShadingScalar.gain8(row + x, gain + x, width - x);
+}
+
+static void gain10Neon(uint16_t *row, const uint16_t *gain, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+        vst1q_u16(row + x, vminq_u16(gained(vld1q_u16(row + x), gain + x), vdupq_n_u16(1023)));
+    if (x < width)
+        kMtkShadingScalar.gain10(row + x, gain + x, width - x);
+}
+
+const MtkShadingKernels kMtkShadingNeon = {
+    gain8Neon,
+    gain10Neon,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_NEON
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MtkPixelKernels.h"
+
+#ifdef MTK_PIXEL_HAVE_X86
+
+#include <emmintrin.h>
+
+namespace android {
+
+/*
+ * pmulhuw of the sample shifted up by 6 and the Q10 gain is the scalar
+ * ((s << 6) * g) >> 16, both for 8 and 10 bit samples.
+ */
+static inline __m128i load(const void *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline void store(void *p, __m128i v)
+{
+    _mm_storeu_si128((__m128i *)p, v);
+}
+
+static void gain8Sse2(uint8_t *row, const uint16_t *gain, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = load(row + x);
+        __m128i lo = _mm_mulhi_epu16(_mm_slli_epi16(_mm_unpacklo_epi8(v, zero), 6),
+                load(gain + x));
+        __m128i hi = _mm_mulhi_epu16(_mm_slli_epi16(_mm_unpackhi_epi8(v, zero), 6),
+                load(gain + x + 8));
+        store(row + x, _mm_packus_epi16(lo, hi));
+    }
+    if (x < width)
+        kMtkShadingScalar.gain8(row + x, gain + x, width - x);
+}
+
+static void gain10Sse2(uint16_t *row, const uint16_t *gain, int width)
+{
+    const __m128i max = _mm_set1_epi16(1023);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_mulhi_epu16(_mm_slli_epi16(load(row + x), 6), load(gain + x));
+        // Unsigned min, which SSE2 lacks
+        store(row + x, _mm_sub_epi16(v, _mm_subs_epu16(v, max)));
+    }
+    if (x < width)
+        kMtkShadingScalar.gain10(row + x, gain + x, width - x);
+}
+
+const MtkShadingKernels kMtkShadingSse2 = {
+    gain8Sse2,
+    gain10Sse2,
+};
+
+}; // namespace android
+
+#endif // MTK_PIXEL_HAVE_X86
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MtkImage"
+#include <utils/Log.h>
+
+#include <unistd.h>
+
+#include "MtkThreadPool.h"
+
+namespace android {
+
+struct Start {
+    MtkThreadPool *pool;
+    int worker;
+};
+
+MtkThreadPool::MtkThreadPool(int threads)
+    : mRound(0),
+      mBusy(0),
+      mExit(false),
+      mTask(NULL),
+      mArg(NULL),
+      mRanges(NULL)
+{
+    if (threads <= 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < threads; i++) {
+        Start *start = new Start;
+        pthread_t thread;
+
+        start->pool = this;
+        start->worker = i;
+        if (pthread_create(&thread, NULL, threadLoop, start) != 0) {
+            ALOGW("Running with %d of %d threads", i, threads);
+            delete start;
+            break;
+        }
+        mThreads.add(thread);
+    }
+    mRanges = new Range[mThreads.size() + 1];
+}
+
+MtkThreadPool::~MtkThreadPool()
+{
+    mLock.lock();
+    mExit = true;
+    mStart.broadcast();
+    mLock.unlock();
+
+    for (size_t i = 0; i < mThreads.size(); i++)
+        pthread_join(mThreads[i], NULL);
+    delete[] mRanges;
+}
+
+void *MtkThreadPool::threadLoop(void *arg)
+{
+    Start *start = (Start *)arg;
+    MtkThreadPool *pool = start->pool;
+    int worker = start->worker;
+    uint32_t round = 0;
+
+    delete start;
+    for (;;) {
+        pool->mLock.lock();
+        while (pool->mRound == round && !pool->mExit)
+            pool->mStart.wait(pool->mLock);
+        if (pool->mExit) {
+            pool->mLock.unlock();
+            return NULL;
+        }
+        round = pool->mRound;
+        pool->mLock.unlock();
+
+        pool->work(worker);
+
+        pool->mLock.lock();
+        if (--pool->mBusy == 0)
+            pool->mDone.signal();
+        pool->mLock.unlock();
+    }
+}
+
+static inline uint64_t range(uint32_t begin, uint32_t end)
+{
+    return (uint64_t)end << 32 | begin;
+}
+
+// Next index off the front of the worker's own run
+bool MtkThreadPool::take(int worker, int *index)
+{
+    std::atomic<uint64_t> &next = mRanges[worker].next;
+    uint64_t v = next.load(std::memory_order_acquire);
+
+    for (;;) {
+        uint32_t begin = (uint32_t)v, end = (uint32_t)(v >> 32);
+        if (begin >= end)
+            return false;
+        if (next.compare_exchange_weak(v, range(begin + 1, end), std::memory_order_acq_rel)) {
+            *index = begin;
+            return true;
+        }
+    }
+}
+
+/*
+ * Moves the back half of the longest run into the worker's own, which
+ * is empty: nobody else writes to it until it has indices again.
+ */
+bool MtkThreadPool::steal(int worker)
+{
+    int workers = size();
+
+    for (;;) {
+        int victim = -1;
+        uint64_t v = 0;
+        uint32_t longest = 0;
+
+        for (int i = 1; i < workers; i++) {
+            int w = (worker + i) % workers;
+            uint64_t r = mRanges[w].next.load(std::memory_order_acquire);
+            uint32_t begin = (uint32_t)r, end = (uint32_t)(r >> 32);
+            if (end > begin && end - begin > longest) {
+                longest = end - begin;
+                victim = w;
+                v = r;
+            }
+        }
+        if (victim < 0)
+            return false;
+
+        uint32_t begin = (uint32_t)v, end = (uint32_t)(v >> 32);
+        uint32_t split = end - (longest + 1) / 2;
+        if (mRanges[victim].next.compare_exchange_strong(v, range(begin, split),
+                std::memory_order_acq_rel)) {
+            mRanges[worker].next.store(range(split, end), std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+void MtkThreadPool::work(int worker)
+{
+    int index;
+
+    do {
+        while (take(worker, &index))
+            mTask(mArg, index, worker);
+    } while (steal(worker));
+}
+
+void MtkThreadPool::run(int count, Task task, void *arg)
+{
+    if (count <= 0)
+        return;
+    // Not worth waking anybody
+    if (count == 1 || mThreads.size() == 0) {
+        for (int i = 0; i < count; i++)
+            task(arg, i, 0);
+        return;
+    }
+
+    mLock.lock();
+    mTask = task;
+    mArg = arg;
+    int workers = size();
+    for (int i = 0; i < workers; i++) {
+        mRanges[i].next.store(range((int64_t)count * i / workers,
+                (int64_t)count * (i + 1) / workers), std::memory_order_relaxed);
+    }
+    mBusy = mThreads.size();
+    mRound++;
+    mStart.broadcast();
+    mLock.unlock();
+
+    work(0);
+
+    mLock.lock();
+    while (mBusy > 0)
+        mDone.wait(mLock);
+    mLock.unlock();
+}
+
+}; // namespace android
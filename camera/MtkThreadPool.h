@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_THREAD_POOL_H
+#define ANDROID_HARDWARE_MTK_THREAD_POOL_H
+
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
+#include <utils/Condition.h>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+/**
+ * Fixed set of worker threads for splitting a frame across cores, the
+ * calling thread works too. run() gives every worker its own run of
+ * consecutive indices, so neighbouring tiles stay on one core; a worker
+ * that runs out steals the back half of the longest run left, so faster
+ * cores end up with more. One run() at a time per pool.
+ */
+class MtkThreadPool {
+public:
+    typedef void (*Task)(void *arg, int index, int worker);
+
+    // 0 threads means one per online CPU
+    explicit MtkThreadPool(int threads = 0);
+    ~MtkThreadPool();
+
+    // Workers including the caller, worker indices are below this
+    int size() const { return mThreads.size() + 1; }
+
+    // Calls task(arg, index, worker) for every index below count, returns when all are done
+    void run(int count, Task task, void *arg);
+
+    // Same with f(index, worker)
+    template <typename F>
+    void run(int count, F f)
+    {
+        run(count, call<F>, &f);
+    }
+
+private:
+    MtkThreadPool(const MtkThreadPool&);
+    MtkThreadPool& operator=(const MtkThreadPool&);
+
+    template <typename F>
+    static void call(void *f, int index, int worker)
+    {
+        (*(F *)f)(index, worker);
+    }
+
+    // Indices [begin, end) still to take, begin in the low half
+    struct Range {
+        std::atomic<uint64_t> next;
+        char pad[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    static void *threadLoop(void *arg);
+    void work(int worker);
+    bool take(int worker, int *index);
+    bool steal(int worker);
+
+    Vector<pthread_t> mThreads;
+    Mutex mLock;
+    Condition mStart;
+    Condition mDone;
+    uint32_t mRound;
+    int mBusy;
+    bool mExit;
+
+    Task mTask;
+    void *mArg;
+    Range *mRanges;
+};
+
+}; // namespace android
+
+#endif
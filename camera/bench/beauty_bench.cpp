@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Time per face beauty pass over a 1080p preview frame, against the
+ * 33 ms a frame has at 30 fps, and over a 13MP capture, for every
+ * instruction set the CPU has, on one thread and on a pool. Each output
+ * is checked byte for byte against the single threaded scalar one, with
+ * a few settings and on odd sizes that leave partial bands and vector
+ * tails.
+ *
+ * Usage: camera_beauty_bench [iterations] [threads]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkFaceBeauty.h"
+#include "bench_common.h"
+
+using namespace android;
+
+static inline int clip(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+/*
+ * A skin coloured ellipse with blotches and noise for a face, dark
+ * features in it, on a striped background that is not skin.
+ */
+static void fill(frame *f, uint32_t seed)
+{
+    const MtkImage &image = f->image;
+    int w = image.width, h = image.height;
+
+    for (int y = 0; y < h; y++) {
+        uint8_t *row = image.planes[0] + image.strides[0] * y;
+        for (int x = 0; x < w; x++) {
+            float dx = (x - w / 2) / (0.25f * w), dy = (y - h / 2) / (0.4f * h);
+            int v;
+
+            seed = seed * 1103515245 + 12345;
+            if (dx * dx + dy * dy < 1) {
+                v = 150 + 10 * (((x / 7) ^ (y / 5)) & 3) + (int)(seed >> 28) - 8;
+                if ((dy > -0.4f && dy < -0.25f && dx * dx > 0.1f && dx * dx < 0.3f) ||
+                        (dy > 0.4f && dy < 0.5f && dx * dx < 0.15f))
+                    v = 60;
+            } else {
+                v = (x / 16) & 1 ? 200 : 40;
+            }
+            row[x] = clip(v);
+        }
+    }
+    for (int y = 0; y < h / 2; y++) {
+        uint8_t *row = image.planes[1] + image.strides[1] * y;
+        for (int x = 0; x < w / 2; x++) {
+            float dx = (2 * x - w / 2) / (0.25f * w), dy = (2 * y - h / 2) / (0.4f * h);
+            bool skin = dx * dx + dy * dy < 1;
+            row[2 * x] = skin ? 150 + (x & 7) : 128 + (y & 15);
+            row[2 * x + 1] = skin ? 110 - (y & 7) : 100 + (x & 31);
+        }
+    }
+}
+
+static const MtkBeautySettings kSettings[] = {
+    { 0.5f, 0.25f, 0.5f, 0, 0, false },
+    { 0, 0, 0, 0, 0, false },
+    { 1, -1, 0, 0, 0, true },
+    { 1, 1, 1, 0, 0, true },
+};
+
+/*
+ * Filters with every instruction set, alone and on the pool, and
+ * compares to single threaded scalar. Returns the number of mismatches;
+ * with iterations > 0 also prints timings.
+ */
+static int run(int width, int height, const MtkBeautySettings &settings, MtkThreadPool *pool,
+        int iterations)
+{
+    MtkFaceBeauty beauty;
+    frame src, ref, out;
+    double scalarNs = 0;
+    int errors = 0;
+
+    if (beauty.init(width, height) != NO_ERROR ||
+            !alloc(&src, MTK_PIXEL_FORMAT_NV21, width, height) ||
+            !alloc(&ref, MTK_PIXEL_FORMAT_NV21, width, height) ||
+            !alloc(&out, MTK_PIXEL_FORMAT_NV21, width, height)) {
+        fprintf(stderr, "Cannot set up %dx%d\n", width, height);
+        exit(1);
+    }
+    fill(&src, width * 31 + height);
+    memset(ref.data, 0, ref.size);
+    if (beauty.process(src.image, &ref.image, settings, NULL, MTK_PIXEL_ISA_SCALAR) !=
+            NO_ERROR) {
+        fprintf(stderr, "%dx%d: scalar failed\n", width, height);
+        exit(1);
+    }
+
+    for (int isa = MTK_PIXEL_ISA_SCALAR; isa < MTK_PIXEL_ISA_COUNT; isa++) {
+        if (!mtkPixelIsaSupported(MtkPixelIsa(isa)))
+            continue;
+
+        for (int threaded = 0; threaded < 2; threaded++) {
+            MtkThreadPool *p = threaded ? pool : NULL;
+
+            memset(out.data, 0xa5, out.size);
+            if (beauty.process(src.image, &out.image, settings, p, MtkPixelIsa(isa)) !=
+                    NO_ERROR || memcmp(out.data, ref.data, out.size) != 0) {
+                fprintf(stderr, "%dx%d: %s%s output differs from scalar\n", width, height,
+                        mtkPixelIsaName(MtkPixelIsa(isa)), threaded ? " threaded" : "");
+                errors++;
+                continue;
+            }
+            if (iterations <= 0)
+                continue;
+
+            int64_t t0 = now_ns();
+            for (int i = 0; i < iterations; i++)
+                beauty.process(src.image, &out.image, settings, p, MtkPixelIsa(isa));
+            double ns = (now_ns() - t0) / (double)iterations;
+            if (isa == MTK_PIXEL_ISA_SCALAR && !threaded)
+                scalarNs = ns;
+
+            printf("  %-7s x%-2d %8.2f ms %6.1f fps %6.1fx\n",
+                    mtkPixelIsaName(MtkPixelIsa(isa)), threaded ? pool->size() : 1,
+                    ns / 1e6, 1e9 / ns, scalarNs / ns);
+        }
+    }
+
+    free(src.data);
+    free(ref.data);
+    free(out.data);
+    return errors;
+}
+
+// Levels on their -min/-max ranges, and unset ones
+static int checkSettings()
+{
+    MtkCameraParameters params;
+    MtkBeautySettings s;
+    int errors = 0;
+
+    MtkFaceBeauty::settings(params, &s);
+    if (s.smooth != 0 || s.skinColor != 0 || s.sharp != 0 || s.extreme ||
+            MtkFaceBeauty::enabled(params)) {
+        fprintf(stderr, "Unset levels are not off\n");
+        errors++;
+    }
+
+    params.set(MTK_KEY_FACE_BEAUTY, MtkCameraParameters::ON);
+    params.set(MTK_KEY_FB_SMOOTH_LEVEL, 12);
+    params.set(MTK_KEY_FB_SMOOTH_LEVEL_MIN, 0);
+    params.set(MTK_KEY_FB_SMOOTH_LEVEL_MAX, 12);
+    params.set(MTK_KEY_FB_SKIN_COLOR, -4);
+    params.set(MTK_KEY_FB_SHARP, 0);
+    params.set(MTK_KEY_FB_EXTREME_BEAUTY, CameraParameters::TRUE);
+    MtkFaceBeauty::settings(params, &s);
+    if (s.smooth != 1 || s.skinColor != -1 || s.sharp != 0.5f || !s.extreme ||
+            !MtkFaceBeauty::enabled(params)) {
+        fprintf(stderr, "Levels map to %g %g %g %d\n", s.smooth, s.skinColor, s.sharp,
+                s.extreme);
+        errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    static const int sizes[][2] = { { 1920, 1080 }, { 4160, 3120 } };
+    static const int odd[][2] = { { 16, 16 }, { 20, 28 }, { 68, 36 }, { 132, 68 }, { 1028, 20 } };
+    int iterations = argc > 1 ? atoi(argv[1]) : 20;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    int errors = checkSettings();
+
+    if (iterations <= 0)
+        iterations = 20;
+    if (threads < 0)
+        threads = 0;
+    MtkThreadPool pool(threads);
+
+    for (size_t i = 0; i < sizeof(odd) / sizeof(odd[0]); i++) {
+        for (size_t j = 0; j < sizeof(kSettings) / sizeof(kSettings[0]); j++)
+            errors += run(odd[i][0], odd[i][1], kSettings[j], &pool, 0);
+    }
+    for (size_t j = 1; j < sizeof(kSettings) / sizeof(kSettings[0]); j++)
+        errors += run(sizes[0][0], sizes[0][1], kSettings[j], &pool, 0);
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%dx%d, %d iterations, 33.3 ms per frame at 30 fps:\n", sizes[i][0],
+                sizes[i][1], iterations);
+        errors += run(sizes[i][0], sizes[i][1], kSettings[0], &pool, iterations);
+    }
+
+    if (errors) {
+        fprintf(stderr, "%d checks failed\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_MTK_BENCH_COMMON_H
+#define ANDROID_HARDWARE_MTK_BENCH_COMMON_H
+
+/*
+ * Timing and frame helpers shared by the camera benchmarks. Each bench
+ * is a single translation unit, so everything here is static inline.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "MtkImage.h"
+
+namespace android {
+
+static inline int64_t now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// A tightly packed image over its own buffer, free data when done
+struct frame {
+    MtkImage image;
+    uint8_t *data;
+    size_t size;
+};
+
+static inline bool alloc(frame *f, MtkPixelFormat format, int width, int height)
+{
+    f->size = mtkImageSize(format, width, height);
+    f->data = (uint8_t *)malloc(f->size);
+    return f->data != NULL &&
+            mtkImageInit(&f->image, format, width, height, f->data) == NO_ERROR;
+}
+
+// Noise, the kernels saturate and clamp so the edges get exercised too
+static inline void fillNoise(frame *f, uint32_t seed)
+{
+    for (size_t i = 0; i < f->size; i++) {
+        seed = seed * 1103515245 + 12345;
+        f->data[i] = seed >> 24;
+    }
+}
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of the pixel format converters at 1080p and 4K, for every
+ * instruction set the CPU has. Each output is checked byte for byte
+ * against the scalar reference, on the bench sizes and on a few odd
+ * ones that leave tails for the scalar code, including the 176x144
+ * YV12_GPU example from MtkCameraParameters.h.
+ *
+ * Usage: camera_convert_bench [iterations]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkPixelConvert.h"
+#include "bench_common.h"
+
+using namespace android;
+
+static const struct {
+    MtkPixelFormat format;
+    const char *name;
+} kSources[] = {
+    { MTK_PIXEL_FORMAT_NV21,        "nv21" },
+    { MTK_PIXEL_FORMAT_YUV420I,     "yuv420i" },
+    { MTK_PIXEL_FORMAT_YV12_GPU,    "yv12-gpu" },
+    { MTK_PIXEL_FORMAT_UYVY,        "uyvy" },
+    { MTK_PIXEL_FORMAT_VYUY,        "vyuy" },
+    { MTK_PIXEL_FORMAT_YVYU,        "yvyu" },
+};
+
+static const struct {
+    MtkPixelFormat format;
+    const char *name;
+} kDestinations[] = {
+    { MTK_PIXEL_FORMAT_NV21,        "nv21" },
+    { MTK_PIXEL_FORMAT_RGBA,        "rgba" },
+};
+
+#define NUM_SOURCES         (sizeof(kSources) / sizeof(kSources[0]))
+#define NUM_DESTINATIONS    (sizeof(kDestinations) / sizeof(kDestinations[0]))
+
+/*
+ * Converts with every instruction set and compares to scalar. Returns
+ * the number of mismatches; with iterations > 0 also prints timings.
+ */
+static int run(int si, int di, int width, int height, int iterations)
+{
+    frame src, ref, out;
+    double scalarNs = 0;
+    int errors = 0;
+
+    if (!alloc(&src, kSources[si].format, width, height) ||
+            !alloc(&ref, kDestinations[di].format, width, height) ||
+            !alloc(&out, kDestinations[di].format, width, height)) {
+        fprintf(stderr, "Cannot set up %dx%d %s\n", width, height, kSources[si].name);
+        exit(1);
+    }
+    fillNoise(&src, width * 31 + si);
+    memset(ref.data, 0, ref.size);
+    mtkPixelConvert(src.image, &ref.image, MTK_PIXEL_ISA_SCALAR);
+
+    for (int isa = MTK_PIXEL_ISA_SCALAR; isa < MTK_PIXEL_ISA_COUNT; isa++) {
+        if (!mtkPixelIsaSupported(MtkPixelIsa(isa)))
+            continue;
+
+        memset(out.data, 0xa5, out.size);
+        if (mtkPixelConvert(src.image, &out.image, MtkPixelIsa(isa)) != NO_ERROR ||
+                memcmp(out.data, ref.data, out.size) != 0) {
+            fprintf(stderr, "%dx%d %s -> %s: %s output differs from scalar\n",
+                    width, height, kSources[si].name, kDestinations[di].name,
+                    mtkPixelIsaName(MtkPixelIsa(isa)));
+            errors++;
+            continue;
+        }
+        if (iterations <= 0)
+            continue;
+
+        int64_t t0 = now_ns();
+        for (int i = 0; i < iterations; i++)
+            mtkPixelConvert(src.image, &out.image, MtkPixelIsa(isa));
+        double ns = (now_ns() - t0) / (double)iterations;
+        if (isa == MTK_PIXEL_ISA_SCALAR)
+            scalarNs = ns;
+
+        printf("  %-9s -> %-5s %-7s %8.2f ms %8.1f Mpix/s %6.1fx\n",
+                kSources[si].name, kDestinations[di].name, mtkPixelIsaName(MtkPixelIsa(isa)),
+                ns / 1e6, width * (double)height * 1e3 / ns, scalarNs / ns);
+    }
+
+    free(src.data);
+    free(ref.data);
+    free(out.data);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    static const int sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    static const int odd[][2] = { { 176, 144 }, { 2, 2 }, { 34, 6 }, { 1922, 1082 } };
+    int iterations = argc > 1 ? atoi(argv[1]) : 20;
+    int errors = 0;
+
+    if (iterations <= 0)
+        iterations = 20;
+
+    for (size_t i = 0; i < sizeof(odd) / sizeof(odd[0]); i++) {
+        for (size_t s = 0; s < NUM_SOURCES; s++) {
+            for (size_t d = 0; d < NUM_DESTINATIONS; d++)
+                errors += run(s, d, odd[i][0], odd[i][1], 0);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%dx%d, %d iterations:\n", sizes[i][0], sizes[i][1], iterations);
+        for (size_t s = 0; s < NUM_SOURCES; s++) {
+            for (size_t d = 0; d < NUM_DESTINATIONS; d++)
+                errors += run(s, d, sizes[i][0], sizes[i][1], iterations);
+        }
+    }
+
+    if (errors) {
+        fprintf(stderr, "%d conversions did not match the scalar reference\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Preview frames lost to dumping. A producer runs at the preview rate
+ * out of a small frame pool, like the preview path, and dumps every
+ * frame: first with a plain write() on the producer thread, then
+ * through MtkFrameDumper, whole and cropped. A frame is lost when the
+ * producer misses its slot or finds no free buffer. The dumps are read
+ * back and checked against their index.
+ *
+ * Usage: camera_dump_bench [frames] [directory] [fps]
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MtkFrameDump.h"
+#include "bench_common.h"
+
+using namespace android;
+
+#define WIDTH       1920
+#define HEIGHT      1080
+#define BUFFERS     6
+
+static void sleepUntil(int64_t t)
+{
+    struct timespec ts = { (time_t)(t / 1000000000LL), (long)(t % 1000000000LL) };
+
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static void fill(const MtkImage &image, uint32_t slot)
+{
+    for (int p = 0; p < 2; p++) {
+        int rows = p == 0 ? image.height : image.height / 2;
+        for (int y = 0; y < rows; y++) {
+            uint8_t *row = image.planes[p] + image.strides[p] * y;
+            for (int x = 0; x < image.width; x++)
+                row[x] = (uint8_t)(x * 3 + y * 5 + slot * 7 + p * 128);
+        }
+    }
+}
+
+struct result {
+    int lost;
+    int64_t worstProducer;          // longest a dump held up the producer
+};
+
+/*
+ * Runs frames slots of the preview clock, then stops the dumper. dumper
+ * NULL writes straight to fd on the producer thread.
+ */
+static result run(int frames, int fps, MtkFrameDumper *dumper, int fd)
+{
+    MtkFramePool pool;
+    result r = { 0, 0 };
+    int64_t period = 1000000000LL / fps, next = now_ns();
+
+    if (pool.init(MTK_PIXEL_FORMAT_NV21, WIDTH, HEIGHT, BUFFERS) != NO_ERROR) {
+        fprintf(stderr, "Cannot set up the preview buffers\n");
+        exit(1);
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)frames; i++) {
+        next += period;
+
+        MtkFrame *frame = pool.acquire(0);
+        if (frame == NULL) {
+            r.lost++;
+        } else {
+            fill(frame->image, i);
+            int64_t t0 = now_ns();
+            if (dumper == NULL) {
+                if (write(fd, frame->data, frame->size) != (ssize_t)frame->size)
+                    fprintf(stderr, "Dump write failed\n");
+                pool.release(frame);
+            } else if (dumper->queue(frame, &pool, i) != NO_ERROR) {
+                pool.release(frame);
+            }
+            int64_t t = now_ns() - t0;
+            if (t > r.worstProducer)
+                r.worstProducer = t;
+        }
+
+        // Slots gone by while we were busy are frames the sensor dropped
+        int64_t now = now_ns();
+        while (next + period <= now) {
+            next += period;
+            i++;
+            r.lost++;
+        }
+        sleepUntil(next);
+    }
+
+    // The pool has to outlive the frames the dumper still holds
+    if (dumper != NULL && dumper->stop() != NO_ERROR)
+        fprintf(stderr, "Dump sync failed\n");
+    return r;
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t getU64(const uint8_t *p)
+{
+    return getU32(p) | (uint64_t)getU32(p + 4) << 32;
+}
+
+// Every indexed frame against a fresh fill; returns the frames checked
+static int verify(const char *path, const MtkFrameDumpStats &stats, bool cropped)
+{
+    char name[520];
+    int checked = 0;
+
+    snprintf(name, sizeof(name), "%s.idx", path);
+    FILE *idx = fopen(name, "rb");
+    snprintf(name, sizeof(name), "%s.frames", path);
+    int data = open(name, O_RDONLY);
+    uint8_t header[8], record[MTK_DUMP_RECORD_SIZE];
+
+    if (idx == NULL || data < 0 || fread(header, sizeof(header), 1, idx) != 1 ||
+            memcmp(header, "MKD", 3) != 0 || header[3] != MTK_DUMP_VERSION ||
+            getU32(header + 4) != MTK_DUMP_RECORD_SIZE) {
+        fprintf(stderr, "%s: bad dump\n", path);
+        exit(1);
+    }
+
+    size_t fullSize = mtkImageSize(MTK_PIXEL_FORMAT_NV21, WIDTH, HEIGHT);
+    uint8_t *full = (uint8_t *)malloc(fullSize);
+    uint8_t *want = (uint8_t *)malloc(fullSize), *got = (uint8_t *)malloc(fullSize);
+    while (fread(record, sizeof(record), 1, idx) == 1) {
+        // The slot went in as the timestamp, the sequence skips lost ones
+        uint32_t slot = (uint32_t)getU64(record + 4);
+        uint64_t offset = getU64(record + 12);
+        uint32_t size = getU32(record + 20);
+        int width = record[24] | record[25] << 8, height = record[26] | record[27] << 8;
+        MtkImage image, crop, out;
+
+        mtkImageInit(&image, MTK_PIXEL_FORMAT_NV21, WIDTH, HEIGHT, full);
+        fill(image, slot);
+        if (offset % MTK_DUMP_ALIGNMENT != 0 || record[28] != MTK_PIXEL_FORMAT_NV21 ||
+                (record[29] == MTK_DUMP_CROPPED) != cropped ||
+                mtkImageCrop(image, (WIDTH - width) / 2 & ~3, (HEIGHT - height) / 2 & ~1,
+                        width, height, &crop) != NO_ERROR ||
+                size != mtkImageSize(MTK_PIXEL_FORMAT_NV21, width, height) ||
+                pread(data, got, size, offset) != (ssize_t)size) {
+            fprintf(stderr, "%s: bad record for frame %u\n", path, slot);
+            exit(1);
+        }
+        mtkImageInit(&out, MTK_PIXEL_FORMAT_NV21, width, height, want);
+        mtkImageCopy(crop, &out);
+        if (memcmp(want, got, size) != 0) {
+            fprintf(stderr, "%s: frame %u differs\n", path, slot);
+            exit(1);
+        }
+        checked++;
+    }
+    if ((uint64_t)checked != stats.written) {
+        fprintf(stderr, "%s: %d frames indexed, %llu written\n", path, checked,
+                (unsigned long long)stats.written);
+        exit(1);
+    }
+
+    free(full);
+    free(want);
+    free(got);
+    fclose(idx);
+    close(data);
+    return checked;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 150;
+    const char *dir = argc > 2 ? argv[2] : "/data/local/tmp";
+    int fps = argc > 3 ? atoi(argv[3]) : 30;
+    char path[512];
+
+    if (frames <= 0)
+        frames = 150;
+    if (fps <= 0)
+        fps = 30;
+    printf("%d frames of %dx%d NV21 at %d fps, %d buffers:\n", frames, WIDTH, HEIGHT, fps,
+            BUFFERS);
+
+    snprintf(path, sizeof(path), "%s/dump_bench_sync.frames", dir);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot create %s\n", path);
+        return 1;
+    }
+    result sync = run(frames, fps, NULL, fd);
+    close(fd);
+    unlink(path);
+    printf("  write() on the producer %4d lost, worst dump %8.3f ms\n", sync.lost,
+            sync.worstProducer / 1e6);
+
+    for (int cropped = 0; cropped < 2; cropped++) {
+        MtkFrameDumper dumper;
+        MtkFrameDumpStats stats;
+
+        snprintf(path, sizeof(path), "%s/dump_bench_%s", dir, cropped ? "crop" : "normal");
+        dumper.setZoomCrop(cropped ? 200 : 100);
+        if (dumper.start(path, BUFFERS - 2) != NO_ERROR) {
+            fprintf(stderr, "Cannot dump to %s\n", path);
+            return 1;
+        }
+        result async = run(frames, fps, &dumper, -1);
+        dumper.stats(&stats);
+
+        int checked = verify(path, stats, cropped);
+        printf("  dumper, %-6s           %4d lost, worst dump %8.3f ms, %llu dumped, "
+                "%llu not, slowest write %.2f ms, %d in flight at most, %d checked\n",
+                cropped ? "crop" : "normal", async.lost, async.worstProducer / 1e6,
+                (unsigned long long)stats.written,
+                (unsigned long long)(stats.dropped + stats.failed),
+                stats.slowestWrite / 1e6, stats.highWater, checked);
+
+        snprintf(path, sizeof(path), "%s/dump_bench_%s.frames", dir, cropped ? "crop" : "normal");
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/dump_bench_%s.idx", dir, cropped ? "crop" : "normal");
+        unlink(path);
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Shot-to-shot jitter of a synthetic burst: a producer takes a frame at
+ * a fixed cadence and writes a full picture into it, as the ISP would,
+ * while a consumer reads every frame back, stalling now and then like an
+ * encoder would. Once with a frame per shot from malloc, once from an
+ * MtkFramePool. Prints how late each shot's frame was ready, plus the
+ * pool's high-water mark and how often the producer had to wait.
+ *
+ * Usage: camera_frame_pool_bench [shots] [pool frames] [interval ms]
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "MtkFramePool.h"
+#include "bench_common.h"
+
+using namespace android;
+
+#define WIDTH           4000
+#define HEIGHT          3000
+#define MAX_SHOTS       256
+
+static void sleepUntil(int64_t t)
+{
+    struct timespec ts = { (time_t)(t / 1000000000), (long)(t % 1000000000) };
+
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+// Frames handed from the producer to the consumer, in shot order
+struct queue {
+    Mutex lock;
+    Condition ready;
+    uint8_t *data[MAX_SHOTS];
+    MtkFrame *frames[MAX_SHOTS];
+    int head, tail;
+};
+
+struct bench {
+    MtkFramePool *pool;             // NULL for malloc
+    size_t size;
+    int shots;
+    int64_t interval;
+    queue q;
+    int64_t late[MAX_SHOTS];
+    uint64_t checksum;
+};
+
+static void *consumerLoop(void *arg)
+{
+    bench *b = (bench *)arg;
+
+    for (int shot = 0; shot < b->shots; shot++) {
+        b->q.lock.lock();
+        while (b->q.head == b->q.tail)
+            b->q.ready.wait(b->q.lock);
+        uint8_t *data = b->q.data[b->q.head % MAX_SHOTS];
+        MtkFrame *frame = b->q.frames[b->q.head % MAX_SHOTS];
+        b->q.head++;
+        b->q.lock.unlock();
+
+        uint64_t sum = 0;
+        for (size_t i = 0; i < b->size; i += 64)
+            sum += data[i];
+        b->checksum += sum;
+
+        // Every eighth frame the encoder falls behind by a few shots
+        if (shot % 8 == 7)
+            sleepUntil(now_ns() + 3 * b->interval);
+
+        if (b->pool != NULL)
+            b->pool->release(frame);
+        else
+            free(data);
+    }
+    return NULL;
+}
+
+static void produce(bench *b)
+{
+    int64_t start = now_ns() + b->interval;
+
+    for (int shot = 0; shot < b->shots; shot++) {
+        int64_t due = start + shot * b->interval;
+        MtkFrame *frame = NULL;
+        uint8_t *data;
+
+        sleepUntil(due);
+        if (b->pool != NULL) {
+            frame = b->pool->acquire();
+            data = frame->data;
+        } else {
+            data = (uint8_t *)malloc(b->size);
+        }
+        memset(data, shot, b->size);
+        b->late[shot] = now_ns() - due;
+
+        b->q.lock.lock();
+        b->q.data[b->q.tail % MAX_SHOTS] = data;
+        b->q.frames[b->q.tail % MAX_SHOTS] = frame;
+        b->q.tail++;
+        b->q.ready.signal();
+        b->q.lock.unlock();
+    }
+}
+
+static int compare(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void run(const char *name, MtkFramePool *pool, int shots, int64_t interval)
+{
+    bench *b = new bench();
+    pthread_t consumer;
+
+    b->pool = pool;
+    b->size = mtkImageSize(MTK_PIXEL_FORMAT_NV21, WIDTH, HEIGHT);
+    b->shots = shots;
+    b->interval = interval;
+    pthread_create(&consumer, NULL, consumerLoop, b);
+    produce(b);
+    pthread_join(consumer, NULL);
+
+    /*
+     * Backpressure makes a shot late by design when the consumer stalls,
+     * so the jitter is the spread between shots rather than the absolute
+     * delay: the malloc case pays page faults on every single one.
+     */
+    int64_t sorted[MAX_SHOTS];
+    double mean = 0, var = 0;
+    memcpy(sorted, b->late, shots * sizeof(int64_t));
+    qsort(sorted, shots, sizeof(int64_t), compare);
+    for (int i = 0; i < shots; i++)
+        mean += sorted[i];
+    mean /= shots;
+    for (int i = 0; i < shots; i++)
+        var += (sorted[i] - mean) * (sorted[i] - mean);
+
+    printf("  %-7s ready after  p50 %7.2f  p90 %7.2f  max %7.2f ms  stddev %6.2f ms\n",
+            name, sorted[shots / 2] / 1e6, sorted[shots * 9 / 10] / 1e6,
+            sorted[shots - 1] / 1e6, __builtin_sqrt(var / shots) / 1e6);
+    delete b;
+}
+
+int main(int argc, char **argv)
+{
+    MtkCameraParameters params;
+    MtkFramePool pool;
+    MtkFramePoolStats stats;
+    int shots = argc > 1 ? atoi(argv[1]) : 40;
+    int frames = argc > 2 ? atoi(argv[2]) : 8;
+    int ms = argc > 3 ? atoi(argv[3]) : 20;
+
+    if (shots <= 0 || shots > MAX_SHOTS)
+        shots = 40;
+    if (frames <= 0)
+        frames = 8;
+    if (ms <= 0)
+        ms = 20;
+
+    params.setPictureSize(WIDTH, HEIGHT);
+    params.setPictureFormat(CameraParameters::PIXEL_FORMAT_JPEG);
+    params.set(MtkCameraParameters::KEY_CAPTURE_MODE, MtkCameraParameters::CAPTURE_MODE_BURST_SHOT);
+    params.set(MtkCameraParameters::KEY_BURST_SHOT_NUM, shots);
+    if (pool.init(params, frames) != NO_ERROR) {
+        fprintf(stderr, "Cannot set up the frame pool\n");
+        return 1;
+    }
+
+    printf("%d shots of %dx%d nv21 every %d ms, %d pooled frames:\n",
+            shots, WIDTH, HEIGHT, ms, pool.capacity());
+    run("malloc", NULL, shots, ms * 1000000LL);
+    run("pool", &pool, shots, ms * 1000000LL);
+
+    pool.stats(&stats);
+    printf("  pool: %llu acquired, high-water %d of %d, %llu waits\n",
+            (unsigned long long)stats.acquired, stats.highWater, stats.capacity,
+            (unsigned long long)stats.waits);
+    if (stats.inUse != 0) {
+        fprintf(stderr, "%d frames never came back\n", stats.inUse);
+        return 1;
+    }
+    return 0;
+}
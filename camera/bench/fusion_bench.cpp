@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Time per exposure fusion of three 13MP NV21 frames, and of two 1080p
+ * ones as video HDR, for every instruction set the CPU has, on one
+ * thread and on a pool. Each output is checked byte for byte against
+ * the single threaded scalar one, on the bench sizes and on a few odd
+ * ones that leave partial bands and vector tails.
+ *
+ * Usage: camera_fusion_bench [iterations] [threads]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkExposureFusion.h"
+#include "bench_common.h"
+
+using namespace android;
+
+static inline int clip(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+/*
+ * The same scene at exposure 2^ev: a wide radiance ramp with blocks of
+ * texture and colored patches, clipped like a sensor would, plus noise.
+ */
+static void fill(frame *f, int ev, uint32_t seed)
+{
+    const MtkImage &image = f->image;
+    float gain = ev < 0 ? 1.0f / (1 << -ev) : (float)(1 << ev);
+
+    for (int y = 0; y < image.height; y++) {
+        uint8_t *row = image.planes[0] + image.strides[0] * y;
+        for (int x = 0; x < image.width; x++) {
+            seed = seed * 1103515245 + 12345;
+            float radiance = 8.0f + 400.0f * x / image.width + 200.0f * y / image.height;
+            if ((x / 53 + y / 41) & 1)
+                radiance *= 0.6f + 0.4f * ((x ^ y) & 7) / 7.0f;
+            row[x] = clip((int)(radiance * gain * 0.5f) + (int)(seed >> 29) - 4);
+        }
+    }
+    for (int y = 0; y < image.height / 2; y++) {
+        uint8_t *row = image.planes[1] + image.strides[1] * y;
+        for (int x = 0; x < image.width / 2; x++) {
+            int tint = (x / 23 + y / 17) % 3 - 1;
+            row[2 * x] = clip(128 + tint * (40 - 10 * ev));
+            row[2 * x + 1] = clip(128 - tint * (30 - 8 * ev) + (x & 3));
+        }
+    }
+}
+
+/*
+ * Fuses count frames with every instruction set, alone and on the pool,
+ * and compares to single threaded scalar. Returns the number of
+ * mismatches; with iterations > 0 also prints timings.
+ */
+static int run(int count, int width, int height, MtkThreadPool *pool, int iterations)
+{
+    MtkExposureFusion fusion;
+    frame frames[MtkExposureFusion::MAX_FRAMES], ref, out;
+    const MtkImage *images[MtkExposureFusion::MAX_FRAMES];
+    double scalarNs = 0;
+    int errors = 0;
+
+    if (fusion.init(width, height, count) != NO_ERROR ||
+            !alloc(&ref, MTK_PIXEL_FORMAT_NV21, width, height) ||
+            !alloc(&out, MTK_PIXEL_FORMAT_NV21, width, height)) {
+        fprintf(stderr, "Cannot set up %d frames of %dx%d\n", count, width, height);
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        if (!alloc(&frames[i], MTK_PIXEL_FORMAT_NV21, width, height)) {
+            fprintf(stderr, "Cannot set up %d frames of %dx%d\n", count, width, height);
+            exit(1);
+        }
+        fill(&frames[i], 2 * i - count + 1, width * 31 + i);
+        images[i] = &frames[i].image;
+    }
+    memset(ref.data, 0, ref.size);
+    if (fusion.process(images, &ref.image, NULL, MTK_PIXEL_ISA_SCALAR) != NO_ERROR) {
+        fprintf(stderr, "%dx%d x%d: scalar failed\n", width, height, count);
+        exit(1);
+    }
+
+    for (int isa = MTK_PIXEL_ISA_SCALAR; isa < MTK_PIXEL_ISA_COUNT; isa++) {
+        if (!mtkPixelIsaSupported(MtkPixelIsa(isa)))
+            continue;
+
+        for (int threaded = 0; threaded < 2; threaded++) {
+            MtkThreadPool *p = threaded ? pool : NULL;
+
+            memset(out.data, 0xa5, out.size);
+            if (fusion.process(images, &out.image, p, MtkPixelIsa(isa)) != NO_ERROR ||
+                    memcmp(out.data, ref.data, out.size) != 0) {
+                fprintf(stderr, "%dx%d x%d: %s%s output differs from scalar\n",
+                        width, height, count, mtkPixelIsaName(MtkPixelIsa(isa)),
+                        threaded ? " threaded" : "");
+                errors++;
+                continue;
+            }
+            if (iterations <= 0)
+                continue;
+
+            int64_t t0 = now_ns();
+            for (int i = 0; i < iterations; i++)
+                fusion.process(images, &out.image, p, MtkPixelIsa(isa));
+            double ns = (now_ns() - t0) / (double)iterations;
+            if (isa == MTK_PIXEL_ISA_SCALAR && !threaded)
+                scalarNs = ns;
+
+            printf("  x%d %-7s x%-2d %8.2f ms %8.1f Mpix/s %6.1fx\n", count,
+                    mtkPixelIsaName(MtkPixelIsa(isa)), threaded ? pool->size() : 1,
+                    ns / 1e6, width * (double)height * 1e3 / ns, scalarNs / ns);
+        }
+    }
+
+    // In place, into the first frame
+    if (iterations <= 0) {
+        frame copy;
+        if (!alloc(&copy, MTK_PIXEL_FORMAT_NV21, width, height)) {
+            fprintf(stderr, "Cannot set up %dx%d\n", width, height);
+            exit(1);
+        }
+        memcpy(copy.data, frames[0].data, copy.size);
+        if (fusion.process(images, &frames[0].image, pool) != NO_ERROR ||
+                memcmp(frames[0].data, ref.data, ref.size) != 0) {
+            fprintf(stderr, "%dx%d x%d: in place output differs from scalar\n",
+                    width, height, count);
+            errors++;
+        }
+        memcpy(frames[0].data, copy.data, copy.size);
+        free(copy.data);
+    }
+
+    for (int i = 0; i < count; i++)
+        free(frames[i].data);
+    free(ref.data);
+    free(out.data);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    static const int sizes[][3] = { { 3, 4160, 3120 }, { 2, 1920, 1080 } };
+    static const int odd[][2] = { { 16, 16 }, { 18, 22 }, { 70, 34 }, { 134, 66 }, { 1030, 18 } };
+    int iterations = argc > 1 ? atoi(argv[1]) : 5;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    int errors = 0;
+
+    if (iterations <= 0)
+        iterations = 5;
+    if (threads < 0)
+        threads = 0;
+    MtkThreadPool pool(threads);
+
+    for (size_t i = 0; i < sizeof(odd) / sizeof(odd[0]); i++) {
+        for (int count = 1; count <= MtkExposureFusion::MAX_FRAMES; count++)
+            errors += run(count, odd[i][0], odd[i][1], &pool, 0);
+    }
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%dx%d, %d iterations:\n", sizes[i][1], sizes[i][2], iterations);
+        errors += run(sizes[i][0], sizes[i][1], sizes[i][2], &pool, iterations);
+    }
+
+    if (errors) {
+        fprintf(stderr, "%d fused frames did not match the scalar reference\n", errors);
+        return 1;
+    }
+    return 0;
+}
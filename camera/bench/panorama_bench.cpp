@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stitches synthetic sweeps cut out of a known scene, in every
+ * direction, and checks the motion found for each frame against the one
+ * it was cut with. Without noise and at even positions the stitched
+ * strip has to be the scene itself, byte for byte; it also has to be the
+ * same for every instruction set and thread count. Times add() per frame
+ * at preview sizes against the 33 ms a frame has at 30 fps, which is
+ * the shortest a panorama capture interval gets.
+ *
+ * Usage: camera_panorama_bench [frames] [threads]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkPanorama.h"
+#include "bench_common.h"
+
+using namespace android;
+
+static inline uint32_t hash(uint32_t x, uint32_t y, uint32_t seed)
+{
+    uint32_t h = x * 374761393u + y * 668265263u + seed * 2246822519u;
+
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return h ^ (h >> 16);
+}
+
+// Bilinear value noise on a lattice of cell pixels, 0 to 255
+static int noise(int x, int y, int cell, uint32_t seed)
+{
+    int ix = x / cell, iy = y / cell, fx = x % cell, fy = y % cell;
+    int a = hash(ix, iy, seed) & 255, b = hash(ix + 1, iy, seed) & 255;
+    int c = hash(ix, iy + 1, seed) & 255, d = hash(ix + 1, iy + 1, seed) & 255;
+    int top = a * (cell - fx) + b * fx, bottom = c * (cell - fx) + d * fx;
+
+    return (top * (cell - fy) + bottom * fy) / (cell * cell);
+}
+
+// Texture at three scales, so that every pyramid level has some
+static void fillScene(frame *f)
+{
+    const MtkImage &image = f->image;
+
+    for (int y = 0; y < image.height; y++) {
+        uint8_t *row = image.planes[0] + image.strides[0] * y;
+        for (int x = 0; x < image.width; x++)
+            row[x] = (4 * noise(x, y, 64, 1) + 3 * noise(x, y, 16, 2) +
+                    noise(x, y, 4, 3)) / 8;
+    }
+    for (int y = 0; y < image.height / 2; y++) {
+        uint8_t *row = image.planes[1] + image.strides[1] * y;
+        for (int x = 0; x < image.width / 2; x++) {
+            row[2 * x] = 96 + noise(x, y, 48, 4) / 4;
+            row[2 * x + 1] = 96 + noise(x, y, 48, 5) / 4;
+        }
+    }
+}
+
+// The frame at (x, y) of the scene, chroma from (x / 2, y / 2), with
+// uniform noise of +-amplitude on luma
+static void cut(const frame &scene, int x, int y, frame *f, int amplitude, uint32_t seed)
+{
+    const MtkImage &s = scene.image;
+    MtkImage &d = f->image;
+
+    for (int r = 0; r < d.height; r++) {
+        uint8_t *out = d.planes[0] + d.strides[0] * r;
+        memcpy(out, s.planes[0] + s.strides[0] * (y + r) + x, d.width);
+        for (int c = 0; amplitude > 0 && c < d.width; c++) {
+            seed = seed * 1103515245 + 12345;
+            int v = out[c] + (int)((seed >> 16) % (2 * amplitude + 1)) - amplitude;
+            out[c] = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+    }
+    for (int r = 0; r < d.height / 2; r++)
+        memcpy(d.planes[1] + d.strides[1] * r,
+                s.planes[1] + s.strides[1] * (y / 2 + r) + 2 * (x / 2), d.width);
+}
+
+struct sweep {
+    MtkPanoramaDir dir;
+    int width;
+    int height;
+    int frames;
+    bool odd;                       // odd steps and drift, with noise
+    int x[16];                      // frame positions in the scene
+    int y[16];
+};
+
+static bool horizontal(MtkPanoramaDir dir)
+{
+    return dir == MTK_PANORAMA_RIGHT || dir == MTK_PANORAMA_LEFT;
+}
+
+// Steps of around a third of a frame and a little drift, in a scene
+// just big enough
+static void plan(sweep *s, frame *scene)
+{
+    bool across = horizontal(s->dir);
+    int along = across ? s->width : s->height, cross = across ? s->height : s->width;
+    int sign = s->dir == MTK_PANORAMA_RIGHT || s->dir == MTK_PANORAMA_DOWN ? 1 : -1;
+    int c = cross / 16, lo = 0, hi = 0;
+    int steps[16], drifts[16];
+
+    for (int i = 1; i < s->frames; i++) {
+        int step = along / 3 + (i * 37) % 64 - 32;
+        int drift = (i * 3) % 5 - 2;
+        if (s->odd) {
+            step |= 1;
+            drift += i & 1 ? 1 : 0;
+        } else {
+            step &= ~1;
+            drift *= 2;
+        }
+        steps[i] = sign * step;
+        drifts[i] = drift;
+    }
+    // Positions relative to the first frame, then shifted into the scene
+    int pa[16], pc[16];
+    pa[0] = 0;
+    pc[0] = 0;
+    for (int i = 1; i < s->frames; i++) {
+        pa[i] = pa[i - 1] + steps[i];
+        pc[i] = pc[i - 1] + drifts[i];
+        lo = pa[i] < lo ? pa[i] : lo;
+        hi = pa[i] > hi ? pa[i] : hi;
+    }
+    int sceneAlong = (hi - lo + along + 1) & ~1, sceneCross = cross + 2 * c;
+    for (int i = 0; i < s->frames; i++) {
+        int a = pa[i] - lo;
+        s->x[i] = across ? a : c + pc[i];
+        s->y[i] = across ? c + pc[i] : a;
+    }
+    if (!alloc(scene, MTK_PIXEL_FORMAT_NV21, across ? sceneAlong : sceneCross,
+            across ? sceneCross : sceneAlong)) {
+        fprintf(stderr, "Cannot allocate a scene\n");
+        exit(1);
+    }
+    fillScene(scene);
+}
+
+/*
+ * Stitches the sweep, checking the motion of each frame. Copies the
+ * result into out when given, and adds the slowest and total add()
+ * times to the ones given.
+ */
+static int stitch(const sweep &s, const frame &scene, MtkThreadPool *pool, MtkPixelIsa isa,
+        frame *out, int64_t *slowest, int64_t *total)
+{
+    MtkPanorama panorama;
+    MtkPanoramaFrame info[16];
+    frame f;
+    int length = horizontal(s.dir) ? scene.image.width : scene.image.height;
+    int errors = 0;
+
+    // Just long enough for the sweep
+    if (panorama.init(s.width, s.height, s.dir, length) != NO_ERROR ||
+            !alloc(&f, MTK_PIXEL_FORMAT_NV21, s.width, s.height)) {
+        fprintf(stderr, "Cannot set up %dx%d\n", s.width, s.height);
+        exit(1);
+    }
+    for (int i = 0; i < s.frames; i++) {
+        cut(scene, s.x[i], s.y[i], &f, s.odd ? 4 : 0, i + 1);
+
+        int64_t t0 = now_ns();
+        status_t err = panorama.add(f.image, &info[i], pool, isa);
+        int64_t ns = now_ns() - t0;
+        if (slowest != NULL && ns > *slowest)
+            *slowest = ns;
+        if (total != NULL)
+            *total += ns;
+
+        int dx = i > 0 ? s.x[i] - s.x[i - 1] : 0, dy = i > 0 ? s.y[i] - s.y[i - 1] : 0;
+        if (err != NO_ERROR || !info[i].added || info[i].dx != dx || info[i].dy != dy) {
+            fprintf(stderr, "%dx%d dir %d %s frame %d: motion %d,%d, want %d,%d\n",
+                    s.width, s.height, s.dir, mtkPixelIsaName(isa), i, info[i].dx,
+                    info[i].dy, dx, dy);
+            errors++;
+        }
+    }
+
+    MtkImage result;
+    if (panorama.result(&result) != NO_ERROR) {
+        fprintf(stderr, "%dx%d dir %d: no result\n", s.width, s.height, s.dir);
+        free(f.data);
+        return errors + 1;
+    }
+
+    // Everything along the sweep, what all frames share across it
+    int left = info[0].x, right = info[0].x + s.width;
+    int top = info[0].y, bottom = info[0].y + s.height;
+    for (int i = 1; i < s.frames; i++) {
+        int x0 = info[i].x, x1 = x0 + s.width, y0 = info[i].y, y1 = y0 + s.height;
+        if (horizontal(s.dir)) {
+            left = x0 < left ? x0 : left;
+            right = x1 > right ? x1 : right;
+            top = y0 > top ? y0 : top;
+            bottom = y1 < bottom ? y1 : bottom;
+        } else {
+            left = x0 > left ? x0 : left;
+            right = x1 < right ? x1 : right;
+            top = y0 < top ? y0 : top;
+            bottom = y1 > bottom ? y1 : bottom;
+        }
+    }
+    left = (left + 1) & ~1;
+    top = (top + 1) & ~1;
+    if (result.width != (right & ~1) - left || result.height != (bottom & ~1) - top) {
+        fprintf(stderr, "%dx%d dir %d: result is %dx%d, want %dx%d\n", s.width, s.height,
+                s.dir, result.width, result.height, (right & ~1) - left, (bottom & ~1) - top);
+        errors++;
+    } else if (!s.odd) {
+        // Strip to scene coordinates
+        int ox = left - info[0].x + s.x[0], oy = top - info[0].y + s.y[0];
+        const MtkImage &sc = scene.image;
+        int bad = 0;
+
+        for (int y = 0; y < result.height; y++) {
+            if (memcmp(result.planes[0] + result.strides[0] * y,
+                    sc.planes[0] + sc.strides[0] * (oy + y) + ox, result.width) != 0)
+                bad++;
+        }
+        for (int y = 0; y < result.height / 2; y++) {
+            if (memcmp(result.planes[1] + result.strides[1] * y,
+                    sc.planes[1] + sc.strides[1] * (oy / 2 + y) + ox, result.width) != 0)
+                bad++;
+        }
+        if (bad) {
+            fprintf(stderr, "%dx%d dir %d %s: %d rows differ from the scene\n", s.width,
+                    s.height, s.dir, mtkPixelIsaName(isa), bad);
+            errors++;
+        }
+    }
+
+    if (out != NULL && alloc(out, MTK_PIXEL_FORMAT_NV21, result.width, result.height))
+        mtkImageCopy(result, &out->image);
+    free(f.data);
+    return errors;
+}
+
+// Every instruction set and thread count against single threaded scalar
+static int compare(sweep s, MtkThreadPool *pool)
+{
+    frame scene, ref;
+    int errors = 0;
+
+    plan(&s, &scene);
+    errors += stitch(s, scene, NULL, MTK_PIXEL_ISA_SCALAR, &ref, NULL, NULL);
+    for (int isa = MTK_PIXEL_ISA_SCALAR; isa < MTK_PIXEL_ISA_COUNT; isa++) {
+        if (!mtkPixelIsaSupported(MtkPixelIsa(isa)))
+            continue;
+        for (int threaded = 0; threaded < 2; threaded++) {
+            frame out;
+            errors += stitch(s, scene, threaded ? pool : NULL, MtkPixelIsa(isa), &out,
+                    NULL, NULL);
+            if (out.size != ref.size || memcmp(out.data, ref.data, ref.size) != 0) {
+                fprintf(stderr, "%dx%d dir %d: %s%s result differs from scalar\n", s.width,
+                        s.height, s.dir, mtkPixelIsaName(MtkPixelIsa(isa)),
+                        threaded ? " threaded" : "");
+                errors++;
+            }
+            free(out.data);
+        }
+    }
+    free(scene.data);
+    free(ref.data);
+    return errors;
+}
+
+// Frames past the end of the strip are left out, and it says it is full
+static int checkFull()
+{
+    sweep s = { MTK_PANORAMA_RIGHT, 320, 240, 8, false, {}, {} };
+    MtkPanorama panorama;
+    MtkPanoramaFrame info;
+    frame scene, f;
+    int added = 0, errors = 0;
+
+    plan(&s, &scene);
+    if (panorama.init(s.width, s.height, s.dir, 2 * s.width) != NO_ERROR ||
+            !alloc(&f, MTK_PIXEL_FORMAT_NV21, s.width, s.height)) {
+        fprintf(stderr, "Cannot set up the full strip\n");
+        exit(1);
+    }
+    for (int i = 0; i < s.frames; i++) {
+        cut(scene, s.x[i], s.y[i], &f, 0, 0);
+        if (panorama.add(f.image, &info) != NO_ERROR)
+            errors++;
+        added += info.added;
+    }
+    if (!panorama.full() || added >= s.frames || panorama.frames() != added) {
+        fprintf(stderr, "Strip of two frames took %d of %d\n", added, s.frames);
+        errors++;
+    }
+
+    MtkCameraParameters params;
+    params.set(MTK_KEY_CAPTURE_MODE, MtkCameraParameters::CAPTURE_MODE_AUTO_PANORAMA_SHOT);
+    params.set(MTK_KEY_PANORAMA_DIR, MtkCameraParameters::PANORAMA_DIR_TOP);
+    panorama.setIndex(&params);
+    if (!MtkPanorama::enabled(params) || MtkPanorama::direction(params) != MTK_PANORAMA_TOP ||
+            params.getInt(MTK_KEY_PANORAMA_IDX) != added) {
+        fprintf(stderr, "Panorama parameters not read or set\n");
+        errors++;
+    }
+    free(scene.data);
+    free(f.data);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    static const MtkPanoramaDir dirs[] = {
+        MTK_PANORAMA_RIGHT, MTK_PANORAMA_LEFT, MTK_PANORAMA_TOP, MTK_PANORAMA_DOWN,
+    };
+    static const int sizes[][2] = { { 1280, 720 }, { 1920, 1080 } };
+    int frames = argc > 1 ? atoi(argv[1]) : 9;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    int errors = checkFull();
+
+    if (frames < 2 || frames > 16)
+        frames = 9;
+    if (threads < 0)
+        threads = 0;
+    MtkThreadPool pool(threads);
+
+    for (size_t d = 0; d < sizeof(dirs) / sizeof(dirs[0]); d++) {
+        for (int odd = 0; odd < 2; odd++) {
+            sweep s = { dirs[d], 640, 480, 6, odd != 0, {}, {} };
+            errors += compare(s, &pool);
+            s.width = 200;
+            s.height = 132;
+            errors += compare(s, &pool);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        sweep s = { MTK_PANORAMA_RIGHT, sizes[i][0], sizes[i][1], frames, false, {}, {} };
+        frame scene;
+
+        plan(&s, &scene);
+        printf("%dx%d, %d frames, 33.3 ms per frame at 30 fps:\n", s.width, s.height,
+                frames);
+        for (int isa = MTK_PIXEL_ISA_SCALAR; isa < MTK_PIXEL_ISA_COUNT; isa++) {
+            if (!mtkPixelIsaSupported(MtkPixelIsa(isa)))
+                continue;
+            for (int threaded = 0; threaded < 2; threaded++) {
+                int64_t slowest = 0, total = 0;
+                errors += stitch(s, scene, threaded ? &pool : NULL, MtkPixelIsa(isa), NULL,
+                        &slowest, &total);
+                printf("  %-7s x%-2d %8.2f ms per frame, slowest %8.2f ms\n",
+                        mtkPixelIsaName(MtkPixelIsa(isa)), threaded ? pool.size() : 1,
+                        total / 1e6 / frames, slowest / 1e6);
+            }
+        }
+        free(scene.data);
+    }
+
+    if (errors) {
+        fprintf(stderr, "%d checks failed\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Micro-benchmark for MtkCameraParameters: ns and heap allocations per
+ * assignment, for the old flatten()/unflatten() round trip and for the
+ * direct map copy, per read of a numeric key by name and by id, per
+ * parameter update sent as a full string or as a delta, and per encode
+ * and decode in the text and binary wire formats.
+ *
+ * Usage: camera_params_bench [iterations]
+ */
+
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkCameraBinary.h"
+#include "MtkCameraParameters.h"
+#include "bench_common.h"
+
+using namespace android;
+
+#define NUM_KEYS    150
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Allocation counting: malloc and friends are interposed for the whole
+//  process and forwarded to libc. Allocations made while dlsym() resolves
+//  the real functions are served from a small static arena.
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+static void (*real_free)(void *);
+
+static char boot_arena[4096] __attribute__((aligned(16)));
+static size_t boot_used;
+static bool resolving;
+static unsigned long allocs;
+
+static void *boot_alloc(size_t n)
+{
+    void *p = boot_arena + boot_used;
+
+    boot_used += (n + 15) & ~(size_t)15;
+    if (boot_used > sizeof(boot_arena))
+        abort();
+    return memset(p, 0, n);
+}
+
+static bool in_boot_arena(void *p)
+{
+    return (char *)p >= boot_arena && (char *)p < boot_arena + sizeof(boot_arena);
+}
+
+static void resolve()
+{
+    resolving = true;
+    real_malloc = (void *(*)(size_t))dlsym(RTLD_NEXT, "malloc");
+    real_calloc = (void *(*)(size_t, size_t))dlsym(RTLD_NEXT, "calloc");
+    real_realloc = (void *(*)(void *, size_t))dlsym(RTLD_NEXT, "realloc");
+    real_free = (void (*)(void *))dlsym(RTLD_NEXT, "free");
+    resolving = false;
+}
+
+extern "C" void *malloc(size_t n)
+{
+    if (real_malloc == NULL) {
+        if (resolving)
+            return boot_alloc(n);
+        resolve();
+    }
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return real_malloc(n);
+}
+
+extern "C" void *calloc(size_t count, size_t n)
+{
+    if (real_calloc == NULL) {
+        if (resolving)
+            return boot_alloc(count * n);
+        resolve();
+    }
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return real_calloc(count, n);
+}
+
+extern "C" void *realloc(void *p, size_t n)
+{
+    if (real_realloc == NULL)
+        resolve();
+    if (in_boot_arena(p)) {
+        void *q = malloc(n);
+        memcpy(q, p, n);
+        return q;
+    }
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return real_realloc(p, n);
+}
+
+extern "C" void free(void *p)
+{
+    if (p == NULL || in_boot_arena(p))
+        return;
+    if (real_free == NULL)
+        resolve();
+    real_free(p);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Benchmark
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+/*
+ * A parameter set the size of what the MTK HAL reports: a few real keys
+ * plus generated ones with the usual mix of short values and lists.
+ */
+static void fill(CameraParameters &params)
+{
+    char key[32], value[64];
+    int i;
+
+    params.set(MtkCameraParameters::KEY_CAPTURE_MODE, MtkCameraParameters::CAPTURE_MODE_NORMAL);
+    params.set(MtkCameraParameters::KEY_SUPPORTED_CAPTURE_MODES,
+            "normal,face_beauty,continuousshot,hdr,autorama,mav");
+    params.set(MtkCameraParameters::KEY_ISO_SPEED, MtkCameraParameters::ISO_SPEED_AUTO);
+    params.set(MtkCameraParameters::KEY_FB_SMOOTH_LEVEL, 0);
+    params.set(MtkCameraParameters::KEY_FB_SMOOTH_LEVEL_MIN, -4);
+    params.set(MtkCameraParameters::KEY_FB_SMOOTH_LEVEL_MAX, 4);
+    params.set(MtkCameraParameters::KEY_ZSD_MODE, MtkCameraParameters::OFF);
+    params.set(MtkCameraParameters::KEY_PREVIEW_INT_FORMAT, MtkCameraParameters::PIXEL_FORMAT_YUV420I);
+    for (i = 0; i < NUM_KEYS - 8; i++) {
+        snprintf(key, sizeof(key), "mtk-bench-key-%d", i);
+        if (i % 4 == 0)
+            snprintf(value, sizeof(value), "%dx%d,%dx%d,%dx%d", 4160, 3120, 1920, 1080, 640, 480);
+        else
+            snprintf(value, sizeof(value), "%d", i * 7);
+        params.set(key, value);
+    }
+}
+
+struct result {
+    double ns;
+    double allocs;
+};
+
+template <typename F>
+static result measure(int iterations, F op)
+{
+    unsigned long a0 = __atomic_load_n(&allocs, __ATOMIC_RELAXED);
+    int64_t t0 = now_ns();
+    result r;
+    int i;
+
+    for (i = 0; i < iterations; i++)
+        op();
+
+    r.ns = (now_ns() - t0) / (double)iterations;
+    r.allocs = (__atomic_load_n(&allocs, __ATOMIC_RELAXED) - a0) / (double)iterations;
+    return r;
+}
+
+static void report(const char *name, const result &r)
+{
+    printf("  %-36s %10.1f ns %10.1f allocs\n", name, r.ns, r.allocs);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    CameraParameters src, old;
+    MtkCameraParameters dst;
+    volatile int sink;
+    int level, i;
+    result r;
+
+    if (iterations <= 0)
+        iterations = 20000;
+
+    fill(src);
+    printf("%zu bytes flattened, %d iterations, per assignment:\n",
+            (size_t)src.flatten().length(), iterations);
+
+    /* What CameraParameters::operator= used to cost */
+    r = measure(iterations, [&]() { old.unflatten(src.flatten()); });
+    report("flatten/unflatten (before)", r);
+
+    r = measure(iterations, [&]() { dst = src; });
+    report("operator=(CameraParameters)", r);
+
+    r = measure(iterations, [&]() { MtkCameraParameters copy(src); dst = copy; });
+    report("copy construct + assign", r);
+
+    /* The first write after a copy pays for the map, once */
+    r = measure(iterations, [&]() {
+        dst = src;
+        dst.set(MtkCameraParameters::KEY_ISO_SPEED, MtkCameraParameters::ISO_SPEED_100);
+    });
+    report("operator= then set()", r);
+
+    if (strcmp(dst.flatten().string(), src.flatten().string()) == 0) {
+        fprintf(stderr, "Copy still matches the source after set()\n");
+        return 1;
+    }
+
+    /* What the HAL does for every frame's metadata */
+    printf("per read of %s:\n", MtkCameraParameters::KEY_FB_SMOOTH_LEVEL);
+
+    r = measure(iterations, [&]() { sink = dst.getInt(MtkCameraParameters::KEY_FB_SMOOTH_LEVEL); });
+    report("getInt(name)", r);
+
+    r = measure(iterations, [&]() {
+        dst.getInt(MTK_KEY_FB_SMOOTH_LEVEL, &level);
+        sink = level;
+    });
+    report("getInt(id), cached and range checked", r);
+
+    /* Tap to focus: the app moves af-x/af-y, the HAL picks up the change */
+    MtkCameraParameters app(src), hal(src);
+    String8 delta;
+    int x = 0;
+    printf("per af-x/af-y update:\n");
+
+    r = measure(iterations, [&]() {
+        app.set(MtkCameraParameters::KEY_AF_X, ++x % 1000);
+        app.set(MtkCameraParameters::KEY_AF_Y, x % 700);
+        hal.unflatten(app.flatten());
+    });
+    report("flatten/unflatten", r);
+
+    r = measure(iterations, [&]() {
+        uint32_t since = app.generation();
+        app.set(MtkCameraParameters::KEY_AF_X, ++x % 1000);
+        app.set(MtkCameraParameters::KEY_AF_Y, x % 700);
+        app.flattenDelta(since, &delta);
+        hal.unflattenDelta(delta);
+    });
+    report("flattenDelta/unflattenDelta", r);
+
+    if (strcmp(hal.flatten().string(), app.flatten().string()) != 0) {
+        fprintf(stderr, "Delta did not bring the HAL side in sync\n");
+        return 1;
+    }
+
+    /* An empty value and a removed key must not look alike in a delta */
+    uint32_t since = app.generation(), halSince = hal.generation();
+    app.set(MtkCameraParameters::KEY_ISO_SPEED, "");
+    app.remove(MtkCameraParameters::KEY_ZSD_MODE);
+    app.set("mtk-bench-key-1", "");
+    app.remove("mtk-bench-key-2");
+    app.flattenDelta(since, &delta);
+    hal.unflattenDelta(delta);
+    if (strcmp(hal.flatten().string(), app.flatten().string()) != 0 ||
+            !hal.isChanged("mtk-bench-key-1", halSince) || !hal.isChanged("mtk-bench-key-2", halSince)) {
+        fprintf(stderr, "Delta \"%s\" lost an empty value or a removal\n", delta.string());
+        return 1;
+    }
+
+    /*
+     * The size setters CameraParameters has, and a write through a plain
+     * reference: a later set() of the old value must still land
+     */
+    MtkCameraParameters sized(src);
+    CameraParameters &plain = sized;
+    sized.set(CameraParameters::KEY_PREVIEW_SIZE, "640x480");
+    since = sized.generation();
+    sized.setPreviewSize(1280, 720);
+    bool tracked = sized.isChanged(CameraParameters::KEY_PREVIEW_SIZE, since);
+    sized.set(CameraParameters::KEY_PREVIEW_SIZE, "640x480");
+    plain.setPreviewSize(1280, 720);
+    since = sized.generation();
+    sized.set(CameraParameters::KEY_PREVIEW_SIZE, "640x480");
+    if (!tracked || strcmp(sized.get(CameraParameters::KEY_PREVIEW_SIZE), "640x480") != 0 ||
+            !sized.flattenDelta(since, &delta) ||
+            !sized.isChanged(CameraParameters::KEY_PREVIEW_SIZE, since)) {
+        fprintf(stderr, "A write past the mirror lost the next set(), preview-size %s\n",
+                sized.get(CameraParameters::KEY_PREVIEW_SIZE));
+        return 1;
+    }
+
+    /* Wire formats, text vs binary, on the bench set plus every MTK key */
+    MtkCameraParameters wire(src), decoded;
+    static const char *const modes[] = { "on", "off", "auto" };
+    for (i = 0; i < MTK_KEY_COUNT; i++) {
+        MtkCameraKey id = MtkCameraKey(i);
+        switch (MtkCameraParameters::keyType(id)) {
+        case MTK_KEY_TYPE_INT:
+            wire.set(id, i * 37 - 100);
+            break;
+        case MTK_KEY_TYPE_ENUM:
+            wire.set(id, modes[i % 3]);
+            break;
+        case MTK_KEY_TYPE_SIZE:
+            wire.set(id, "1920x1080");
+            break;
+        default:
+            wire.set(id, "normal,face_beauty,hdr");
+            break;
+        }
+    }
+    String8 text = wire.flatten();
+    Vector<uint8_t> binary;
+    wire.flattenBinary(&binary);
+    printf("wire format, %zu bytes as text, %zu as binary:\n",
+            (size_t)text.length(), (size_t)binary.size());
+
+    r = measure(iterations, [&]() { text = wire.flatten(); });
+    report("flatten()", r);
+
+    r = measure(iterations, [&]() { wire.flattenBinary(&binary); });
+    report("flattenBinary()", r);
+
+    /* Into a fresh object, then into one that already has the values */
+    r = measure(iterations, [&]() { MtkCameraParameters to; to.unflatten(text); });
+    report("unflatten()", r);
+
+    r = measure(iterations, [&]() {
+        MtkCameraParameters to;
+        to.unflattenBinary(binary.array(), binary.size());
+    });
+    report("unflattenBinary()", r);
+
+    decoded.unflatten(text);
+    r = measure(iterations, [&]() { decoded.unflatten(text); });
+    report("unflatten(), same values again", r);
+
+    r = measure(iterations, [&]() {
+        MtkCameraBinaryReader reader(binary.array(), binary.size());
+        MtkCameraBinaryReader::Entry e;
+        reader.init();
+        while (reader.next(&e)) {
+            if (e.id == MTK_KEY_FB_SMOOTH_LEVEL)
+                sink = e.intValue;
+        }
+    });
+    report("MtkCameraBinaryReader walk", r);
+
+    Vector<uint8_t> fromText;
+    mtkCameraBinaryEncode(text.string(), &fromText);
+    if (fromText.size() != binary.size() ||
+            memcmp(fromText.array(), binary.array(), binary.size()) != 0) {
+        fprintf(stderr, "flattenBinary() does not match the encoded text form\n");
+        return 1;
+    }
+
+    decoded.unflattenBinary(binary.array(), binary.size());
+    if (decoded.flatten() != text) {
+        fprintf(stderr, "Binary round trip does not match the text form\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of raw development at 1080p and 12MP, BAYER10 and BAYER8
+ * into RGBA and NV21 with both demosaics, for every instruction set the
+ * CPU has, on one thread and on a pool. Each output is checked byte for
+ * byte against the single threaded scalar one, on the bench sizes and
+ * on a few odd ones that leave partial tiles and vector tails.
+ *
+ * Usage: camera_raw_bench [iterations] [threads]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkRawProcessor.h"
+#include "bench_common.h"
+
+using namespace android;
+
+/*
+ * A gradient with hard vertical and horizontal edges and some noise,
+ * so both demosaic directions and the clamps get exercised.
+ */
+static void fill(frame *f, uint32_t seed)
+{
+    const MtkImage &image = f->image;
+
+    for (int y = 0; y < image.height; y++) {
+        uint8_t *row = image.planes[0] + image.strides[0] * y;
+        for (int x = 0; x < image.width; x++) {
+            seed = seed * 1103515245 + 12345;
+            int v = (x * 7 + y * 3) % 1024;
+            if ((x / 37 + y / 29) & 1)
+                v = 1023 - v;
+            v += (int)(seed >> 26) - 32;
+            v = v < 0 ? 0 : v > 1023 ? 1023 : v;
+
+            if (image.format == MTK_PIXEL_FORMAT_BAYER8) {
+                row[x] = v >> 2;
+            } else {
+                uint8_t *group = row + x / 4 * 5;
+                group[x & 3] = v >> 2;
+                group[4] = (group[4] & ~(3 << 2 * (x & 3))) | (v & 3) << 2 * (x & 3);
+            }
+        }
+    }
+}
+
+static void settingsFor(MtkRawSettings *s, int variant)
+{
+    static const MtkBayerPattern patterns[] = {
+        MTK_BAYER_RGGB, MTK_BAYER_GRBG, MTK_BAYER_GBRG, MTK_BAYER_BGGR,
+    };
+
+    mtkRawDefaultSettings(s);
+    s->pattern = patterns[variant % 4];
+    s->demosaic = variant & 4 ? MTK_DEMOSAIC_BILINEAR : MTK_DEMOSAIC_EDGE_AWARE;
+    s->blackLevel[0] = 64;
+    s->blackLevel[1] = 60;
+    s->blackLevel[2] = 62;
+    s->blackLevel[3] = 66;
+    s->whiteLevel = 1000;
+    s->gains[0] = 1.9f;
+    s->gains[1] = 1.0f;
+    s->gains[2] = 1.6f;
+}
+
+static const char *name(MtkPixelFormat format)
+{
+    switch (format) {
+    case MTK_PIXEL_FORMAT_BAYER8:   return "bayer8";
+    case MTK_PIXEL_FORMAT_BAYER10:  return "bayer10";
+    case MTK_PIXEL_FORMAT_RGBA:     return "rgba";
+    case MTK_PIXEL_FORMAT_NV21:     return "nv21";
+    default:                        return "?";
+    }
+}
+
+/*
+ * Develops with every instruction set, alone and on the pool, and
+ * compares to single threaded scalar. Returns the number of mismatches;
+ * with iterations > 0 also prints timings.
+ */
+static int run(MtkPixelFormat in, MtkPixelFormat outFormat, int variant,
+        int width, int height, MtkThreadPool *pool, int iterations)
+{
+    MtkRawSettings settings;
+    frame src, ref, out;
+    double scalarNs = 0;
+    int errors = 0;
+
+    settingsFor(&settings, variant);
+    if (!alloc(&src, in, width, height) || !alloc(&ref, outFormat, width, height) ||
+            !alloc(&out, outFormat, width, height)) {
+        fprintf(stderr, "Cannot set up %dx%d %s\n", width, height, name(in));
+        exit(1);
+    }
+    fill(&src, width * 31 + variant);
+    memset(ref.data, 0, ref.size);
+    if (mtkRawProcess(src.image, &ref.image, settings, NULL, MTK_PIXEL_ISA_SCALAR) != NO_ERROR) {
+        fprintf(stderr, "%dx%d %s: scalar failed\n", width, height, name(in));
+        exit(1);
+    }
+
+    for (int isa = MTK_PIXEL_ISA_SCALAR; isa < MTK_PIXEL_ISA_COUNT; isa++) {
+        if (!mtkPixelIsaSupported(MtkPixelIsa(isa)))
+            continue;
+
+        for (int threaded = 0; threaded < 2; threaded++) {
+            MtkThreadPool *p = threaded ? pool : NULL;
+
+            memset(out.data, 0xa5, out.size);
+            if (mtkRawProcess(src.image, &out.image, settings, p, MtkPixelIsa(isa)) != NO_ERROR ||
+                    memcmp(out.data, ref.data, out.size) != 0) {
+                fprintf(stderr, "%dx%d %s -> %s, variant %d: %s%s output differs from scalar\n",
+                        width, height, name(in), name(outFormat), variant,
+                        mtkPixelIsaName(MtkPixelIsa(isa)), threaded ? " threaded" : "");
+                errors++;
+                continue;
+            }
+            if (iterations <= 0)
+                continue;
+
+            int64_t t0 = now_ns();
+            for (int i = 0; i < iterations; i++)
+                mtkRawProcess(src.image, &out.image, settings, p, MtkPixelIsa(isa));
+            double ns = (now_ns() - t0) / (double)iterations;
+            if (isa == MTK_PIXEL_ISA_SCALAR && !threaded)
+                scalarNs = ns;
+
+            printf("  %-7s -> %-4s %-10s %-7s x%-2d %8.2f ms %8.1f Mpix/s %6.1fx\n",
+                    name(in), name(outFormat),
+                    settings.demosaic == MTK_DEMOSAIC_EDGE_AWARE ? "edge-aware" : "bilinear",
+                    mtkPixelIsaName(MtkPixelIsa(isa)), threaded ? pool->size() : 1,
+                    ns / 1e6, width * (double)height * 1e3 / ns, scalarNs / ns);
+        }
+    }
+
+    free(src.data);
+    free(ref.data);
+    free(out.data);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    static const int sizes[][2] = { { 1920, 1080 }, { 4000, 3000 } };
+    static const int odd[][2] = { { 4, 4 }, { 36, 6 }, { 520, 34 }, { 1028, 70 } };
+    static const MtkPixelFormat inputs[] = { MTK_PIXEL_FORMAT_BAYER10, MTK_PIXEL_FORMAT_BAYER8 };
+    static const MtkPixelFormat outputs[] = { MTK_PIXEL_FORMAT_RGBA, MTK_PIXEL_FORMAT_NV21 };
+    int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    int errors = 0;
+
+    if (iterations <= 0)
+        iterations = 10;
+    if (threads < 0)
+        threads = 0;
+    MtkThreadPool pool(threads);
+
+    for (size_t i = 0; i < sizeof(odd) / sizeof(odd[0]); i++) {
+        for (int in = 0; in < 2; in++) {
+            for (int out = 0; out < 2; out++) {
+                for (int variant = 0; variant < 8; variant++) {
+                    errors += run(inputs[in], outputs[out], variant,
+                            odd[i][0], odd[i][1], &pool, 0);
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%dx%d, %d iterations:\n", sizes[i][0], sizes[i][1], iterations);
+        for (int in = 0; in < 2; in++) {
+            for (int out = 0; out < 2; out++) {
+                errors += run(inputs[in], outputs[out], 0, sizes[i][0], sizes[i][1], &pool, iterations);
+                errors += run(inputs[in], outputs[out], 4, sizes[i][0], sizes[i][1], &pool, iterations);
+            }
+        }
+    }
+
+    if (errors) {
+        fprintf(stderr, "%d developed frames did not match the scalar reference\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cost per frame of lens shading correction: the first frame of a size,
+ * which builds the gain map, and the ones after it, which find it in the
+ * cache. For 13MP BAYER10 and BAYER8 and 1080p NV21, with every
+ * instruction set the CPU has, on one thread and on a pool.
+ *
+ * The tables are written to directory and read back through their
+ * mappings; it defaults to /data/local/tmp where that is writable, as on
+ * a device, and to TMPDIR or /tmp elsewhere.
+ * Outputs are checked byte for byte against single threaded scalar on
+ * odd sizes and all Bayer patterns, a unity table has to leave frames
+ * alone, and the upsampled gains are checked against a floating point
+ * bilinear reference.
+ *
+ * Usage: camera_shading_bench [iterations] [threads] [directory]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "MtkLensShading.h"
+#include "bench_common.h"
+
+using namespace android;
+
+#define GRID_WIDTH      17
+#define GRID_HEIGHT     13
+
+// Radial fall-off of strength per channel, red the strongest; 0 is unity
+static uint16_t *makeGrid(float strength)
+{
+    static const float channel[MTK_SHADING_CHANNELS] = { 1.3f, 1.0f, 1.0f, 0.8f };
+    uint16_t *gains = (uint16_t *)malloc(MTK_SHADING_CHANNELS * GRID_WIDTH * GRID_HEIGHT * 2);
+
+    for (int c = 0; c < MTK_SHADING_CHANNELS; c++) {
+        for (int y = 0; y < GRID_HEIGHT; y++) {
+            for (int x = 0; x < GRID_WIDTH; x++) {
+                float dx = 2.0f * x / (GRID_WIDTH - 1) - 1, dy = 2.0f * y / (GRID_HEIGHT - 1) - 1;
+                float g = 1 + strength * channel[c] * (dx * dx + dy * dy);
+                gains[(c * GRID_HEIGHT + y) * GRID_WIDTH + x] = (uint16_t)(g * 1024 + 0.5f);
+            }
+        }
+    }
+    return gains;
+}
+
+static int channelAt(MtkBayerPattern pattern, int x, int y)
+{
+    bool redX = pattern == MTK_BAYER_GRBG || pattern == MTK_BAYER_BGGR;
+    bool redY = pattern == MTK_BAYER_GBRG || pattern == MTK_BAYER_BGGR;
+    bool redRow = ((y & 1) ^ redY) == 0, redCol = ((x & 1) ^ redX) == 0;
+
+    return redRow ? (redCol ? 0 : 1) : (redCol ? 2 : 3);
+}
+
+static double bilinear(const uint16_t *grid, int c, int x, int y, int width, int height)
+{
+    double gx = (double)x * (GRID_WIDTH - 1) / (width - 1);
+    double gy = (double)y * (GRID_HEIGHT - 1) / (height - 1);
+    int i = gx < GRID_WIDTH - 2 ? (int)gx : GRID_WIDTH - 2;
+    int j = gy < GRID_HEIGHT - 2 ? (int)gy : GRID_HEIGHT - 2;
+    const uint16_t *p = grid + (c * GRID_HEIGHT + j) * GRID_WIDTH + i;
+    double fx = gx - i, fy = gy - j;
+
+    return (p[0] * (1 - fx) + p[1] * fx) * (1 - fy) +
+            (p[GRID_WIDTH] * (1 - fx) + p[GRID_WIDTH + 1] * fx) * fy;
+}
+
+// A flat BAYER8 frame through the table against the reference gains
+static int checkGains(MtkLensShading *shading, const uint16_t *grid, MtkBayerPattern pattern,
+        int width, int height)
+{
+    frame f;
+    int errors = 0;
+
+    if (!alloc(&f, MTK_PIXEL_FORMAT_BAYER8, width, height)) {
+        fprintf(stderr, "Cannot set up %dx%d\n", width, height);
+        exit(1);
+    }
+    memset(f.data, 40, f.size);
+    shading->apply(&f.image, pattern);
+    for (int y = 0; y < height && errors < 4; y++) {
+        for (int x = 0; x < width; x++) {
+            double want = 40 * bilinear(grid, channelAt(pattern, x, y), x, y, width, height)
+                    / 1024;
+            if (want > 255)
+                want = 255;
+            int got = f.image.planes[0][f.image.strides[0] * y + x];
+            // The kernels truncate, and the map gains are rounded to Q10
+            if (fabs(got - floor(want)) > 1) {
+                fprintf(stderr, "%dx%d pattern %d: %g at %d,%d, got %d\n", width, height,
+                        pattern, want, x, y, got);
+                errors++;
+                break;
+            }
+        }
+    }
+    free(f.data);
+    return errors;
+}
+
+/*
+ * Corrects one frame with every instruction set, alone and on the pool,
+ * and compares to single threaded scalar. Returns the number of
+ * mismatches; with iterations > 0 also prints timings.
+ */
+static int run(MtkLensShading *shading, MtkPixelFormat format, MtkBayerPattern pattern,
+        int width, int height, MtkThreadPool *pool, int iterations)
+{
+    frame src, ref, out;
+    double scalarNs = 0;
+    int errors = 0;
+
+    if (!alloc(&src, format, width, height) || !alloc(&ref, format, width, height) ||
+            !alloc(&out, format, width, height)) {
+        fprintf(stderr, "Cannot set up %dx%d\n", width, height);
+        exit(1);
+    }
+    fillNoise(&src, width * 31 + height);
+    memcpy(ref.data, src.data, src.size);
+
+    MtkShadingStats before, after;
+    shading->stats(&before);
+    int64_t t0 = now_ns();
+    if (shading->apply(&ref.image, pattern, NULL, MTK_PIXEL_ISA_SCALAR) != NO_ERROR) {
+        fprintf(stderr, "%dx%d: scalar failed\n", width, height);
+        exit(1);
+    }
+    shading->stats(&after);
+    if (iterations > 0) {
+        printf("  first frame, scalar x1  %8.2f ms, gain map %s\n", (now_ns() - t0) / 1e6,
+                after.misses > before.misses ? "built" : "cached");
+    }
+
+    for (int isa = MTK_PIXEL_ISA_SCALAR; isa < MTK_PIXEL_ISA_COUNT; isa++) {
+        if (!mtkPixelIsaSupported(MtkPixelIsa(isa)))
+            continue;
+
+        for (int threaded = 0; threaded < 2; threaded++) {
+            MtkThreadPool *p = threaded ? pool : NULL;
+
+            memcpy(out.data, src.data, src.size);
+            if (shading->apply(&out.image, pattern, p, MtkPixelIsa(isa)) != NO_ERROR ||
+                    memcmp(out.data, ref.data, out.size) != 0) {
+                fprintf(stderr, "%dx%d format %d pattern %d: %s%s output differs from scalar\n",
+                        width, height, format, pattern, mtkPixelIsaName(MtkPixelIsa(isa)),
+                        threaded ? " threaded" : "");
+                errors++;
+                continue;
+            }
+            if (iterations <= 0)
+                continue;
+
+            // Shading the same frame over and over saturates it, which
+            // costs the same
+            int64_t t1 = now_ns();
+            for (int i = 0; i < iterations; i++)
+                shading->apply(&out.image, pattern, p, MtkPixelIsa(isa));
+            double ns = (now_ns() - t1) / (double)iterations;
+            if (isa == MTK_PIXEL_ISA_SCALAR && !threaded)
+                scalarNs = ns;
+
+            printf("  %-7s x%-2d %8.2f ms %8.1f Mpix/s %6.1fx\n",
+                    mtkPixelIsaName(MtkPixelIsa(isa)), threaded ? pool->size() : 1,
+                    ns / 1e6, width * (double)height * 1e3 / ns, scalarNs / ns);
+        }
+    }
+
+    free(src.data);
+    free(ref.data);
+    free(out.data);
+    return errors;
+}
+
+// A unity table leaves every format as it was
+static int checkUnity(MtkLensShading *shading)
+{
+    static const MtkPixelFormat formats[] = {
+        MTK_PIXEL_FORMAT_BAYER8, MTK_PIXEL_FORMAT_BAYER10, MTK_PIXEL_FORMAT_NV21,
+    };
+    int errors = 0;
+
+    shading->select(MtkCameraParameters::KEY_ENG_SHADING_TABLE_TSF);
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        frame f, copy;
+        if (!alloc(&f, formats[i], 132, 68) || !alloc(&copy, formats[i], 132, 68)) {
+            fprintf(stderr, "Cannot set up 132x68\n");
+            exit(1);
+        }
+        fillNoise(&f, i);
+        memcpy(copy.data, f.data, f.size);
+        if (shading->apply(&f.image) != NO_ERROR || memcmp(f.data, copy.data, f.size) != 0) {
+            fprintf(stderr, "Unity table changed format %d\n", formats[i]);
+            errors++;
+        }
+        free(f.data);
+        free(copy.data);
+    }
+    return errors;
+}
+
+// Where the tables go without a directory argument
+static const char *scratchDir()
+{
+    const char *tmp = getenv("TMPDIR");
+
+    if (access("/data/local/tmp", W_OK) == 0)
+        return "/data/local/tmp";
+    return tmp != NULL && tmp[0] != 0 ? tmp : "/tmp";
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [iterations] [threads] [directory]\n"
+            "directory has to exist and be writable\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    static const int odd[][2] = { { 4, 2 }, { 36, 18 }, { 132, 66 }, { 1028, 6 } };
+    static const MtkPixelFormat formats[] = {
+        MTK_PIXEL_FORMAT_BAYER8, MTK_PIXEL_FORMAT_BAYER10, MTK_PIXEL_FORMAT_NV21,
+    };
+    int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    const char *dir = argc > 3 ? argv[3] : scratchDir();
+    int errors = 0;
+
+    if (iterations <= 0)
+        iterations = 10;
+    if (threads < 0)
+        threads = 0;
+    MtkThreadPool pool(threads);
+
+    // Written by one instance, mapped by another
+    uint16_t *grids[MTK_SHADING_TABLES] = {
+        NULL, makeGrid(1.0f), makeGrid(1.5f), makeGrid(2.0f), makeGrid(0),
+    };
+    {
+        MtkLensShading writer;
+        MtkCameraParameters params;
+
+        if (writer.init(dir) != NO_ERROR) {
+            fprintf(stderr, "Cannot use %s\n", dir);
+            usage(argv[0]);
+            return 1;
+        }
+        for (int t = 1; t < MTK_SHADING_TABLES; t++) {
+            MtkShadingGrid grid = { GRID_WIDTH, GRID_HEIGHT, grids[t] };
+            writer.setTable(t, grid);
+        }
+        params.set(MTK_KEY_ENG_SAVE_SHADING_TABLE, 1);
+        if (writer.configure(params) != NO_ERROR) {
+            fprintf(stderr, "Cannot save the tables to %s\n", dir);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    MtkLensShading shading;
+    MtkCameraParameters params;
+    shading.init(dir);
+    params.set(MTK_KEY_ENG_SHADING_TABLE, MtkCameraParameters::KEY_ENG_SHADING_TABLE_AUTO);
+    if (MtkLensShading::table(params, 2800) != MtkCameraParameters::KEY_ENG_SHADING_TABLE_LOW ||
+            MtkLensShading::table(params) != MtkCameraParameters::KEY_ENG_SHADING_TABLE_MIDDLE) {
+        fprintf(stderr, "AUTO picks the wrong table\n");
+        errors++;
+    }
+    params.set(MTK_KEY_ENG_SHADING_TABLE, MtkCameraParameters::KEY_ENG_SHADING_TABLE_HIGH);
+    shading.configure(params);
+
+    for (int p = MTK_BAYER_RGGB; p <= MTK_BAYER_BGGR; p++) {
+        errors += checkGains(&shading, grids[MtkCameraParameters::KEY_ENG_SHADING_TABLE_HIGH],
+                MtkBayerPattern(p), 132, 66);
+    }
+    for (size_t i = 0; i < sizeof(odd) / sizeof(odd[0]); i++) {
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            for (int p = MTK_BAYER_RGGB; p <= MTK_BAYER_BGGR; p++)
+                errors += run(&shading, formats[f], MtkBayerPattern(p), odd[i][0], odd[i][1],
+                        &pool, 0);
+        }
+    }
+    errors += checkUnity(&shading);
+
+    struct {
+        MtkPixelFormat format;
+        const char *name;
+        int width;
+        int height;
+    } sizes[] = {
+        { MTK_PIXEL_FORMAT_BAYER10, "BAYER10", 4160, 3120 },
+        { MTK_PIXEL_FORMAT_BAYER8, "BAYER8", 4160, 3120 },
+        { MTK_PIXEL_FORMAT_NV21, "NV21", 1920, 1080 },
+    };
+    MtkLensShading timed;
+    timed.init(dir);
+    timed.select(MtkCameraParameters::KEY_ENG_SHADING_TABLE_MIDDLE);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%s %dx%d, %d iterations:\n", sizes[i].name, sizes[i].width, sizes[i].height,
+                iterations);
+        errors += run(&timed, sizes[i].format, MTK_BAYER_RGGB, sizes[i].width, sizes[i].height,
+                &pool, iterations);
+    }
+
+    MtkShadingStats stats;
+    timed.stats(&stats);
+    printf("%d tables mapped, %d gain maps cached in %.1f MB, %llu hits, %llu builds\n",
+            stats.tables, stats.maps, stats.mapBytes / 1048576.0,
+            (unsigned long long)stats.hits, (unsigned long long)stats.misses);
+
+    for (int t = 0; t < MTK_SHADING_TABLES; t++)
+        free(grids[t]);
+    if (errors) {
+        fprintf(stderr, "%d checks failed\n", errors);
+        return 1;
+    }
+    return 0;
+}
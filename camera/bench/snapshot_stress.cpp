@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stress test for MtkCameraParametersPublisher: reader threads take a
+ * snapshot and read zsd-mode and cap-mode in a loop, first alone and then
+ * while a writer flips both as fast as it can. Prints the read latency
+ * percentiles of each phase, for snapshots and for the same reads behind
+ * a mutex. Exits non-zero if a reader sees a torn or unknown value.
+ *
+ * Usage: camera_snapshot_stress [readers] [milliseconds per phase]
+ */
+
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "MtkCameraSnapshot.h"
+#include "bench_common.h"
+
+using namespace android;
+
+#define MAX_READERS     16
+#define BUCKETS         128
+
+static const char *const zsdModes[] = {
+    MtkCameraParameters::OFF,
+    MtkCameraParameters::ON,
+    NULL
+};
+
+static const char *const captureModes[] = {
+    MtkCameraParameters::CAPTURE_MODE_NORMAL,
+    MtkCameraParameters::CAPTURE_MODE_ZSD_SHOT,
+    NULL
+};
+
+/*
+ * Latencies go into buckets of 1/4 power of two, fine enough for the
+ * percentiles and cheap enough to record in the loop.
+ */
+static int bucket(int64_t ns)
+{
+    if (ns < 4)
+        return ns < 0 ? 0 : (int)ns;
+    int log = 63 - __builtin_clzll(ns);
+    int b = log * 4 + (int)((ns >> (log - 2)) & 3) - 4;
+    return b < BUCKETS ? b : BUCKETS - 1;
+}
+
+static int64_t bucketFloor(int b)
+{
+    if (b < 4)
+        return b;
+    int log = (b + 4) / 4;
+    return (4LL + (b + 4) % 4) << (log - 2);
+}
+
+struct histogram {
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    int64_t max;
+};
+
+static void add(histogram *h, const histogram &other)
+{
+    for (int i = 0; i < BUCKETS; i++)
+        h->counts[i] += other.counts[i];
+    h->total += other.total;
+    if (other.max > h->max)
+        h->max = other.max;
+}
+
+static int64_t percentile(const histogram &h, double p)
+{
+    uint64_t want = (uint64_t)(h.total * p);
+    uint64_t seen = 0;
+
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += h.counts[i];
+        if (seen > want)
+            return bucketFloor(i);
+    }
+    return h.max;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Threads
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+struct shared {
+    MtkCameraParametersPublisher publisher;
+    Mutex lock;
+    MtkCameraParameters locked;
+    bool useLock;
+    std::atomic<bool> stop;
+    std::atomic<int> errors;
+    std::atomic<uint64_t> writes;
+};
+
+struct reader {
+    pthread_t thread;
+    shared *s;
+    histogram h;
+};
+
+// Both keys always change together, a snapshot must never mix them
+static bool consistent(const MtkCameraParameters &params)
+{
+    int zsd = params.getEnum(MTK_KEY_ZSD_MODE, zsdModes);
+    int capture = params.getEnum(MTK_KEY_CAPTURE_MODE, captureModes);
+
+    return zsd >= 0 && zsd == capture;
+}
+
+static void *readerLoop(void *arg)
+{
+    reader *r = (reader *)arg;
+    shared *s = r->s;
+
+    memset(&r->h, 0, sizeof(r->h));
+    while (!s->stop.load(std::memory_order_relaxed)) {
+        int64_t t0 = now_ns();
+        bool ok;
+        if (s->useLock) {
+            Mutex::Autolock _l(s->lock);
+            ok = consistent(s->locked);
+        } else {
+            sp<const MtkCameraParametersSnapshot> snapshot = s->publisher.snapshot();
+            ok = consistent(snapshot->params());
+        }
+        int64_t ns = now_ns() - t0;
+
+        if (!ok)
+            s->errors.fetch_add(1, std::memory_order_relaxed);
+        r->h.counts[bucket(ns)]++;
+        r->h.total++;
+        if (ns > r->h.max)
+            r->h.max = ns;
+    }
+    return NULL;
+}
+
+static void set(MtkCameraParameters &params, int mode)
+{
+    params.set(MTK_KEY_ZSD_MODE, zsdModes[mode]);
+    params.set(MTK_KEY_CAPTURE_MODE, captureModes[mode]);
+}
+
+static void *writerLoop(void *arg)
+{
+    shared *s = (shared *)arg;
+    int mode = 0;
+
+    while (!s->stop.load(std::memory_order_relaxed)) {
+        mode ^= 1;
+        if (s->useLock) {
+            Mutex::Autolock _l(s->lock);
+            set(s->locked, mode);
+        } else {
+            s->publisher.update([mode](MtkCameraParameters &params) { set(params, mode); });
+        }
+        s->writes.fetch_add(1, std::memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static void phase(shared *s, const char *name, int readers, int ms, bool writer)
+{
+    reader r[MAX_READERS];
+    pthread_t w;
+    histogram h;
+
+    s->stop = false;
+    s->writes = 0;
+    for (int i = 0; i < readers; i++) {
+        r[i].s = s;
+        pthread_create(&r[i].thread, NULL, readerLoop, &r[i]);
+    }
+    if (writer)
+        pthread_create(&w, NULL, writerLoop, s);
+
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+    s->stop = true;
+
+    memset(&h, 0, sizeof(h));
+    for (int i = 0; i < readers; i++) {
+        pthread_join(r[i].thread, NULL);
+        add(&h, r[i].h);
+    }
+    if (writer)
+        pthread_join(w, NULL);
+
+    printf("  %-28s %10llu reads %8llu writes   p50 %6lld  p99 %6lld  p99.9 %7lld  max %8lld ns\n",
+            name, (unsigned long long)h.total, (unsigned long long)s->writes.load(),
+            (long long)percentile(h, 0.5), (long long)percentile(h, 0.99),
+            (long long)percentile(h, 0.999), (long long)h.max);
+}
+
+int main(int argc, char **argv)
+{
+    int readers = argc > 1 ? atoi(argv[1]) : 4;
+    int ms = argc > 2 ? atoi(argv[2]) : 1000;
+    MtkCameraParameters params;
+    shared *s = new shared();
+
+    if (readers <= 0 || readers > MAX_READERS)
+        readers = 4;
+    if (ms <= 0)
+        ms = 1000;
+
+    set(params, 0);
+    params.set(MtkCameraParameters::KEY_SUPPORTED_CAPTURE_MODES, "normal,zsd");
+    s->publisher.publish(params);
+    s->locked = params;
+
+    printf("%d readers, %d ms per phase:\n", readers, ms);
+    s->useLock = false;
+    phase(s, "snapshot, no writer", readers, ms, false);
+    phase(s, "snapshot, writer", readers, ms, true);
+    s->useLock = true;
+    phase(s, "mutex, no writer", readers, ms, false);
+    phase(s, "mutex, writer", readers, ms, true);
+
+    int errors = s->errors.load();
+    delete s;
+    if (errors) {
+        fprintf(stderr, "%d reads saw zsd-mode and cap-mode out of step\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks MtkCameraCapabilities against a sensor's worth of supported
+ * lists and limits: a clean parameter set passes, a set with known bad
+ * values reports each of them and nothing else, and on random sets the
+ * index agrees with checking the old way, splitting the comma lists
+ * every time, and the index takes as many values as it can hold and no
+ * more. Then times a whole setParameters() check both ways, and against
+ * a budget.
+ *
+ * Usage: camera_validate_bench [iterations]
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MtkCameraCapabilities.h"
+#include "bench_common.h"
+
+using namespace android;
+
+// Most a whole check may take per setParameters()
+#define BUDGET_NS   100000
+
+// What a sensor publishes, close to the main camera of a MT6735 device
+static void fillSupported(MtkCameraParameters *p)
+{
+    static const char *const lists[][2] = {
+        { "cap-mode-values", "normal,face_beauty,continuousshot,smileshot,bestshot,"
+                "evbracketshot,autorama,mav,hdr,asd,zsd,pano_3d,single_3d,gestureshot" },
+        { "zsd-supported", "off,on" },
+        { "iso-speed-values", "auto,100,200,400,800,1600" },
+        { "exposure-meter-values", "center,spot,average" },
+        { "focus-meter-values", "spot,multi" },
+        { "edge-values", "low,middle,high" },
+        { "hue-values", "low,middle,high" },
+        { "saturation-values", "low,middle,high" },
+        { "brightness-values", "low,middle,high" },
+        { "contrast-values", "low,middle,high" },
+        { "aflamp-mode-values", "off,on,auto" },
+        { "ae-mode-values", "auto,sport,night" },
+        { "awb-2pass-values", "on,off" },
+        { "video-hdr-values", "on,off" },
+        { "face-beauty-values", "false,true" },
+        { "fb-extreme-beauty-values", "false,true" },
+        { "pano-dir-values", "right,left,top,down" },
+        { "prv-int-fmt-values", "yuv420p,yuv420sp,yuv422i-yuyv" },
+        { "stereo3d-preview-size-values", "1280x720,960x540,640x480, 320x240" },
+        { "stereo3d-picture-size-values", "2560x1440,1920x1080" },
+        { "burst-num-values", "1,3,5,10,20,40" },
+    };
+    static const char *const limits[][2] = {
+        { "fb-smooth-level-min", "-4" }, { "fb-smooth-level-max", "4" },
+        { "fb-skin-color-min", "-4" }, { "fb-skin-color-max", "4" },
+        { "fb-sharp-min", "-4" }, { "fb-sharp-max", "4" },
+        { "fb-enlarge-eye-min", "-4" }, { "fb-enlarge-eye-max", "4" },
+        { "fb-slim-face-min", "-4" }, { "fb-slim-face-max", "4" },
+        { "eng-flash-duty-min", "0" }, { "eng-flash-duty-max", "31" },
+    };
+
+    for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++)
+        p->set(lists[i][0], lists[i][1]);
+    for (size_t i = 0; i < sizeof(limits) / sizeof(limits[0]); i++)
+        p->set(limits[i][0], limits[i][1]);
+}
+
+// A set the app could send back: everything supported, plus settings
+static void fillValid(MtkCameraParameters *p)
+{
+    static const char *const values[][2] = {
+        { "cap-mode", "normal" }, { "zsd-mode", "off" }, { "iso-speed", "auto" },
+        { "exposure-meter", "center" }, { "focus-meter", "spot" }, { "edge", "middle" },
+        { "hue", "middle" }, { "saturation", "middle" }, { "brightness", "middle" },
+        { "contrast", "middle" }, { "aflamp-mode", "off" }, { "ae-mode", "auto" },
+        { "awb-2pass", "on" }, { "video-hdr", "off" }, { "face-beauty", "false" },
+        { "fb-extreme-beauty", "false" }, { "pano-dir", "right" },
+        { "prv-int-fmt", "yuv420sp" }, { "stereo3d-preview-size", "640x480" },
+        { "stereo3d-picture-size", "1920x1080" }, { "burst-num", "3" },
+        { "fb-smooth-level", "0" }, { "fb-skin-color", "0" }, { "fb-sharp", "0" },
+        { "fb-enlarge-eye", "0" }, { "fb-slim-face", "0" }, { "eng-flash-duty-value", "8" },
+        { "preview-size", "1280x720" }, { "picture-size", "4160x3120" },
+        { "capfname", "/sdcard/DCIM/cap.jpg" },
+    };
+
+    fillSupported(p);
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        p->set(values[i][0], values[i][1]);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  The old way: split the list of the key on every check
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static const char *naiveList(const MtkCameraParameters &s, MtkCameraKey id)
+{
+    if (id == MTK_KEY_CAPTURE_MODE)
+        return s.get(MTK_KEY_SUPPORTED_CAPTURE_MODES);
+    if (id == MTK_KEY_ZSD_MODE)
+        return s.get(MTK_KEY_SUPPORTED_ZSD_MODE);
+
+    char name[128];
+    snprintf(name, sizeof(name), "%s-values", MtkCameraParameters::keyName(id));
+    return s.get(name);
+}
+
+static bool naiveNumber(const char *v, long *n)
+{
+    char *end;
+
+    *n = strtol(v, &end, 10);
+    return end != v && *end == '\0' && *n >= INT_MIN && *n <= INT_MAX;
+}
+
+static bool naiveSize(const char *v, long *w, long *h)
+{
+    char *end;
+
+    *w = strtol(v, &end, 10);
+    if (end == v || *end != 'x' || *w <= 0)
+        return false;
+    v = end + 1;
+    *h = strtol(v, &end, 10);
+    return end != v && *end == '\0' && *h > 0;
+}
+
+// -1 for fine, else the violation kind
+static int naiveCheck(const MtkCameraParameters &s, MtkCameraKey id, const char *value)
+{
+    MtkCameraKeyType type = MtkCameraParameters::keyType(id);
+    const char *list = naiveList(s, id);
+    long n = 0, w = 0, h = 0;
+    int min, max;
+
+    if (type == MTK_KEY_TYPE_INT && !naiveNumber(value, &n))
+        return list != NULL || s.getRange(id, &min, &max) == NO_ERROR ?
+                MTK_VIOLATION_MALFORMED : -1;
+    if (type == MTK_KEY_TYPE_SIZE && list != NULL && !naiveSize(value, &w, &h))
+        return MTK_VIOLATION_MALFORMED;
+    if (list != NULL) {
+        char *copy = strdup(list), *save, *item;
+        bool found = false;
+        for (item = strtok_r(copy, ",", &save); item != NULL && !found;
+                item = strtok_r(NULL, ",", &save)) {
+            while (*item == ' ')
+                item++;
+            long iw, ih, in;
+            if (type == MTK_KEY_TYPE_ENUM)
+                found = strcmp(item, value) == 0;
+            else if (type == MTK_KEY_TYPE_SIZE)
+                found = naiveSize(item, &iw, &ih) && iw == w && ih == h;
+            else
+                found = naiveNumber(item, &in) && in == n;
+        }
+        free(copy);
+        if (!found)
+            return MTK_VIOLATION_UNSUPPORTED;
+    }
+    if (type == MTK_KEY_TYPE_INT && s.getRange(id, &min, &max) == NO_ERROR &&
+            (n < min || n > max))
+        return MTK_VIOLATION_OUT_OF_RANGE;
+    return -1;
+}
+
+static int naiveValidate(const MtkCameraParameters &s, const MtkCameraParameters &p)
+{
+    int count = 0;
+
+    for (int i = 0; i < MTK_KEY_COUNT; i++) {
+        MtkCameraKeyType type = MtkCameraParameters::keyType(MtkCameraKey(i));
+        const char *value = p.get(MtkCameraKey(i));
+        if (value != NULL && type != MTK_KEY_TYPE_STRING && type != MTK_KEY_TYPE_FLOAT &&
+                naiveCheck(s, MtkCameraKey(i), value) >= 0)
+            count++;
+    }
+    return count;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Checks
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+static int checkKnown(const MtkCameraCapabilities &caps)
+{
+    static const struct {
+        MtkCameraKey id;
+        const char *value;
+        MtkCameraViolationKind kind;
+    } bad[] = {
+        { MTK_KEY_FB_SMOOTH_LEVEL, "9", MTK_VIOLATION_OUT_OF_RANGE },
+        { MTK_KEY_ISO_SPEED, "3200", MTK_VIOLATION_UNSUPPORTED },
+        { MTK_KEY_STEREO_3D_PREVIEW_SIZE, "640x", MTK_VIOLATION_MALFORMED },
+        { MTK_KEY_ZSD_MODE, "maybe", MTK_VIOLATION_UNSUPPORTED },
+        { MTK_KEY_CAPTURE_MODE, "panoramashot", MTK_VIOLATION_UNSUPPORTED },
+        { MTK_KEY_BURST_SHOT_NUM, "2", MTK_VIOLATION_UNSUPPORTED },
+        { MTK_KEY_ENG_FLASH_DUTY_VALUE, "high", MTK_VIOLATION_MALFORMED },
+    };
+    MtkCameraParameters params;
+    MtkCameraValidation result;
+    int errors = 0;
+
+    fillValid(&params);
+    if (caps.validate(params, &result) != NO_ERROR || result.checked < 25) {
+        fprintf(stderr, "Valid set: %d violations in %d values\n", result.count,
+                result.checked);
+        errors++;
+    }
+    if (!caps.supports(MTK_KEY_ISO_SPEED, "1600") || caps.supports(MTK_KEY_ISO_SPEED, "1601") ||
+            !caps.supports(MTK_KEY_STEREO_3D_PREVIEW_SIZE, "320x240") ||
+            !caps.supports(MTK_KEY_CAPTURE_PATH, "anything")) {
+        fprintf(stderr, "Single values are not checked right\n");
+        errors++;
+    }
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+        params.set(bad[i].id, bad[i].value);
+    for (int flat = 0; flat < 2; flat++) {
+        status_t err = flat ? caps.validate(params.flatten().string(), &result) :
+                caps.validate(params, &result);
+        bool ok = err == BAD_VALUE && result.count == (int)(sizeof(bad) / sizeof(bad[0]));
+
+        for (size_t i = 0; ok && i < sizeof(bad) / sizeof(bad[0]); i++) {
+            int j = 0;
+            while (j < result.count && result.violations[j].id != bad[i].id)
+                j++;
+            ok = j < result.count && result.violations[j].kind == bad[i].kind;
+        }
+        if (!ok) {
+            fprintf(stderr, "Bad set%s: %d violations, want %zu\n", flat ? " flattened" : "",
+                    result.count, sizeof(bad) / sizeof(bad[0]));
+            for (int j = 0; j < result.count; j++)
+                fprintf(stderr, "  %s: %s\n",
+                        MtkCameraParameters::keyName(result.violations[j].id),
+                        MtkCameraCapabilities::kindName(result.violations[j].kind));
+            errors++;
+        }
+    }
+
+    // Only the keys asked for
+    MtkCameraKeySet keys;
+    keys.add(MTK_KEY_ISO_SPEED);
+    keys.add(MTK_KEY_EDGE);
+    if (caps.validate(params, &result, &keys) != BAD_VALUE || result.count != 1 ||
+            result.checked != 2) {
+        fprintf(stderr, "Key subset: %d violations in %d values\n", result.count,
+                result.checked);
+        errors++;
+    }
+    return errors;
+}
+
+// Random values for the indexed keys, good and bad, against the old way
+static int checkRandom(const MtkCameraParameters &supported, const MtkCameraCapabilities &caps,
+        int rounds)
+{
+    static const char *const pool[] = {
+        "normal", "hdr", "panoramashot", "on", "off", "auto", "100", "3200", "low", "high",
+        "spot", "multi", "true", "false", "right", "up", "yuv420sp", "rgb565", "640x480",
+        "641x480", "1920x1080", "2560x1440", "x", "12x", "0x0", "-1", "0", "4", "5", "-4",
+        "-5", "31", "32", "abc", "1 ", "2147483648", "-2147483648", "3", "40", "",
+    };
+    uint32_t seed = 1;
+    int errors = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        MtkCameraParameters params;
+        MtkCameraValidation result;
+
+        fillValid(&params);
+        for (int i = 0; i < MTK_KEY_COUNT; i++) {
+            seed = seed * 1103515245 + 12345;
+            if (caps.isIndexed(MtkCameraKey(i)) && (seed >> 16) % 3 == 0)
+                params.set(MtkCameraKey(i), pool[(seed >> 8) % (sizeof(pool) / sizeof(pool[0]))]);
+        }
+        caps.validate(params, &result);
+
+        // The string has "key=" for an empty value, it has to count as unset too
+        MtkCameraValidation flat;
+        caps.validate(params.flatten().string(), &flat);
+
+        int want = naiveValidate(supported, params);
+        bool ok = result.count == want && flat.count == want && flat.checked == result.checked;
+        for (int j = 0; ok && j < result.count; j++) {
+            MtkCameraKey id = result.violations[j].id;
+            ok = naiveCheck(supported, id, params.get(id)) == (int)result.violations[j].kind;
+        }
+        if (!ok) {
+            fprintf(stderr, "Round %d: %d violations, %d off the string, the old way %d\n", r,
+                    result.count, flat.count, want);
+            for (int j = 0; j < result.count; j++) {
+                MtkCameraKey id = result.violations[j].id;
+                fprintf(stderr, "  %s=%s: %s\n", MtkCameraParameters::keyName(id),
+                        params.get(id),
+                        MtkCameraCapabilities::kindName(result.violations[j].kind));
+            }
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// Slots index up to 0xfffe values, one more has to be turned down
+static int checkLimit()
+{
+    int errors = 0;
+
+    for (int count = 0xfffe; count <= 0xffff; count++) {
+        MtkCameraParameters supported;
+        MtkCameraCapabilities caps;
+        String8 list, last;
+
+        for (int i = 0; i < count; i++) {
+            last = String8::format("mode%d", i);
+            if (i > 0)
+                list.append(",");
+            list.append(last);
+        }
+        supported.set("cap-mode-values", list.string());
+
+        status_t err = caps.init(supported);
+        bool ok = count < 0xffff ? err == NO_ERROR &&
+                caps.supports(MTK_KEY_CAPTURE_MODE, last.string()) &&
+                caps.supports(MTK_KEY_CAPTURE_MODE, "mode0") &&
+                !caps.supports(MTK_KEY_CAPTURE_MODE, "normal") : err == BAD_VALUE;
+        if (!ok) {
+            fprintf(stderr, "%d values: init() gave %d\n", count, err);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+    MtkCameraParameters supported, params;
+    MtkCameraCapabilities caps;
+    MtkCameraValidation result;
+    int errors = 0;
+
+    if (iterations <= 0)
+        iterations = 100000;
+    fillSupported(&supported);
+
+    int64_t t0 = now_ns();
+    if (caps.init(supported) != NO_ERROR) {
+        fprintf(stderr, "Cannot index the capabilities\n");
+        return 1;
+    }
+    printf("index built in %.1f us\n", (now_ns() - t0) / 1e3);
+
+    errors += checkKnown(caps);
+    errors += checkRandom(supported, caps, 2000);
+    errors += checkLimit();
+
+    fillValid(&params);
+    String8 flat = params.flatten();
+    nsecs_t slowest = 0, total = 0;
+    for (int i = 0; i < iterations; i++) {
+        caps.validate(params, &result);
+        total += result.elapsed;
+        slowest = result.elapsed > slowest ? result.elapsed : slowest;
+    }
+    double indexNs = (double)total / iterations;
+
+    t0 = now_ns();
+    for (int i = 0; i < iterations; i++)
+        caps.validate(flat.string(), &result);
+    double flatNs = (double)(now_ns() - t0) / iterations;
+
+    int naiveIterations = iterations / 10 > 0 ? iterations / 10 : 1;
+    t0 = now_ns();
+    for (int i = 0; i < naiveIterations; i++)
+        naiveValidate(supported, params);
+    double naiveNs = (double)(now_ns() - t0) / naiveIterations;
+
+    printf("%d values per set, ns per setParameters() check:\n", result.checked);
+    printf("  index          %9.0f  slowest %lld\n", indexNs, (long long)slowest);
+    printf("  index, string  %9.0f\n", flatNs);
+    printf("  lists split    %9.0f  %.1fx\n", naiveNs, naiveNs / indexNs);
+    if (indexNs > BUDGET_NS || flatNs > BUDGET_NS) {
+        fprintf(stderr, "Over the budget of %d ns\n", BUDGET_NS);
+        errors++;
+    }
+
+    if (errors) {
+        fprintf(stderr, "%d checks failed\n", errors);
+        return 1;
+    }
+    return 0;
+}
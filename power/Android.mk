@@ -14,16 +14,95 @@
 
 LOCAL_PATH := $(call my-dir)
 
+# Node layout must match between the HAL and the tools reading its stats
+power_cflags :=
+ifneq ($(TARGET_TAP_TO_WAKE_NODE),)
+  power_cflags += -DTAP_TO_WAKE_NODE=\"$(TARGET_TAP_TO_WAKE_NODE)\"
+endif
+
+power_src_files := \
+    power.c \
+    boost.c \
+    dispatch.c \
+    looper.c \
+    nodes.c \
+    pacing.c \
+    profile.c \
+    stats.c \
+    thermal.c \
+    video.c
+
 include $(CLEAR_VARS)
 
 LOCAL_MODULE := power.$(TARGET_BOARD_PLATFORM)
 LOCAL_MODULE_RELATIVE_PATH := hw
-LOCAL_SRC_FILES := power.c
-LOCAL_SHARED_LIBRARIES := liblog
-LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := $(power_src_files)
 
-ifneq ($(TARGET_TAP_TO_WAKE_NODE),)
-  LOCAL_CFLAGS += -DTAP_TO_WAKE_NODE=\"$(TARGET_TAP_TO_WAKE_NODE)\"
-endif
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(power_cflags)
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := powerhal_stats
+LOCAL_SRC_FILES := \
+    tools/powerhal_stats.c \
+    nodes.c \
+    stats.c
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(power_cflags)
+
+include $(BUILD_EXECUTABLE)
+
+# Host build of the HAL and the trace replay benchmark that drives it
+# against a fake sysfs tree, see bench/power_bench.c. bench/Makefile builds
+# the same outside of the platform build.
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := power.$(TARGET_BOARD_PLATFORM)_host
+LOCAL_SRC_FILES := $(power_src_files)
+LOCAL_STATIC_LIBRARIES := liblog libcutils
+LOCAL_LDLIBS := -lpthread
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(power_cflags)
+
+include $(BUILD_HOST_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := power_bench
+LOCAL_SRC_FILES := \
+    bench/power_bench.c \
+    nodes.c \
+    stats.c
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)
+LOCAL_STATIC_LIBRARIES := liblog libcutils
+LOCAL_LDLIBS := -ldl -lpthread
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(power_cflags)
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := power_dispatch_test
+LOCAL_SRC_FILES := \
+    bench/dispatch_test.c \
+    dispatch.c \
+    looper.c \
+    nodes.c \
+    stats.c
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)
+LOCAL_STATIC_LIBRARIES := liblog libcutils
+LOCAL_LDLIBS := -lpthread
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(power_cflags)
+
+include $(BUILD_HOST_EXECUTABLE)
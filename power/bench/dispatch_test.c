@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks that the dispatcher never runs a hint on the caller: with the
+ * looper parked in the handler, a burst of hints overflows the event
+ * queue. The overflow must be dropped and counted, and once the looper
+ * gets going again every state hint must come out as the newest one
+ * sent, exactly once. Video sessions overflow their queue too, but every
+ * start and stop must be handled, a stop never before its start.
+ *
+ * Usage: power_dispatch_test
+ */
+#include <errno.h>
+#include <ftw.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include <hardware/power.h>
+
+#include "dispatch.h"
+#include "looper.h"
+#include "nodes.h"
+#include "stats.h"
+#include "util.h"
+
+#define BURST           200
+#define DRAIN_TIMEOUT_NS (5 * NSEC_PER_SEC)
+
+static pthread_t caller;
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gate_cond = PTHREAD_COND_INITIALIZER;
+static int parked, released;
+
+/* Looper thread only */
+static int on_caller;
+static int interactions;
+static int low_power_count, low_power = -1;
+static int profile_count, profile = -1;
+static int vsync_count, vsync = -1;
+static int video_starts, video_stops, video_open, video_unbalanced;
+
+static void handle(power_hint_t hint, void *data, int64_t when)
+{
+    if (pthread_equal(pthread_self(), caller))
+        on_caller++;
+
+    switch (hint) {
+        case POWER_HINT_INTERACTION:
+            /* The first one parks the looper until the burst is in */
+            pthread_mutex_lock(&gate_lock);
+            if (!parked) {
+                parked = 1;
+                pthread_cond_broadcast(&gate_cond);
+                while (!released)
+                    pthread_cond_wait(&gate_cond, &gate_lock);
+            } else {
+                interactions++;
+            }
+            pthread_mutex_unlock(&gate_lock);
+            break;
+        case POWER_HINT_LOW_POWER:
+            low_power = *(int32_t *)data;
+            low_power_count++;
+            break;
+        case POWER_HINT_SET_PROFILE:
+            profile = *(int32_t *)data;
+            profile_count++;
+            break;
+        case POWER_HINT_VSYNC:
+            vsync = *(int32_t *)data;
+            vsync_count++;
+            break;
+        case POWER_HINT_VIDEO_DECODE:
+            if (strncmp(data, "state=1", 7) == 0) {
+                video_starts++;
+                video_open++;
+            } else {
+                video_stops++;
+                if (--video_open < 0)
+                    video_unbalanced++;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static int make_file(const char *root, const char *path)
+{
+    char full[PATH_MAX];
+    char *p;
+    int fd;
+
+    snprintf(full, sizeof(full), "%s%s", root, path);
+    for (p = full + strlen(root) + 1; (p = strchr(p, '/')) != NULL; p++) {
+        *p = '\0';
+        if (mkdir(full, 0755) < 0 && errno != EEXIST)
+            return -1;
+        *p = '/';
+    }
+
+    fd = open(full, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+    close(fd);
+    return 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag,
+                        struct FTW *ftw)
+{
+    return remove(path);
+}
+
+static uint64_t sum_counts(const struct power_stats *s)
+{
+    uint64_t sum = __atomic_load_n(&s->queue_full, __ATOMIC_RELAXED);
+    int i;
+
+    for (i = 0; i < STAT_HINT_COUNT; i++) {
+        sum += __atomic_load_n(&s->handled[i].count, __ATOMIC_RELAXED);
+        sum += __atomic_load_n(&s->coalesced[i], __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "FAIL: " __VA_ARGS__); \
+            fputc('\n', stderr); \
+            failed++; \
+        } \
+    } while (0)
+
+int main(void)
+{
+    char root[PATH_MAX], path[PATH_MAX + 64];
+    const struct power_stats *stats;
+    int64_t start;
+    uint64_t sent = 0, queue_full;
+    int32_t value;
+    int failed = 0;
+    int fd, i;
+
+    snprintf(root, sizeof(root), "/tmp/power_dispatch_test.XXXXXX");
+    if (mkdtemp(root) == NULL) {
+        fprintf(stderr, "Cannot create fake tree: %s\n", strerror(errno));
+        return 1;
+    }
+    for (i = 0; i < NODE_COUNT; i++) {
+        if (make_file(root, node_path(i)) < 0)
+            return 1;
+    }
+    if (make_file(root, STATS_FILE) < 0)
+        return 1;
+    setenv(SYSFS_ROOT_ENV, root, 1);
+
+    nodes_init();
+    stats_init();
+    snprintf(path, sizeof(path), "%s%s", root, STATS_FILE);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    stats = fd < 0 ? MAP_FAILED :
+            mmap(NULL, sizeof(*stats), PROT_READ, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        close(fd);
+    if (stats == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s\n", path);
+        return 1;
+    }
+
+    caller = pthread_self();
+    if (dispatch_init(handle) < 0 || looper_start() < 0) {
+        fprintf(stderr, "Cannot start the dispatcher\n");
+        return 1;
+    }
+
+    dispatch_hint(POWER_HINT_INTERACTION, NULL);
+    sent++;
+    pthread_mutex_lock(&gate_lock);
+    while (!parked)
+        pthread_cond_wait(&gate_cond, &gate_lock);
+    pthread_mutex_unlock(&gate_lock);
+
+    for (i = 0; i < BURST; i++) {
+        dispatch_hint(POWER_HINT_INTERACTION, NULL);
+        value = i & 1;
+        dispatch_hint(POWER_HINT_LOW_POWER, &value);
+        value = i % 4;
+        dispatch_hint(POWER_HINT_SET_PROFILE, &value);
+        value = !(i & 1);
+        dispatch_hint(POWER_HINT_VSYNC, &value);
+        dispatch_hint(POWER_HINT_VIDEO_DECODE, "state=1;codec=hevc;width=1920;height=1080");
+        dispatch_hint(POWER_HINT_VIDEO_DECODE, "state=0");
+        sent += 6;
+    }
+    queue_full = __atomic_load_n(&stats->queue_full, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&gate_lock);
+    released = 1;
+    pthread_cond_broadcast(&gate_cond);
+    pthread_mutex_unlock(&gate_lock);
+
+    for (start = now_ns(); sum_counts(stats) < sent; usleep(100)) {
+        if (now_ns() - start > DRAIN_TIMEOUT_NS) {
+            fprintf(stderr, "FAIL: timed out, %llu of %llu hints accounted for\n",
+                    (unsigned long long)sum_counts(stats), (unsigned long long)sent);
+            return 1;
+        }
+    }
+    /* The last handled count lands just before its hint is accounted for */
+    usleep(10000);
+
+    CHECK(on_caller == 0, "%d hints handled on the caller", on_caller);
+    CHECK(queue_full > 0, "a burst of %d did not fill the queue", BURST);
+    CHECK(queue_full == stats->queue_full, "dropped hints after the burst");
+    CHECK(interactions + queue_full == BURST, "%d interactions handled, %llu dropped, "
+            "%d sent", interactions, (unsigned long long)queue_full, BURST);
+    CHECK(low_power_count == 1 && low_power == ((BURST - 1) & 1),
+            "low power handled %d times, last %d", low_power_count, low_power);
+    CHECK(profile_count == 1 && profile == (BURST - 1) % 4,
+            "profile handled %d times, last %d", profile_count, profile);
+    CHECK(vsync_count == 1 && vsync == !((BURST - 1) & 1),
+            "vsync handled %d times, last %d", vsync_count, vsync);
+    CHECK(video_starts == BURST && video_stops == BURST && video_open == 0 &&
+            !video_unbalanced, "%d video starts and %d stops of %d handled, %d stops early",
+            video_starts, video_stops, BURST, video_unbalanced);
+    CHECK(stats->coalesced[STAT_HINT_LOW_POWER] == BURST - 1,
+            "%llu low power hints coalesced",
+            (unsigned long long)stats->coalesced[STAT_HINT_LOW_POWER]);
+
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    if (failed) {
+        fprintf(stderr, "%d checks failed\n", failed);
+        return 1;
+    }
+    printf("%d of %d interactions queued, %llu dropped; each state handled once\n",
+            interactions, BURST, (unsigned long long)queue_full);
+    return 0;
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for the platform's cutils/properties.h. There is no
+ * property service on the host, property_get() always returns the
+ * default; the bench points the HAL at its tree through the environment.
+ */
+#ifndef MTK_POWER_HOST_PROPERTIES_H
+#define MTK_POWER_HOST_PROPERTIES_H
+
+#define PROPERTY_KEY_MAX    32
+#define PROPERTY_VALUE_MAX  92
+
+int property_get(const char *key, char *value, const char *default_value);
+
+#endif /* MTK_POWER_HOST_PROPERTIES_H */
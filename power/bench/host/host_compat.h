@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Bionic string functions glibc only has since 2.38, see host_stubs.c */
+#ifndef MTK_POWER_HOST_COMPAT_H
+#define MTK_POWER_HOST_COMPAT_H
+
+#include <stddef.h>
+
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+/* Error level log messages so far, power_bench -e looks it up in the module */
+extern int host_log_errors;
+
+#endif /* MTK_POWER_HOST_COMPAT_H */
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The two liblog/libcutils calls the power HAL makes, for the host build
+ * in the Makefile next door. Only linked there, the platform build uses
+ * the real libraries.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cutils/properties.h>
+#include <utils/Log.h>
+
+#include "host_compat.h"
+
+int host_log_errors;
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...)
+{
+    static const char letters[] = "??VDIWE";
+    va_list ap;
+    int ret;
+
+    if (prio >= ANDROID_LOG_ERROR)
+        __atomic_fetch_add(&host_log_errors, 1, __ATOMIC_RELAXED);
+    va_start(ap, fmt);
+    fprintf(stderr, "%c/%s: ", prio < (int)sizeof(letters) - 1 ? letters[prio] : '?',
+            tag ? tag : "");
+    ret = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    /* logcat ends every message, the HAL only sometimes does */
+    if (fmt[0] == '\0' || fmt[strlen(fmt) - 1] != '\n')
+        fputc('\n', stderr);
+    return ret;
+}
+
+int property_get(const char *key, char *value, const char *default_value)
+{
+    return (int)strlcpy(value, default_value ? default_value : "", PROPERTY_VALUE_MAX);
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
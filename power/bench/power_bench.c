@@ -0,0 +1,566 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays recorded hint traces against a power HAL module pointed at a
+ * throwaway fake sysfs tree, and reports throughput, per-hint caller
+ * latency, the HAL's own statistics and the syscalls spent.
+ *
+ * Usage: power_bench [-f] [-k] [-e] [-q] [-n loops] [-c profiles.conf] module.so trace...
+ *
+ *   -f  ignore the trace timestamps and replay back to back
+ *   -e  fail on error logs from the module, failed node writes or hints
+ *       still queued at the end
+ *   -q  fail on hints dropped for a full queue
+ *   -k  keep the fake tree around after the run
+ *   -n  replay every trace this many times
+ *   -c  power_profiles.conf to install in the fake tree
+ *
+ * Trace format, one hint per line, '#' starts a comment:
+ *
+ *   <delay us> <hint> [payload]
+ *   repeat <n>
+ *   end
+ *
+ * where hint is one of the names in hint_names below, "interactive" for
+ * setInteractive(), "temp" to set the fake thermal zone to the payload in
+ * millidegrees, or a raw hint number. Int hints take an integer
+ * payload, video hints the key=value string, other payloads are ignored.
+ * repeat/end blocks replay the enclosed lines n times and do not nest.
+ */
+#include <dlfcn.h>
+#include <errno.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include <hardware/hardware.h>
+#include <hardware/power.h>
+
+#include "nodes.h"
+#include "profile.h"
+#include "stats.h"
+#include "thermal.h"
+#include "util.h"
+
+#define HINT_INTERACTIVE    -1
+#define HINT_TEMP           -2
+#define MAX_EVENTS          (1 << 20)
+#define DRAIN_TIMEOUT_NS    (5 * NSEC_PER_SEC)
+
+struct event {
+    int64_t delay_ns;
+    int hint;
+    int has_int;
+    int32_t value;
+    char payload[64];
+};
+
+struct latencies {
+    const char *name;
+    int64_t *ns;
+    size_t count;
+    size_t cap;
+};
+
+static const struct {
+    const char *name;
+    int hint;
+} hint_names[] = {
+    { "vsync",          POWER_HINT_VSYNC },
+    { "interaction",    POWER_HINT_INTERACTION },
+    { "video_encode",   POWER_HINT_VIDEO_ENCODE },
+    { "video_decode",   POWER_HINT_VIDEO_DECODE },
+    { "low_power",      POWER_HINT_LOW_POWER },
+    { "cpu_boost",      POWER_HINT_CPU_BOOST },
+    { "launch_boost",   POWER_HINT_LAUNCH_BOOST },
+    { "audio",          POWER_HINT_AUDIO },
+    { "set_profile",    POWER_HINT_SET_PROFILE },
+    { "interactive",    HINT_INTERACTIVE },
+    { "temp",           HINT_TEMP },
+};
+
+#define NUM_HINT_NAMES  (int)(sizeof(hint_names) / sizeof(hint_names[0]))
+
+static struct event *events;
+static size_t num_events;
+static struct latencies lat[NUM_HINT_NAMES + 1];
+static int undrained;
+
+static int hint_index(int hint)
+{
+    int i;
+
+    for (i = 0; i < NUM_HINT_NAMES; i++) {
+        if (hint_names[i].hint == hint)
+            return i;
+    }
+    return NUM_HINT_NAMES;
+}
+
+static int parse_hint(const char *s, int *hint)
+{
+    char *end;
+    int i;
+
+    for (i = 0; i < NUM_HINT_NAMES; i++) {
+        if (!strcmp(hint_names[i].name, s)) {
+            *hint = hint_names[i].hint;
+            return 0;
+        }
+    }
+    *hint = (int)strtol(s, &end, 0);
+    return *end == '\0' ? 0 : -1;
+}
+
+static int add_event(const struct event *ev)
+{
+    if (num_events == MAX_EVENTS) {
+        fprintf(stderr, "Trace too long, max %d events\n", MAX_EVENTS);
+        return -1;
+    }
+    events[num_events++] = *ev;
+    return 0;
+}
+
+static int load_trace(const char *path, int loops)
+{
+    char line[256], name[32], payload[64];
+    struct event block[256];
+    size_t block_len = 0;
+    int repeat = 0, lineno = 0;
+    size_t start = num_events;
+    struct event ev;
+    long delay_us;
+    char *hash;
+    FILE *f;
+    int i, n;
+
+    f = fopen(path, "re");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        if ((hash = strchr(line, '#')) != NULL)
+            *hash = '\0';
+
+        if (sscanf(line, " repeat %d", &n) == 1) {
+            repeat = n > 0 ? n : 1;
+            block_len = 0;
+            continue;
+        }
+        if (sscanf(line, " %31s", name) == 1 && !strcmp(name, "end")) {
+            for (; repeat > 0; repeat--) {
+                for (i = 0; i < (int)block_len; i++) {
+                    if (add_event(&block[i]) < 0)
+                        goto err;
+                }
+            }
+            continue;
+        }
+
+        payload[0] = '\0';
+        n = sscanf(line, " %ld %31s %63s", &delay_us, name, payload);
+        if (n < 2)
+            continue;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.delay_ns = delay_us * NSEC_PER_USEC;
+        if (parse_hint(name, &ev.hint) < 0) {
+            fprintf(stderr, "%s:%d: unknown hint %s\n", path, lineno, name);
+            goto err;
+        }
+        if (n == 3) {
+            strlcpy(ev.payload, payload, sizeof(ev.payload));
+            ev.value = (int32_t)strtol(payload, NULL, 0);
+            ev.has_int = 1;
+        }
+
+        if (repeat) {
+            if (block_len == sizeof(block) / sizeof(block[0])) {
+                fprintf(stderr, "%s:%d: repeat block too long\n", path, lineno);
+                goto err;
+            }
+            block[block_len++] = ev;
+        } else if (add_event(&ev) < 0) {
+            goto err;
+        }
+    }
+    fclose(f);
+
+    /* Whole-trace loops */
+    n = num_events - start;
+    for (; loops > 1; loops--) {
+        for (i = 0; i < n; i++) {
+            if (add_event(&events[start + i]) < 0)
+                return -1;
+        }
+    }
+    return 0;
+
+err:
+    fclose(f);
+    return -1;
+}
+
+static int make_file(const char *root, const char *path, const char *content)
+{
+    char full[PATH_MAX];
+    char *p;
+    int fd;
+
+    if (snprintf(full, sizeof(full), "%s%s", root, path) >= (int)sizeof(full)) {
+        fprintf(stderr, "Path too long: %s%s\n", root, path);
+        return -1;
+    }
+    for (p = full + strlen(root) + 1; (p = strchr(p, '/')) != NULL; p++) {
+        *p = '\0';
+        if (mkdir(full, 0755) < 0 && errno != EEXIST) {
+            fprintf(stderr, "Cannot create %s: %s\n", full, strerror(errno));
+            return -1;
+        }
+        *p = '/';
+    }
+
+    fd = open(full, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot create %s: %s\n", full, strerror(errno));
+        return -1;
+    }
+    if (content != NULL && write(fd, content, strlen(content)) < 0) {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+static int make_tree(char *root, size_t len, const char *conf)
+{
+    char buf[4096], path[PATH_MAX + 64];
+    const char *base = access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+    ssize_t n;
+    int i, in, out;
+
+    snprintf(root, len, "%s/power_bench.XXXXXX", base);
+    if (mkdtemp(root) == NULL) {
+        fprintf(stderr, "Cannot create fake tree: %s\n", strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < NODE_COUNT; i++) {
+        if (make_file(root, node_path(i), NULL) < 0)
+            return -1;
+    }
+    if (make_file(root, STATS_FILE, NULL) < 0)
+        return -1;
+
+    /* One zone with a passive trip at 85C, starting out cool */
+    if (make_file(root, THERMAL_ZONES_DEFAULT "/temp", "40000") < 0 ||
+            make_file(root, THERMAL_ZONES_DEFAULT "/trip_point_0_type", "passive") < 0 ||
+            make_file(root, THERMAL_ZONES_DEFAULT "/trip_point_0_temp", "85000") < 0)
+        return -1;
+
+    if (conf != NULL) {
+        if (make_file(root, PROFILES_CONF, NULL) < 0)
+            return -1;
+        snprintf(path, sizeof(path), "%s%s", root, PROFILES_CONF);
+        in = open(conf, O_RDONLY | O_CLOEXEC);
+        out = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+        if (in < 0 || out < 0) {
+            fprintf(stderr, "Cannot install %s\n", conf);
+            return -1;
+        }
+        while ((n = read(in, buf, sizeof(buf))) > 0) {
+            if (write(out, buf, n) != n)
+                break;
+        }
+        close(in);
+        close(out);
+    }
+
+    return 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag,
+                        struct FTW *ftw)
+{
+    return remove(path);
+}
+
+/* Syscalls issued by this process so far, as reported by taskstats */
+static void read_io(long long *syscr, long long *syscw)
+{
+    char line[64];
+    FILE *f = fopen("/proc/self/io", "re");
+
+    *syscr = *syscw = -1;
+    if (f == NULL)
+        return;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        sscanf(line, "syscr: %lld", syscr);
+        sscanf(line, "syscw: %lld", syscw);
+    }
+    fclose(f);
+}
+
+static void record(int hint, int64_t ns)
+{
+    struct latencies *l = &lat[hint_index(hint)];
+
+    if (l->count == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 1024;
+        l->ns = realloc(l->ns, l->cap * sizeof(*l->ns));
+        if (l->ns == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    l->ns[l->count++] = ns;
+}
+
+static int cmp_ns(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t sum_hist_counts(const struct stat_hist *h, int n)
+{
+    uint64_t sum = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+        sum += __atomic_load_n(&h[i].count, __ATOMIC_RELAXED);
+    return sum;
+}
+
+static uint64_t sum_counts(const uint64_t *c, int n)
+{
+    uint64_t sum = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+        sum += __atomic_load_n(&c[i], __ATOMIC_RELAXED);
+    return sum;
+}
+
+/* Waits until the looper has handled or coalesced every queued hint */
+static int64_t drain(const struct power_stats *s, uint64_t sent)
+{
+    int64_t start = now_ns();
+    uint64_t done;
+
+    for (;;) {
+        done = sum_hist_counts(s->handled, STAT_HINT_COUNT) +
+                sum_counts(s->coalesced, STAT_HINT_COUNT) +
+                __atomic_load_n(&s->queue_full, __ATOMIC_RELAXED);
+        if (done >= sent || now_ns() - start > DRAIN_TIMEOUT_NS)
+            break;
+        usleep(100);
+    }
+    if (done < sent) {
+        fprintf(stderr, "Timed out waiting for %llu queued hints\n",
+                (unsigned long long)(sent - done));
+        undrained = 1;
+    }
+    return now_ns() - start;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "Usage: %s [-f] [-k] [-e] [-q] [-n loops] [-c profiles.conf] "
+            "module.so trace...\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    char root[PATH_MAX], path[PATH_MAX + 64];
+    const char *conf = NULL;
+    const struct power_stats *stats;
+    struct power_module *module;
+    struct rusage ru0, ru1;
+    long long r0, w0, r1, w1;
+    int64_t start, elapsed, drained, next, t, ns;
+    uint64_t sent = 0;
+    int fast = 0, keep = 0, loops = 1, strict = 0, lossless = 0, failed = 0;
+    const int *log_errors;
+    uint64_t node_errors, queue_full;
+    int opt, fd, temp_fd, i;
+    struct event *ev;
+    size_t n;
+    void *dso;
+
+    while ((opt = getopt(argc, argv, "fkeqn:c:")) != -1) {
+        switch (opt) {
+            case 'f': fast = 1; break;
+            case 'k': keep = 1; break;
+            case 'e': strict = 1; break;
+            case 'q': lossless = 1; break;
+            case 'n': loops = atoi(optarg); break;
+            case 'c': conf = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (argc - optind < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    events = calloc(MAX_EVENTS, sizeof(*events));
+    if (events == NULL)
+        return 1;
+    for (i = optind + 1; i < argc; i++) {
+        if (load_trace(argv[i], loops) < 0)
+            return 1;
+    }
+
+    if (make_tree(root, sizeof(root), conf) < 0)
+        return 1;
+    setenv(SYSFS_ROOT_ENV, root, 1);
+
+    dso = dlopen(argv[optind], RTLD_NOW);
+    if (dso == NULL) {
+        fprintf(stderr, "Cannot load %s: %s\n", argv[optind], dlerror());
+        return 1;
+    }
+    module = dlsym(dso, HAL_MODULE_INFO_SYM_AS_STR);
+    if (module == NULL) {
+        fprintf(stderr, "No %s in %s\n", HAL_MODULE_INFO_SYM_AS_STR, argv[optind]);
+        return 1;
+    }
+    if (module->init)
+        module->init(module);
+
+    snprintf(path, sizeof(path), "%s%s", root, STATS_FILE);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    stats = fd < 0 ? MAP_FAILED :
+            mmap(NULL, sizeof(*stats), PROT_READ, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        close(fd);
+    if (stats == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s\n", path);
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s%s/temp", root, THERMAL_ZONES_DEFAULT);
+    temp_fd = open(path, O_WRONLY | O_CLOEXEC);
+
+    read_io(&r0, &w0);
+    getrusage(RUSAGE_SELF, &ru0);
+    start = next = now_ns();
+
+    for (n = 0; n < num_events; n++) {
+        ev = &events[n];
+        if (!fast) {
+            next += ev->delay_ns;
+            while (now_ns() < next)
+                ;
+        }
+
+        if (ev->hint == HINT_TEMP) {
+            /* Not a HAL call, the thermal poll picks it up */
+            if (temp_fd < 0 || ftruncate(temp_fd, 0) < 0 ||
+                    pwrite(temp_fd, ev->payload, strlen(ev->payload), 0) < 0)
+                fprintf(stderr, "Cannot set zone temperature\n");
+            continue;
+        }
+
+        t = now_ns();
+        if (ev->hint == HINT_INTERACTIVE) {
+            if (module->setInteractive)
+                module->setInteractive(module, ev->value);
+        } else {
+            if (ev->hint == POWER_HINT_VIDEO_ENCODE ||
+                    ev->hint == POWER_HINT_VIDEO_DECODE)
+                module->powerHint(module, ev->hint, ev->payload[0] ? ev->payload : NULL);
+            else
+                module->powerHint(module, ev->hint, ev->has_int ? &ev->value : NULL);
+            sent++;
+        }
+        record(ev->hint, now_ns() - t);
+    }
+
+    elapsed = now_ns() - start;
+    drained = drain(stats, sent);
+    getrusage(RUSAGE_SELF, &ru1);
+    read_io(&r1, &w1);
+
+    printf("Replayed %zu events in %.3f ms (%.0f hints/s), drained in %.3f ms\n",
+            num_events, elapsed / 1e6, num_events * 1e9 / (elapsed ? elapsed : 1),
+            drained / 1e6);
+    printf("Syscalls: %lld read, %lld write; context switches: %ld voluntary, "
+            "%ld involuntary\n\n", r1 - r0, w1 - w0,
+            ru1.ru_nvcsw - ru0.ru_nvcsw, ru1.ru_nivcsw - ru0.ru_nivcsw);
+
+    printf("Caller latency (us):\n");
+    printf("  %-20s %10s %10s %10s %10s %10s\n", "hint", "count", "mean", "p50",
+            "p99", "max");
+    for (i = 0; i <= NUM_HINT_NAMES; i++) {
+        if (!lat[i].count)
+            continue;
+        qsort(lat[i].ns, lat[i].count, sizeof(*lat[i].ns), cmp_ns);
+        ns = 0;
+        for (n = 0; n < lat[i].count; n++)
+            ns += lat[i].ns[n];
+        printf("  %-20s %10zu %10.2f %10.2f %10.2f %10.2f\n",
+                i < NUM_HINT_NAMES ? hint_names[i].name : "other",
+                lat[i].count, ns / 1e3 / lat[i].count,
+                lat[i].ns[lat[i].count / 2] / 1e3,
+                lat[i].ns[lat[i].count * 99 / 100] / 1e3,
+                lat[i].ns[lat[i].count - 1] / 1e3);
+    }
+
+    printf("\nHAL statistics:\n");
+    fflush(stdout);
+    stats_dump(stats, STDOUT_FILENO);
+
+    /* The module has its own copy of the host stubs */
+    log_errors = dlsym(dso, "host_log_errors");
+    node_errors = 0;
+    for (i = 0; i < NODE_COUNT; i++)
+        node_errors += __atomic_load_n(&stats->nodes[i].errors, __ATOMIC_RELAXED);
+    queue_full = __atomic_load_n(&stats->queue_full, __ATOMIC_RELAXED);
+    if (strict && (undrained || node_errors ||
+            (log_errors != NULL && __atomic_load_n(log_errors, __ATOMIC_RELAXED)))) {
+        fprintf(stderr, "FAIL: %d error logs, %llu failed node writes%s\n",
+                log_errors != NULL ? *log_errors : -1, (unsigned long long)node_errors,
+                undrained ? ", hints left queued" : "");
+        failed = 1;
+    }
+    if (lossless && queue_full) {
+        fprintf(stderr, "FAIL: %llu hints dropped for a full queue\n",
+                (unsigned long long)queue_full);
+        failed = 1;
+    }
+
+    if (keep)
+        printf("\nFake tree kept at %s\n", root);
+    else
+        nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    return failed;
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+
+#include "boost.h"
+#include "looper.h"
+#include "nodes.h"
+#include "util.h"
+
+struct boost_params {
+    int min_freq[CLUSTER_COUNT];
+    int min_core[CLUSTER_COUNT];
+    int base_perf;
+};
+
+static const struct boost_params boost_table[BOOST_LEVEL_COUNT] = {
+    [BOOST_NONE]        = { { PPM_NO_LIMIT, PPM_NO_LIMIT }, { PPM_NO_LIMIT, PPM_NO_LIMIT }, 0 },
+    [BOOST_INTERACTION] = { { 1014000, PPM_NO_LIMIT }, { 2, PPM_NO_LIMIT }, 2 },
+    [BOOST_CPU]         = { { 1144000, 1248000 }, { 4, 1 }, 4 },
+    [BOOST_LAUNCH]      = { { 1144000, 1625000 }, { 4, 2 }, 6 },
+};
+
+static const char *boost_names[BOOST_LEVEL_COUNT] = {
+    [BOOST_NONE]        = "none",
+    [BOOST_INTERACTION] = "interaction",
+    [BOOST_CPU]         = "cpu",
+    [BOOST_LAUNCH]      = "launch",
+};
+
+static pthread_mutex_t boost_lock = PTHREAD_MUTEX_INITIALIZER;
+static enum boost_level cur_level = BOOST_NONE;
+static enum boost_level max_level = BOOST_LAUNCH;
+static int64_t cur_deadline;
+static int timer_fd = -1;
+
+/* Floors and ceilings set by the active profile, see boost_set_limits() */
+static struct boost_limits limits = {
+    .min_freq = { PPM_NO_LIMIT, PPM_NO_LIMIT },
+    .max_freq = { PPM_NO_LIMIT, PPM_NO_LIMIT },
+    .min_core = { PPM_NO_LIMIT, PPM_NO_LIMIT },
+    .max_core = { PPM_NO_LIMIT, PPM_NO_LIMIT },
+};
+
+/* Boost value raised to the profile floor and clamped to its ceiling */
+static int clamp_limit(int value, int floor, int ceiling)
+{
+    if (floor > value)
+        value = floor;
+    if (ceiling != PPM_NO_LIMIT && value > ceiling)
+        value = ceiling;
+    return value;
+}
+
+/* Must be called with boost_lock held. */
+static void boost_write(const struct boost_params *p, int raising)
+{
+    int c;
+
+    /* Raise the core floor before the frequency floor, drop it after */
+    if (raising)
+        node_write_int(NODE_HPS_BASE_PERF, p->base_perf);
+    for (c = 0; c < CLUSTER_COUNT; c++) {
+        if (raising)
+            node_write_cluster(NODE_PPM_MIN_CORE_LL + c, c, clamp_limit(p->min_core[c],
+                    limits.min_core[c], limits.max_core[c]));
+        node_write_cluster(NODE_PPM_MIN_FREQ_LL + c, c, clamp_limit(p->min_freq[c],
+                limits.min_freq[c], limits.max_freq[c]));
+        if (!raising)
+            node_write_cluster(NODE_PPM_MIN_CORE_LL + c, c, clamp_limit(p->min_core[c],
+                    limits.min_core[c], limits.max_core[c]));
+    }
+    if (!raising)
+        node_write_int(NODE_HPS_BASE_PERF, p->base_perf);
+}
+
+/* Must be called with boost_lock held. */
+static void boost_apply(enum boost_level level)
+{
+    if (level == cur_level)
+        return;
+
+    boost_write(&boost_table[level], level > cur_level);
+
+    ALOGV("boost %s -> %s", boost_names[cur_level], boost_names[level]);
+    cur_level = level;
+}
+
+/* Must be called with boost_lock held. A zero deadline disarms the timer. */
+static void boost_arm(int64_t deadline)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value = ns_to_timespec(deadline);
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+        ALOGE("Error arming boost timer: %s\n", strerror(errno));
+}
+
+static void boost_expire(int fd, uint32_t events, void *data)
+{
+    uint64_t expirations;
+
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        ALOGE("Error reading boost timer: %s\n", strerror(errno));
+
+    pthread_mutex_lock(&boost_lock);
+    if (cur_level != BOOST_NONE) {
+        if (now_ns() >= cur_deadline) {
+            boost_apply(BOOST_NONE);
+            cur_deadline = 0;
+        } else {
+            /* Extended while the expiry was in flight */
+            boost_arm(cur_deadline);
+        }
+    }
+    pthread_mutex_unlock(&boost_lock);
+}
+
+int boost_init(void)
+{
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        ALOGE("Error creating boost timer: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (looper_add(timer_fd, EPOLLIN, boost_expire, NULL) < 0) {
+        close(timer_fd);
+        timer_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+void boost_request(enum boost_level level, int64_t start_ns, int64_t duration_ns)
+{
+    int64_t deadline;
+
+    if (level <= BOOST_NONE || level >= BOOST_LEVEL_COUNT || duration_ns <= 0)
+        return;
+
+    deadline = start_ns + duration_ns;
+    if (deadline <= now_ns())
+        return;
+
+    pthread_mutex_lock(&boost_lock);
+    if (timer_fd < 0) {
+        pthread_mutex_unlock(&boost_lock);
+        return;
+    }
+
+    /* Thermal may have tightened the cap since the request was arbitrated */
+    if (level > max_level)
+        level = max_level;
+    if (level == BOOST_NONE) {
+        pthread_mutex_unlock(&boost_lock);
+        return;
+    }
+
+    /* Merge with whatever is running: strongest level, latest deadline */
+    if (cur_level != BOOST_NONE && level < cur_level)
+        level = cur_level;
+    boost_apply(level);
+
+    if (deadline > cur_deadline) {
+        cur_deadline = deadline;
+        boost_arm(cur_deadline);
+    }
+    pthread_mutex_unlock(&boost_lock);
+}
+
+void boost_set_limits(const struct boost_limits *l)
+{
+    pthread_mutex_lock(&boost_lock);
+    limits = *l;
+    /* Nodes skip unchanged values, so only moved limits hit the kernel */
+    boost_write(&boost_table[cur_level], 1);
+    pthread_mutex_unlock(&boost_lock);
+}
+
+void boost_cancel(void)
+{
+    pthread_mutex_lock(&boost_lock);
+    if (cur_level != BOOST_NONE) {
+        boost_apply(BOOST_NONE);
+        cur_deadline = 0;
+        if (timer_fd >= 0)
+            boost_arm(0);
+    }
+    pthread_mutex_unlock(&boost_lock);
+}
+
+/* Thermal cap, a running boost above it is lowered on the spot */
+void boost_set_max_level(enum boost_level level)
+{
+    pthread_mutex_lock(&boost_lock);
+    max_level = level;
+    if (cur_level > level) {
+        boost_apply(level);
+        if (level == BOOST_NONE) {
+            cur_deadline = 0;
+            if (timer_fd >= 0)
+                boost_arm(0);
+        }
+    }
+    pthread_mutex_unlock(&boost_lock);
+}
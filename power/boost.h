@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_BOOST_H
+#define MTK_POWER_BOOST_H
+
+#include <stdint.h>
+
+#include "nodes.h"
+
+/* Ordered by strength: overlapping requests keep the highest level */
+enum boost_level {
+    BOOST_NONE,
+    BOOST_INTERACTION,
+    BOOST_CPU,
+    BOOST_LAUNCH,
+    BOOST_LEVEL_COUNT
+};
+
+/*
+ * Profile-provided PPM limits. Boosts never drop below the floors and
+ * never exceed the ceilings; with no boost active the floors are what
+ * gets written.
+ */
+struct boost_limits {
+    int min_freq[CLUSTER_COUNT];
+    int max_freq[CLUSTER_COUNT];
+    int min_core[CLUSTER_COUNT];
+    int max_core[CLUSTER_COUNT];
+};
+
+int boost_init(void);
+void boost_set_limits(const struct boost_limits *limits);
+void boost_request(enum boost_level level, int64_t start_ns, int64_t duration_ns);
+void boost_cancel(void);
+void boost_set_max_level(enum boost_level level);
+
+#endif /* MTK_POWER_BOOST_H */
@@ -0,0 +1,388 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+
+#include "dispatch.h"
+#include "looper.h"
+#include "stats.h"
+#include "util.h"
+
+/* Must be a power of two */
+#define QUEUE_SIZE      64
+#define PAYLOAD_MAX     64
+
+enum payload_kind {
+    PAYLOAD_NONE,
+    PAYLOAD_INT,
+    PAYLOAD_STRING,
+    PAYLOAD_OPAQUE,
+};
+
+struct hint_msg {
+    power_hint_t hint;
+    enum payload_kind kind;
+    int64_t when;
+    union {
+        int32_t i;
+        char s[PAYLOAD_MAX];
+    } payload;
+};
+
+/*
+ * Bounded MPMC ring (D. Vyukov). Each cell carries a sequence number that
+ * tells producers and consumers whose turn it is, so neither side takes a
+ * lock; binder threads race on enq_pos with a single CAS.
+ */
+struct cell {
+    uint32_t seq;
+    struct hint_msg msg;
+};
+
+struct ring {
+    struct cell cells[QUEUE_SIZE];
+    uint32_t enq_pos;
+    uint32_t deq_pos;
+};
+
+static struct ring events;
+
+/*
+ * VIDEO_ENCODE/DECODE open and close refcounted sessions, so unlike the
+ * events above none of them may be lost: they get a ring of their own,
+ * and what does not fit is counted per [encode][start] and handled as a
+ * session of unknown codec. That keeps starts and stops paired.
+ */
+static struct ring sessions;
+static uint32_t session_overflow[2][2];
+
+/*
+ * Queued events and filled slots not yet handled; the producer that moves
+ * it off 0 wakes the worker
+ */
+static uint32_t pending;
+
+static int event_fd = -1;
+static dispatch_handler handler;
+
+static int queue_push(struct ring *q, const struct hint_msg *msg)
+{
+    uint32_t pos = __atomic_load_n(&q->enq_pos, __ATOMIC_RELAXED);
+    struct cell *c;
+    int32_t diff;
+
+    for (;;) {
+        c = &q->cells[pos & (QUEUE_SIZE - 1)];
+        diff = (int32_t)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&q->enq_pos, &pos, pos + 1, 1,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&q->enq_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    c->msg = *msg;
+    __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int queue_pop(struct ring *q, struct hint_msg *msg)
+{
+    uint32_t pos = __atomic_load_n(&q->deq_pos, __ATOMIC_RELAXED);
+    struct cell *c;
+    int32_t diff;
+
+    for (;;) {
+        c = &q->cells[pos & (QUEUE_SIZE - 1)];
+        diff = (int32_t)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&q->deq_pos, &pos, pos + 1, 1,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&q->deq_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    *msg = c->msg;
+    __atomic_store_n(&c->seq, pos + QUEUE_SIZE, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void queue_init(struct ring *q)
+{
+    uint32_t i;
+
+    for (i = 0; i < QUEUE_SIZE; i++)
+        q->cells[i].seq = i;
+}
+
+static void *msg_data(struct hint_msg *msg)
+{
+    switch (msg->kind) {
+        case PAYLOAD_INT:       return &msg->payload.i;
+        case PAYLOAD_STRING:    return msg->payload.s;
+        /* Only presence matters, the pointed-to data is gone by now */
+        case PAYLOAD_OPAQUE:    return msg;
+        default:                return NULL;
+    }
+}
+
+/* Hints that carry a state rather than an event: only the last one counts */
+enum state_slot {
+    SLOT_VSYNC,
+    SLOT_LOW_POWER,
+    SLOT_SET_PROFILE,
+    SLOT_COUNT
+};
+
+static const power_hint_t slot_hints[SLOT_COUNT] = {
+    [SLOT_VSYNC]        = POWER_HINT_VSYNC,
+    [SLOT_LOW_POWER]    = POWER_HINT_LOW_POWER,
+    [SLOT_SET_PROFILE]  = POWER_HINT_SET_PROFILE,
+};
+
+/*
+ * Latest value of each state hint, packed in one word that producers
+ * publish with a single exchange: the int payload in the low half and
+ * the flags above it. The time goes next to it; a producer racing on the
+ * same slot can leave the worker its time with the other's value, which
+ * only the latency stats see.
+ */
+#define SLOT_DIRTY      (1ULL << 63)
+#define SLOT_HAS_VALUE  (1ULL << 62)
+
+struct slot {
+    uint64_t word;
+    int64_t when;
+};
+
+static struct slot slots[SLOT_COUNT];
+
+/* State hints all carry an int, or nothing */
+static int state_slot(power_hint_t hint)
+{
+    switch (hint) {
+        case POWER_HINT_VSYNC:          return SLOT_VSYNC;
+        case POWER_HINT_LOW_POWER:      return SLOT_LOW_POWER;
+        case POWER_HINT_SET_PROFILE:    return SLOT_SET_PROFILE;
+        default:                        return -1;
+    }
+}
+
+/* Returns 1 when the slot was empty, 0 when msg replaced an unhandled hint */
+static int slot_store(struct slot *slot, const struct hint_msg *msg)
+{
+    uint64_t word = SLOT_DIRTY;
+
+    if (msg->kind == PAYLOAD_INT)
+        word |= SLOT_HAS_VALUE | (uint32_t)msg->payload.i;
+    __atomic_store_n(&slot->when, msg->when, __ATOMIC_RELAXED);
+    word = __atomic_exchange_n(&slot->word, word, __ATOMIC_ACQ_REL);
+    return !(word & SLOT_DIRTY);
+}
+
+static int slot_take(int i, struct hint_msg *msg)
+{
+    uint64_t word = __atomic_exchange_n(&slots[i].word, 0, __ATOMIC_ACQ_REL);
+
+    if (!(word & SLOT_DIRTY))
+        return 0;
+    msg->hint = slot_hints[i];
+    msg->when = __atomic_load_n(&slots[i].when, __ATOMIC_RELAXED);
+    msg->kind = word & SLOT_HAS_VALUE ? PAYLOAD_INT : PAYLOAD_NONE;
+    msg->payload.i = (int32_t)(uint32_t)word;
+    return 1;
+}
+
+static void dispatch_handle(struct hint_msg *msg)
+{
+    int64_t start = now_ns();
+
+    handler(msg->hint, msg_data(msg), msg->when);
+    stats_handled(msg->hint, now_ns() - start);
+}
+
+/*
+ * 1 for a session start, 0 for a stop, -1 for a hint without state=,
+ * which video_hint() ignores anyway
+ */
+static int session_state(const struct hint_msg *msg)
+{
+    const char *p;
+    int state;
+
+    if (msg->kind != PAYLOAD_STRING)
+        return -1;
+    for (p = msg->payload.s; (p = strstr(p, "state=")) != NULL; p += 6) {
+        if (p != msg->payload.s && !strchr(";, ", p[-1]))
+            continue;
+        state = atoi(p + 6);
+        return state < 0 ? -1 : state != 0;
+    }
+    return -1;
+}
+
+/* Session hints that overflowed, with nothing but their state left */
+static uint32_t drain_overflow(void)
+{
+    struct hint_msg msg;
+    uint32_t n = 0, count;
+    int encode, start;
+
+    msg.kind = PAYLOAD_STRING;
+    for (encode = 0; encode < 2; encode++) {
+        /* Starts first, a stop never finds its session missing */
+        for (start = 1; start >= 0; start--) {
+            count = __atomic_exchange_n(&session_overflow[encode][start], 0,
+                    __ATOMIC_ACQUIRE);
+            msg.hint = encode ? POWER_HINT_VIDEO_ENCODE : POWER_HINT_VIDEO_DECODE;
+            strlcpy(msg.payload.s, start ? "state=1" : "state=0", sizeof(msg.payload.s));
+            for (n += count; count > 0; count--) {
+                msg.when = now_ns();
+                dispatch_handle(&msg);
+            }
+        }
+    }
+    return n;
+}
+
+static void dispatch_drain(int fd, uint32_t events_mask, void *data)
+{
+    struct hint_msg msg;
+    uint64_t val;
+    uint32_t n, k, left;
+    int i;
+
+    if (read(fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+        ALOGE("Error reading dispatch eventfd: %s\n", strerror(errno));
+
+    do {
+        n = 0;
+
+        /* States first, so the events queued alongside see the newest one */
+        for (i = 0; i < SLOT_COUNT; i++) {
+            if (slot_take(i, &msg)) {
+                dispatch_handle(&msg);
+                n++;
+            }
+        }
+
+        /* Sessions in order, then whatever of them overflowed */
+        for (k = 0; k < QUEUE_SIZE && queue_pop(&sessions, &msg) == 0; k++)
+            dispatch_handle(&msg);
+        n += k;
+        n += drain_overflow();
+
+        for (k = 0; k < QUEUE_SIZE && queue_pop(&events, &msg) == 0; k++)
+            dispatch_handle(&msg);
+        n += k;
+
+        /* A producer may have counted its hint but not published it yet */
+        left = __atomic_sub_fetch(&pending, n, __ATOMIC_ACQ_REL);
+        if (left && !n)
+            sched_yield();
+    } while (left);
+}
+
+int dispatch_init(dispatch_handler h)
+{
+    handler = h;
+    queue_init(&events);
+    queue_init(&sessions);
+
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0) {
+        ALOGE("Error creating dispatch eventfd: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (looper_add(event_fd, EPOLLIN, dispatch_drain, NULL) < 0) {
+        close(event_fd);
+        event_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+void dispatch_hint(power_hint_t hint, void *data)
+{
+    struct hint_msg msg;
+    uint64_t one = 1;
+    int session = hint == POWER_HINT_VIDEO_ENCODE || hint == POWER_HINT_VIDEO_DECODE;
+    int slot, state;
+
+    msg.hint = hint;
+    msg.when = now_ns();
+    if (data == NULL) {
+        msg.kind = PAYLOAD_NONE;
+    } else if (session) {
+        msg.kind = PAYLOAD_STRING;
+        strlcpy(msg.payload.s, data, sizeof(msg.payload.s));
+    } else if (hint == POWER_HINT_LAUNCH_BOOST) {
+        msg.kind = PAYLOAD_OPAQUE;
+    } else {
+        msg.kind = PAYLOAD_INT;
+        msg.payload.i = *(int32_t *)data;
+    }
+
+    if (event_fd < 0) {
+        stats_queue_full();
+        return;
+    }
+
+    slot = state_slot(hint);
+    if (slot >= 0) {
+        if (!slot_store(&slots[slot], &msg)) {
+            /* The worker has not got to the previous one, nothing to wake */
+            stats_coalesced(hint);
+            return;
+        }
+    } else if (session) {
+        if (queue_push(&sessions, &msg) < 0) {
+            /* Kept as a bare start or stop, see session_overflow */
+            state = session_state(&msg);
+            if (state < 0)
+                return;
+            __atomic_fetch_add(&session_overflow[hint == POWER_HINT_VIDEO_ENCODE][state], 1,
+                    __ATOMIC_RELEASE);
+        }
+    } else if (queue_push(&events, &msg) < 0) {
+        /* Events that do not fit are dropped, never handled on the caller */
+        stats_queue_full();
+        return;
+    }
+
+    if (__atomic_fetch_add(&pending, 1, __ATOMIC_ACQ_REL) == 0 &&
+            write(event_fd, &one, sizeof(one)) < 0)
+        ALOGE("Error waking dispatcher: %s\n", strerror(errno));
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_DISPATCH_H
+#define MTK_POWER_DISPATCH_H
+
+#include <stdint.h>
+
+#include <hardware/power.h>
+
+/*
+ * Moves hint handling off the caller's binder thread; powerHint() never
+ * runs the handler itself. State hints (VSYNC, LOW_POWER, SET_PROFILE)
+ * overwrite a latest-value slot per hint, so only the newest one is
+ * handled. Video session hints (VIDEO_ENCODE/DECODE) are never lost: they
+ * have a bounded lock-free queue of their own, and past it are kept as
+ * bare starts and stops. Other event hints are copied into a bounded
+ * lock-free queue; when it is full they are dropped and counted as
+ * queue_full in the stats. The looper thread drains the slots, then the
+ * sessions, then the events. No producer takes a lock.
+ *
+ * The handler gets a copy of the payload and the time the hint was sent,
+ * so time based hints are not stretched by queueing delay.
+ */
+typedef void (*dispatch_handler)(power_hint_t hint, void *data, int64_t when);
+
+int dispatch_init(dispatch_handler handler);
+void dispatch_hint(power_hint_t hint, void *data);
+
+#endif /* MTK_POWER_DISPATCH_H */
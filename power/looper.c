@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+
+#include "looper.h"
+
+#define LOOPER_MAX_HANDLERS 8
+
+struct handler {
+    int fd;
+    looper_cb cb;
+    void *data;
+};
+
+static struct handler handlers[LOOPER_MAX_HANDLERS];
+static int num_handlers;
+static int epoll_fd = -1;
+static int started;
+static pthread_t thread;
+static pthread_mutex_t looper_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Must be called with looper_lock held. */
+static int looper_epoll_fd(void)
+{
+    char buf[64];
+
+    if (epoll_fd < 0) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            strerror_r(errno, buf, sizeof(buf));
+            ALOGE("Error creating epoll fd: %s\n", buf);
+        }
+    }
+    return epoll_fd;
+}
+
+int looper_add(int fd, uint32_t events, looper_cb cb, void *data)
+{
+    struct epoll_event ev;
+    struct handler *h;
+    char buf[64];
+
+    pthread_mutex_lock(&looper_lock);
+    if (looper_epoll_fd() < 0 || num_handlers == LOOPER_MAX_HANDLERS) {
+        pthread_mutex_unlock(&looper_lock);
+        return -1;
+    }
+
+    h = &handlers[num_handlers];
+    h->fd = fd;
+    h->cb = cb;
+    h->data = data;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = h;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error adding fd %d to looper: %s\n", fd, buf);
+        pthread_mutex_unlock(&looper_lock);
+        return -1;
+    }
+
+    num_handlers++;
+    pthread_mutex_unlock(&looper_lock);
+    return 0;
+}
+
+static void *looper_loop(void *arg)
+{
+    struct epoll_event events[LOOPER_MAX_HANDLERS];
+    struct handler *h;
+    int i, n;
+
+    for (;;) {
+        n = epoll_wait(epoll_fd, events, LOOPER_MAX_HANDLERS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ALOGE("epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+        for (i = 0; i < n; i++) {
+            h = events[i].data.ptr;
+            h->cb(h->fd, events[i].events, h->data);
+        }
+    }
+
+    return NULL;
+}
+
+int looper_start(void)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&looper_lock);
+    if (started)
+        goto out;
+
+    if (looper_epoll_fd() < 0) {
+        ret = -1;
+        goto out;
+    }
+
+    ret = pthread_create(&thread, NULL, looper_loop, NULL);
+    if (ret) {
+        ALOGE("Error creating looper thread: %s\n", strerror(ret));
+        ret = -1;
+        goto out;
+    }
+    pthread_setname_np(thread, "powerhal");
+    started = 1;
+
+out:
+    pthread_mutex_unlock(&looper_lock);
+    return ret;
+}
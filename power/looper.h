@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_LOOPER_H
+#define MTK_POWER_LOOPER_H
+
+#include <stdint.h>
+
+/*
+ * Single worker thread shared by everything in the HAL that needs to run
+ * outside of the caller's binder thread. Users hand it an fd (timerfd,
+ * eventfd, sysfs attribute...) and get called back from the worker when
+ * epoll reports it ready.
+ */
+typedef void (*looper_cb)(int fd, uint32_t events, void *data);
+
+int looper_add(int fd, uint32_t events, looper_cb cb, void *data);
+int looper_start(void);
+
+#endif /* MTK_POWER_LOOPER_H */
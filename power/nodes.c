@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+#include <cutils/properties.h>
+
+#include "nodes.h"
+#include "stats.h"
+#include "util.h"
+
+#define SYSFS_ROOT_PROP "debug.power.sysfs_root"
+
+struct node {
+    const char *name;
+    const char *path;
+    int fd;
+    int warned;
+    char last[NODE_VALUE_MAX];
+    pthread_mutex_t lock;
+};
+
+#define NODE(n, p) { .name = (n), .path = (p), .fd = -1, \
+                     .lock = PTHREAD_MUTEX_INITIALIZER }
+
+static struct node nodes[NODE_COUNT] = {
+    [NODE_RUSH_BOOST]           = NODE("rush_boost", "/proc/hps/rush_boost_enabled"),
+    [NODE_FPS_UPPER_BOUND]      = NODE("fps_upper_bound", "/d/ged/hal/fps_upper_bound"),
+    [NODE_PPM_MIN_FREQ_LL]      = NODE("ppm_min_freq_ll", "/proc/ppm/policy/userlimit_min_cpu_freq"),
+    [NODE_PPM_MIN_FREQ_L]       = NODE("ppm_min_freq_l", "/proc/ppm/policy/userlimit_min_cpu_freq"),
+    [NODE_PPM_MIN_CORE_LL]      = NODE("ppm_min_core_ll", "/proc/ppm/policy/userlimit_min_cpu_core"),
+    [NODE_PPM_MIN_CORE_L]       = NODE("ppm_min_core_l", "/proc/ppm/policy/userlimit_min_cpu_core"),
+    [NODE_PPM_MAX_FREQ_LL]      = NODE("ppm_max_freq_ll", "/proc/ppm/policy/userlimit_max_cpu_freq"),
+    [NODE_PPM_MAX_FREQ_L]       = NODE("ppm_max_freq_l", "/proc/ppm/policy/userlimit_max_cpu_freq"),
+    [NODE_PPM_MAX_CORE_LL]      = NODE("ppm_max_core_ll", "/proc/ppm/policy/userlimit_max_cpu_core"),
+    [NODE_PPM_MAX_CORE_L]       = NODE("ppm_max_core_l", "/proc/ppm/policy/userlimit_max_cpu_core"),
+    [NODE_HPS_BASE_PERF]        = NODE("hps_base_perf", "/proc/hps/num_base_perf_serv"),
+    [NODE_HPS_UP_THRESHOLD]     = NODE("hps_up_threshold", "/proc/hps/up_threshold"),
+    [NODE_HPS_DOWN_THRESHOLD]   = NODE("hps_down_threshold", "/proc/hps/down_threshold"),
+    [NODE_HPS_POWER_LIMIT]      = NODE("hps_power_limit", "/proc/hps/num_limit_power_serv"),
+    [NODE_HISPEED_FREQ]         = NODE("hispeed_freq", "/sys/devices/system/cpu/cpufreq/interactive/hispeed_freq"),
+    [NODE_CPUFREQ_MAX]          = NODE("cpufreq_max", "/proc/cpufreq/cpufreq_limited_max_freq_by_user"),
+    [NODE_CPUFREQ_HEVC]         = NODE("cpufreq_hevc", "/proc/cpufreq/cpufreq_limited_by_hevc"),
+#ifdef TAP_TO_WAKE_NODE
+    [NODE_TAP_TO_WAKE]          = NODE("tap_to_wake", TAP_TO_WAKE_NODE),
+#endif
+};
+
+static char root[PATH_MAX];
+
+const char *node_root(void)
+{
+    return root;
+}
+
+const char *node_name(enum power_node node)
+{
+    return nodes[node].name;
+}
+
+const char *node_path(enum power_node node)
+{
+    return nodes[node].path;
+}
+
+/* Must be called with n->lock held. */
+static int node_open(struct node *n)
+{
+    char path[PATH_MAX];
+    char buf[64];
+
+    snprintf(path, sizeof(path), "%s%s", root, n->path);
+    n->fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (n->fd < 0) {
+        /* Only complain once per node, hints keep coming regardless */
+        if (!n->warned) {
+            strerror_r(errno, buf, sizeof(buf));
+            ALOGE("Error opening %s: %s\n", path, buf);
+            n->warned = 1;
+        }
+        return -1;
+    }
+
+    n->warned = 0;
+    n->last[0] = '\0';
+    return 0;
+}
+
+void nodes_init(void)
+{
+    char prop[PROPERTY_VALUE_MAX];
+    const char *env = getenv(SYSFS_ROOT_ENV);
+    int i;
+
+    if (env != NULL) {
+        strlcpy(root, env, sizeof(root));
+    } else {
+        property_get(SYSFS_ROOT_PROP, prop, "");
+        strlcpy(root, prop, sizeof(root));
+    }
+    if (root[0] != '\0')
+        ALOGI("Using %s as sysfs root\n", root);
+
+    for (i = 0; i < NODE_COUNT; i++) {
+        pthread_mutex_lock(&nodes[i].lock);
+        if (nodes[i].fd >= 0) {
+            close(nodes[i].fd);
+            nodes[i].fd = -1;
+        }
+        node_open(&nodes[i]);
+        pthread_mutex_unlock(&nodes[i].lock);
+    }
+}
+
+/* Must be called with n->lock held. */
+static int node_pwrite(struct node *n, const char *value)
+{
+    size_t len = strlen(value);
+    char buf[64];
+    int retried = 0;
+
+    if (n->fd < 0 && node_open(n) < 0)
+        return -1;
+
+    while (pwrite(n->fd, value, len, 0) < 0) {
+        if ((errno == ENODEV || errno == EBADF) && !retried) {
+            /* The node went away under us (module reload, debugfs remount) */
+            close(n->fd);
+            n->fd = -1;
+            retried = 1;
+            if (node_open(n) == 0)
+                continue;
+            return -1;
+        }
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error writing to %s%s: %s\n", root, n->path, buf);
+        n->last[0] = '\0';
+        return -1;
+    }
+
+    strlcpy(n->last, value, sizeof(n->last));
+    return 0;
+}
+
+int node_write(enum power_node node, const char *value)
+{
+    struct node *n = &nodes[node];
+    int64_t start;
+    int ret;
+
+    pthread_mutex_lock(&n->lock);
+
+    if (n->fd >= 0 && !strcmp(n->last, value)) {
+        pthread_mutex_unlock(&n->lock);
+        stats_write_skipped(node);
+        return 0;
+    }
+
+    start = now_ns();
+    ret = node_pwrite(n, value);
+    pthread_mutex_unlock(&n->lock);
+
+    stats_write(node, now_ns() - start, ret < 0);
+    return ret;
+}
+
+int node_write_int(enum power_node node, int value)
+{
+    char buf[NODE_VALUE_MAX];
+
+    snprintf(buf, sizeof(buf), "%d", value);
+    return node_write(node, buf);
+}
+
+int node_write_cluster(enum power_node node, int cluster, int value)
+{
+    char buf[NODE_VALUE_MAX];
+
+    snprintf(buf, sizeof(buf), "%d %d", cluster, value);
+    return node_write(node, buf);
+}
+
+void node_invalidate(enum power_node node)
+{
+    pthread_mutex_lock(&nodes[node].lock);
+    nodes[node].last[0] = '\0';
+    pthread_mutex_unlock(&nodes[node].lock);
+}
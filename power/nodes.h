@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_NODES_H
+#define MTK_POWER_NODES_H
+
+/*
+ * Tunable nodes the HAL writes to. Each node is opened once by
+ * nodes_init() and kept open; writes go through pwrite() at offset 0 and
+ * are skipped when the value matches the last one written.
+ *
+ * All paths are resolved against a root prefix taken from the
+ * POWER_HAL_SYSFS_ROOT environment variable or the debug.power.sysfs_root
+ * property, so the HAL can be pointed at a fake tree on tmpfs.
+ *
+ * PPM userlimit nodes take "<cluster> <value>" and are registered once per
+ * cluster, so each cluster keeps its own fd and last written value.
+ */
+#define CLUSTER_LL      0
+#define CLUSTER_L       1
+#define CLUSTER_COUNT   2
+
+/* PPM treats -1 as "no user limit" */
+#define PPM_NO_LIMIT    -1
+
+/* Per-cluster nodes are laid out so that NODE_*_LL + cluster works */
+enum power_node {
+    NODE_RUSH_BOOST,
+    NODE_FPS_UPPER_BOUND,
+    NODE_PPM_MIN_FREQ_LL,
+    NODE_PPM_MIN_FREQ_L,
+    NODE_PPM_MIN_CORE_LL,
+    NODE_PPM_MIN_CORE_L,
+    NODE_PPM_MAX_FREQ_LL,
+    NODE_PPM_MAX_FREQ_L,
+    NODE_PPM_MAX_CORE_LL,
+    NODE_PPM_MAX_CORE_L,
+    NODE_HPS_BASE_PERF,
+    NODE_HPS_UP_THRESHOLD,
+    NODE_HPS_DOWN_THRESHOLD,
+    NODE_HPS_POWER_LIMIT,
+    NODE_HISPEED_FREQ,
+    NODE_CPUFREQ_MAX,
+    NODE_CPUFREQ_HEVC,
+#ifdef TAP_TO_WAKE_NODE
+    NODE_TAP_TO_WAKE,
+#endif
+    NODE_COUNT
+};
+
+#define NODE_VALUE_MAX 32
+
+#define SYSFS_ROOT_ENV "POWER_HAL_SYSFS_ROOT"
+
+void nodes_init(void);
+int node_write(enum power_node node, const char *value);
+int node_write_int(enum power_node node, int value);
+int node_write_cluster(enum power_node node, int cluster, int value);
+void node_invalidate(enum power_node node);
+const char *node_root(void);
+const char *node_name(enum power_node node);
+const char *node_path(enum power_node node);
+
+#endif /* MTK_POWER_NODES_H */
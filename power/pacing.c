@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+
+#include "looper.h"
+#include "pacing.h"
+#include "profile.h"
+#include "stats.h"
+#include "util.h"
+
+/*
+ * Stages entered after VSYNC has been off for the given time. The first
+ * grace period is long enough that the on/off pairs SurfaceFlinger sends
+ * during normal animation never reach the nodes.
+ */
+struct pacing_stage {
+    int64_t idle_ns;
+    int fps_cap;
+    int rush_off;
+};
+
+static const struct pacing_stage stages[] = {
+    { 0,                    0,  0 },
+    { 100 * NSEC_PER_MSEC,  0,  1 },
+    { 500 * NSEC_PER_MSEC,  45, 1 },
+    { 2000 * NSEC_PER_MSEC, 30, 1 },
+};
+
+#define NUM_STAGES  (int)(sizeof(stages) / sizeof(stages[0]))
+
+static pthread_mutex_t pacing_lock = PTHREAD_MUTEX_INITIALIZER;
+static int timer_fd = -1;
+static int vsync_on = 1;
+static int display_on = 1;
+static int stage;
+static int64_t idle_since;
+static int64_t wake_at;
+
+/* Must be called with pacing_lock held. */
+static void pacing_enter(int s)
+{
+    if (s == stage)
+        return;
+    stage = s;
+    profile_set_pacing(stages[s].fps_cap, stages[s].rush_off);
+}
+
+/* Must be called with pacing_lock held. Arms the timer for the next stage. */
+static void pacing_arm(void)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (stage + 1 < NUM_STAGES && !vsync_on)
+        its.it_value = ns_to_timespec(idle_since + stages[stage + 1].idle_ns);
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+        ALOGE("Error arming pacing timer: %s\n", strerror(errno));
+}
+
+static void pacing_timeout(int fd, uint32_t events, void *data)
+{
+    uint64_t expirations;
+    int64_t idle;
+    int s;
+
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        ALOGE("Error reading pacing timer: %s\n", strerror(errno));
+
+    pthread_mutex_lock(&pacing_lock);
+    if (!vsync_on) {
+        idle = now_ns() - idle_since;
+        for (s = stage; s + 1 < NUM_STAGES && idle >= stages[s + 1].idle_ns; s++)
+            ;
+        pacing_enter(s);
+        pacing_arm();
+    }
+    pthread_mutex_unlock(&pacing_lock);
+}
+
+int pacing_init(void)
+{
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        ALOGE("Error creating pacing timer: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (looper_add(timer_fd, EPOLLIN, pacing_timeout, NULL) < 0) {
+        close(timer_fd);
+        timer_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+void pacing_vsync(int on, int64_t when)
+{
+    pthread_mutex_lock(&pacing_lock);
+    if (timer_fd < 0 || !on == !vsync_on) {
+        pthread_mutex_unlock(&pacing_lock);
+        return;
+    }
+
+    vsync_on = !!on;
+    if (vsync_on) {
+        pacing_enter(0);
+        /* First frame requested since the screen came back on */
+        if (wake_at) {
+            stats_wake(when - wake_at);
+            wake_at = 0;
+        }
+    } else {
+        /* From when SurfaceFlinger turned it off, not from when we got to it */
+        idle_since = when;
+        /* A dark display cannot show anything, skip the grace periods */
+        if (!display_on)
+            pacing_enter(NUM_STAGES - 1);
+    }
+    pacing_arm();
+    pthread_mutex_unlock(&pacing_lock);
+}
+
+void pacing_set_display(int on)
+{
+    pthread_mutex_lock(&pacing_lock);
+    if (timer_fd < 0 || !on == !display_on) {
+        pthread_mutex_unlock(&pacing_lock);
+        return;
+    }
+
+    display_on = !!on;
+    if (display_on) {
+        /* Waking up is an interaction, walk down from the top again */
+        idle_since = now_ns();
+        wake_at = vsync_on ? 0 : idle_since;
+        pacing_enter(0);
+    } else {
+        wake_at = 0;
+        pacing_enter(NUM_STAGES - 1);
+    }
+    pacing_arm();
+    pthread_mutex_unlock(&pacing_lock);
+}
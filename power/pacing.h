@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_PACING_H
+#define MTK_POWER_PACING_H
+
+#include <stdint.h>
+
+/*
+ * Frame pacing: follows POWER_HINT_VSYNC and the display state. While
+ * SurfaceFlinger has VSYNC off the screen is static, so after a short
+ * grace period rush boost is dropped and the GED fps cap is walked down.
+ * The first VSYNC on restores the profile's values synchronously.
+ *
+ * The time from the display turning on to the first VSYNC on is recorded
+ * as the wake-to-first-frame latency.
+ */
+int pacing_init(void);
+void pacing_vsync(int on, int64_t when);
+void pacing_set_display(int on);
+
+#endif /* MTK_POWER_PACING_H */
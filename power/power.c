@@ -25,83 +25,142 @@
 #include <hardware/hardware.h>
 #include <hardware/power.h>
 
-#define MT_RUSH_BOOST_PATH "/proc/hps/rush_boost_enabled"
-#define MT_FPS_UPPER_BOUND_PATH "/d/ged/hal/fps_upper_bound"
-
+#include "boost.h"
+#include "dispatch.h"
+#include "looper.h"
+#include "nodes.h"
+#include "pacing.h"
+#include "profile.h"
+#include "stats.h"
+#include "thermal.h"
+#include "util.h"
+#include "video.h"
 
 #define POWER_HINT_POWER_SAVING 0x00000101
 #define POWER_HINT_PERFORMANCE_BOOST 0x00000102
 #define POWER_HINT_BALANCE  0x00000103
 
+#define INTERACTION_BOOST_DEFAULT_MS    200
+#define INTERACTION_BOOST_MAX_MS        5000
+#define LAUNCH_BOOST_MS                 1500
+
+static void power_hint_handle(power_hint_t hint, void *data, int64_t when);
+
 static void power_init(struct power_module *module)
 {
+    nodes_init();
+    stats_init();
+    boost_init();
+    profile_init();
+    pacing_init();
+    thermal_init();
+    dispatch_init(power_hint_handle);
+    looper_start();
 }
 
+/*
+ * Screen off drops any running boost and applies the [screen_off] section
+ * of the profile config on top of the active profile. Screen on lifts it
+ * again in one batch, so the previous state comes back as a whole.
+ */
 static void power_set_interactive(struct power_module *module, int on)
 {
-}
-
-static void power_fwrite(const char *path, char *s)
-{
-    char buf[64];
-    int len;
-    int fd = open(path, O_WRONLY);
-
-    if (fd < 0) {
-        strerror_r(errno, buf, sizeof(buf));
-        ALOGE("Error opening %s: %s\n", path, buf);
-        return;
-    }
-
-    len = write(fd, s, strlen(s));
-    if (len < 0) {
-        strerror_r(errno, buf, sizeof(buf));
-        ALOGE("Error writing to %s: %s\n", path, buf);
+    if (on) {
+        pacing_set_display(1);
+        profile_set_interactive(1);
+        thermal_set_display(1);
+    } else {
+        boost_cancel();
+        profile_set_interactive(0);
+        pacing_set_display(0);
+        thermal_set_display(0);
     }
-
-    close(fd);
 }
 
-static void power_hint(struct power_module *module, power_hint_t hint,
-                       void *data) {
+/* Runs on the looper thread, see dispatch.h */
+static void power_hint_handle(power_hint_t hint, void *data, int64_t when)
+{
     int32_t dataint = -1;
+
     switch (hint) {
         case POWER_HINT_LOW_POWER:
             dataint = *(int32_t *)data;
-            if (dataint) {
-                power_fwrite(MT_FPS_UPPER_BOUND_PATH, "30");
-                power_fwrite(MT_RUSH_BOOST_PATH, "0");
-            } else {
-                power_fwrite(MT_FPS_UPPER_BOUND_PATH, "60");
-                power_fwrite(MT_RUSH_BOOST_PATH, "1");
-            }
+            profile_set_low_power(dataint);
             ALOGI("POWER_HINT_LOW_POWER");
             break;
-        case POWER_HINT_VSYNC:
         case POWER_HINT_INTERACTION:
+            /* Optional payload is the expected interaction length in ms */
+            dataint = data ? *(int32_t *)data : INTERACTION_BOOST_DEFAULT_MS;
+            if (dataint <= 0)
+                dataint = INTERACTION_BOOST_DEFAULT_MS;
+            else if (dataint > INTERACTION_BOOST_MAX_MS)
+                dataint = INTERACTION_BOOST_MAX_MS;
+            boost_request(thermal_arbitrate(hint, BOOST_INTERACTION), when,
+                    dataint * NSEC_PER_MSEC);
+            break;
         case POWER_HINT_CPU_BOOST:
+            /* Payload is the boost duration in us */
+            if (data)
+                boost_request(thermal_arbitrate(hint, BOOST_CPU), when,
+                        *(int32_t *)data * NSEC_PER_USEC);
+            break;
         case POWER_HINT_LAUNCH_BOOST:
+            boost_request(thermal_arbitrate(hint, BOOST_LAUNCH), when,
+                    LAUNCH_BOOST_MS * NSEC_PER_MSEC);
+            break;
         case POWER_HINT_SET_PROFILE:
+            if (data)
+                profile_set(*(int32_t *)data);
+            break;
         case POWER_HINT_VIDEO_ENCODE:
+            video_hint(1, data);
+            break;
         case POWER_HINT_VIDEO_DECODE:
-        break;
+            video_hint(0, data);
+            break;
+        case POWER_HINT_VSYNC:
+            if (data)
+                pacing_vsync(*(int32_t *)data, when);
+            break;
     default:
+        /* MTK perfservice hints, mapped onto the equivalent profiles */
+        if (hint == POWER_HINT_POWER_SAVING)
+            profile_set(PROFILE_POWER_SAVE);
+        else if (hint == POWER_HINT_PERFORMANCE_BOOST)
+            /* Counts as a launch-strength boost, balanced when scaled down */
+            profile_set(thermal_arbitrate(hint, BOOST_LAUNCH) == BOOST_LAUNCH ?
+                    PROFILE_HIGH_PERFORMANCE : PROFILE_BALANCED);
+        else if (hint == POWER_HINT_BALANCE)
+            profile_set(PROFILE_BALANCED);
         break;
     }
 }
 
+static void power_hint(struct power_module *module, power_hint_t hint,
+                       void *data) {
+    int64_t start = now_ns();
+
+    dispatch_hint(hint, data);
+    stats_hint(hint, now_ns() - start);
+}
+
 void set_feature(struct power_module *module, feature_t feature, int state)
 {
 #ifdef TAP_TO_WAKE_NODE
-    char tmp_str[64];
     if (feature == POWER_FEATURE_DOUBLE_TAP_TO_WAKE) {
-        snprintf(tmp_str, 64, "%d", state);
-        power_fwrite(TAP_TO_WAKE_NODE, tmp_str);
+        node_write_int(NODE_TAP_TO_WAKE, state);
         return;
     }
 #endif
 }
 
+int get_feature(struct power_module *module, feature_t feature)
+{
+    if (feature == POWER_FEATURE_SUPPORTED_PROFILES)
+        return profile_count();
+    return -1;
+}
+
 static struct hw_module_methods_t power_module_methods = {
     .open = NULL,
 };
@@ -121,4 +180,5 @@ struct power_module HAL_MODULE_INFO_SYM = {
     .setInteractive = power_set_interactive,
     .powerHint = power_hint,
     .setFeature = set_feature,
+    .getFeature = get_feature,
 };
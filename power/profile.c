@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+
+#include "boost.h"
+#include "nodes.h"
+#include "profile.h"
+
+/* Tunables left out of a profile are never touched by it */
+#define TUNABLE_UNSET   INT_MIN
+
+#define LOW_POWER_FPS   30
+
+enum tunable {
+    T_HPS_UP_THRESHOLD,
+    T_HPS_DOWN_THRESHOLD,
+    T_MIN_FREQ_LL,
+    T_MIN_FREQ_L,
+    T_MAX_FREQ_LL,
+    T_MAX_FREQ_L,
+    T_MIN_CORE_LL,
+    T_MIN_CORE_L,
+    T_MAX_CORE_LL,
+    T_MAX_CORE_L,
+    T_FPS_UPPER_BOUND,
+    T_HISPEED_FREQ,
+    T_RUSH_BOOST,
+    T_CPUFREQ_MAX,
+    T_CPUFREQ_HEVC,
+    T_HPS_POWER_LIMIT,
+    T_COUNT
+};
+
+/*
+ * Floors and ceilings come in pairs the kernel may reject when they cross,
+ * so a switch raises ceilings first, then moves floors, then lowers
+ * ceilings. PPM floors are shared with the boost engine and are handed to
+ * it rather than written directly.
+ */
+enum tunable_kind {
+    TUNABLE_PLAIN,
+    TUNABLE_FLOOR,
+    TUNABLE_CEILING,
+};
+
+struct tunable_desc {
+    const char *key;
+    enum power_node node;
+    int cluster;
+    enum tunable_kind kind;
+    int boosted;
+};
+
+static const struct tunable_desc tunables[T_COUNT] = {
+    [T_HPS_UP_THRESHOLD]   = { "hps_up_threshold",   NODE_HPS_UP_THRESHOLD,   -1,         TUNABLE_CEILING, 0 },
+    [T_HPS_DOWN_THRESHOLD] = { "hps_down_threshold", NODE_HPS_DOWN_THRESHOLD, -1,         TUNABLE_FLOOR,   0 },
+    [T_MIN_FREQ_LL]        = { "ppm_min_freq_ll",    NODE_PPM_MIN_FREQ_LL,    CLUSTER_LL, TUNABLE_FLOOR,   1 },
+    [T_MIN_FREQ_L]         = { "ppm_min_freq_l",     NODE_PPM_MIN_FREQ_L,     CLUSTER_L,  TUNABLE_FLOOR,   1 },
+    [T_MAX_FREQ_LL]        = { "ppm_max_freq_ll",    NODE_PPM_MAX_FREQ_LL,    CLUSTER_LL, TUNABLE_CEILING, 0 },
+    [T_MAX_FREQ_L]         = { "ppm_max_freq_l",     NODE_PPM_MAX_FREQ_L,     CLUSTER_L,  TUNABLE_CEILING, 0 },
+    [T_MIN_CORE_LL]        = { "ppm_min_core_ll",    NODE_PPM_MIN_CORE_LL,    CLUSTER_LL, TUNABLE_FLOOR,   1 },
+    [T_MIN_CORE_L]         = { "ppm_min_core_l",     NODE_PPM_MIN_CORE_L,     CLUSTER_L,  TUNABLE_FLOOR,   1 },
+    [T_MAX_CORE_LL]        = { "ppm_max_core_ll",    NODE_PPM_MAX_CORE_LL,    CLUSTER_LL, TUNABLE_CEILING, 0 },
+    [T_MAX_CORE_L]         = { "ppm_max_core_l",     NODE_PPM_MAX_CORE_L,     CLUSTER_L,  TUNABLE_CEILING, 0 },
+    [T_FPS_UPPER_BOUND]    = { "fps_upper_bound",    NODE_FPS_UPPER_BOUND,    -1,         TUNABLE_PLAIN,   0 },
+    [T_HISPEED_FREQ]       = { "hispeed_freq",       NODE_HISPEED_FREQ,       -1,         TUNABLE_PLAIN,   0 },
+    [T_RUSH_BOOST]         = { "rush_boost",         NODE_RUSH_BOOST,         -1,         TUNABLE_PLAIN,   0 },
+    [T_CPUFREQ_MAX]        = { "cpufreq_max_freq",   NODE_CPUFREQ_MAX,        -1,         TUNABLE_CEILING, 0 },
+    [T_CPUFREQ_HEVC]       = { "hevc_min_freq",      NODE_CPUFREQ_HEVC,       -1,         TUNABLE_FLOOR,   0 },
+    [T_HPS_POWER_LIMIT]    = { "hps_power_limit",    NODE_HPS_POWER_LIMIT,    -1,         TUNABLE_PLAIN,   0 },
+};
+
+static const char *profile_names[PROFILE_MAX] = {
+    [PROFILE_POWER_SAVE]        = "power_save",
+    [PROFILE_BALANCED]          = "balanced",
+    [PROFILE_HIGH_PERFORMANCE]  = "high_performance",
+    [PROFILE_BIAS_POWER]        = "bias_power",
+    [PROFILE_BIAS_PERFORMANCE]  = "bias_performance",
+};
+
+struct profile {
+    int defined;
+    int values[T_COUNT];
+};
+
+static struct profile profiles[PROFILE_MAX];
+static int applied[T_COUNT];
+static int cur_profile = PROFILE_BALANCED;
+/* Tunables replaced while the screen is off, from the [screen_off] section */
+#define SCREEN_OFF_SECTION "screen_off"
+static struct profile screen_off;
+static int interactive = 1;
+
+static int low_power;
+static int pacing_fps;
+static int pacing_rush_off;
+static int thermal_rush_off;
+static struct video_limits video;
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void profile_clear(struct profile *p)
+{
+    int t;
+
+    p->defined = 0;
+    for (t = 0; t < T_COUNT; t++)
+        p->values[t] = TUNABLE_UNSET;
+}
+
+static char *strip(char *s)
+{
+    char *end;
+
+    while (isspace((unsigned char)*s))
+        s++;
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+    return s;
+}
+
+static int profile_lookup(const char *name)
+{
+    int i;
+
+    for (i = 0; i < PROFILE_MAX; i++) {
+        if (!strcmp(profile_names[i], name))
+            return i;
+    }
+    return -1;
+}
+
+static int tunable_lookup(const char *key)
+{
+    int t;
+
+    for (t = 0; t < T_COUNT; t++) {
+        if (!strcmp(tunables[t].key, key))
+            return t;
+    }
+    return -1;
+}
+
+/*
+ * Config format:
+ *
+ *   [balanced]
+ *   fps_upper_bound = 60
+ *   ppm_max_freq_l = -1
+ *
+ * '#' starts a comment. Sections are profile names, keys are tunables.
+ */
+static int profile_load(const char *path)
+{
+    char line[128];
+    char *s, *eq, *end;
+    struct profile *p = NULL;
+    int lineno = 0;
+    int t;
+    long val;
+    FILE *f;
+
+    f = fopen(path, "re");
+    if (f == NULL) {
+        ALOGW("Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        if ((s = strchr(line, '#')) != NULL)
+            *s = '\0';
+        s = strip(line);
+        if (*s == '\0')
+            continue;
+
+        if (*s == '[') {
+            end = strchr(s, ']');
+            if (end == NULL) {
+                ALOGE("%s:%d: unterminated section\n", path, lineno);
+                p = NULL;
+                continue;
+            }
+            *end = '\0';
+            s = strip(s + 1);
+            if (!strcmp(s, SCREEN_OFF_SECTION)) {
+                p = &screen_off;
+                p->defined = 1;
+                continue;
+            }
+            t = profile_lookup(s);
+            if (t < 0) {
+                ALOGW("%s:%d: unknown profile %s\n", path, lineno, s);
+                p = NULL;
+                continue;
+            }
+            p = &profiles[t];
+            p->defined = 1;
+            continue;
+        }
+
+        eq = strchr(s, '=');
+        if (p == NULL || eq == NULL) {
+            ALOGW("%s:%d: ignoring line\n", path, lineno);
+            continue;
+        }
+        *eq = '\0';
+        t = tunable_lookup(strip(s));
+        if (t < 0) {
+            ALOGW("%s:%d: unknown tunable %s\n", path, lineno, strip(s));
+            continue;
+        }
+        errno = 0;
+        val = strtol(strip(eq + 1), &end, 10);
+        if (errno || *end != '\0' || val < INT_MIN + 1 || val > INT_MAX) {
+            ALOGW("%s:%d: bad value for %s\n", path, lineno, tunables[t].key);
+            continue;
+        }
+        p->values[t] = (int)val;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/* Both PPM_NO_LIMIT and the cpufreq "0" mean unlimited */
+static int ceiling_rank(int value)
+{
+    return value <= 0 ? INT_MAX : value;
+}
+
+static int limit_or_none(int value)
+{
+    return value == TUNABLE_UNSET ? PPM_NO_LIMIT : value;
+}
+
+static void tunable_write(enum tunable t, int value)
+{
+    const struct tunable_desc *d = &tunables[t];
+    int ret;
+
+    if (d->cluster >= 0)
+        ret = node_write_cluster(d->node, d->cluster, value);
+    else
+        ret = node_write_int(d->node, value);
+    /* Forget failed writes so the next switch retries them */
+    applied[t] = ret ? TUNABLE_UNSET : value;
+}
+
+/*
+ * Overlay the video session limits: the tighter ceiling and the higher
+ * floors win. Tunables only set for video are released with 0 once the
+ * last session ends.
+ */
+static void profile_apply_video(int *target)
+{
+    int t;
+
+    if (video.max_freq > 0 && ceiling_rank(video.max_freq) <
+            ceiling_rank(target[T_CPUFREQ_MAX]))
+        target[T_CPUFREQ_MAX] = video.max_freq;
+    if (video.hevc_freq > 0 && video.hevc_freq > target[T_CPUFREQ_HEVC])
+        target[T_CPUFREQ_HEVC] = video.hevc_freq;
+    if (video.min_core > 0 && video.min_core > target[T_MIN_CORE_LL])
+        target[T_MIN_CORE_LL] = video.min_core;
+
+    for (t = T_CPUFREQ_MAX; t <= T_CPUFREQ_HEVC; t++) {
+        if (target[t] == TUNABLE_UNSET && applied[t] != TUNABLE_UNSET &&
+                applied[t] != 0)
+            target[t] = 0;
+    }
+}
+
+/* Must be called with profile_lock held. */
+static void profile_apply(void)
+{
+    struct boost_limits limits;
+    int target[T_COUNT];
+    int boost_dirty = 0;
+    int t, raise;
+
+    memcpy(target, profiles[cur_profile].values, sizeof(target));
+    if (low_power) {
+        target[T_FPS_UPPER_BOUND] = LOW_POWER_FPS;
+        target[T_RUSH_BOOST] = 0;
+    }
+
+    /* Frame pacing only ever tightens what the profile asked for */
+    if (pacing_fps > 0 && target[T_FPS_UPPER_BOUND] > pacing_fps)
+        target[T_FPS_UPPER_BOUND] = pacing_fps;
+    if (pacing_rush_off && target[T_RUSH_BOOST] != TUNABLE_UNSET)
+        target[T_RUSH_BOOST] = 0;
+
+    /* Close to a trip point, rush boost only heats things up further */
+    if (thermal_rush_off && target[T_RUSH_BOOST] != TUNABLE_UNSET)
+        target[T_RUSH_BOOST] = 0;
+
+    profile_apply_video(target);
+
+    /* Screen off wins over everything, the overlays above included */
+    if (!interactive) {
+        for (t = 0; t < T_COUNT; t++) {
+            if (screen_off.values[t] != TUNABLE_UNSET)
+                target[t] = screen_off.values[t];
+        }
+    }
+
+    /* Boost clamps to the PPM ceilings as well as the floors */
+    for (t = 0; t < T_COUNT; t++) {
+        if (tunables[t].cluster >= 0 && target[t] != applied[t])
+            boost_dirty = 1;
+    }
+
+    /* Ceilings going up */
+    for (t = 0; t < T_COUNT; t++) {
+        if (tunables[t].kind != TUNABLE_CEILING || target[t] == applied[t] ||
+                target[t] == TUNABLE_UNSET)
+            continue;
+        raise = applied[t] == TUNABLE_UNSET ||
+                ceiling_rank(target[t]) > ceiling_rank(applied[t]);
+        if (raise)
+            tunable_write(t, target[t]);
+    }
+
+    /* Floors, either direction */
+    for (t = 0; t < T_COUNT; t++) {
+        if (tunables[t].kind != TUNABLE_FLOOR || target[t] == applied[t])
+            continue;
+        if (tunables[t].boosted)
+            applied[t] = target[t];
+        else if (target[t] != TUNABLE_UNSET) {
+            tunable_write(t, target[t]);
+        }
+    }
+
+    /* Ceilings going down, then everything else */
+    for (t = 0; t < T_COUNT; t++) {
+        if (tunables[t].kind == TUNABLE_FLOOR || target[t] == applied[t] ||
+                target[t] == TUNABLE_UNSET)
+            continue;
+        tunable_write(t, target[t]);
+    }
+
+    if (boost_dirty) {
+        limits.min_freq[CLUSTER_LL] = limit_or_none(target[T_MIN_FREQ_LL]);
+        limits.min_freq[CLUSTER_L] = limit_or_none(target[T_MIN_FREQ_L]);
+        limits.max_freq[CLUSTER_LL] = limit_or_none(target[T_MAX_FREQ_LL]);
+        limits.max_freq[CLUSTER_L] = limit_or_none(target[T_MAX_FREQ_L]);
+        limits.min_core[CLUSTER_LL] = limit_or_none(target[T_MIN_CORE_LL]);
+        limits.min_core[CLUSTER_L] = limit_or_none(target[T_MIN_CORE_L]);
+        limits.max_core[CLUSTER_LL] = limit_or_none(target[T_MAX_CORE_LL]);
+        limits.max_core[CLUSTER_L] = limit_or_none(target[T_MAX_CORE_L]);
+        boost_set_limits(&limits);
+    }
+}
+
+void profile_init(void)
+{
+    char path[PATH_MAX];
+    int i;
+
+    pthread_mutex_lock(&profile_lock);
+    for (i = 0; i < PROFILE_MAX; i++)
+        profile_clear(&profiles[i]);
+    profile_clear(&screen_off);
+    for (i = 0; i < T_COUNT; i++)
+        applied[i] = TUNABLE_UNSET;
+
+    snprintf(path, sizeof(path), "%s%s", node_root(), PROFILES_CONF);
+    if (profile_load(path) < 0 || !profiles[PROFILE_BALANCED].defined) {
+        /* What the HAL always did when leaving low power mode */
+        profiles[PROFILE_BALANCED].defined = 1;
+        profiles[PROFILE_BALANCED].values[T_FPS_UPPER_BOUND] = 60;
+        profiles[PROFILE_BALANCED].values[T_RUSH_BOOST] = 1;
+    }
+    if (!screen_off.defined) {
+        screen_off.defined = 1;
+        screen_off.values[T_FPS_UPPER_BOUND] = 30;
+        screen_off.values[T_RUSH_BOOST] = 0;
+    }
+
+    cur_profile = PROFILE_BALANCED;
+    profile_apply();
+    pthread_mutex_unlock(&profile_lock);
+}
+
+/* Profiles are exposed to the framework as 0..n-1, so stop at the first gap */
+int profile_count(void)
+{
+    int n = 0;
+
+    while (n < PROFILE_MAX && profiles[n].defined)
+        n++;
+    return n;
+}
+
+void profile_set(int profile)
+{
+    if (profile < 0 || profile >= PROFILE_MAX || !profiles[profile].defined) {
+        ALOGE("Unsupported power profile %d\n", profile);
+        return;
+    }
+
+    pthread_mutex_lock(&profile_lock);
+    if (profile != cur_profile) {
+        ALOGI("Switching to power profile %s\n", profile_names[profile]);
+        cur_profile = profile;
+        profile_apply();
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+void profile_set_low_power(int on)
+{
+    pthread_mutex_lock(&profile_lock);
+    if (!on != !low_power) {
+        low_power = !!on;
+        profile_apply();
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+void profile_set_interactive(int on)
+{
+    pthread_mutex_lock(&profile_lock);
+    if (!on != !interactive) {
+        interactive = !!on;
+        profile_apply();
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+void profile_set_pacing(int fps_cap, int rush_off)
+{
+    pthread_mutex_lock(&profile_lock);
+    if (fps_cap != pacing_fps || !rush_off != !pacing_rush_off) {
+        pacing_fps = fps_cap;
+        pacing_rush_off = !!rush_off;
+        profile_apply();
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+void profile_set_thermal(int rush_off)
+{
+    pthread_mutex_lock(&profile_lock);
+    if (!rush_off != !thermal_rush_off) {
+        thermal_rush_off = !!rush_off;
+        profile_apply();
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+void profile_set_video(const struct video_limits *limits)
+{
+    pthread_mutex_lock(&profile_lock);
+    if (memcmp(&video, limits, sizeof(video))) {
+        video = *limits;
+        profile_apply();
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_PROFILE_H
+#define MTK_POWER_PROFILE_H
+
+/* Profile ids as sent by CMHW through POWER_HINT_SET_PROFILE */
+enum power_profile {
+    PROFILE_POWER_SAVE,
+    PROFILE_BALANCED,
+    PROFILE_HIGH_PERFORMANCE,
+    PROFILE_BIAS_POWER,
+    PROFILE_BIAS_PERFORMANCE,
+    PROFILE_MAX
+};
+
+/* Limits requested by active video sessions, 0 when unused */
+struct video_limits {
+    int max_freq;
+    int min_core;
+    int hevc_freq;
+};
+
+#define PROFILES_CONF "/system/etc/power_profiles.conf"
+
+void profile_init(void);
+int profile_count(void);
+void profile_set(int profile);
+void profile_set_interactive(int on);
+void profile_set_low_power(int on);
+void profile_set_pacing(int fps_cap, int rush_off);
+void profile_set_thermal(int rush_off);
+void profile_set_video(const struct video_limits *limits);
+
+#endif /* MTK_POWER_PROFILE_H */
@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+
+#include "boost.h"
+#include "stats.h"
+#include "thermal.h"
+#include "util.h"
+
+static const char *hint_names[STAT_HINT_COUNT] = {
+    [STAT_HINT_VSYNC]           = "vsync",
+    [STAT_HINT_INTERACTION]     = "interaction",
+    [STAT_HINT_VIDEO_ENCODE]    = "video_encode",
+    [STAT_HINT_VIDEO_DECODE]    = "video_decode",
+    [STAT_HINT_LOW_POWER]       = "low_power",
+    [STAT_HINT_CPU_BOOST]       = "cpu_boost",
+    [STAT_HINT_LAUNCH_BOOST]    = "launch_boost",
+    [STAT_HINT_AUDIO]           = "audio",
+    [STAT_HINT_SET_PROFILE]     = "set_profile",
+    [STAT_HINT_OTHER]           = "other",
+};
+
+static const char *boost_names[BOOST_LEVEL_COUNT] = {
+    [BOOST_NONE]        = "none",
+    [BOOST_INTERACTION] = "interaction",
+    [BOOST_CPU]         = "cpu",
+    [BOOST_LAUNCH]      = "launch",
+};
+
+static const char *thermal_names[THERMAL_STATE_COUNT] = {
+    [THERMAL_NORMAL]    = "normal",
+    [THERMAL_WARM]      = "warm",
+    [THERMAL_HOT]       = "hot",
+    [THERMAL_CRITICAL]  = "critical",
+};
+
+static struct power_stats local_stats = {
+    .magic = STATS_MAGIC,
+    .version = STATS_VERSION,
+    .num_nodes = NODE_COUNT,
+};
+static struct power_stats *stats = &local_stats;
+
+void stats_init(void)
+{
+    char path[PATH_MAX];
+    struct power_stats *s;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s%s", node_root(), STATS_FILE);
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ALOGW("Cannot open %s, keeping stats in memory: %s\n", path, strerror(errno));
+        return;
+    }
+
+    /* Start from zero on every HAL start */
+    if (ftruncate(fd, 0) < 0 || ftruncate(fd, sizeof(*s)) < 0) {
+        ALOGW("Cannot size %s: %s\n", path, strerror(errno));
+        close(fd);
+        return;
+    }
+
+    s = mmap(NULL, sizeof(*s), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (s == MAP_FAILED) {
+        ALOGW("Cannot map %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    s->magic = STATS_MAGIC;
+    s->version = STATS_VERSION;
+    s->num_nodes = NODE_COUNT;
+    stats = s;
+}
+
+static enum stat_hint stat_hint_index(power_hint_t hint)
+{
+    switch (hint) {
+        case POWER_HINT_VSYNC:          return STAT_HINT_VSYNC;
+        case POWER_HINT_INTERACTION:    return STAT_HINT_INTERACTION;
+        case POWER_HINT_VIDEO_ENCODE:   return STAT_HINT_VIDEO_ENCODE;
+        case POWER_HINT_VIDEO_DECODE:   return STAT_HINT_VIDEO_DECODE;
+        case POWER_HINT_LOW_POWER:      return STAT_HINT_LOW_POWER;
+        case POWER_HINT_CPU_BOOST:      return STAT_HINT_CPU_BOOST;
+        case POWER_HINT_LAUNCH_BOOST:   return STAT_HINT_LAUNCH_BOOST;
+        case POWER_HINT_AUDIO:          return STAT_HINT_AUDIO;
+        case POWER_HINT_SET_PROFILE:    return STAT_HINT_SET_PROFILE;
+        default:                        return STAT_HINT_OTHER;
+    }
+}
+
+static int hist_bucket(uint64_t ns)
+{
+    int b = ns ? 64 - __builtin_clzll(ns) : 0;
+
+    return b < STATS_BUCKETS ? b : STATS_BUCKETS - 1;
+}
+
+static void hist_add(struct stat_hist *h, int64_t ns)
+{
+    uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+    uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ns, v, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->buckets[hist_bucket(v)], 1, __ATOMIC_RELAXED);
+    while (v > max && !__atomic_compare_exchange_n(&h->max_ns, &max, v, 1,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+void stats_hint(power_hint_t hint, int64_t ns)
+{
+    hist_add(&stats->hints[stat_hint_index(hint)], ns);
+}
+
+void stats_handled(power_hint_t hint, int64_t ns)
+{
+    hist_add(&stats->handled[stat_hint_index(hint)], ns);
+}
+
+void stats_coalesced(power_hint_t hint)
+{
+    __atomic_fetch_add(&stats->coalesced[stat_hint_index(hint)], 1, __ATOMIC_RELAXED);
+}
+
+void stats_queue_full(void)
+{
+    __atomic_fetch_add(&stats->queue_full, 1, __ATOMIC_RELAXED);
+}
+
+void stats_wake(int64_t ns)
+{
+    hist_add(&stats->wake_to_frame, ns);
+}
+
+static void thermal_add(int hint, int state, int temp, int headroom,
+                        int requested, int granted)
+{
+    uint64_t seq = __atomic_add_fetch(&stats->thermal_seq, 1, __ATOMIC_RELAXED);
+    struct stat_thermal_event *e = &stats->thermal[(seq - 1) % STATS_THERMAL_EVENTS];
+
+    __atomic_store_n(&e->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->time_ns = now_ns();
+    e->temp = temp;
+    e->headroom = headroom;
+    e->hint = hint;
+    e->state = state;
+    e->requested = requested;
+    e->granted = granted;
+    __atomic_store_n(&e->seq, seq, __ATOMIC_RELEASE);
+}
+
+void stats_thermal(power_hint_t hint, int state, int temp, int headroom,
+                   int requested, int granted)
+{
+    thermal_add(stat_hint_index(hint), state, temp, headroom, requested, granted);
+}
+
+void stats_thermal_state(int state, int temp, int headroom)
+{
+    thermal_add(STAT_HINT_COUNT, state, temp, headroom, 0, 0);
+}
+
+void stats_write(enum power_node node, int64_t ns, int error)
+{
+    hist_add(&stats->nodes[node].latency, ns);
+    if (error)
+        __atomic_fetch_add(&stats->nodes[node].errors, 1, __ATOMIC_RELAXED);
+}
+
+void stats_write_skipped(enum power_node node)
+{
+    __atomic_fetch_add(&stats->nodes[node].skipped, 1, __ATOMIC_RELAXED);
+}
+
+/* Upper bound of the bucket holding the given percentile, in ns */
+static uint64_t hist_percentile(const struct stat_hist *h, int pct)
+{
+    uint64_t want = (h->count * pct + 99) / 100;
+    uint64_t seen = 0;
+    uint64_t bound;
+    int b;
+
+    for (b = 0; b < STATS_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= want) {
+            bound = b ? 1ULL << b : 0;
+            return bound < h->max_ns ? bound : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+static void hist_dump(FILE *f, const char *name, const struct stat_hist *h)
+{
+    int b;
+
+    if (!h->count)
+        return;
+
+    fprintf(f, "  %-20s %10llu %10.1f %10.1f %10.1f %10.1f\n", name,
+            (unsigned long long)h->count,
+            h->sum_ns / (double)h->count / 1000.0,
+            hist_percentile(h, 50) / 1000.0,
+            hist_percentile(h, 99) / 1000.0,
+            h->max_ns / 1000.0);
+    fprintf(f, "  %-20s", "");
+    for (b = 0; b < STATS_BUCKETS; b++) {
+        if (h->buckets[b])
+            fprintf(f, " <2^%d:%llu", b, (unsigned long long)h->buckets[b]);
+    }
+    fprintf(f, "\n");
+}
+
+static void thermal_dump(FILE *f, const struct power_stats *s)
+{
+    uint64_t head = __atomic_load_n(&s->thermal_seq, __ATOMIC_ACQUIRE);
+    uint64_t seq = head > STATS_THERMAL_EVENTS ? head - STATS_THERMAL_EVENTS + 1 : 1;
+    const struct stat_thermal_event *e;
+    struct stat_thermal_event copy;
+    int64_t now = now_ns();
+
+    fprintf(f, "Thermal decisions (last %d):\n", STATS_THERMAL_EVENTS);
+    fprintf(f, "  %10s %-14s %-9s %8s %9s %-12s %-12s\n", "age_s", "hint",
+            "state", "temp", "headroom", "requested", "granted");
+    for (; seq <= head; seq++) {
+        e = &s->thermal[(seq - 1) % STATS_THERMAL_EVENTS];
+        if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != seq)
+            continue;
+        copy = *e;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&e->seq, __ATOMIC_RELAXED) != seq ||
+                copy.state >= THERMAL_STATE_COUNT ||
+                copy.requested >= BOOST_LEVEL_COUNT ||
+                copy.granted >= BOOST_LEVEL_COUNT)
+            continue;
+
+        if (copy.hint >= STAT_HINT_COUNT)
+            fprintf(f, "  %10.3f %-14s %-9s %8.1f %9.1f\n",
+                    (now - copy.time_ns) / 1e9, "(state)",
+                    thermal_names[copy.state], copy.temp / 1000.0,
+                    copy.headroom / 1000.0);
+        else
+            fprintf(f, "  %10.3f %-14s %-9s %8.1f %9.1f %-12s %-12s\n",
+                    (now - copy.time_ns) / 1e9, hint_names[copy.hint],
+                    thermal_names[copy.state], copy.temp / 1000.0,
+                    copy.headroom / 1000.0, boost_names[copy.requested],
+                    boost_names[copy.granted]);
+    }
+}
+
+int stats_dump(const struct power_stats *s, int fd)
+{
+    FILE *f;
+    int i;
+
+    if (s->magic != STATS_MAGIC || s->version != STATS_VERSION ||
+            s->num_nodes != NODE_COUNT) {
+        dprintf(fd, "power HAL stats: layout mismatch\n");
+        return -1;
+    }
+
+    f = fdopen(dup(fd), "w");
+    if (f == NULL)
+        return -1;
+
+    fprintf(f, "Hints, caller side (latency in us, percentiles are log2 bucket bounds):\n");
+    fprintf(f, "  %-20s %10s %10s %10s %10s %10s\n", "hint", "count",
+            "mean", "p50", "p99", "max");
+    for (i = 0; i < STAT_HINT_COUNT; i++)
+        hist_dump(f, hint_names[i], &s->hints[i]);
+
+    fprintf(f, "Hints, handled by worker:\n");
+    fprintf(f, "  %-20s %10s %10s %10s %10s %10s\n", "hint", "count",
+            "mean", "p50", "p99", "max");
+    for (i = 0; i < STAT_HINT_COUNT; i++)
+        hist_dump(f, hint_names[i], &s->handled[i]);
+    fprintf(f, "  %-20s %10s\n", "hint", "coalesced");
+    for (i = 0; i < STAT_HINT_COUNT; i++) {
+        if (s->coalesced[i])
+            fprintf(f, "  %-20s %10llu\n", hint_names[i],
+                    (unsigned long long)s->coalesced[i]);
+    }
+    fprintf(f, "  queue full: %llu\n", (unsigned long long)s->queue_full);
+
+    fprintf(f, "Screen on:\n");
+    hist_dump(f, "wake_to_first_frame", &s->wake_to_frame);
+
+    thermal_dump(f, s);
+
+    fprintf(f, "Node writes:\n");
+    fprintf(f, "  %-20s %10s %10s %10s %10s %10s\n", "node", "writes",
+            "mean", "p50", "p99", "max");
+    for (i = 0; i < NODE_COUNT; i++)
+        hist_dump(f, node_name(i), &s->nodes[i].latency);
+    fprintf(f, "  %-20s %10s %10s\n", "node", "skipped", "errors");
+    for (i = 0; i < NODE_COUNT; i++) {
+        if (s->nodes[i].skipped || s->nodes[i].errors)
+            fprintf(f, "  %-20s %10llu %10llu\n", node_name(i),
+                    (unsigned long long)s->nodes[i].skipped,
+                    (unsigned long long)s->nodes[i].errors);
+    }
+
+    fclose(f);
+    return 0;
+}
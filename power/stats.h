@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_STATS_H
+#define MTK_POWER_STATS_H
+
+#include <stdint.h>
+
+#include <hardware/power.h>
+
+#include "nodes.h"
+
+/*
+ * Lock-free hint and node write statistics. Counters are only touched
+ * with relaxed atomics, so recording is a handful of uncontended adds.
+ *
+ * The counters live in a file mapping under /data/system so the
+ * powerhal_stats tool can read them from outside the HAL's host process
+ * without any IPC. If the file cannot be mapped they are kept in memory.
+ */
+#define STATS_FILE      "/data/system/power_hal.stats"
+#define STATS_MAGIC     0x50484c53  /* PHLS */
+#define STATS_VERSION   4
+
+/* Bucket b counts latencies in [2^(b-1), 2^b) ns, the last one is open */
+#define STATS_BUCKETS   32
+
+enum stat_hint {
+    STAT_HINT_VSYNC,
+    STAT_HINT_INTERACTION,
+    STAT_HINT_VIDEO_ENCODE,
+    STAT_HINT_VIDEO_DECODE,
+    STAT_HINT_LOW_POWER,
+    STAT_HINT_CPU_BOOST,
+    STAT_HINT_LAUNCH_BOOST,
+    STAT_HINT_AUDIO,
+    STAT_HINT_SET_PROFILE,
+    STAT_HINT_OTHER,
+    STAT_HINT_COUNT
+};
+
+struct stat_hist {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[STATS_BUCKETS];
+};
+
+/*
+ * Thermal arbitration decisions and state changes, kept in a ring of the
+ * last STATS_THERMAL_EVENTS entries. A slot's seq is cleared while it is
+ * being written, readers skip slots whose seq is not the one expected.
+ */
+#define STATS_THERMAL_EVENTS    64
+
+struct stat_thermal_event {
+    uint64_t seq;
+    int64_t time_ns;
+    int32_t temp;           /* millidegrees C, hottest zone */
+    int32_t headroom;       /* millidegrees left to its trip point */
+    uint8_t hint;           /* enum stat_hint, STAT_HINT_COUNT for state changes */
+    uint8_t state;          /* enum thermal_state */
+    uint8_t requested;      /* enum boost_level */
+    uint8_t granted;
+    uint32_t reserved;
+};
+
+struct stat_node {
+    struct stat_hist latency;
+    uint64_t skipped;
+    uint64_t errors;
+};
+
+/*
+ * hints[] is what powerHint() costs the caller, handled[] is the time the
+ * worker spends on each hint that survived coalescing. wake_to_frame is
+ * measured from setInteractive(1) to the first VSYNC on.
+ */
+struct power_stats {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_nodes;
+    uint32_t reserved;
+    struct stat_hist hints[STAT_HINT_COUNT];
+    struct stat_hist handled[STAT_HINT_COUNT];
+    uint64_t coalesced[STAT_HINT_COUNT];
+    uint64_t queue_full;
+    struct stat_hist wake_to_frame;
+    uint64_t thermal_seq;
+    struct stat_thermal_event thermal[STATS_THERMAL_EVENTS];
+    struct stat_node nodes[NODE_COUNT];
+};
+
+void stats_init(void);
+void stats_hint(power_hint_t hint, int64_t ns);
+void stats_handled(power_hint_t hint, int64_t ns);
+void stats_coalesced(power_hint_t hint);
+void stats_queue_full(void);
+void stats_wake(int64_t ns);
+void stats_thermal(power_hint_t hint, int state, int temp, int headroom,
+                   int requested, int granted);
+void stats_thermal_state(int state, int temp, int headroom);
+void stats_write(enum power_node node, int64_t ns, int error);
+void stats_write_skipped(enum power_node node);
+int stats_dump(const struct power_stats *stats, int fd);
+
+#endif /* MTK_POWER_STATS_H */
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+#include <cutils/properties.h>
+
+#include "boost.h"
+#include "looper.h"
+#include "nodes.h"
+#include "profile.h"
+#include "stats.h"
+#include "thermal.h"
+#include "util.h"
+
+#define MAX_ZONES       4
+#define MAX_TRIPS       16
+
+/* Poll faster once close to a trip point, the slope matters there */
+#define POLL_NS         (1000 * NSEC_PER_MSEC)
+#define POLL_HOT_NS     (250 * NSEC_PER_MSEC)
+
+/* Leaving a state needs this much more headroom than entering it */
+#define HYSTERESIS      2000
+
+/* Headroom in millidegrees at or below which each state is entered */
+static const int state_headroom[THERMAL_STATE_COUNT] = {
+    [THERMAL_NORMAL]    = INT_MAX,
+    [THERMAL_WARM]      = 10000,
+    [THERMAL_HOT]       = 5000,
+    [THERMAL_CRITICAL]  = 0,
+};
+
+/* Strongest boost granted in each state */
+static const enum boost_level state_cap[THERMAL_STATE_COUNT] = {
+    [THERMAL_NORMAL]    = BOOST_LAUNCH,
+    [THERMAL_WARM]      = BOOST_CPU,
+    [THERMAL_HOT]       = BOOST_INTERACTION,
+    [THERMAL_CRITICAL]  = BOOST_NONE,
+};
+
+static const char *state_names[THERMAL_STATE_COUNT] = {
+    [THERMAL_NORMAL]    = "normal",
+    [THERMAL_WARM]      = "warm",
+    [THERMAL_HOT]       = "hot",
+    [THERMAL_CRITICAL]  = "critical",
+};
+
+struct zone {
+    char path[PATH_MAX];
+    int fd;
+    int trip;
+};
+
+static struct zone zones[MAX_ZONES];
+static int num_zones;
+static int timer_fd = -1;
+
+/* Serializes arming the timer against the display state */
+static pthread_mutex_t thermal_lock = PTHREAD_MUTEX_INITIALIZER;
+static int display_on = 1;
+
+/* Written by the looper only, read by whoever arbitrates a boost */
+static int cur_state = THERMAL_NORMAL;
+static int cur_temp;
+static int cur_headroom = INT_MAX;
+
+static int read_file(const char *path, char *buf, size_t len)
+{
+    ssize_t n;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    n = read(fd, buf, len - 1);
+    close(fd);
+    if (n < 0)
+        return -1;
+    buf[n] = '\0';
+    return 0;
+}
+
+/*
+ * Lowest passive or hot trip point of the zone, falling back to the
+ * critical one. Active trips only start fans, they do not throttle.
+ */
+static int zone_trip(const char *dir)
+{
+    char path[PATH_MAX + 32];
+    char type[16], value[16];
+    int passive = INT_MAX, critical = INT_MAX;
+    int i, temp;
+
+    for (i = 0; i < MAX_TRIPS; i++) {
+        snprintf(path, sizeof(path), "%s/trip_point_%d_type", dir, i);
+        if (read_file(path, type, sizeof(type)) < 0)
+            break;
+        snprintf(path, sizeof(path), "%s/trip_point_%d_temp", dir, i);
+        if (read_file(path, value, sizeof(value)) < 0)
+            continue;
+        temp = atoi(value);
+        if (temp <= 0)
+            continue;
+
+        if (!strncmp(type, "passive", 7) || !strncmp(type, "hot", 3)) {
+            if (temp < passive)
+                passive = temp;
+        } else if (!strncmp(type, "critical", 8)) {
+            if (temp < critical)
+                critical = temp;
+        }
+    }
+
+    return passive != INT_MAX ? passive : critical;
+}
+
+static void zones_init(void)
+{
+    char prop[PROPERTY_VALUE_MAX];
+    char path[PATH_MAX + 8];
+    char *tok, *save;
+    struct zone *z;
+
+    property_get(THERMAL_ZONES_PROP, prop, THERMAL_ZONES_DEFAULT);
+    for (tok = strtok_r(prop, ",", &save); tok != NULL && num_zones < MAX_ZONES;
+            tok = strtok_r(NULL, ",", &save)) {
+        z = &zones[num_zones];
+        snprintf(z->path, sizeof(z->path), "%s%s", node_root(), tok);
+
+        z->trip = zone_trip(z->path);
+        if (z->trip == INT_MAX) {
+            ALOGW("No trip point in %s, ignoring it\n", z->path);
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/temp", z->path);
+        z->fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (z->fd < 0) {
+            ALOGW("Cannot open %s: %s\n", path, strerror(errno));
+            continue;
+        }
+
+        ALOGI("Thermal zone %s, trip at %d\n", z->path, z->trip);
+        num_zones++;
+    }
+}
+
+/* Smallest headroom to a trip point over all zones, INT_MAX if none read */
+static int zones_headroom(int *temp)
+{
+    int headroom = INT_MAX;
+    char buf[16];
+    ssize_t n;
+    int i, t;
+
+    for (i = 0; i < num_zones; i++) {
+        n = pread(zones[i].fd, buf, sizeof(buf) - 1, 0);
+        if (n <= 0)
+            continue;
+        buf[n] = '\0';
+        t = atoi(buf);
+        if (zones[i].trip - t < headroom) {
+            headroom = zones[i].trip - t;
+            *temp = t;
+        }
+    }
+    return headroom;
+}
+
+static int state_for(int headroom)
+{
+    int s = THERMAL_NORMAL;
+
+    while (s + 1 < THERMAL_STATE_COUNT && headroom <= state_headroom[s + 1])
+        s++;
+    return s;
+}
+
+/* Must be called with thermal_lock held. 0 disarms. */
+static void thermal_arm(int64_t ns)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = ns / NSEC_PER_SEC;
+    its.it_value.tv_nsec = ns % NSEC_PER_SEC;
+    if (timerfd_settime(timer_fd, 0, &its, NULL) < 0)
+        ALOGE("Error arming thermal timer: %s\n", strerror(errno));
+}
+
+/* Next poll, unless the screen went off while this one was running */
+static void thermal_rearm(int64_t ns)
+{
+    pthread_mutex_lock(&thermal_lock);
+    if (display_on)
+        thermal_arm(ns);
+    pthread_mutex_unlock(&thermal_lock);
+}
+
+static void thermal_poll(int fd, uint32_t events, void *data)
+{
+    uint64_t expirations;
+    int temp = 0, headroom, state;
+
+    if (read(fd, &expirations, sizeof(expirations)) < 0) {
+        /* Disarmed by thermal_set_display() while the expiry was queued */
+        if (errno != EAGAIN)
+            ALOGE("Error reading thermal timer: %s\n", strerror(errno));
+        return;
+    }
+
+    headroom = zones_headroom(&temp);
+    if (headroom == INT_MAX) {
+        thermal_rearm(POLL_NS);
+        return;
+    }
+
+    state = state_for(headroom);
+    if (state < cur_state) {
+        /* Cooling down only counts once past the hysteresis */
+        state = state_for(headroom - HYSTERESIS);
+        if (state > cur_state)
+            state = cur_state;
+    }
+
+    __atomic_store_n(&cur_temp, temp, __ATOMIC_RELAXED);
+    __atomic_store_n(&cur_headroom, headroom, __ATOMIC_RELAXED);
+
+    if (state != cur_state) {
+        ALOGI("Thermal state %s -> %s at %d, %d to trip\n", state_names[cur_state],
+                state_names[state], temp, headroom);
+        __atomic_store_n(&cur_state, state, __ATOMIC_RELAXED);
+        stats_thermal_state(state, temp, headroom);
+
+        /* Softer boosts now rather than the kernel's hard throttle later */
+        profile_set_thermal(state >= THERMAL_HOT);
+        boost_set_max_level(state_cap[state]);
+    }
+
+    thermal_rearm(state == THERMAL_NORMAL ? POLL_NS : POLL_HOT_NS);
+}
+
+int thermal_init(void)
+{
+    zones_init();
+    if (num_zones == 0) {
+        ALOGW("No usable thermal zone, boosts are not arbitrated\n");
+        return -1;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        ALOGE("Error creating thermal timer: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (looper_add(timer_fd, EPOLLIN, thermal_poll, NULL) < 0) {
+        close(timer_fd);
+        timer_fd = -1;
+        return -1;
+    }
+
+    /* First reading as soon as the looper runs */
+    thermal_rearm(1);
+    return 0;
+}
+
+/*
+ * Nothing boosts with the screen off, so polling stops. The state is kept
+ * and refreshed right away on the next screen on. A poll already running
+ * on the looper sees the new display state before it re-arms.
+ */
+void thermal_set_display(int on)
+{
+    if (timer_fd < 0)
+        return;
+
+    pthread_mutex_lock(&thermal_lock);
+    display_on = !!on;
+    thermal_arm(on ? 1 : 0);
+    pthread_mutex_unlock(&thermal_lock);
+}
+
+enum boost_level thermal_arbitrate(power_hint_t hint, enum boost_level level)
+{
+    int state = __atomic_load_n(&cur_state, __ATOMIC_RELAXED);
+    enum boost_level granted = level;
+
+    /* No zone to go by */
+    if (timer_fd < 0)
+        return level;
+
+    if (granted > state_cap[state])
+        granted = state_cap[state];
+
+    stats_thermal(hint, state, __atomic_load_n(&cur_temp, __ATOMIC_RELAXED),
+            __atomic_load_n(&cur_headroom, __ATOMIC_RELAXED), level, granted);
+    return granted;
+}
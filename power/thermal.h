@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_THERMAL_H
+#define MTK_POWER_THERMAL_H
+
+#include <hardware/power.h>
+
+#include "boost.h"
+
+/*
+ * Thermal arbitration for boosts. The zones listed in the
+ * ro.power.thermal_zones property (comma separated thermal_zone
+ * directories, resolved against the sysfs root) are polled from the
+ * looper while the screen is on, and the smallest headroom to a passive
+ * or hot trip point picks the thermal state:
+ *
+ *   normal    boosts are granted as requested
+ *   warm      boosts are scaled down to at most BOOST_CPU
+ *   hot       boosts are scaled down to BOOST_INTERACTION, no rush boost
+ *   critical  boosts are refused
+ *
+ * Boosts already running are clamped when the state gets stricter. Each
+ * decision and state change goes to the ring in the stats file.
+ */
+#define THERMAL_ZONES_PROP      "ro.power.thermal_zones"
+#define THERMAL_ZONES_DEFAULT   "/sys/class/thermal/thermal_zone0"
+
+enum thermal_state {
+    THERMAL_NORMAL,
+    THERMAL_WARM,
+    THERMAL_HOT,
+    THERMAL_CRITICAL,
+    THERMAL_STATE_COUNT
+};
+
+int thermal_init(void);
+void thermal_set_display(int on);
+enum boost_level thermal_arbitrate(power_hint_t hint, enum boost_level level);
+
+#endif /* MTK_POWER_THERMAL_H */
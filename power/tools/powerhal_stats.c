@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Prints the power HAL statistics straight from the shared stats file,
+ * without going through the HAL's host process.
+ *
+ * Usage: powerhal_stats [stats file]
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "stats.h"
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : STATS_FILE;
+    const struct power_stats *stats;
+    struct stat st;
+    int fd, ret;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(*stats)) {
+        fprintf(stderr, "%s is not a power HAL stats file\n", path);
+        close(fd);
+        return 1;
+    }
+
+    stats = mmap(NULL, sizeof(*stats), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (stats == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    ret = stats_dump(stats, STDOUT_FILENO);
+    munmap((void *)stats, sizeof(*stats));
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define LOG_TAG "MTK PowerHAL"
+#include <utils/Log.h>
+
+#include "profile.h"
+#include "video.h"
+
+#define MAX_SESSIONS    8
+#define UHD_PIXELS      (2560 * 1440)
+
+enum video_codec {
+    CODEC_UNKNOWN,
+    CODEC_AVC,
+    CODEC_HEVC,
+    CODEC_VP9,
+    CODEC_COUNT
+};
+
+struct video_session {
+    int encode;
+    enum video_codec codec;
+    int uhd;
+};
+
+/*
+ * Ceiling, LL core floor and HEVC floor per codec and resolution class.
+ * Decoding is done by the VDEC block, the CPU only has to keep up with
+ * parsing and composition, so the ceilings sit well below the big
+ * cluster's top OPPs. Unknown codecs get a core floor but no ceiling.
+ */
+struct video_policy {
+    struct video_limits limits[2];  /* [uhd] */
+};
+
+static const struct video_policy decode_policy[CODEC_COUNT] = {
+    [CODEC_UNKNOWN] = { { { 0, 2, 0 },             { 0, 2, 0 } } },
+    [CODEC_AVC]     = { { { 1144000, 2, 0 },       { 1495000, 3, 0 } } },
+    [CODEC_HEVC]    = { { { 1248000, 2, 806000 },  { 1625000, 4, 1014000 } } },
+    [CODEC_VP9]     = { { { 1495000, 3, 0 },       { 1781000, 4, 0 } } },
+};
+
+static const struct video_policy encode_policy[CODEC_COUNT] = {
+    [CODEC_UNKNOWN] = { { { 0, 2, 0 },             { 0, 4, 0 } } },
+    [CODEC_AVC]     = { { { 1495000, 2, 0 },       { 1781000, 4, 0 } } },
+    [CODEC_HEVC]    = { { { 1625000, 3, 1014000 }, { 1781000, 4, 1014000 } } },
+    [CODEC_VP9]     = { { { 1625000, 3, 0 },       { 1781000, 4, 0 } } },
+};
+
+static struct video_session sessions[MAX_SESSIONS];
+static int num_sessions;
+static pthread_mutex_t video_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static enum video_codec parse_codec(const char *value)
+{
+    /* Accept both bare names and mime types, e.g. "video/hevc" */
+    if (strcasestr(value, "hevc") || strcasestr(value, "265"))
+        return CODEC_HEVC;
+    if (strcasestr(value, "avc") || strcasestr(value, "264"))
+        return CODEC_AVC;
+    if (strcasestr(value, "vp9"))
+        return CODEC_VP9;
+    return CODEC_UNKNOWN;
+}
+
+/* Returns the value of state=, or -1 when the payload has none */
+static int parse_payload(const char *payload, struct video_session *s)
+{
+    char buf[128];
+    char *tok, *save, *eq;
+    int state = -1;
+    long width = 0, height = 0;
+
+    strlcpy(buf, payload, sizeof(buf));
+    for (tok = strtok_r(buf, ";, ", &save); tok != NULL;
+            tok = strtok_r(NULL, ";, ", &save)) {
+        eq = strchr(tok, '=');
+        if (eq == NULL)
+            continue;
+        *eq++ = '\0';
+        if (!strcmp(tok, "state"))
+            state = atoi(eq);
+        else if (!strcmp(tok, "codec") || !strcmp(tok, "mime"))
+            s->codec = parse_codec(eq);
+        else if (!strcmp(tok, "width"))
+            width = strtol(eq, NULL, 10);
+        else if (!strcmp(tok, "height"))
+            height = strtol(eq, NULL, 10);
+    }
+
+    s->uhd = width * height > UHD_PIXELS;
+    return state;
+}
+
+static int limit_max(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+/* Must be called with video_lock held. */
+static void video_update(void)
+{
+    struct video_limits merged = { 0, 0, 0 };
+    const struct video_limits *l;
+    int unlimited = 0;
+    int i;
+
+    /* The most demanding session decides, an unlimited one lifts the cap */
+    for (i = 0; i < num_sessions; i++) {
+        l = &(sessions[i].encode ? encode_policy : decode_policy)
+                [sessions[i].codec].limits[sessions[i].uhd];
+        if (l->max_freq == 0)
+            unlimited = 1;
+        merged.max_freq = limit_max(merged.max_freq, l->max_freq);
+        merged.min_core = limit_max(merged.min_core, l->min_core);
+        merged.hevc_freq = limit_max(merged.hevc_freq, l->hevc_freq);
+    }
+    if (unlimited)
+        merged.max_freq = 0;
+
+    profile_set_video(&merged);
+}
+
+/* Must be called with video_lock held. */
+static void video_start(const struct video_session *s)
+{
+    if (num_sessions == MAX_SESSIONS) {
+        ALOGW("Too many video sessions, ignoring new one\n");
+        return;
+    }
+    sessions[num_sessions++] = *s;
+}
+
+/*
+ * Must be called with video_lock held. Closes the most recent matching
+ * session; stop hints usually carry nothing but state=0, so an unknown
+ * codec matches any session in the same direction.
+ */
+static void video_stop(const struct video_session *s)
+{
+    int i;
+
+    for (i = num_sessions - 1; i >= 0; i--) {
+        if (sessions[i].encode != s->encode)
+            continue;
+        if (s->codec != CODEC_UNKNOWN && sessions[i].codec != s->codec)
+            continue;
+        memmove(&sessions[i], &sessions[i + 1],
+                (num_sessions - i - 1) * sizeof(sessions[0]));
+        num_sessions--;
+        return;
+    }
+    ALOGW("Video %s stop without matching start\n", s->encode ? "encode" : "decode");
+}
+
+void video_hint(int encode, const char *payload)
+{
+    struct video_session s;
+    int state;
+
+    if (payload == NULL)
+        return;
+
+    memset(&s, 0, sizeof(s));
+    s.encode = encode;
+    state = parse_payload(payload, &s);
+    if (state < 0)
+        return;
+
+    pthread_mutex_lock(&video_lock);
+    if (state)
+        video_start(&s);
+    else
+        video_stop(&s);
+    video_update();
+    pthread_mutex_unlock(&video_lock);
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2016 CyanogenMod
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MTK_POWER_VIDEO_H
+#define MTK_POWER_VIDEO_H
+
+/*
+ * POWER_HINT_VIDEO_ENCODE/DECODE handling. The payload is a key=value
+ * string such as "state=1;codec=hevc;width=3840;height=2160"; only state
+ * is mandatory. Every state=1 opens a session and every state=0 closes
+ * one, and the limits of all open sessions are merged.
+ */
+void video_hint(int encode, const char *payload);
+
+#endif /* MTK_POWER_VIDEO_H */
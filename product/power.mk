@@ -6,3 +6,9 @@ PRODUCT_PACKAGES += \
 PRODUCT_PACKAGES += \
     power.default \
     power.mt6755
+
+PRODUCT_COPY_FILES += \
+    $(LOCAL_PATH)/configs/power_profiles.conf:system/etc/power_profiles.conf
+
+PRODUCT_PACKAGES_DEBUG += \
+    powerhal_stats